@@ -4,6 +4,7 @@
 
 #include "mycommon.h"
 #include "mex_settings.h"
+#include "metro/MetroContext.h"
 
 int main(int argc, char *argv[]) {
     QApplication a(argc, argv);
@@ -17,6 +18,8 @@ int main(int argc, char *argv[]) {
         MEXSettings::Get().InitDefaults();
     }
 
+    MetroContext::Get().GetTexturesDB().SetIndexCacheFolder(folder);
+
     MainWindow w;
     w.show();
     const int execResult = a.exec();
@@ -1156,6 +1156,12 @@ void MainWindow::EnsureExtractionOptions() {
     mExtractionCtx.txUseBC3 = (s.extraction.textureFormat == MEXSettings::Extraction::TexFormat::LegacyDds);
     mExtractionCtx.txSaveAsTga = (s.extraction.textureFormat == MEXSettings::Extraction::TexFormat::Tga);
     mExtractionCtx.txSaveAsPng = (s.extraction.textureFormat == MEXSettings::Extraction::TexFormat::Png);
+    switch (s.extraction.texturePngLevel) {
+        case MEXSettings::Extraction::PngLevel::Store:   mExtractionCtx.txPngLevel = scast<int>(PngCompression::Store); break;
+        case MEXSettings::Extraction::PngLevel::Default: mExtractionCtx.txPngLevel = scast<int>(PngCompression::Default); break;
+        case MEXSettings::Extraction::PngLevel::Best:    mExtractionCtx.txPngLevel = scast<int>(PngCompression::Best); break;
+        default:                                         mExtractionCtx.txPngLevel = scast<int>(PngCompression::Fast); break;
+    }
     // sounds
     mExtractionCtx.sndSaveAsOgg = (s.extraction.soundFormat == MEXSettings::Extraction::SndFormat::Ogg);
     mExtractionCtx.sndSaveAsWav = (s.extraction.soundFormat == MEXSettings::Extraction::SndFormat::Wav);
@@ -1295,6 +1301,25 @@ bool MainWindow::ExtractFile(const FileExtractionCtx& ctx, const fs::path& outPa
     return result;
 }
 
+// the folder export saves its batch loaded textures through here too, so both write the very same files
+static bool SaveTextureAs(MetroTexture& texture, const FileExtractionCtx& ctx, const fs::path& filePath) {
+    bool result = false;
+
+    if (ctx.txSaveAsDds) {
+        if (ctx.txUseBC3) {
+            result = texture.SaveAsLegacyDDS(filePath);
+        } else {
+            result = texture.SaveAsDDS(filePath);
+        }
+    } else if (ctx.txSaveAsTga) {
+        result = texture.SaveAsTGA(filePath);
+    } else {
+        result = texture.SaveAsPNG(filePath, ctx.txPngLevel);
+    }
+
+    return result;
+}
+
 bool MainWindow::ExtractTexture(const FileExtractionCtx& ctx, const fs::path& outPath) {
     bool result = false;
 
@@ -1331,17 +1356,7 @@ bool MainWindow::ExtractTexture(const FileExtractionCtx& ctx, const fs::path& ou
 
             MetroTexture texture;
             if (texture.LoadFromData(stream, fileName)) {
-                if (ctx.txSaveAsDds) {
-                    if (ctx.txUseBC3) {
-                        result = texture.SaveAsLegacyDDS(resultPath);
-                    } else {
-                        result = texture.SaveAsDDS(resultPath);
-                    }
-                } else if (ctx.txSaveAsTga) {
-                    result = texture.SaveAsTGA(resultPath);
-                } else {
-                    result = texture.SaveAsPNG(resultPath);
-                }
+                result = SaveTextureAs(texture, ctx, resultPath);
             }
         }
     }
@@ -1496,8 +1511,8 @@ bool MainWindow::ExtractModel(const FileExtractionCtx& ctx, const fs::path& outP
                     CharString textureName = gd.model->GetMaterialString(MetroModelBase::kMaterialStringTexture);
 
                     if (settings.extraction.modelSaveSurfaceSet) {
-                        MetroSurfaceDescription surface = MetroContext::Get().GetTexturesDB().GetSurfaceSetFromName(textureName, false);
-                        this->ExtractSurfaceSet(ctx, surface, folderPath);
+                        const RefPtr<const MetroSurfaceDescription> surface = MetroContext::Get().GetTexturesDB().GetSurfaceSetFromName(textureName, false);
+                        this->ExtractSurfaceSet(ctx, *surface, folderPath);
                     } else {
                         const CharString& sourceName = MetroContext::Get().GetTexturesDB().GetSourceName(textureName);
                         this->TextureSaveHelper(folderPath, ctx, sourceName);
@@ -1623,6 +1638,10 @@ bool MainWindow::ExtractLocalization(const FileExtractionCtx& ctx, const fs::pat
     return result;
 }
 
+// legacy crunched textures are loaded in batches, all the mips of all of them transcoded at once to keep all the cores busy,
+//  then every one is saved with SaveTextureAs, exactly like a single texture export
+static const size_t kCrunchedBatchSize = 32;
+
 bool MainWindow::ExtractFolderComplete(const FileExtractionCtx& ctx, const fs::path& outPath) {
     bool result = false;
 
@@ -1632,6 +1651,35 @@ bool MainWindow::ExtractFolderComplete(const FileExtractionCtx& ctx, const fs::p
     fs::path curPath = outPath / folderName;
     fs::create_directories(curPath);
 
+    const bool batchCrunched = !ctx.raw && (MetroContext::Get().GetGameVersion() <= MetroGameVersion::Redux);
+    MyArray<MemStream> crunchedStreams;
+    MyArray<FileExtractionCtx> crunchedCtxs;
+    MyArray<fs::path> crunchedPaths;
+    MyArray<MetroTexture::CrunchedLoadJob> crunchedJobs;
+
+    auto flushCrunchedTextures = [&]() {
+        MyArray<MetroTexture> textures(crunchedJobs.size());
+        for (size_t i = 0; i < crunchedJobs.size(); ++i) {
+            crunchedJobs[i].texture = &textures[i];
+        }
+
+        MetroTexture::LoadCrunchedBatch(crunchedJobs);
+
+        for (size_t i = 0; i < crunchedJobs.size(); ++i) {
+            if (crunchedJobs[i].success) {
+                SaveTextureAs(textures[i], crunchedCtxs[i], crunchedPaths[i]);
+            } else {
+                // not something the batch can load, let the single texture path deal with it
+                this->ExtractTexture(crunchedCtxs[i], crunchedPaths[i]);
+            }
+        }
+
+        crunchedStreams.clear();
+        crunchedCtxs.clear();
+        crunchedPaths.clear();
+        crunchedJobs.clear();
+    };
+
     FileExtractionCtx tmpCtx = ctx;
     for (MyHandle child = mfs.GetFirstChild(ctx.file.fileHandle); child != kInvalidHandle; child = mfs.GetNextChild(child)) {
         tmpCtx.file = MetroFSPath(child);
@@ -1649,7 +1697,21 @@ bool MainWindow::ExtractFolderComplete(const FileExtractionCtx& ctx, const fs::p
                 fs::path filePath = curPath / this->MakeFileOutputName(child, tmpCtx);
                 switch (tmpCtx.type) {
                     case FileType::Texture: {
-                        this->ExtractTexture(tmpCtx, filePath);
+                        const CharString& fileName = mfs.GetName(tmpCtx.file);
+                        const bool isCrunched = batchCrunched && StrEndsWith(fileName, "c");
+                        MemStream stream = isCrunched ? mfs.OpenFileStream(tmpCtx.file) : MemStream();
+
+                        if (stream) {
+                            crunchedJobs.push_back({ stream.GetDataAtCursor(), stream.Remains(), fileName, nullptr, false });
+                            crunchedStreams.emplace_back(std::move(stream));
+                            crunchedCtxs.push_back(tmpCtx);
+                            crunchedPaths.push_back(filePath);
+                            if (crunchedJobs.size() >= kCrunchedBatchSize) {
+                                flushCrunchedTextures();
+                            }
+                        } else {
+                            this->ExtractTexture(tmpCtx, filePath);
+                        }
                     } break;
 
                     case FileType::Model: {
@@ -1682,6 +1744,8 @@ bool MainWindow::ExtractFolderComplete(const FileExtractionCtx& ctx, const fs::p
         }
     }
 
+    flushCrunchedTextures();
+
     result = true;
 
     return result;
@@ -73,6 +73,7 @@ struct FileExtractionCtx {
     bool        txSaveAsDds;
     bool        txSaveAsTga;
     bool        txSaveAsPng;
+    int         txPngLevel;
     // sounds
     bool        sndSaveAsOgg;
     bool        sndSaveAsWav;
@@ -0,0 +1,277 @@
+#include "ModelAOBenchmark.h"
+#include "ModelAOCalculator.h"
+#include "metro/MetroModel.h"
+#include "jansson.h"
+
+#include <tbb/tbb.h>
+#include <chrono>
+#include <cmath>
+
+
+static float Bench_BumpsHeight(const float x, const float z) {
+    return 0.8f * std::sin(x * 1.3f) * std::cos(z * 1.1f) + 0.3f * std::sin(x * 4.1f + z * 3.7f);
+}
+
+static double Bench_GetMeanAO(const RefPtr<MetroModelBase>& model) {
+    MyArray<MetroModelGeomData> gds;
+    model->CollectGeomData(gds);
+
+    double sum = 0.0;
+    size_t count = 0;
+    for (const MetroModelGeomData& gd : gds) {
+        for (size_t i = 0; i < gd.mesh->verticesCount; ++i) {
+            const uint32_t n = (gd.mesh->vertexType == MetroVertexType::Skin) ?
+                rcast<const VertexSkinned*>(gd.vertices)[i].normal :
+                rcast<const VertexStatic*>(gd.vertices)[i].normal;
+            sum += DecodeNormal(n).w;
+        }
+        count += gd.mesh->verticesCount;
+    }
+
+    return count ? sum / scast<double>(count) : 0.0;
+}
+
+// The tracer before the packets, one rtcOccluded1 per sample and every sample is traced. Only the reference now,
+//  ignores maxDistance and adaptive.
+static float Bench_CalcAOForPointSingle(const vec3& pos, const vec3& normal, const MyArray<vec3>& samples, RTCScene embreeScene) {
+    float occlusion = 0.0f;
+
+    vec3 tangent, bitangent;
+    OrthonormalBasis(normal, tangent, bitangent);
+    mat3 tbn(tangent, bitangent, normal);
+
+    for (const vec3& s : samples) {
+        vec3 sample = tbn * s;
+
+        RTCRay ray = {};
+        ray.mask = kInvalidValue32;
+        ray.flags = 0;
+        ray.time = 0.0f;
+        ray.org_x = pos.x;
+        ray.org_y = pos.y;
+        ray.org_z = pos.z;
+        ray.dir_x = sample.x;
+        ray.dir_y = sample.y;
+        ray.dir_z = sample.z;
+        ray.tnear = kAORayStartBias;
+        ray.tfar = std::numeric_limits<float>::max();
+
+        rtcOccluded1(embreeScene, &ray);
+        if (ray.tfar <= ray.tnear) { // hit
+            occlusion += 1.0f;
+        }
+    }
+
+    return Clamp(1.0f - (occlusion / scast<float>(samples.size())), 0.0f, 1.0f);
+}
+
+// same steps as CalculateModelAO, with the single rays tracer
+static bool Bench_CalculateModelAOSingle(RefPtr<MetroModelBase>& model, const size_t quality, ModelAOStats& stats) {
+    model->MakeGeometryUnique();
+
+    MyArray<MetroModelGeomData> gds;
+    model->CollectGeomData(gds);
+
+    AOEmbreeScene aoScene;
+    BuildAOEmbreeScene(gds, aoScene);
+    RTCScene embreeScene = aoScene.scene;
+
+    const size_t numSamples = GetAONumSamples(std::min<size_t>(quality, 3));
+    const MyArray<vec3> samples = MakeProgressiveSamples(numSamples);
+
+    stats = ModelAOStats();
+    const auto timeStart = std::chrono::high_resolution_clock::now();
+
+    for (size_t gdIdx = 0; gdIdx < gds.size(); ++gdIdx) {
+        MetroModelGeomData& gd = gds[gdIdx];
+        const MyArray<EmbreeVertex>& vertices = aoScene.vertexBuffers[gdIdx];
+        const bool isSkin = gd.mesh->vertexType == MetroVertexType::Skin;
+
+        MyArray<float> aos(gd.mesh->verticesCount);
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, gd.mesh->verticesCount),
+            [&gd, isSkin, &vertices, &aos, &samples, embreeScene](const tbb::blocked_range<size_t>& r) {
+                for (size_t i = r.begin(); i < r.end(); ++i) {
+                    const uint32_t encoded = isSkin ? rcast<const VertexSkinned*>(gd.vertices)[i].normal : rcast<const VertexStatic*>(gd.vertices)[i].normal;
+                    aos[i] = Bench_CalcAOForPointSingle(vec3(vertices[i].pos), vec3(DecodeNormal(encoded)), samples, embreeScene);
+                }
+            });
+
+        AverageAO(gd, aos);
+
+        stats.numVertices += gd.mesh->verticesCount;
+        stats.numRays += scast<size_t>(gd.mesh->verticesCount) * numSamples;
+    }
+
+    const auto timeEnd = std::chrono::high_resolution_clock::now();
+    stats.seconds = std::chrono::duration<double>(timeEnd - timeStart).count();
+    stats.numRaysMax = stats.numRays;
+
+    ReleaseAOEmbreeScene(aoScene);
+
+    return true;
+}
+
+
+ModelAOBenchmark::ModelAOBenchmark() {
+}
+ModelAOBenchmark::~ModelAOBenchmark() {
+}
+
+void ModelAOBenchmark::AddModel(const CharString& name, const RefPtr<MetroModelBase>& model) {
+    if (model) {
+        mSetups.push_back({ name, model });
+    }
+}
+
+void ModelAOBenchmark::AddSyntheticModel(const size_t gridSize) {
+    if (gridSize < 2 || gridSize > 255) {
+        return;
+    }
+
+    constexpr float kSize = 10.0f;
+    const float step = kSize / scast<float>(gridSize - 1);
+
+    MyArray<VertexStatic> vertices(gridSize * gridSize);
+    for (size_t y = 0; y < gridSize; ++y) {
+        for (size_t x = 0; x < gridSize; ++x) {
+            const float fx = scast<float>(x) * step, fz = scast<float>(y) * step;
+            const float dx = Bench_BumpsHeight(fx + step, fz) - Bench_BumpsHeight(fx - step, fz);
+            const float dz = Bench_BumpsHeight(fx, fz + step) - Bench_BumpsHeight(fx, fz - step);
+
+            VertexStatic& v = vertices[y * gridSize + x];
+            v = {};
+            v.pos = vec3(fx, Bench_BumpsHeight(fx, fz), fz);
+            v.normal = EncodeNormal(Normalize(vec3(-dx, 2.0f * step, -dz)), 1.0f);
+            v.uv = vec2(scast<float>(x), scast<float>(y)) / scast<float>(gridSize - 1);
+        }
+    }
+
+    MyArray<MetroFace> faces;
+    faces.reserve((gridSize - 1) * (gridSize - 1) * 2);
+    for (size_t y = 0; y + 1 < gridSize; ++y) {
+        for (size_t x = 0; x + 1 < gridSize; ++x) {
+            const uint16_t i0 = scast<uint16_t>(y * gridSize + x);
+            const uint16_t i1 = scast<uint16_t>(i0 + 1);
+            const uint16_t i2 = scast<uint16_t>(i0 + gridSize);
+            const uint16_t i3 = scast<uint16_t>(i2 + 1);
+            faces.push_back({ i0, i2, i1 });
+            faces.push_back({ i1, i2, i3 });
+        }
+    }
+
+    AABBox bbox;
+    bbox.minimum = vec3(0.0f, -1.1f, 0.0f);
+    bbox.maximum = vec3(kSize, 1.1f, kSize);
+
+    RefPtr<MetroModelStd> mesh = MakeRefPtr<MetroModelStd>();
+    mesh->CreateMesh(vertices.size(), faces.size(), 0, 0);
+    mesh->CopyVerticesData(vertices.data());
+    mesh->CopyFacesData(faces.data());
+    mesh->SetBBox(bbox);
+
+    RefPtr<MetroModelHierarchy> model = MakeRefPtr<MetroModelHierarchy>();
+    model->AddChild(mesh);
+    model->SetBBox(bbox);
+
+    this->AddModel("bumps_" + std::to_string(gridSize), model);
+}
+
+void ModelAOBenchmark::AddDefaultSyntheticModels() {
+    this->AddSyntheticModel(128);
+}
+
+size_t ModelAOBenchmark::GetNumModels() const {
+    return mSetups.size();
+}
+
+size_t ModelAOBenchmark::Run(const size_t quality, const size_t numIterations) {
+    mResults.clear();
+
+    struct Path {
+        const char* name;
+        bool        singleRays;
+        bool        adaptive;
+        bool        distance;
+    };
+
+    const Path paths[] = {
+        { "occluded1",          true,  false, false },
+        { "packet8",            false, false, false },
+        { "packet8_adaptive",   false, true,  false },
+        { "packet8_distance",   false, false, true  },
+    };
+
+    for (const Setup& setup : mSetups) {
+        RefPtr<MetroModelBase> model = setup.model;
+        double baselineSeconds = 0.0;
+
+        for (const Path& path : paths) {
+            ModelAOParams params;
+            params.quality = quality;
+            params.adaptive = path.adaptive;
+            // a quarter of the bbox diagonal keeps most of the hits in range
+            params.maxDistance = path.distance ? Length(model->GetBBox().Extent()) * 0.5f : 0.0f;
+
+            ModelAOStats best;
+            bool ok = true;
+            for (size_t iteration = 0; ok && iteration < std::max<size_t>(1, numIterations); ++iteration) {
+                ModelAOStats stats;
+                ok = path.singleRays ? Bench_CalculateModelAOSingle(model, quality, stats) : CalculateModelAO(model, params, &stats);
+                if (ok && (iteration == 0 || stats.seconds < best.seconds)) {
+                    best = stats;
+                }
+            }
+
+            if (!ok) {
+                LogPrintF(LogLevel::Warning, "AO benchmark: %s failed on %s", path.name, setup.name.c_str());
+                continue;
+            }
+
+            if (path.singleRays) {
+                baselineSeconds = best.seconds;
+            }
+
+            ModelAOBenchResult result = {};
+            result.model = setup.name;
+            result.path = path.name;
+            result.numVertices = best.numVertices;
+            result.numSamples = best.numVertices ? best.numRaysMax / best.numVertices : 0;
+            result.numRays = best.numRays;
+            result.seconds = best.seconds;
+            result.mraysPerSec = (best.seconds > 0.0) ? (scast<double>(best.numRays) / best.seconds) * 1e-6 : 0.0;
+            result.speedup = (best.seconds > 0.0 && baselineSeconds > 0.0) ? baselineSeconds / best.seconds : 0.0;
+            result.aoMean = Bench_GetMeanAO(model);
+
+            mResults.emplace_back(std::move(result));
+        }
+    }
+
+    return mResults.size();
+}
+
+const MyArray<ModelAOBenchResult>& ModelAOBenchmark::GetResults() const {
+    return mResults;
+}
+
+json_t* ModelAOBenchmark::ToJsonTree() const {
+    json_t* root = json_object();
+    json_t* results = json_array();
+
+    for (const ModelAOBenchResult& r : mResults) {
+        json_t* jr = json_object();
+        json_object_set_new(jr, "model", json_string(r.model.c_str()));
+        json_object_set_new(jr, "path", json_string(r.path.c_str()));
+        json_object_set_new(jr, "vertices", json_integer(scast<json_int_t>(r.numVertices)));
+        json_object_set_new(jr, "samples", json_integer(scast<json_int_t>(r.numSamples)));
+        json_object_set_new(jr, "rays", json_integer(scast<json_int_t>(r.numRays)));
+        json_object_set_new(jr, "seconds", json_real(r.seconds));
+        json_object_set_new(jr, "mrays_s", json_real(r.mraysPerSec));
+        json_object_set_new(jr, "speedup", json_real(r.speedup));
+        json_object_set_new(jr, "ao_mean", json_real(r.aoMean));
+        json_array_append_new(results, jr);
+    }
+
+    json_object_set_new(root, "results", results);
+
+    return root;
+}
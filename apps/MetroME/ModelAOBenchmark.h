@@ -0,0 +1,49 @@
+#pragma once
+#include "mycommon.h"
+
+class MetroModelBase;
+struct json_t;
+
+// Bakes vertex AO into the same models with the old tracer (one rtcOccluded1 per sample) and the packet one,
+//  plain, adaptive and distance weighted. Rays/s tells how much faster every ray got, the time how much the whole
+//  bake saves, the mean AO shows the paths agree (samples get a new random shift every bake, so it's not bit exact).
+
+struct ModelAOBenchResult {
+    CharString  model;
+    CharString  path;           // occluded1, packet8, packet8_adaptive, packet8_distance
+    size_t      numVertices;
+    size_t      numSamples;     // per vertex, before the adaptive mode stops early
+    size_t      numRays;        // actually traced
+    double      seconds;        // best of all iterations
+    double      mraysPerSec;
+    double      speedup;        // bake time vs occluded1
+    double      aoMean;
+};
+
+class ModelAOBenchmark {
+public:
+    ModelAOBenchmark();
+    ~ModelAOBenchmark();
+
+    void                                AddModel(const CharString& name, const RefPtr<MetroModelBase>& model);
+    // rolling bumps heightfield of gridSize x gridSize vertices, mostly partially occluded
+    void                                AddSyntheticModel(const size_t gridSize);
+    void                                AddDefaultSyntheticModels();
+    size_t                              GetNumModels() const;
+
+    // quality as in ModelAOParams, returns number of successful runs (models x paths)
+    size_t                              Run(const size_t quality, const size_t numIterations = 1);
+
+    const MyArray<ModelAOBenchResult>&  GetResults() const;
+    json_t*                             ToJsonTree() const;
+
+private:
+    struct Setup {
+        CharString              name;
+        RefPtr<MetroModelBase>  model;
+    };
+
+private:
+    MyArray<Setup>                      mSetups;
+    MyArray<ModelAOBenchResult>         mResults;
+};
@@ -1,25 +1,21 @@
+#include "ModelAOCalculator.h"
 #include "metro/MetroModel.h"
+#include "metro/MetroTexture.h"
 #include <embree4/rtcore.h>
 #include <tbb/tbb.h>
+#include <chrono>
 
 #ifdef max
 #undef max
 #endif
 
-//#NOTE_SK: Embree requires shared vertices to be padded to 16 bytes
-//          so it's easier to just use vec4 aligned (for better SIMD perf)
-struct alignas(16) EmbreeVertex {
-    vec4 pos;
-};
-
-// The index buffer must contain an array of three 32-bit indices per triangle (RTC_FORMAT_UINT3 format)
-PACKED_STRUCT_BEGIN
-struct EmbreeFace {
-    uint32_t a, b, c;
-} PACKED_STRUCT_END;
-
-constexpr float     kRayStartBias = 0.001f;
 constexpr float     kAOIntensity  = 1.0f;
+constexpr size_t    kAOPacketSize = 8;      // RTCRay8, matches AVX2 (AVX-512 builds of Embree split it anyway)
+constexpr size_t    kAOBatchSize  = 32;     // adaptive mode checks convergence every batch, also the minimum samples count
+
+// adaptive mode error targets per quality, the 95% confidence half-interval of the vertex occlusion
+constexpr float     kAOAdaptiveMaxError[] = { 0.05f, 0.035f, 0.025f, 0.015f };
+constexpr size_t    kAOTexelsGrainSize = 256;   // texels per tbb task, consecutive texels come from the same triangle
 
 
 // Maps a value inside the square [0,1]x[0,1] to a value in a disk of radius 1 using concentric squares.
@@ -81,7 +77,7 @@ static vec3 SampleDirectionHemisphere(float u1, float u2) {
     return vec3(x, y, z);
 }
 
-static void AverageAO(MetroModelGeomData& gd, const MyArray<float>& aos) {
+void AverageAO(MetroModelGeomData& gd, const MyArray<float>& aos) {
     const MetroFace* faces = rcast<const MetroFace*>(gd.faces);
     for (size_t i = 0; i < gd.mesh->facesCount; ++i) {
         float a = aos[faces[i].a];
@@ -107,53 +103,167 @@ static void AverageAO(MetroModelGeomData& gd, const MyArray<float>& aos) {
     }
 }
 
-static float CalcAOForVertex(const vec4& pos, const vec3& normal, const MyArray<vec3>& samples, RTCScene embreeScene) {
+// Sobol (0,2)-sequence, the first dimension is van der Corput, the second one uses the v ^= v >> 1 direction numbers
+static vec2 Sobol2D(uint32_t index) {
+    uint32_t x = 0, y = 0;
+    for (uint32_t vx = 1u << 31, vy = 1u << 31; index; index >>= 1, vx >>= 1, vy ^= vy >> 1) {
+        if (index & 1) {
+            x ^= vx;
+            y ^= vy;
+        }
+    }
+
+    return vec2(scast<float>(x) * 2.3283064365386963e-10f, scast<float>(y) * 2.3283064365386963e-10f);
+}
+
+// Cosine-weighted Sobol samples (with a random toroidal shift per bake).
+//  Every batch of kAOBatchSize is a prefix of the sequence, so tracing any number of batches gives well stratified
+//  directions. Inside a batch samples are ordered along the Morton curve, so the packets of kAOPacketSize consecutive
+//  samples cover small solid angles and their rays stay coherent.
+MyArray<vec3> MakeProgressiveSamples(const size_t numSamples) {
+    auto spreadBits = [](uint32_t v)->uint32_t {
+        v &= 0x0000FFFF;
+        v = (v | (v << 8)) & 0x00FF00FF;
+        v = (v | (v << 4)) & 0x0F0F0F0F;
+        v = (v | (v << 2)) & 0x33333333;
+        v = (v | (v << 1)) & 0x55555555;
+        return v;
+    };
+
+    const vec2 shift(RandomFloat01(), RandomFloat01());
+
+    MyArray<std::pair<uint32_t, vec2>> points(numSamples);
+    for (size_t i = 0; i < numSamples; ++i) {
+        const vec2 p = glm::fract(Sobol2D(scast<uint32_t>(i)) + shift);
+        const uint32_t morton = spreadBits(scast<uint32_t>(p.x * 65535.0f)) | (spreadBits(scast<uint32_t>(p.y * 65535.0f)) << 1);
+        points[i] = { morton, p };
+    }
+
+    for (size_t first = 0; first < numSamples; first += kAOBatchSize) {
+        const size_t last = std::min(first + kAOBatchSize, numSamples);
+        std::sort(points.begin() + first, points.begin() + last, [](const auto& a, const auto& b) {
+            return a.first < b.first;
+        });
+    }
+
+    MyArray<vec3> samples(numSamples);
+    for (size_t i = 0; i < numSamples; ++i) {
+        samples[i] = SampleCosineHemisphere(points[i].second.x, points[i].second.y);
+    }
+
+    return samples;
+}
+
+struct AOTraceParams {
+    float   maxDistance;    // > 0 limits the rays and weights every hit with 1 - (hitDistance / maxDistance)
+    float   maxError;       // adaptive only, 95% confidence half-interval of the occlusion to stop at, 0 is not adaptive
+};
+
+// Distance weighting needs the hit distance, so intersect queries instead of the (cheaper) occlusion ones.
+//  Adaptive mode checks the running estimate after every batch, the per-sample variance is floored by the binomial
+//  one of the smoothed mean, so a handful of all-open (or all-occluded) samples never counts as converged.
+//  bentNormal is optional, it's the average unoccluded direction (each one weighted by how open it is).
+static float CalcAOForPoint(const vec3& pos, const vec3& normal, const MyArray<vec3>& samples, const AOTraceParams& tp, RTCScene embreeScene, size_t& numTraced, vec3* bentNormal = nullptr) {
     float occlusion = 0.0f;
+    float occlusionSq = 0.0f;
+    vec3 openDirsSum(0.0f);
 
     vec3 tangent, bitangent;
     OrthonormalBasis(normal, tangent, bitangent);
-    mat3 tbn(tangent, bitangent, normal);
 
-    for (const vec3& s : samples) {
-        vec3 sample = tbn * s;
+    const bool distanceWeighted = tp.maxDistance > 0.0f;
+    const float rayTFar = distanceWeighted ? tp.maxDistance : std::numeric_limits<float>::max();
+
+    RTCRayHit8 packet;
+    RTCRay8& ray = packet.ray;
+    int valid[kAOPacketSize];
+
+    const size_t numSamples = samples.size();
+    size_t first = 0;
+    while (first < numSamples) {
+        const size_t count = std::min(kAOPacketSize, numSamples - first);
+
+        for (size_t j = 0; j < kAOPacketSize; ++j) {
+            const vec3& s = samples[first + std::min(j, count - 1)];
+            const vec3 dir = tangent * s.x + bitangent * s.y + normal * s.z;
+
+            valid[j] = (j < count) ? -1 : 0;
+            ray.org_x[j] = pos.x;
+            ray.org_y[j] = pos.y;
+            ray.org_z[j] = pos.z;
+            ray.tnear[j] = kAORayStartBias;
+            ray.dir_x[j] = dir.x;
+            ray.dir_y[j] = dir.y;
+            ray.dir_z[j] = dir.z;
+            ray.time[j] = 0.0f;
+            ray.tfar[j] = rayTFar;
+            ray.mask[j] = kInvalidValue32;
+            ray.id[j] = scast<uint32_t>(j);
+            ray.flags[j] = 0;
+            packet.hit.geomID[j] = RTC_INVALID_GEOMETRY_ID;
+        }
 
-        RTCRay ray = {};
-        ray.mask = kInvalidValue32;
-        ray.flags = 0;
-        ray.time = 0.0f;
-        ray.org_x = pos.x;
-        ray.org_y = pos.y;
-        ray.org_z = pos.z;
-        ray.dir_x = sample.x;
-        ray.dir_y = sample.y;
-        ray.dir_z = sample.z;
-        ray.tnear = kRayStartBias;
-        ray.tfar = std::numeric_limits<float>::max();
+        if (distanceWeighted) {
+            rtcIntersect8(valid, embreeScene, &packet);
+            for (size_t j = 0; j < count; ++j) {
+                float o = 0.0f;
+                if (packet.hit.geomID[j] != RTC_INVALID_GEOMETRY_ID) {
+                    o = Clamp(1.0f - (ray.tfar[j] / tp.maxDistance), 0.0f, 1.0f);
+                    occlusion += o;
+                    occlusionSq += o * o;
+                }
+                if (bentNormal) {
+                    openDirsSum += vec3(ray.dir_x[j], ray.dir_y[j], ray.dir_z[j]) * (1.0f - o);
+                }
+            }
+        } else {
+            rtcOccluded8(valid, embreeScene, &ray);
+            for (size_t j = 0; j < count; ++j) {
+                if (ray.tfar[j] <= ray.tnear[j]) { // hit
+                    occlusion += 1.0f;
+                    occlusionSq += 1.0f;
+                } else if (bentNormal) {
+                    openDirsSum += vec3(ray.dir_x[j], ray.dir_y[j], ray.dir_z[j]);
+                }
+            }
+        }
+
+        first += count;
 
-        rtcOccluded1(embreeScene, &ray);
-        if (ray.tfar <= ray.tnear) { // hit
-            occlusion += 1.0f;  //#TODO_SK: implement distance weighting ??? something simple like clamp(1.0f - (hitDistance / maximumRange))
+        if (tp.maxError > 0.0f && (first % kAOBatchSize) == 0 && first < numSamples) {
+            const float n = scast<float>(first);
+            const float mean = occlusion / n;
+            const float smoothedMean = (occlusion + 0.5f) / (n + 1.0f);
+            const float variance = std::max((occlusionSq - n * mean * mean) / (n - 1.0f), smoothedMean * (1.0f - smoothedMean));
+            const float halfInterval = 1.96f * Sqrt(variance / n);
+            if (halfInterval * kAOIntensity < tp.maxError) {
+                break;
+            }
         }
     }
 
+    numTraced = first;
+
+    if (bentNormal) {
+        const float len = Length(openDirsSum);
+        *bentNormal = (len > MM_Epsilon) ? (openDirsSum / len) : normal;
+    }
+
     //#TODO_SK: make intensity configurable
-    return Clamp(1.0f - ((occlusion * kAOIntensity) / scast<float>(samples.size())), 0.0f, 1.0f);
+    return Clamp(1.0f - ((occlusion * kAOIntensity) / scast<float>(first)), 0.0f, 1.0f);
 }
 
-bool CalculateModelAO(RefPtr<MetroModelBase>& model, const size_t quality) {
-    RTCDevice embreeDevice = rtcNewDevice(nullptr);
-    RTCScene embreeScene = rtcNewScene(embreeDevice);
-
-    MyArray<MetroModelGeomData> gds;
-    model->CollectGeomData(gds);
+void BuildAOEmbreeScene(const MyArray<MetroModelGeomData>& gds, AOEmbreeScene& result) {
+    result.device = rtcNewDevice(nullptr);
+    result.scene = rtcNewScene(result.device);
 
-    MyArray<MyArray<EmbreeVertex>> vertexBuffers(gds.size());
-    MyArray<MyArray<EmbreeFace>> indexBuffers(gds.size());
+    result.vertexBuffers.resize(gds.size());
+    result.indexBuffers.resize(gds.size());
 
     for (size_t gdIdx = 0; gdIdx < gds.size(); ++gdIdx) {
         const MetroModelGeomData& gd = gds[gdIdx];
-        MyArray<EmbreeVertex>& vertices = vertexBuffers[gdIdx];
-        MyArray<EmbreeFace>& faces = indexBuffers[gdIdx];
+        MyArray<EmbreeVertex>& vertices = result.vertexBuffers[gdIdx];
+        MyArray<EmbreeFace>& faces = result.indexBuffers[gdIdx];
         vertices.resize(gd.mesh->verticesCount);
         faces.resize(gd.mesh->facesCount);
 
@@ -176,65 +286,401 @@ bool CalculateModelAO(RefPtr<MetroModelBase>& model, const size_t quality) {
             faces[i].c = scast<uint32_t>(srcFaces[i].c);
         }
 
-        RTCGeometry embreeGeom = rtcNewGeometry(embreeDevice, RTC_GEOMETRY_TYPE_TRIANGLE);
+        RTCGeometry embreeGeom = rtcNewGeometry(result.device, RTC_GEOMETRY_TYPE_TRIANGLE);
         rtcSetGeometryBuildQuality(embreeGeom, RTC_BUILD_QUALITY_HIGH);
         rtcSetGeometryVertexAttributeCount(embreeGeom, 1);
         rtcSetSharedGeometryBuffer(embreeGeom, RTC_BUFFER_TYPE_VERTEX, 0, RTC_FORMAT_FLOAT3, vertices.data(), 0, sizeof(EmbreeVertex), vertices.size());
         rtcSetSharedGeometryBuffer(embreeGeom, RTC_BUFFER_TYPE_INDEX, 0, RTC_FORMAT_UINT3, faces.data(), 0, sizeof(EmbreeFace), faces.size());
         rtcCommitGeometry(embreeGeom);
-        rtcAttachGeometry(embreeScene, embreeGeom);
+        rtcAttachGeometry(result.scene, embreeGeom);
         rtcReleaseGeometry(embreeGeom);
     }
 
-    rtcCommitScene(embreeScene);
+    rtcCommitScene(result.scene);
+}
 
-    size_t numSamples = 256;    // low
-    if (quality == 1) {         // normal
-        numSamples = 512;
-    } else if (quality == 2) {  // high
-        numSamples = 1024;
-    } else if (quality > 0) {   // ultra
-        numSamples = 2048;
-    }
+void ReleaseAOEmbreeScene(AOEmbreeScene& scene) {
+    rtcReleaseScene(scene.scene);
+    rtcReleaseDevice(scene.device);
+    scene = AOEmbreeScene();
+}
 
-    MyArray<vec3> samples(numSamples);
-    for (size_t i = 0; i < numSamples; ++i) {
-        const float u = RandomFloat01();
-        const float v = RandomFloat01();
-        samples[i] = SampleCosineHemisphere(u, v);//SampleDirectionHemisphere(u, v);
+size_t GetAONumSamples(const size_t quality) {
+    switch (quality) {
+        case 0:  return 256;    // low
+        case 1:  return 512;    // normal
+        case 2:  return 1024;   // high
+        default: return 2048;   // ultra
     }
+}
+
+bool CalculateModelAO(RefPtr<MetroModelBase>& model, const ModelAOParams& params, ModelAOStats* stats) {
+    //#NOTE_SK: we write AO right into the vertices, so make sure we're not touching the source file memory
+    model->MakeGeometryUnique();
+
+    MyArray<MetroModelGeomData> gds;
+    model->CollectGeomData(gds);
+
+    AOEmbreeScene aoScene;
+    BuildAOEmbreeScene(gds, aoScene);
+    RTCScene embreeScene = aoScene.scene;
+
+    const size_t quality = std::min<size_t>(params.quality, 3);
+    const size_t numSamples = GetAONumSamples(quality);
+
+    AOTraceParams tp;
+    tp.maxDistance = params.maxDistance;
+    tp.maxError = params.adaptive ? kAOAdaptiveMaxError[quality] : 0.0f;
+
+    const MyArray<vec3> samples = MakeProgressiveSamples(numSamples);
+
+    ModelAOStats result;
+    const auto timeStart = std::chrono::high_resolution_clock::now();
 
     for (size_t gdIdx = 0; gdIdx < gds.size(); ++gdIdx) {
         MetroModelGeomData& gd = gds[gdIdx];
-        const MyArray<EmbreeVertex>& vertices = vertexBuffers[gdIdx];
+        const MyArray<EmbreeVertex>& vertices = aoScene.vertexBuffers[gdIdx];
 
         MyArray<float> aos(gd.mesh->verticesCount);
+        MyArray<size_t> numTraced(gd.mesh->verticesCount);
 
         if (gd.mesh->vertexType == MetroVertexType::Skin) {
             VertexSkinned* dstVerts = (VertexSkinned*)gd.vertices;
             tbb::parallel_for(tbb::blocked_range<size_t>(0, gd.mesh->verticesCount),
-                [&gd, dstVerts, &vertices, &aos, &samples, embreeScene](const tbb::blocked_range<size_t>& r) {
+                [&gd, dstVerts, &vertices, &aos, &numTraced, &samples, &tp, embreeScene](const tbb::blocked_range<size_t>& r) {
                     for (size_t i = r.begin(); i < r.end(); ++i) {
                         vec3 n = vec3(DecodeNormal(dstVerts[i].normal));
-                        aos[i] = CalcAOForVertex(vertices[i].pos, n, samples, embreeScene);
+                        aos[i] = CalcAOForPoint(vec3(vertices[i].pos), n, samples, tp, embreeScene, numTraced[i]);
                     }
                 });
         } else {
             VertexStatic* dstVerts = (VertexStatic*)gd.vertices;
             tbb::parallel_for(tbb::blocked_range<size_t>(0, gd.mesh->verticesCount),
-                [&gd, dstVerts, &vertices, &aos, &samples, embreeScene](const tbb::blocked_range<size_t>& r) {
+                [&gd, dstVerts, &vertices, &aos, &numTraced, &samples, &tp, embreeScene](const tbb::blocked_range<size_t>& r) {
                     for (size_t i = r.begin(); i < r.end(); ++i) {
                         vec3 n = vec3(DecodeNormal(dstVerts[i].normal));
-                        aos[i] = CalcAOForVertex(vertices[i].pos, n, samples, embreeScene);
+                        aos[i] = CalcAOForPoint(vec3(vertices[i].pos), n, samples, tp, embreeScene, numTraced[i]);
                     }
                 });
         }
 
         AverageAO(gd, aos);
+
+        result.numVertices += gd.mesh->verticesCount;
+        result.numRays += std::accumulate(numTraced.begin(), numTraced.end(), scast<size_t>(0));
+        result.numRaysMax += scast<size_t>(gd.mesh->verticesCount) * numSamples;
     }
 
-    rtcReleaseScene(embreeScene);
-    rtcReleaseDevice(embreeDevice);
+    const auto timeEnd = std::chrono::high_resolution_clock::now();
+    result.seconds = std::chrono::duration<double>(timeEnd - timeStart).count();
+
+    LogPrintF(LogLevel::Info, "AO: %zu of %zu rays (%.1f samples per vertex) in %.3f sec (%.2f Mrays/s)",
+              result.numRays, result.numRaysMax,
+              result.numVertices ? scast<double>(result.numRays) / scast<double>(result.numVertices) : 0.0,
+              result.seconds, (result.seconds > 0.0) ? (scast<double>(result.numRays) / result.seconds) * 1e-6 : 0.0);
+
+    if (stats) {
+        *stats = result;
+    }
+
+    ReleaseAOEmbreeScene(aoScene);
 
     return true;
 }
+
+
+struct AOTexel {
+    vec3        pos;
+    vec3        normal;
+    uint32_t    pixel;      // y * resolution + x
+};
+
+struct AOTexelVertex {
+    vec3        pos;
+    vec3        normal;
+    vec2        uv;         // in texels
+};
+
+template <typename T>
+static void CollectAOTexelVertices(const MetroModelGeomData& gd, const float resolution, MyArray<AOTexelVertex>& result) {
+    const T* srcVerts = rcast<const T*>(gd.vertices);
+    const float posScale = (gd.mesh->vertexType == MetroVertexType::Skin) ? gd.mesh->verticesScale : 1.0f;
+
+    result.resize(gd.mesh->verticesCount);
+    for (size_t i = 0; i < result.size(); ++i) {
+        const MetroVertex v = ConvertVertex(srcVerts[i]);
+        result[i].pos = v.pos * posScale;
+        result[i].normal = Normalize(vec3(v.normal));
+        result[i].uv = v.uv0 * resolution;
+    }
+}
+
+// Rasterizes UV0 of all the meshes into the resolution x resolution grid, a texel belongs to the triangle covering its center.
+//  Texels are claimed by the first triangle that covers them (overlapping or mirrored charts bake only once), tiled UVs
+//  are wrapped into the grid. Texels of one triangle go out together, so consecutive texels trace coherent rays.
+static void RasterizeAOTexels(const MyArray<MetroModelGeomData>& gds, const size_t resolution, MyArray<AOTexel>& texels, BytesArray& coverage) {
+    const int32_t res = scast<int32_t>(resolution);
+    coverage.assign(resolution * resolution, 0);
+
+    MyArray<AOTexelVertex> verts;
+    for (const MetroModelGeomData& gd : gds) {
+        if (gd.mesh->vertexType == MetroVertexType::Skin) {
+            CollectAOTexelVertices<VertexSkinned>(gd, scast<float>(resolution), verts);
+        } else {
+            CollectAOTexelVertices<VertexStatic>(gd, scast<float>(resolution), verts);
+        }
+
+        const MetroFace* faces = rcast<const MetroFace*>(gd.faces);
+        for (size_t i = 0; i < gd.mesh->facesCount; ++i) {
+            const AOTexelVertex& va = verts[faces[i].a];
+            const AOTexelVertex& vb = verts[faces[i].b];
+            const AOTexelVertex& vc = verts[faces[i].c];
+
+            const float area = (vb.uv.x - va.uv.x) * (vc.uv.y - va.uv.y) - (vb.uv.y - va.uv.y) * (vc.uv.x - va.uv.x);
+            if (std::abs(area) < MM_Epsilon) {
+                continue;
+            }
+            const float invArea = 1.0f / area;
+
+            // move the triangle into the first tile, the rest is wrapped per texel
+            const vec2 minUV = glm::min(va.uv, glm::min(vb.uv, vc.uv));
+            const vec2 maxUV = glm::max(va.uv, glm::max(vb.uv, vc.uv));
+            const vec2 tileOffset = glm::floor(minUV / scast<float>(resolution)) * scast<float>(resolution);
+
+            const int32_t x0 = scast<int32_t>(std::floor(minUV.x - tileOffset.x));
+            const int32_t y0 = scast<int32_t>(std::floor(minUV.y - tileOffset.y));
+            const int32_t x1 = std::min(scast<int32_t>(std::ceil(maxUV.x - tileOffset.x)), x0 + res);
+            const int32_t y1 = std::min(scast<int32_t>(std::ceil(maxUV.y - tileOffset.y)), y0 + res);
+
+            for (int32_t y = y0; y < y1; ++y) {
+                for (int32_t x = x0; x < x1; ++x) {
+                    const uint32_t pixel = scast<uint32_t>((y % res) * res + (x % res));
+                    if (coverage[pixel]) {
+                        continue;
+                    }
+
+                    const vec2 p = vec2(scast<float>(x) + 0.5f, scast<float>(y) + 0.5f) + tileOffset;
+                    const float wa = ((vb.uv.x - p.x) * (vc.uv.y - p.y) - (vb.uv.y - p.y) * (vc.uv.x - p.x)) * invArea;
+                    const float wb = ((vc.uv.x - p.x) * (va.uv.y - p.y) - (vc.uv.y - p.y) * (va.uv.x - p.x)) * invArea;
+                    const float wc = 1.0f - wa - wb;
+                    if (wa < 0.0f || wb < 0.0f || wc < 0.0f) {
+                        continue;
+                    }
+
+                    AOTexel texel;
+                    texel.pos = va.pos * wa + vb.pos * wb + vc.pos * wc;
+                    texel.normal = Normalize(va.normal * wa + vb.normal * wb + vc.normal * wc);
+                    texel.pixel = pixel;
+                    texels.push_back(texel);
+
+                    coverage[pixel] = 1;
+                }
+            }
+        }
+    }
+}
+
+// Grows the charts by one texel per pass, every empty texel next to the covered ones gets their average.
+//  Keeps the chart borders from bleeding the empty background in when filtering and building the mips.
+static void DilateAOTexture(uint8_t* rgba, BytesArray& coverage, const size_t resolution, const size_t numPasses) {
+    BytesArray nextCoverage(coverage.size());
+    const int32_t res = scast<int32_t>(resolution);
+
+    for (size_t pass = 0; pass < numPasses; ++pass) {
+        nextCoverage = coverage;
+
+        //#NOTE_SK: only the texels empty in coverage are written, and only the covered ones are read, so rows can go in parallel
+        tbb::parallel_for(tbb::blocked_range<int32_t>(0, res), [&](const tbb::blocked_range<int32_t>& r) {
+            for (int32_t y = r.begin(); y < r.end(); ++y) {
+                for (int32_t x = 0; x < res; ++x) {
+                    const size_t pixel = scast<size_t>(y * res + x);
+                    if (coverage[pixel]) {
+                        continue;
+                    }
+
+                    uint32_t sum[4] = { 0, 0, 0, 0 }, count = 0;
+                    for (int32_t dy = std::max(y - 1, 0); dy <= std::min(y + 1, res - 1); ++dy) {
+                        for (int32_t dx = std::max(x - 1, 0); dx <= std::min(x + 1, res - 1); ++dx) {
+                            const size_t neighbour = scast<size_t>(dy * res + dx);
+                            if (coverage[neighbour]) {
+                                for (size_t c = 0; c < 4; ++c) {
+                                    sum[c] += rgba[neighbour * 4 + c];
+                                }
+                                ++count;
+                            }
+                        }
+                    }
+
+                    if (count) {
+                        for (size_t c = 0; c < 4; ++c) {
+                            rgba[pixel * 4 + c] = scast<uint8_t>((sum[c] + count / 2) / count);
+                        }
+                        nextCoverage[pixel] = 1;
+                    }
+                }
+            }
+        });
+
+        coverage.swap(nextCoverage);
+    }
+}
+
+// Meshes of different materials usually map the whole 0..1 UV range to their own texture, so every material
+//  texture gets its own AO texture. Groups are keyed by the full texture path, same file names in different folders
+//  are different textures. Suffix is the file name of the material texture, with the group index appended when
+//  another group already took it, or just the index for untextured meshes.
+static void GroupAOMeshesByMaterial(const MyArray<MetroModelGeomData>& gds, MyArray<CharString>& suffixes, MyArray<MyArray<MetroModelGeomData>>& groups) {
+    MyDict<CharString, size_t> textureToGroup;
+    MyArray<CharString> textures;
+    for (const MetroModelGeomData& gd : gds) {
+        const CharString& texture = gd.model->GetMaterialString(MetroModelBase::kMaterialStringTexture);
+
+        auto it = textureToGroup.find(texture);
+        if (it == textureToGroup.end()) {
+            it = textureToGroup.insert({ texture, groups.size() }).first;
+            textures.push_back(texture);
+            groups.push_back({});
+        }
+        groups[it->second].push_back(gd);
+    }
+
+    for (size_t i = 0; i < textures.size(); ++i) {
+        const CharString::size_type slashPos = textures[i].find_last_of("\\/");
+        const CharString name = (slashPos == CharString::npos) ? textures[i] : textures[i].substr(slashPos + 1);
+
+        CharString suffix = name.empty() ? std::to_string(i) : name;
+        for (size_t n = i; std::find(suffixes.begin(), suffixes.end(), suffix) != suffixes.end(); ++n) {
+            suffix = (name.empty() ? CharString() : name + "_") + std::to_string(n);
+        }
+
+        suffixes.push_back(suffix);
+    }
+}
+
+// Traces the texels of one material group against the whole model scene and saves them as one texture
+static bool BakeAOTextureGroup(const MyArray<MetroModelGeomData>& gds,
+                               RTCScene embreeScene,
+                               const MyArray<vec3>& samples,
+                               const AOTraceParams& tp,
+                               const ModelAOTextureParams& params,
+                               const fs::path& filePath,
+                               ModelAOStats& stats) {
+    const size_t resolution = params.resolution;
+
+    MyArray<AOTexel> texels;
+    BytesArray coverage;
+    RasterizeAOTexels(gds, resolution, texels, coverage);
+    if (texels.empty()) {
+        return false;
+    }
+
+    // empty texels (if any left after the dilation) are unoccluded and face +Z
+    BytesArray rgba(resolution * resolution * 4);
+    for (size_t i = 0; i < rgba.size(); i += 4) {
+        rgba[i + 0] = 128;
+        rgba[i + 1] = 128;
+        rgba[i + 2] = 255;
+        rgba[i + 3] = 255;
+    }
+
+    MyArray<size_t> numTraced(texels.size());
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, texels.size(), kAOTexelsGrainSize),
+        [&texels, &rgba, &numTraced, &samples, &tp, embreeScene](const tbb::blocked_range<size_t>& r) {
+            for (size_t i = r.begin(); i < r.end(); ++i) {
+                const AOTexel& texel = texels[i];
+
+                vec3 bentNormal;
+                const float ao = CalcAOForPoint(texel.pos, texel.normal, samples, tp, embreeScene, numTraced[i], &bentNormal);
+
+                const vec3 encoded = bentNormal * 127.5f + 127.5f;
+                uint8_t* dst = rgba.data() + scast<size_t>(texel.pixel) * 4;
+                dst[0] = scast<uint8_t>(Clamp(encoded.x, 0.0f, 255.0f));
+                dst[1] = scast<uint8_t>(Clamp(encoded.y, 0.0f, 255.0f));
+                dst[2] = scast<uint8_t>(Clamp(encoded.z, 0.0f, 255.0f));
+                dst[3] = scast<uint8_t>(Clamp(ao * 255.0f + 0.5f, 0.0f, 255.0f));
+            }
+        });
+
+    const size_t numDilationPasses = params.dilation ? params.dilation : (resolution / 256);
+    DilateAOTexture(rgba.data(), coverage, resolution, numDilationPasses);
+
+    stats.numTextures++;
+    stats.numTexels += texels.size();
+    stats.numRays += std::accumulate(numTraced.begin(), numTraced.end(), scast<size_t>(0));
+    stats.numRaysMax += texels.size() * samples.size();
+
+    // not a color, and the alpha is AO, not coverage
+    MipGenParams mipParams;
+    mipParams.srgb = false;
+    mipParams.alphaWeighted = false;
+
+    MetroTexture texture;
+    return texture.LoadFromRGBA(rgba.data(), resolution, resolution) &&
+           texture.SaveAsMetroTexture(filePath, MetroTexture::PixelFormat::BC7, mipParams);
+}
+
+// Bakes AO and bent normals into textures laid out by UV0, one per material texture of the model, RGB is the object space
+//  bent normal, A is the AO. Texels are traced with the same Embree scene (all the meshes) and samples as the vertices,
+//  saved as BC7 Metro textures. A single material keeps filePath as is, more get "_<material texture name>" appended
+//  (see GroupAOMeshesByMaterial for the clashing names).
+bool BakeModelAOTexture(const RefPtr<MetroModelBase>& model, const ModelAOTextureParams& params, const fs::path& filePath, ModelAOStats* stats) {
+    const size_t resolution = params.resolution;
+    if (!model || !IsPowerOfTwo(resolution) || resolution < 512 || resolution > 4096) {
+        return false;
+    }
+
+    MyArray<MetroModelGeomData> gds;
+    model->CollectGeomData(gds);
+    if (gds.empty()) {
+        return false;
+    }
+
+    const auto timeStart = std::chrono::high_resolution_clock::now();
+
+    MyArray<CharString> groupSuffixes;
+    MyArray<MyArray<MetroModelGeomData>> groups;
+    GroupAOMeshesByMaterial(gds, groupSuffixes, groups);
+
+    AOEmbreeScene aoScene;
+    BuildAOEmbreeScene(gds, aoScene);
+
+    const size_t quality = std::min<size_t>(params.quality, 3);
+    const size_t numSamples = GetAONumSamples(quality);
+
+    AOTraceParams tp;
+    tp.maxDistance = params.maxDistance;
+    tp.maxError = params.adaptive ? kAOAdaptiveMaxError[quality] : 0.0f;
+
+    const MyArray<vec3> samples = MakeProgressiveSamples(numSamples);
+
+    ModelAOStats result;
+    bool allSaved = true;
+    for (size_t i = 0; i < groups.size(); ++i) {
+        fs::path groupPath = filePath;
+        if (groups.size() > 1) {
+            groupPath += "_" + groupSuffixes[i];
+        }
+
+        const size_t numTexelsBefore = result.numTexels;
+        if (!BakeAOTextureGroup(groups[i], aoScene.scene, samples, tp, params, groupPath, result)) {
+            // meshes without any UV area have nothing to bake, that's not an error
+            allSaved = allSaved && (result.numTexels == numTexelsBefore);
+        }
+    }
+
+    ReleaseAOEmbreeScene(aoScene);
+
+    const auto timeEnd = std::chrono::high_resolution_clock::now();
+    result.seconds = std::chrono::duration<double>(timeEnd - timeStart).count();
+
+    LogPrintF(LogLevel::Info, "AO textures %zux%zu: %zu textures, %zu texels, %zu of %zu rays (%.1f samples per texel) in %.3f sec (%.2f Mrays/s)",
+              resolution, resolution, result.numTextures, result.numTexels, result.numRays, result.numRaysMax,
+              result.numTexels ? scast<double>(result.numRays) / scast<double>(result.numTexels) : 0.0,
+              result.seconds, (result.seconds > 0.0) ? (scast<double>(result.numRays) / result.seconds) * 1e-6 : 0.0);
+
+    if (stats) {
+        *stats = result;
+    }
+
+    return result.numTextures > 0 && allSaved;
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include "mycommon.h"
+#include "mymath.h"
+#include <embree4/rtcore.h>
+
+class MetroModelBase;
+struct MetroModelGeomData;
+
+struct ModelAOParams {
+    size_t  quality = 0;            // 0 (low) .. 3 (ultra), picks the samples count (maximum one for the adaptive mode)
+    float   maxDistance = 0.0f;     // <= 0 is unlimited, otherwise limits the rays and weights the hits by distance
+    bool    adaptive = false;       // stop tracing a vertex as soon as its occlusion estimate is good enough
+};
+
+// texture bake is laid out by UV0, one texture per material texture, RGB is the object space bent normal, A is the AO
+struct ModelAOTextureParams {
+    size_t  resolution = 2048;      // power of two, 512 .. 4096
+    size_t  quality = 0;
+    float   maxDistance = 0.0f;
+    bool    adaptive = true;
+    size_t  dilation = 0;           // texels to grow the charts by, 0 is resolution / 256
+};
+
+struct ModelAOStats {
+    size_t  numVertices = 0;
+    size_t  numTextures = 0;        // texture bake only
+    size_t  numTexels = 0;          // texture bake only
+    size_t  numRays = 0;            // actually traced
+    size_t  numRaysMax = 0;         // what the full samples count for every vertex would trace
+    double  seconds = 0.0;
+};
+
+bool CalculateModelAO(RefPtr<MetroModelBase>& model, const ModelAOParams& params, ModelAOStats* stats);
+// filePath is the Metro texture path without the extension, saved as BC7, "_<material texture name>" is appended
+//  when the model has more than one material
+bool BakeModelAOTexture(const RefPtr<MetroModelBase>& model, const ModelAOTextureParams& params, const fs::path& filePath, ModelAOStats* stats);
+
+
+// The pieces both bakes are made of, so a tracer living elsewhere (the one ray per sample reference of
+//  ModelAOBenchmark) traces the same scene with the same samples and stores the result the same way.
+
+//#NOTE_SK: Embree requires shared vertices to be padded to 16 bytes
+//          so it's easier to just use vec4 aligned (for better SIMD perf)
+struct alignas(16) EmbreeVertex {
+    vec4 pos;
+};
+
+// The index buffer must contain an array of three 32-bit indices per triangle (RTC_FORMAT_UINT3 format)
+PACKED_STRUCT_BEGIN
+struct EmbreeFace {
+    uint32_t a, b, c;
+} PACKED_STRUCT_END;
+
+constexpr float kAORayStartBias = 0.001f;
+
+struct AOEmbreeScene {
+    RTCDevice                       device = nullptr;
+    RTCScene                        scene = nullptr;
+    // shared with Embree, have to outlive the scene
+    MyArray<MyArray<EmbreeVertex>>  vertexBuffers;
+    MyArray<MyArray<EmbreeFace>>    indexBuffers;
+};
+
+void            BuildAOEmbreeScene(const MyArray<MetroModelGeomData>& gds, AOEmbreeScene& result);
+void            ReleaseAOEmbreeScene(AOEmbreeScene& scene);
+size_t          GetAONumSamples(const size_t quality);
+MyArray<vec3>   MakeProgressiveSamples(const size_t numSamples);
+// smooths the per vertex AO over the faces and writes it into the vertices normals
+void            AverageAO(MetroModelGeomData& gd, const MyArray<float>& aos);
@@ -1,61 +1,277 @@
 #include "metro/MetroModel.h"
+#include "metro/MetroSkeleton.h"
 #include "meshoptimizer.h"
 
-RefPtr<MetroModelBase> BuildModelLOD(RefPtr<MetroModelBase>& model, const float ratio) {
-    assert(model->GetModelType() == MetroModelType::Std);
-
-    MyArray<MetroModelGeomData> gds;
-    model->CollectGeomData(gds);
-    assert(gds.size() == 1);
+#ifdef min
+#undef min
+#endif
+#ifdef max
+#undef max
+#endif
+#include "Mathematics/ContOrientedBox3.h"
 
-    const MetroModelGeomData& gd = gds[0];
+constexpr float kLODTargetError = 0.01f;
+constexpr size_t kMaxLODs = 2;          // Metro models only have lod1 and lod2
 
-    const size_t indicesCount = scast<size_t>(gd.mesh->facesCount) * 3;
-    const size_t targetIndecesCount = scast<size_t>(indicesCount * ratio);
-    constexpr float targetError = 0.01f;
+// Simplified vertices are always a subset of the source ones, so all the attributes (normals, uvs, bones and weights)
+//  stay untouched. meshopt_simplify also never collapses across attribute seams (split vertices sharing a position).
+template <typename T>
+static void SimplifyMesh(const T* vertices,
+                         const size_t numVertices,
+                         const uint16_t* indices,
+                         const size_t numIndices,
+                         const float* positions,
+                         const size_t positionsStride,
+                         const float ratio,
+                         MyArray<T>& lodVertices,
+                         MyArray<uint16_t>& lodIndices) {
+    const size_t targetIndicesCount = scast<size_t>(numIndices * ratio);
     float lodError = 0.0f;
 
-    MyArray<uint16_t> lodIndices(indicesCount);
-    const uint16_t* indices = rcast<const uint16_t*>(gd.faces);
-    const float* vertices = rcast<const float*>(gd.vertices);
+    lodIndices.resize(numIndices);
     const size_t lodIndicesCount = meshopt_simplify<uint16_t>(lodIndices.data(),
                                                               indices,
-                                                              indicesCount,
-                                                              vertices,
-                                                              gd.mesh->verticesCount,
-                                                              sizeof(VertexStatic),
-                                                              targetIndecesCount,
-                                                              targetError,
+                                                              numIndices,
+                                                              positions,
+                                                              numVertices,
+                                                              positionsStride,
+                                                              targetIndicesCount,
+                                                              kLODTargetError,
                                                               &lodError);
     lodIndices.resize(lodIndicesCount);
 
-    MyArray<VertexStatic> lodVertices(lodIndicesCount < gd.mesh->verticesCount ? lodIndicesCount : gd.mesh->verticesCount);
+    lodVertices.resize(lodIndicesCount < numVertices ? lodIndicesCount : numVertices);
     const size_t lodVerticesCount = meshopt_optimizeVertexFetch<uint16_t>(lodVertices.data(),
                                                                           lodIndices.data(),
                                                                           lodIndicesCount,
-                                                                          gd.vertices,
-                                                                          gd.mesh->verticesCount,
-                                                                          sizeof(VertexStatic));
+                                                                          vertices,
+                                                                          numVertices,
+                                                                          sizeof(T));
     lodVertices.resize(lodVerticesCount);
+}
+
+static void CopyLODMaterial(const MetroModelBase* src, MetroModelBase* dst) {
+    dst->SetModelVersion(src->GetModelVersion());
+    dst->SetEngineMaterialId(src->GetEngineMaterialId());
+    for (size_t i = 0; i < MetroModelBase::kMaterialStringNumStrings; ++i) {
+        dst->SetMaterialString(src->GetMaterialString(i), i);
+    }
+}
+
+static void SetLODBounds(MetroModelBase* model, const AABBox& bbox) {
+    BSphere bsphere;
+    bsphere.center = bbox.Center();
+    bsphere.radius = Length(bbox.Extent());
+
+    model->SetBBox(bbox);
+    model->SetBSphere(bsphere);
+}
+
+static MyArray<OBBox> CalculateBonesOBBs(const VertexSkinned* vertices,
+                                         const size_t numVertices,
+                                         const float verticesScale,
+                                         const BytesArray& bonesRemap,
+                                         const MetroSkeleton& skeleton) {
+    MyArray<MyArray<vec3>> perBoneVertices(bonesRemap.size());
+    for (size_t j = 0; j < numVertices; ++j) {
+        const size_t boneIdx = vertices[j].bones[2] / 3;    // ZYXW swizzle so bone 2 is the first bone (with bigger weight)
+        mat4 boneInvTransform = skeleton.GetBoneFullTransformInv(bonesRemap[boneIdx]);
+        vec3 vertexPos = boneInvTransform * vec4(DecodeSkinnedPosition(vertices[j].pos) * verticesScale, 1.0f);
+        perBoneVertices[boneIdx].push_back(vertexPos);
+    }
+
+    MyArray<OBBox> obbs;
+    for (const MyArray<vec3>& boneVerts : perBoneVertices) {
+        gte::OrientedBox3<float> box3;
+        OBBox bbox; bbox.Reset();
+        if (!boneVerts.empty() && gte::GetContainer<float>(scast<int>(boneVerts.size()), rcast<const gte::Vector3<float>*>(boneVerts.data()), box3)) {
+            bbox.matrix[0] = *rcast<vec3*>(&box3.axis[0]);
+            bbox.matrix[1] = *rcast<vec3*>(&box3.axis[1]);
+            bbox.matrix[2] = *rcast<vec3*>(&box3.axis[2]);
+            bbox.offset = *rcast<vec3*>(&box3.center);
+            bbox.hsize = *rcast<vec3*>(&box3.extent);
+        }
+        obbs.push_back(bbox);
+    }
+
+    return obbs;
+}
+
+static RefPtr<MetroModelBase> BuildStdLOD(const MetroModelBase* model, const float ratio) {
+    const RefPtr<MetroModelMesh> mesh = model->GetMesh();
+    const VertexStatic* vertices = rcast<const VertexStatic*>(model->GetVerticesMemData());
+    const uint16_t* indices = rcast<const uint16_t*>(model->GetFacesMemData());
+    if (!mesh || !vertices || !indices) {
+        return nullptr;
+    }
+
+    MyArray<VertexStatic> lodVertices;
+    MyArray<uint16_t> lodIndices;
+    SimplifyMesh(vertices, mesh->verticesCount, indices, scast<size_t>(mesh->facesCount) * 3,
+                 rcast<const float*>(vertices), sizeof(VertexStatic), ratio, lodVertices, lodIndices);
+    if (lodIndices.empty()) {
+        return nullptr;
+    }
 
     RefPtr<MetroModelStd> result = MakeRefPtr<MetroModelStd>();
-    result->CreateMesh(lodVerticesCount, lodIndicesCount / 3, 0, 0);
+    result->CreateMesh(lodVertices.size(), lodIndices.size() / 3, 0, 0);
     result->CopyVerticesData(lodVertices.data());
     result->CopyFacesData(lodIndices.data());
-    result->SetMaterialString(kEmptyString, 0); // force-create material strings array
+    CopyLODMaterial(model, result.get());
 
     AABBox bbox;
     bbox.Reset();
     for (const VertexStatic& v : lodVertices) {
         bbox.Absorb(v.pos);
     }
+    SetLODBounds(result.get(), bbox);
 
-    BSphere bsphere;
-    bsphere.center = bbox.Center();
-    bsphere.radius = Length(bbox.Extent());
+    return result;
+}
 
-    result->SetBBox(bbox);
-    result->SetBSphere(bsphere);
+// skeleton is optional, without it the source bones OBBs are kept (they still contain all the lod vertices)
+static RefPtr<MetroModelBase> BuildSkinLOD(const MetroModelBase* model, const MetroSkeleton* skeleton, const float ratio) {
+    const RefPtr<MetroModelMesh> mesh = model->GetMesh();
+    const VertexSkinned* vertices = rcast<const VertexSkinned*>(model->GetVerticesMemData());
+    const uint16_t* indices = rcast<const uint16_t*>(model->GetFacesMemData());
+    if (!mesh || !vertices || !indices) {
+        return nullptr;
+    }
+
+    // simplifier needs float positions, relative error makes the scale irrelevant
+    MyArray<vec3> positions(mesh->verticesCount);
+    for (size_t i = 0; i < positions.size(); ++i) {
+        positions[i] = DecodeSkinnedPosition(vertices[i].pos);
+    }
+
+    MyArray<VertexSkinned> lodVertices;
+    MyArray<uint16_t> lodIndices;
+    SimplifyMesh(vertices, mesh->verticesCount, indices, scast<size_t>(mesh->facesCount) * 3,
+                 rcast<const float*>(positions.data()), sizeof(vec3), ratio, lodVertices, lodIndices);
+    if (lodIndices.empty()) {
+        return nullptr;
+    }
+
+    RefPtr<MetroModelSkin> result = MakeRefPtr<MetroModelSkin>();
+    result->CreateMesh(lodVertices.size(), lodIndices.size() / 3, mesh->verticesScale);
+    result->CopyVerticesData(lodVertices.data());
+    result->CopyFacesData(lodIndices.data());
+    result->SetBonesRemapTable(mesh->bonesRemap);
+    if (skeleton) {
+        result->SetBonesOBB(CalculateBonesOBBs(lodVertices.data(), lodVertices.size(), mesh->verticesScale, mesh->bonesRemap, *skeleton));
+    } else {
+        result->SetBonesOBB(mesh->bonesOBBs);
+    }
+    CopyLODMaterial(model, result.get());
+
+    AABBox bbox;
+    bbox.Reset();
+    for (const VertexSkinned& v : lodVertices) {
+        bbox.Absorb(DecodeSkinnedPosition(v.pos) * mesh->verticesScale);
+    }
+    SetLODBounds(result.get(), bbox);
 
     return result;
 }
+
+static const MetroSkeleton* FindSkeleton(const MetroModelBase* model) {
+    if (model->IsSkeleton()) {
+        return scast<const MetroModelSkeleton*>(model)->GetSkeleton().get();
+    } else if (model->GetModelType() == MetroModelType::Skin) {
+        const MetroModelSkeleton* parent = scast<const MetroModelSkin*>(model)->GetParent();
+        return parent ? parent->GetSkeleton().get() : nullptr;
+    } else {
+        return nullptr;
+    }
+}
+
+static RefPtr<MetroModelBase> BuildMeshLOD(const MetroModelBase* model, const MetroSkeleton* skeleton, const float ratio) {
+    switch (model->GetModelType()) {
+        case MetroModelType::Std:
+            return BuildStdLOD(model, ratio);
+        case MetroModelType::Skin:
+            return BuildSkinLOD(model, skeleton, ratio);
+        default:
+            return nullptr;
+    }
+}
+
+
+// single Std or Skin mesh
+RefPtr<MetroModelBase> BuildModelLOD(RefPtr<MetroModelBase>& model, const float ratio) {
+    return BuildMeshLOD(model.get(), FindSkeleton(model.get()), ratio);
+}
+
+// Replaces the lods of a hierarchy, skinned hierarchy or skeleton model with simplified copies of its (non-collision) children.
+//  One lod per ratio (up to kMaxLODs), every mesh x ratio pair is simplified in parallel.
+//  Skeletons get their lods as Hierarchy2 models of Skin meshes, the same layout they load them in.
+bool BuildModelLODs(RefPtr<MetroModelBase>& model, const MyArray<float>& ratios) {
+    if (!model || !model->IsHierarchy() || ratios.empty()) {
+        return false;
+    }
+
+    RefPtr<MetroModelHierarchy> hierarchy = SCastRefPtr<MetroModelHierarchy>(model);
+    const bool isSkinned = model->IsSkeleton() || model->IsSkinnedHierarchy();
+    const MetroModelType meshType = isSkinned ? MetroModelType::Skin : MetroModelType::Std;
+    const MetroSkeleton* skeleton = FindSkeleton(model.get());
+
+    MyArray<RefPtr<MetroModelBase>> srcMeshes;
+    const size_t numChildren = hierarchy->GetChildrenCount();
+    for (size_t i = 0; i < numChildren; ++i) {
+        RefPtr<MetroModelBase> child = hierarchy->GetChild(i);
+        if (!child->IsCollisionModel() && child->GetModelType() == meshType) {
+            srcMeshes.push_back(child);
+        }
+    }
+
+    if (srcMeshes.empty()) {
+        return false;
+    }
+
+    const size_t numMeshes = srcMeshes.size();
+    const size_t numLods = std::min(ratios.size(), kMaxLODs);
+
+    MyArray<RefPtr<MetroModelBase>> lodMeshes(numMeshes * numLods);
+    ParallelFor(lodMeshes.size(), [&](const size_t idx, const size_t) {
+        const size_t lodIdx = idx / numMeshes;
+        const size_t meshIdx = idx % numMeshes;
+        lodMeshes[idx] = BuildMeshLOD(srcMeshes[meshIdx].get(), skeleton, ratios[lodIdx]);
+    });
+
+    hierarchy->RemoveLODs();
+
+    for (size_t i = 0; i < numLods; ++i) {
+        RefPtr<MetroModelHierarchy> lod = MakeRefPtr<MetroModelHierarchy>();
+        lod->SetModelVersion(model->GetModelVersion());
+        if (isSkinned) {
+            lod->SetModelType(MetroModelType::Hierarchy2);
+        }
+
+        for (size_t j = 0; j < numMeshes; ++j) {
+            const RefPtr<MetroModelBase>& lm = lodMeshes[i * numMeshes + j];
+            if (lm) {
+                lod->AddChild(lm);
+            }
+        }
+
+        // lods can't have gaps
+        if (!lod->GetChildrenCount()) {
+            break;
+        }
+
+        hierarchy->AddLOD(lod);
+    }
+
+    return true;
+}
+
+// bones OBBs of a Skin mesh in the bind pose of the skeleton
+MyArray<OBBox> CalculateSkinBonesOBBs(const MetroModelBase& skin, const MetroSkeleton& skeleton) {
+    const RefPtr<MetroModelMesh> mesh = skin.GetMesh();
+    const VertexSkinned* vertices = rcast<const VertexSkinned*>(skin.GetVerticesMemData());
+    if (!mesh || !vertices) {
+        return {};
+    }
+
+    return CalculateBonesOBBs(vertices, mesh->verticesCount, mesh->verticesScale, mesh->bonesRemap, skeleton);
+}
@@ -2,8 +2,266 @@
 
 #include <QApplication>
 
+#include "mycommon.h"
+#include "ModelAOBenchmark.h"
+#include "metro/MetroModelBenchmark.h"
+#include "metro/MetroMotionBenchmark.h"
+#include "metro/MetroMotionOptimizer.h"
+#include "metro/MetroSkeleton.h"
+#include "log.h"
+#include "json_utils.h"
+#include "engine/AnimatorBenchmark.h"
+#include "exporters/ExporterOBJBenchmark.h"
+#include "importers/ImporterOBJBenchmark.h"
+
+// the benchmarks all start with <results.json> [iterations], the rest of the arguments is theirs
+struct BenchArgs {
+    fs::path    resultPath;
+    size_t      numIterations;
+};
+
+static bool GetBenchArgs(const QStringList& args, BenchArgs& benchArgs) {
+    if (args.size() < 3) {
+        return false;
+    }
+
+    benchArgs.resultPath = args[2].toStdWString();
+    benchArgs.numIterations = (args.size() > 3) ? scast<size_t>(std::max(1, args[3].toInt())) : 1;
+    return true;
+}
+
+// MetroME -motionbench <results.json> [iterations]
+//  plays the synthetic motions back with every keyframes lookup mode and dumps the numbers as json
+static int RunMotionBenchmark(const QStringList& args) {
+    BenchArgs benchArgs;
+    if (!GetBenchArgs(args, benchArgs)) {
+        return 1;
+    }
+
+    MetroMotionBenchmark bench;
+    bench.AddDefaultSyntheticMotions();
+    bench.Run(benchArgs.numIterations);
+    return JsonSaveTree(bench.ToJsonTree(), benchArgs.resultPath) ? 0 : 3;
+}
+
+// MetroME -posebench <results.json> [iterations]
+//  evaluates whole poses of the synthetic skeletons (up to 200 bones) headless and dumps the numbers as json
+static int RunPoseBenchmark(const QStringList& args) {
+    BenchArgs benchArgs;
+    if (!GetBenchArgs(args, benchArgs)) {
+        return 1;
+    }
+
+    u4a::AnimatorBenchmark bench;
+    bench.AddDefaultSyntheticSetups();
+    bench.Run(benchArgs.numIterations);
+    return JsonSaveTree(bench.ToJsonTree(), benchArgs.resultPath) ? 0 : 3;
+}
+
+// MetroME -modelloadbench <results.json> [iterations]
+//  writes the synthetic 40 parts skinned characters as .model + .mesh files to a temp content folder and loads them
+//  with the lod meshes loaded serially and in parallel, dumps the numbers as json
+static int RunModelLoadBenchmark(const QStringList& args) {
+    BenchArgs benchArgs;
+    if (!GetBenchArgs(args, benchArgs)) {
+        return 1;
+    }
+
+    MetroModelBenchmark bench;
+    bench.AddDefaultSyntheticModels();
+    bench.Run(benchArgs.numIterations);
+    return JsonSaveTree(bench.ToJsonTree(), benchArgs.resultPath) ? 0 : 3;
+}
+
+// MetroME -objbench <results.json> [iterations]
+//  formats the synthetic 5M triangles model into .obj text the old (stringstream) and the new way, dumps the numbers as json
+static int RunObjExportBenchmark(const QStringList& args) {
+    BenchArgs benchArgs;
+    if (!GetBenchArgs(args, benchArgs)) {
+        return 1;
+    }
+
+    ExporterOBJBenchmark bench;
+    bench.AddDefaultSyntheticModels();
+    bench.Run(benchArgs.numIterations);
+    return JsonSaveTree(bench.ToJsonTree(), benchArgs.resultPath) ? 0 : 3;
+}
+
+// MetroME -importbench <results.json> [iterations]
+//  imports the synthetic grid meshes (2k to 129k triangles) with the exact and the epsilon weld, dumps the numbers as json
+static int RunImportBenchmark(const QStringList& args) {
+    BenchArgs benchArgs;
+    if (!GetBenchArgs(args, benchArgs)) {
+        return 1;
+    }
+
+    ImporterOBJBenchmark bench;
+    bench.AddDefaultSyntheticMeshes();
+    bench.Run({ 0.0f, 0.0001f }, benchArgs.numIterations);
+    return JsonSaveTree(bench.ToJsonTree(), benchArgs.resultPath) ? 0 : 3;
+}
+
+// MetroME -aobench <results.json> [iterations] [quality]
+//  bakes vertex AO into the synthetic bumps with the old single rays tracer and the packet one, dumps the numbers as json
+static int RunAOBenchmark(const QStringList& args) {
+    BenchArgs benchArgs;
+    if (!GetBenchArgs(args, benchArgs)) {
+        return 1;
+    }
+    const size_t quality = (args.size() > 4) ? scast<size_t>(std::max(0, args[4].toInt())) : 1;
+
+    ModelAOBenchmark bench;
+    bench.AddDefaultSyntheticModels();
+    bench.Run(quality, benchArgs.numIterations);
+    return JsonSaveTree(bench.ToJsonTree(), benchArgs.resultPath) ? 0 : 3;
+}
+
+// MetroME -motionoptimize <src motion> <dst motion> [rotation tolerance, degrees] [position tolerance, cm]
+//  saves the motion with the keys reduction and compression, loads it back and checks every bone against the source
+static int RunMotionOptimize(const QStringList& args) {
+    if (args.size() < 4) {
+        return 1;
+    }
+
+    const fs::path srcPath = args[2].toStdWString();
+    const fs::path dstPath = args[3].toStdWString();
+
+    MetroMotionOptimizeParams params;
+    if (args.size() > 4) {
+        params.rotationTolerance = args[4].toFloat();
+    }
+    if (args.size() > 5) {
+        params.positionTolerance = args[5].toFloat();
+    }
+
+    MemStream srcStream = OSReadFile(srcPath);
+    MetroMotion source(srcPath.filename().u8string());
+    if (!srcStream || !source.LoadFromData(srcStream)) {
+        return 2;
+    }
+
+    MetroMotionOptimizeStats stats;
+    MemWriteStream dstStream;
+    if (!source.SaveToStream(dstStream, &params, &stats) ||
+        !OSWriteFile(dstPath, dstStream.Data(), dstStream.GetWrittenBytesCount())) {
+        return 3;
+    }
+
+    MemStream savedStream(dstStream.Data(), dstStream.GetWrittenBytesCount());
+    MetroMotion saved(dstPath.filename().u8string());
+    if (!saved.LoadFromData(savedStream)) {
+        return 3;
+    }
+
+    MetroMotionErrorStats errors;
+    MOT_MeasureMotionError(source, saved, errors);
+
+    LogPrintF(LogLevel::Info, "Motion %s: %zu curves (%zu one value, %zu compressed quat, %zu compressed pos, %zu uncompressed)",
+              source.GetName().c_str(), stats.numCurves, stats.numOneValue, stats.numCompressedQuat, stats.numCompressedPos, stats.numUncompressed);
+    LogPrintF(LogLevel::Info, "  keys %zu -> %zu, curves %zu -> %zu bytes, motion data %zu -> %zu bytes",
+              stats.keysBefore, stats.keysAfter, stats.curvesSizeBefore, stats.curvesSizeAfter, stats.dataSizeBefore, stats.dataSizeAfter);
+    LogPrintF(LogLevel::Info, "  max error over %zu samples: %f deg, %f cm, %f scale",
+              errors.numSamples, errors.maxRotationError, errors.maxPositionError, errors.maxScaleError);
+
+    return errors.IsWithin(params) ? 0 : 4;
+}
+
+// MetroME -motionoptimizetest
+//  self check of the motion optimizer, no game files needed: the synthetic motions are saved optimized in the old
+//  byte swapped (v14) and the current (v17) layouts, loaded back and checked per bone and in the model space of a synthetic skeleton
+static int RunMotionOptimizeTest(const QStringList&) {
+    struct TestMotion {
+        const char* name;
+        size_t      numFrames;
+        size_t      keyStep;
+    };
+    const TestMotion testMotions[] = {
+        { "short_3s", 90, 1 },
+        { "long_60s", 1800, 1 },
+        { "long_60s_sparse", 1800, 4 },
+    };
+    const size_t versions[] = { 14, 17 };
+    const size_t numBones = 80;
+
+    RefPtr<MetroSkeleton> skeleton = u4a::AnimatorBenchmark::MakeSyntheticSkeleton(numBones);
+    const MetroMotionOptimizeParams params;
+
+    size_t numFailed = 0;
+    for (const size_t version : versions) {
+        for (const TestMotion& test : testMotions) {
+            RefPtr<MetroMotion> source = MetroMotionBenchmark::MakeSyntheticMotion(test.name, numBones, test.numFrames, test.keyStep);
+            source->mVersion = version;
+            source->mMotionDataHeader.bonesMask.Clear();
+            for (size_t i = 0; i < numBones; ++i) {
+                source->mMotionDataHeader.bonesMask.SetBit(i, true);
+            }
+
+            // a still bone and a scaled one, so the one value and the scale curves get their share too
+            for (AttributeCurve::AttribPoint& p : source->mBonesPositions[numBones / 2].points) {
+                p.value = vec4(0.1f, 0.2f, 0.3f, 0.0f);
+            }
+            source->mBonesScales.resize(numBones);
+            for (const AttributeCurve::AttribPoint& p : source->mBonesPositions[numBones - 1].points) {
+                source->mBonesScales[numBones - 1].points.push_back({ p.time, vec4(1.0f + p.value.x * 0.2f, 1.0f, 1.0f, 0.0f) });
+            }
+
+            MetroMotionOptimizeStats stats;
+            MemWriteStream dstStream;
+            bool ok = source->SaveToStream(dstStream, &params, &stats);
+
+            MemStream savedStream(dstStream.Data(), dstStream.GetWrittenBytesCount());
+            MetroMotion saved(source->GetName());
+            ok = ok && saved.LoadFromData(savedStream);
+
+            MetroMotionErrorStats errors;
+            MetroMotionModelErrorStats modelErrors;
+            if (ok) {
+                MOT_MeasureMotionError(*source, saved, errors);
+                ok = MOT_MeasureModelSpaceError(*source, saved, *skeleton, params, modelErrors);
+            }
+
+            const bool passed = ok && errors.IsWithin(params) && modelErrors.IsWithin();
+            numFailed += passed ? 0 : 1;
+
+            LogPrintF(passed ? LogLevel::Info : LogLevel::Error, "v%zu %s: %s, motion data %zu -> %zu bytes, local %f deg %f cm %f scale, model %f deg %f cm (%.0f%% of the bound)",
+                      version, test.name, passed ? "ok" : "FAILED", stats.dataSizeBefore, stats.dataSizeAfter,
+                      errors.maxRotationError, errors.maxPositionError, errors.maxScaleError,
+                      modelErrors.maxRotationError, modelErrors.maxPositionError, modelErrors.maxBoundUsage * 100.0f);
+        }
+    }
+
+    return numFailed ? 4 : 0;
+}
+
+// headless tools, the flag goes first and the editor doesn't start
+struct CommandLineTool {
+    const char* flag;
+    int         (*run)(const QStringList& args);
+};
+
+static const CommandLineTool kCommandLineTools[] = {
+    { "-motionbench",           RunMotionBenchmark },
+    { "-posebench",             RunPoseBenchmark },
+    { "-modelloadbench",        RunModelLoadBenchmark },
+    { "-objbench",              RunObjExportBenchmark },
+    { "-importbench",           RunImportBenchmark },
+    { "-aobench",               RunAOBenchmark },
+    { "-motionoptimize",        RunMotionOptimize },
+    { "-motionoptimizetest",    RunMotionOptimizeTest },
+};
+
 int main(int argc, char *argv[]) {
     QApplication a(argc, argv);
+
+    const QStringList args = a.arguments();
+    if (args.size() > 1) {
+        for (const CommandLineTool& tool : kCommandLineTools) {
+            if (args[1] == QLatin1String(tool.flag)) {
+                return tool.run(args);
+            }
+        }
+    }
+
     MainWindow w;
     w.show();
     return a.exec();
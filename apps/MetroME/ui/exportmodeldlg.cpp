@@ -64,6 +64,10 @@ bool ExportModelDlg::IsSavePhysics() const {
     return ui->chkSavePhysics->isChecked();
 }
 
+bool ExportModelDlg::IsOptimizeGeometry() const {
+    return ui->chkOptimizeGeometry->isChecked();
+}
+
 bool ExportModelDlg::IsOverrideModelVersion() const {
     return mShouldOverrideModelVersion;
 }
@@ -22,6 +22,7 @@ public:
     bool    IsExportMeshesInlined() const;
     bool    IsExportSkeletonInlined() const;
     bool    IsSavePhysics() const;
+    bool    IsOptimizeGeometry() const;
     bool    IsOverrideModelVersion() const;
     int     GetOverrideModelVersion() const;
 
@@ -0,0 +1,28 @@
+#include "importfbxdlg.h"
+#include "ui_importfbxdlg.h"
+
+ImportFBXDlg::ImportFBXDlg(QWidget *parent)
+    : QDialog(parent)
+    , ui(new Ui::ImportFBXDlg)
+{
+    ui->setupUi(this);
+    ui->label->setPixmap(QIcon(":/imgs/fbx.svg").pixmap(ui->label->size()));
+}
+
+ImportFBXDlg::~ImportFBXDlg() {
+    delete ui;
+}
+
+float ImportFBXDlg::GetWeldEpsilon() const {
+    return ui->chkWeldCloseVertices->isChecked() ? scast<float>(ui->spinWeldEpsilon->value()) : 0.0f;
+}
+
+
+void ImportFBXDlg::on_chkWeldCloseVertices_stateChanged(int state) {
+    ui->spinWeldEpsilon->setEnabled(ui->chkWeldCloseVertices->isChecked());
+}
+
+
+void ImportFBXDlg::on_buttonBox_accepted() {
+    this->accept();
+}
@@ -0,0 +1,29 @@
+#ifndef IMPORTFBXDLG_H
+#define IMPORTFBXDLG_H
+
+#include <QDialog>
+#include "mycommon.h"
+
+namespace Ui {
+class ImportFBXDlg;
+}
+
+class ImportFBXDlg : public QDialog {
+    Q_OBJECT
+
+public:
+    explicit ImportFBXDlg(QWidget *parent = nullptr);
+    ~ImportFBXDlg();
+
+    // 0 - only the exact duplicates get welded
+    float   GetWeldEpsilon() const;
+
+private slots:
+    void    on_chkWeldCloseVertices_stateChanged(int state);
+    void    on_buttonBox_accepted();
+
+private:
+    Ui::ImportFBXDlg*   ui;
+};
+
+#endif // IMPORTFBXDLG_H
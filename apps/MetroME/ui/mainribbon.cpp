@@ -46,7 +46,11 @@ MainRibbon::MainRibbon(QWidget* parent)
     , mGroup3DViewRenderer(nullptr)
     // model controls
     , mComboTPreset(nullptr)
+    , mAOMaxDistance(nullptr)
+    , mAOAdaptive(nullptr)
     , mCalculateAOButton(nullptr)
+    , mAOTextureSize(nullptr)
+    , mBakeAOTextureButton(nullptr)
     , mBuildLODsButton(nullptr)
     // skeleton controls
     , mBuildBonesOBBsButton(nullptr)
@@ -169,7 +173,13 @@ void MainRibbon::OnModelTPresetEditClicked() {
 
 void MainRibbon::OnModelCalculateAOClicked() {
     const int idx = mAOCalcQuality->currentIndex();
-    emit SignalModelCalculateAOClicked(idx >= 0 ? idx : 0);
+    emit SignalModelCalculateAOClicked(idx >= 0 ? idx : 0, scast<float>(mAOMaxDistance->value()), mAOAdaptive->isChecked());
+}
+
+void MainRibbon::OnModelBakeAOTextureClicked() {
+    const int idx = mAOCalcQuality->currentIndex();
+    const int resolution = mAOTextureSize->currentData().toInt();
+    emit SignalModelBakeAOTextureClicked(idx >= 0 ? idx : 0, scast<float>(mAOMaxDistance->value()), mAOAdaptive->isChecked(), resolution);
 }
 
 void MainRibbon::OnModelBuildLODsClicked() {
@@ -363,6 +373,54 @@ void MainRibbon::BuildModelTab() {
         vbar->AddWidget(mCalculateAOButton);
         mGroupModelAO->AddWidget(vbar);
     }
+    {
+        SimpleRibbonVBar* vbar = new SimpleRibbonVBar();
+        QLabel* label = new QLabel();
+        label->setText(tr("AO max distance:"));
+        label->setAlignment(Qt::AlignHCenter);
+
+        // 0 is unlimited, anything else limits the rays and weights the occlusion by the hit distance
+        mAOMaxDistance = new QDoubleSpinBox();
+        mAOMaxDistance->setRange(0.0, 100.0);
+        mAOMaxDistance->setDecimals(2);
+        mAOMaxDistance->setSingleStep(0.1);
+        mAOMaxDistance->setSuffix(tr(" m"));
+        mAOMaxDistance->setSpecialValueText(tr("Unlimited"));
+        mAOMaxDistance->setValue(0.0);
+
+        // quality becomes the maximum samples count, converged vertices stop early
+        mAOAdaptive = new QCheckBox();
+        mAOAdaptive->setText(tr("Adaptive"));
+        mAOAdaptive->setChecked(true);
+
+        vbar->AddWidget(label);
+        vbar->AddWidget(mAOMaxDistance);
+        vbar->AddWidget(mAOAdaptive);
+        mGroupModelAO->AddWidget(vbar);
+    }
+    {
+        SimpleRibbonVBar* vbar = new SimpleRibbonVBar();
+        QLabel* label = new QLabel();
+        label->setText(tr("AO texture size:"));
+        label->setAlignment(Qt::AlignHCenter);
+
+        // Metro textures tiers, from .512 up to .4096
+        mAOTextureSize = new QComboBox();
+        for (int resolution = 512; resolution <= 4096; resolution *= 2) {
+            mAOTextureSize->addItem(QString("%1 x %1").arg(resolution), resolution);
+        }
+        mAOTextureSize->setCurrentIndex(2);
+        mAOTextureSize->setEditable(false);
+
+        mBakeAOTextureButton = new QPushButton();
+        mBakeAOTextureButton->setText(tr("Bake texture..."));
+        connect(mBakeAOTextureButton, &QPushButton::clicked, this, &MainRibbon::OnModelBakeAOTextureClicked);
+
+        vbar->AddWidget(label);
+        vbar->AddWidget(mAOTextureSize);
+        vbar->AddWidget(mBakeAOTextureButton);
+        mGroupModelAO->AddWidget(vbar);
+    }
 
     // LODs
     {
@@ -64,7 +64,8 @@ signals:
     //
     void    SignalModelTPresetChanged(int index);
     void    SignalModelTPresetEditClicked();
-    void    SignalModelCalculateAOClicked(int quality);
+    void    SignalModelCalculateAOClicked(int quality, float maxDistance, bool adaptive);
+    void    SignalModelBakeAOTextureClicked(int quality, float maxDistance, bool adaptive, int resolution);
     void    SignalModelBuildLODsClicked();
     //
     void    SignalSkeletonBuildBonesOBBsClicked();
@@ -101,6 +102,7 @@ private slots:
     void    OnModelTPresetChanged(int index);
     void    OnModelTPresetEditClicked();
     void    OnModelCalculateAOClicked();
+    void    OnModelBakeAOTextureClicked();
     void    OnModelBuildLODsClicked();
     //
     void    OnSkeletonBuildBonesOBBsClicked();
@@ -154,7 +156,11 @@ private:
     // model controls
     QComboBox*          mComboTPreset;
     QComboBox*          mAOCalcQuality;
+    QDoubleSpinBox*     mAOMaxDistance;
+    QCheckBox*          mAOAdaptive;
     QPushButton*        mCalculateAOButton;
+    QComboBox*          mAOTextureSize;
+    QPushButton*        mBakeAOTextureButton;
     QPushButton*        mBuildLODsButton;
     // skeleton controls
     QPushButton*        mBuildBonesOBBsButton;
@@ -5,6 +5,7 @@
 #include "sessionsdlg.h"
 #include "exportmodeldlg.h"
 #include "exportfbxdlg.h"
+#include "importfbxdlg.h"
 #include "edittpresetsdlg.h"
 
 #include <QToolButton>
@@ -18,6 +19,7 @@
 
 #include "metro/MetroContext.h"
 #include "metro/MetroModel.h"
+#include "metro/MetroModelOptimizer.h"
 #include "metro/MetroSkeleton.h"
 
 #include "engine/Renderer.h"
@@ -36,14 +38,6 @@
 #define PHYSX3UTILS_IMPORT 1
 #include "physx/physx3utils/physx3utils.h"
 
-#ifdef min
-#undef min
-#endif
-#ifdef max
-#undef max
-#endif
-#include "Mathematics/ContOrientedBox3.h"
-
 #include "engine/DebugGeo.h"
 
 static RefPtr<u4a::DebugGeo> DebugGeoFromCForm(MetroPhysicsCForm* phys, const MetroGameVersion gameVersion) {
@@ -181,6 +175,7 @@ RefPtr<MetroPhysicsCForm> MakeCFormFromModel(MetroModelBase* model, const MetroG
 #endif
 
 #include "../MetroSessions.h"
+#include "../ModelAOCalculator.h"
 
 
 MainWindow::MainWindow(QWidget *parent)
@@ -219,6 +214,7 @@ MainWindow::MainWindow(QWidget *parent)
     connect(ui->ribbon, &MainRibbon::SignalModelTPresetChanged, this, &MainWindow::OnTPresetChanged);
     connect(ui->ribbon, &MainRibbon::SignalModelTPresetEditClicked, this, &MainWindow::OnTPresetsEdit);
     connect(ui->ribbon, &MainRibbon::SignalModelCalculateAOClicked, this, &MainWindow::OnCalculateAO);
+    connect(ui->ribbon, &MainRibbon::SignalModelBakeAOTextureClicked, this, &MainWindow::OnBakeAOTexture);
     connect(ui->ribbon, &MainRibbon::SignalModelBuildLODsClicked, this, &MainWindow::OnBuildLODs);
     //
     connect(ui->ribbon, &MainRibbon::SignalSkeletonBuildBonesOBBsClicked, this, &MainWindow::OnSkeletonBuildOBBs);
@@ -432,15 +428,19 @@ void MainWindow::OnImportOBJModel() {
 void MainWindow::OnImportFBXModel() {
     QString name = QFileDialog::getOpenFileName(this, tr("Choose FBX model file..."), QString(), tr("FBX model files (*.fbx);;All files (*.*)"));
     if (!name.isEmpty()) {
-        fs::path fullPath = name.toStdWString();
+        ImportFBXDlg dlg(this);
+        if (QDialog::Accepted == dlg.exec()) {
+            fs::path fullPath = name.toStdWString();
 
-        ImporterFBX importer;
-        importer.SetGameVersion(MetroContext::Get().GetGameVersion());
-        RefPtr<MetroModelBase> model = importer.ImportModel(fullPath);
-        if (model && mRenderPanel) {
-            mRenderPanel->SetModel(model);
+            ImporterFBX importer;
+            importer.SetGameVersion(MetroContext::Get().GetGameVersion());
+            importer.SetWeldEpsilon(dlg.GetWeldEpsilon());
+            RefPtr<MetroModelBase> model = importer.ImportModel(fullPath);
+            if (model && mRenderPanel) {
+                mRenderPanel->SetModel(model);
 
-            this->UpdateUIForTheModel(model.get());
+                this->UpdateUIForTheModel(model.get());
+            }
         }
     }
 }
@@ -468,9 +468,27 @@ void MainWindow::OnExportMetroModel() {
                     params.saveFlags |= MetroModelSaveParams::SaveFlags::InlineSkeleton;
                 }
 
+                MetroGeometryOptimizeStats optimizeStats;
+                if (dlg.IsOptimizeGeometry()) {
+                    params.saveFlags |= MetroModelSaveParams::SaveFlags::OptimizeGeometry;
+                    params.optimizeStats = &optimizeStats;
+                }
+
                 MemWriteStream stream;
                 if (model->Save(stream, params)) {
                     OSWriteFile(fullPath, stream.Data(), stream.GetWrittenBytesCount());
+
+                    if (optimizeStats.numMeshes) {
+                        const QString report = tr("Optimized %1 meshes (%2 vertices, %3 faces)\n\nACMR: %4 -> %5\nATVR: %6 -> %7")
+                                               .arg(optimizeStats.numMeshes)
+                                               .arg(optimizeStats.numVertices)
+                                               .arg(optimizeStats.numFaces)
+                                               .arg(optimizeStats.GetACMRBefore(), 0, 'f', 3)
+                                               .arg(optimizeStats.GetACMRAfter(), 0, 'f', 3)
+                                               .arg(optimizeStats.GetATVRBefore(), 0, 'f', 3)
+                                               .arg(optimizeStats.GetATVRAfter(), 0, 'f', 3);
+                        QMessageBox::information(this, this->windowTitle(), report);
+                    }
                 }
             }
         }
@@ -523,7 +541,7 @@ void MainWindow::OnExportFBXModel() {
 void MainWindow::OnExportGLTFModel() {
     RefPtr<MetroModelBase> model = mRenderPanel ? mRenderPanel->GetModel() : nullptr;
     if (model) {
-        QString name = QFileDialog::getSaveFileName(this, tr("Where to export GLTF model..."), QString(), tr("FBX model file (*.gltf);;All files (*.*)"));
+        QString name = QFileDialog::getSaveFileName(this, tr("Where to export GLTF model..."), QString(), tr("GLTF model file (*.gltf);;GLTF binary model file (*.glb);;All files (*.*)"));
         if (!name.isEmpty()) {
             fs::path fullPath = name.toStdWString();
 
@@ -667,52 +685,68 @@ void MainWindow::OnTPresetsEdit() {
     }
 }
 
-extern "C++" bool CalculateModelAO(RefPtr<MetroModelBase>& model, const size_t quality);
-void MainWindow::OnCalculateAO(int quality) {
+void MainWindow::OnCalculateAO(int quality, float maxDistance, bool adaptive) {
     RefPtr<MetroModelBase> model = mRenderPanel ? mRenderPanel->GetModel() : nullptr;
     if (model) {
-        if (CalculateModelAO(model, scast<size_t>(quality))) {
+        ModelAOParams params;
+        params.quality = scast<size_t>(quality);
+        params.maxDistance = maxDistance;
+        params.adaptive = adaptive;
+
+        ModelAOStats stats;
+        if (CalculateModelAO(model, params, &stats)) {
             this->OnModelMeshPropertiesChanged();
+
+            const QString report = tr("AO calculated for %1 vertices\n\nRays traced: %2 of %3 (%4 samples per vertex)\nTime: %5 sec")
+                                   .arg(stats.numVertices)
+                                   .arg(stats.numRays)
+                                   .arg(stats.numRaysMax)
+                                   .arg(stats.numVertices ? scast<double>(stats.numRays) / scast<double>(stats.numVertices) : 0.0, 0, 'f', 1)
+                                   .arg(stats.seconds, 0, 'f', 2);
+            QMessageBox::information(this, this->windowTitle(), report);
         }
     }
 }
 
-extern "C++" RefPtr<MetroModelBase> BuildModelLOD(RefPtr<MetroModelBase>&model, const float ratio);
-void MainWindow::OnBuildLODs() {
+void MainWindow::OnBakeAOTexture(int quality, float maxDistance, bool adaptive, int resolution) {
     RefPtr<MetroModelBase> model = mRenderPanel ? mRenderPanel->GetModel() : nullptr;
     if (model) {
-        if (model->IsSkeleton() || model->IsSkinnedHierarchy() || model->IsSoft()) {
-            QMessageBox::critical(this, this->windowTitle(), tr("Only static models supported at the moment!"));
-        } else {
-            RefPtr<MetroModelHierarchy> hierarchy = SCastRefPtr<MetroModelHierarchy>(model);
-            hierarchy->RemoveLODs();
-
-            const size_t numChildren = hierarchy->GetChildrenCount();
-
-            for (size_t i = 0; i < 2; ++i) {
-                const float ratio = (i == 0) ? 0.6f : 0.3f;
-
-                MyArray<RefPtr<MetroModelBase>> lodMeshes; lodMeshes.reserve(numChildren);
-                for (size_t i = 0; i < numChildren; ++i) {
-                    RefPtr<MetroModelBase> child = hierarchy->GetChild(i);
-                    if (!child->IsCollisionModel()) {
-                        RefPtr<MetroModelBase> lodMesh = BuildModelLOD(child, ratio);
-                        if (lodMesh) {
-                            lodMeshes.push_back(lodMesh);
-                        }
-                    }
-                }
-
-                if (!lodMeshes.empty()) {
-                    RefPtr<MetroModelHierarchy> lod = MakeRefPtr<MetroModelHierarchy>();
-                    for (auto& lm : lodMeshes) {
-                        lod->AddChild(lm);
-                    }
-
-                    hierarchy->AddLOD(lod);
-                }
+        QString name = QFileDialog::getSaveFileName(this, tr("Where to save AO texture..."), QString(), tr("Metro texture file (*.512);;All files (*.*)"));
+        if (!name.isEmpty()) {
+            // tiers extensions (.512, .1024 ...) are added by the texture itself
+            fs::path fullPath = name.toStdWString();
+            fullPath.replace_extension("");
+
+            ModelAOTextureParams params;
+            params.resolution = scast<size_t>(resolution);
+            params.quality = scast<size_t>(quality);
+            params.maxDistance = maxDistance;
+            params.adaptive = adaptive;
+
+            ModelAOStats stats;
+            if (BakeModelAOTexture(model, params, fullPath, &stats)) {
+                const QString report = tr("AO baked into %1 texture(s), %2 texels\n\nRays traced: %3 of %4 (%5 samples per texel)\nTime: %6 sec")
+                                       .arg(stats.numTextures)
+                                       .arg(stats.numTexels)
+                                       .arg(stats.numRays)
+                                       .arg(stats.numRaysMax)
+                                       .arg(stats.numTexels ? scast<double>(stats.numRays) / scast<double>(stats.numTexels) : 0.0, 0, 'f', 1)
+                                       .arg(stats.seconds, 0, 'f', 2);
+                QMessageBox::information(this, this->windowTitle(), report);
+            } else {
+                QMessageBox::critical(this, this->windowTitle(), tr("Failed to bake AO texture!"));
             }
+        }
+    }
+}
 
+extern "C++" bool BuildModelLODs(RefPtr<MetroModelBase>& model, const MyArray<float>& ratios);
+void MainWindow::OnBuildLODs() {
+    RefPtr<MetroModelBase> model = mRenderPanel ? mRenderPanel->GetModel() : nullptr;
+    if (model) {
+        if (!model->IsHierarchy()) {
+            QMessageBox::critical(this, this->windowTitle(), tr("Only hierarchy and skeleton models can have LODs!"));
+        } else if (BuildModelLODs(model, { 0.6f, 0.3f })) {
             this->OnModelMeshPropertiesChanged();
         }
     }
@@ -739,6 +773,7 @@ void MainWindow::OnPhysicsBuild(int physicsSource) {
 }
 
 //
+extern "C++" MyArray<OBBox> CalculateSkinBonesOBBs(const MetroModelBase& skin, const MetroSkeleton& skeleton);
 void MainWindow::OnSkeletonBuildOBBs() {
     RefPtr<MetroModelBase> model = mRenderPanel ? mRenderPanel->GetModel() : nullptr;
     if (model && model->IsSkeleton()) {
@@ -748,32 +783,7 @@ void MainWindow::OnSkeletonBuildOBBs() {
         const size_t numChildren = skelModel->GetChildrenCount();
         for (size_t i = 0; i < numChildren; ++i) {
             RefPtr<MetroModelBase> child = skelModel->GetChild(i);
-            RefPtr<MetroModelMesh> mesh = child->GetMesh();
-            const size_t numVertices = mesh->verticesCount;
-            const VertexSkinned* vertices = rcast<const VertexSkinned*>(child->GetVerticesMemData());
-            MyArray<MyArray<vec3>> perBoneVertices(mesh->bonesRemap.size());
-            for (size_t j = 0; j < numVertices; ++j) {
-                const size_t boneIdx = vertices[j].bones[2] / 3;    // ZYXW swizzle so bone 2 is the first bone (with bigger weight)
-                mat4 boneInvTransform = skeleton->GetBoneFullTransformInv(mesh->bonesRemap[boneIdx]);
-                vec3 vertexPos = boneInvTransform * vec4(DecodeSkinnedPosition(vertices[j].pos) * mesh->verticesScale, 1.0f);
-                perBoneVertices[boneIdx].push_back(vertexPos);
-            }
-
-            MyArray<OBBox> obbs;
-            for (const MyArray<vec3>& boneVerts : perBoneVertices) {
-                gte::OrientedBox3<float> box3;
-                OBBox bbox; bbox.Reset();
-                if (!boneVerts.empty() && gte::GetContainer<float>(scast<int>(boneVerts.size()), rcast<const gte::Vector3<float>*>(boneVerts.data()), box3)) {
-                    bbox.matrix[0] = *rcast<vec3*>(&box3.axis[0]);
-                    bbox.matrix[1] = *rcast<vec3*>(&box3.axis[1]);
-                    bbox.matrix[2] = *rcast<vec3*>(&box3.axis[2]);
-                    bbox.offset = *rcast<vec3*>(&box3.center);
-                    bbox.hsize = *rcast<vec3*>(&box3.extent);
-                }
-                obbs.push_back(bbox);
-            }
-
-            SCastRefPtr<MetroModelSkin>(child)->SetBonesOBB(obbs);
+            SCastRefPtr<MetroModelSkin>(child)->SetBonesOBB(CalculateSkinBonesOBBs(*child, *skeleton));
         }
     }
 }
@@ -60,7 +60,8 @@ public slots:
     //
     void    OnTPresetChanged(int index);
     void    OnTPresetsEdit();
-    void    OnCalculateAO(int quality);
+    void    OnCalculateAO(int quality, float maxDistance, bool adaptive);
+    void    OnBakeAOTexture(int quality, float maxDistance, bool adaptive, int resolution);
     void    OnBuildLODs();
     //
     void    OnPhysicsBuild(int physicsSource);
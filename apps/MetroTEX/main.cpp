@@ -2,6 +2,111 @@
 
 #include <QApplication>
 
+#include "mycommon.h"
+#include "json_utils.h"
+#include "metro/MetroTextureBenchmark.h"
+#include "metro/MetroPngBenchmark.h"
+#include "metro/MetroTextureDupFinder.h"
+#include "metro/MetroContext.h"
+
+// MetroTEX -bench <images folder> <results.json> [iterations]
+//  runs every image (png/tga/bmp) through all default encoder presets and dumps the numbers as json
+static int RunTextureBenchmark(const QStringList& args) {
+    if (args.size() < 4) {
+        return 1;
+    }
+
+    const fs::path imagesFolder = args[2].toStdWString();
+    const fs::path resultPath = args[3].toStdWString();
+    const size_t numIterations = (args.size() > 4) ? scast<size_t>(std::max(1, args[4].toInt())) : 1;
+
+    MetroTextureBenchmark bench;
+
+    const MyArray<fs::path> files = OSPathGetEntriesList(imagesFolder, true, true);
+    for (const fs::path& file : files) {
+        WideString ext = file.extension().wstring();
+        std::transform(ext.begin(), ext.end(), ext.begin(), ::towlower);
+        if (ext == L".png" || ext == L".tga" || ext == L".bmp") {
+            bench.AddImage(file);
+        }
+    }
+
+    if (!bench.GetNumImages()) {
+        return 2;
+    }
+
+    bench.Run(MetroTextureBenchmark::GetDefaultPresets(), numIterations);
+    return JsonSaveTree(bench.ToJsonTree(), resultPath) ? 0 : 3;
+}
+
+// MetroTEX -pngbench <results.json> [iterations] [images folder]
+//  encodes the synthetic 2048^2 and 4096^2 images (and png/tga/bmp images of the folder, if any) with the PNG writer
+//  of the texture export and with stb_image_write, dumps the numbers as json
+static int RunPngBenchmark(const QStringList& args) {
+    if (args.size() < 3) {
+        return 1;
+    }
+
+    const fs::path resultPath = args[2].toStdWString();
+    const size_t numIterations = (args.size() > 3) ? scast<size_t>(std::max(1, args[3].toInt())) : 1;
+
+    MetroPngBenchmark bench;
+    bench.AddDefaultSyntheticImages();
+
+    if (args.size() > 4) {
+        const MyArray<fs::path> files = OSPathGetEntriesList(fs::path(args[4].toStdWString()), true, true);
+        for (const fs::path& file : files) {
+            WideString ext = file.extension().wstring();
+            std::transform(ext.begin(), ext.end(), ext.begin(), ::towlower);
+            if (ext == L".png" || ext == L".tga" || ext == L".bmp") {
+                bench.AddImage(file);
+            }
+        }
+    }
+
+    bench.Run(MetroPngBenchmark::GetDefaultPresets(), numIterations);
+    return JsonSaveTree(bench.ToJsonTree(), resultPath) ? 0 : 3;
+}
+
+// MetroTEX -dedup <game folder> <aliases.json> [max hash distance]
+//  scans all the game textures for exact and near duplicates and dumps alias suggestions as json
+static int RunTextureDedup(const QStringList& args) {
+    if (args.size() < 4) {
+        return 1;
+    }
+
+    const fs::path gameFolder = args[2].toStdWString();
+    const fs::path resultPath = args[3].toStdWString();
+
+    TextureDupScanParams params;
+    if (args.size() > 4) {
+        params.maxHashDistance = scast<uint32_t>(std::max(0, args[4].toInt()));
+    }
+
+    if (!MetroContext::Get().InitFromGameFolder(gameFolder)) {
+        return 2;
+    }
+
+    MetroTextureDupFinder finder;
+    const bool result = finder.Scan(MetroContext::Get().GetFilesystem(), params) && JsonSaveTree(finder.ToJsonTree(), resultPath);
+
+    MetroContext::Get().Shutdown();
+
+    return result ? 0 : 3;
+}
+
+// headless tools, the flag goes first and the editor doesn't start
+struct CommandLineTool {
+    const char* flag;
+    int         (*run)(const QStringList& args);
+};
+
+static const CommandLineTool kCommandLineTools[] = {
+    { "-bench",     RunTextureBenchmark },
+    { "-pngbench",  RunPngBenchmark },
+    { "-dedup",     RunTextureDedup },
+};
+
 int main(int argc, char* argv[]) {
     QApplication a(argc, argv);
 
@@ -9,6 +114,15 @@ int main(int argc, char* argv[]) {
     a.setOrganizationName("MetroTools");
     a.setApplicationName("MetroTEX");
 
+    const QStringList args = a.arguments();
+    if (args.size() > 1) {
+        for (const CommandLineTool& tool : kCommandLineTools) {
+            if (args[1] == QLatin1String(tool.flag)) {
+                return tool.run(args);
+            }
+        }
+    }
+
     MainWindow w;
     w.show();
     return a.exec();
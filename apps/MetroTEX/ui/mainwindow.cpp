@@ -238,7 +238,14 @@ void MainWindow::AddOrReplaceTexture(bool replaceCurrent) {
 
                         outFolder.replace_extension("");
                         fmt = texture.HasAlpha() ? MetroTexture::PixelFormat::BC3 : MetroTexture::PixelFormat::BC1;
-                        success = texture.SaveAsMetroTexture(outFolder, fmt);
+
+                        // normal maps are not colors, don't filter them in linear space
+                        CharString srcName = sourcePath.stem().string();
+                        std::transform(srcName.begin(), srcName.end(), srcName.begin(), ::tolower);
+                        MipGenParams mipParams;
+                        mipParams.srgb = !(StrContains(srcName, "_bump") || StrEndsWith(srcName, "_nm"));
+
+                        success = texture.SaveAsMetroTexture(outFolder, fmt, mipParams);
                     }
 
                     if (!success) {
@@ -0,0 +1,28 @@
+#include "cpu_utils.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+
+bool CPU_SupportsAVX2() {
+#ifdef _MSC_VER
+    int regs[4];
+    __cpuid(regs, 0);
+    if (regs[0] < 7) {
+        return false;
+    }
+
+    __cpuid(regs, 1);
+    const bool hasOSXSave = (regs[2] & (1 << 27)) != 0;
+    const bool hasAVX = (regs[2] & (1 << 28)) != 0;
+    if (!hasOSXSave || !hasAVX || (_xgetbv(0) & 6) != 6) {
+        return false;
+    }
+
+    __cpuidex(regs, 7, 0);
+    return (regs[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+// SIMD code paths are compiled in unconditionally and picked at runtime.
+//  Functions using AVX2 intrinsics are marked with TARGET_AVX2 (MSVC takes the intrinsics anywhere,
+//  gcc and clang need the attribute) and must only be called when CPU_SupportsAVX2() says so.
+
+#include <immintrin.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+bool    CPU_SupportsAVX2();
@@ -75,7 +75,9 @@ void DDS_DecompressBC7(const void* inputBlocks, void* outPixels, const size_t wi
 }
 
 template <bool alpha>
-void DDS_CompressBC_Common(const void* inputRGBA, void* outBlocks, const size_t width, const size_t height) {
+void DDS_CompressBC_Common(const void* inputRGBA, void* outBlocks, const size_t width, const size_t height, const DDSCompressParams& params) {
+    const int mode = (params.highQuality ? STB_DXT_HIGHQUAL : 0) | (params.dither ? STB_DXT_DITHER : 0);
+
     const size_t sx = (width < 4) ? width : 4;
     const size_t sy = (height < 4) ? height : 4;
 
@@ -92,21 +94,21 @@ void DDS_CompressBC_Common(const void* inputRGBA, void* outBlocks, const size_t
                 src += (width * 4);
             }
 
-            stb_compress_dxt_block(dst, pixelsBlock, alpha ? 1 : 0, STB_DXT_HIGHQUAL);
+            stb_compress_dxt_block(dst, pixelsBlock, alpha ? 1 : 0, mode);
             dst += alpha ? 16 : 8;
         }
     }
 }
 
-void DDS_CompressBC1(const void* inputRGBA, void* outBlocks, const size_t width, const size_t height) {
-    DDS_CompressBC_Common<false>(inputRGBA, outBlocks, width, height);
+void DDS_CompressBC1(const void* inputRGBA, void* outBlocks, const size_t width, const size_t height, const DDSCompressParams& params) {
+    DDS_CompressBC_Common<false>(inputRGBA, outBlocks, width, height, params);
 }
 
-void DDS_CompressBC3(const void* inputRGBA, void* outBlocks, const size_t width, const size_t height) {
-    DDS_CompressBC_Common<true>(inputRGBA, outBlocks, width, height);
+void DDS_CompressBC3(const void* inputRGBA, void* outBlocks, const size_t width, const size_t height, const DDSCompressParams& params) {
+    DDS_CompressBC_Common<true>(inputRGBA, outBlocks, width, height, params);
 }
 
-void DDS_CompressBC7(const void* inputRGBA, void* outBlocks, const size_t width, const size_t height) {
+void DDS_CompressBC7(const void* inputRGBA, void* outBlocks, const size_t width, const size_t height, const DDSCompressParams& params) {
     static bool sNeedInitBc7Comp = true;
 
     if (sNeedInitBc7Comp) {
@@ -114,9 +116,15 @@ void DDS_CompressBC7(const void* inputRGBA, void* outBlocks, const size_t width,
         sNeedInitBc7Comp = false;
     }
 
-    bc7enc16_compress_block_params params;
-    bc7enc16_compress_block_params_init(&params);
-    bc7enc16_compress_block_params_init_perceptual_weights(&params);
+    bc7enc16_compress_block_params bc7params;
+    bc7enc16_compress_block_params_init(&bc7params);
+    bc7params.m_perceptual = params.perceptual ? BC7ENC16_TRUE : BC7ENC16_FALSE;
+    bc7params.m_weights[0] = params.weights[0];
+    bc7params.m_weights[1] = params.weights[1];
+    bc7params.m_weights[2] = params.weights[2];
+    bc7params.m_weights[3] = params.weights[3];
+    bc7params.m_uber_level = std::min<uint32_t>(params.uberLevel, BC7ENC16_MAX_UBER_LEVEL);
+    bc7params.m_max_partitions_mode1 = std::min<uint32_t>(params.maxPartitions, BC7ENC16_MAX_PARTITIONS1);
 
     const size_t sx = (width < 4) ? width : 4;
     const size_t sy = (height < 4) ? height : 4;
@@ -134,7 +142,7 @@ void DDS_CompressBC7(const void* inputRGBA, void* outBlocks, const size_t width,
                 src += (width * 4);
             }
 
-            bc7enc16_compress_block(dst, pixelsBlock, &params);
+            bc7enc16_compress_block(dst, pixelsBlock, &bc7params);
             dst += 16;
         }
     }
@@ -10,9 +10,21 @@ void DDS_DecompressBC3(const void* inputBlocks, void* outPixels, const size_t wi
 //void DDS_DecompressBC6H(const void* inputBlocks, void* outPixels, const size_t width, const size_t height);
 void DDS_DecompressBC7(const void* inputBlocks, void* outPixels, const size_t width, const size_t height);
 
-void DDS_CompressBC1(const void* inputRGBA, void* outBlocks, const size_t width, const size_t height);
-void DDS_CompressBC3(const void* inputRGBA, void* outBlocks, const size_t width, const size_t height);
-void DDS_CompressBC7(const void* inputRGBA, void* outBlocks, const size_t width, const size_t height);
+// encoder settings, defaults are what we've always been using
+struct DDSCompressParams {
+    // BC1 / BC3 (stb_dxt)
+    bool        highQuality = true;                 // extra refinement pass, ~30-40% slower
+    bool        dither = false;                     // never for normal maps
+    // BC7 (bc7enc16)
+    bool        perceptual = true;                  // measure error in YCbCr instead of RGB
+    uint32_t    weights[4] = { 128, 64, 16, 32 };   // relative YCbCrA (or RGBA if not perceptual) weights
+    uint32_t    uberLevel = 0;                      // 0 .. 4, higher is slower and better
+    uint32_t    maxPartitions = 64;                 // 0 .. 64, mode 1 partitions to try
+};
+
+void DDS_CompressBC1(const void* inputRGBA, void* outBlocks, const size_t width, const size_t height, const DDSCompressParams& params = DDSCompressParams());
+void DDS_CompressBC3(const void* inputRGBA, void* outBlocks, const size_t width, const size_t height, const DDSCompressParams& params = DDSCompressParams());
+void DDS_CompressBC7(const void* inputRGBA, void* outBlocks, const size_t width, const size_t height, const DDSCompressParams& params = DDSCompressParams());
 
 size_t DDS_GetCompressedSizeBC1(const size_t width, const size_t height, const size_t numMips);
 size_t DDS_GetCompressedSizeBC7(const size_t width, const size_t height, const size_t numMips);
@@ -1,6 +1,16 @@
 #include "mycommon.h"
 #include <fstream>
 
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 MemStream OSReadFile(const fs::path& filePath) {
     std::ifstream file(filePath, std::ifstream::binary);
     if (file.good()) {
@@ -42,6 +52,52 @@ MemStream OSReadFileEX(const fs::path& filePath, const size_t subOffset, const s
     }
 }
 
+MemStream OSMapFile(const fs::path& filePath) {
+    MemStream result;
+
+#ifdef _WIN32
+    HANDLE file = ::CreateFileW(filePath.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file != INVALID_HANDLE_VALUE) {
+        LARGE_INTEGER fileSize;
+        if (::GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0) {
+            HANDLE mapping = ::CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mapping != nullptr) {
+                void* view = ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+                if (view != nullptr) {
+                    std::shared_ptr<uint8_t> owner(rcast<uint8_t*>(view), [mapping](uint8_t* ptr) {
+                        ::UnmapViewOfFile(ptr);
+                        ::CloseHandle(mapping);
+                    });
+                    result = MemStream(view, scast<size_t>(fileSize.QuadPart), owner, scast<size_t>(fileSize.QuadPart));
+                } else {
+                    ::CloseHandle(mapping);
+                }
+            }
+        }
+        // the mapping holds its own reference to the file
+        ::CloseHandle(file);
+    }
+#else
+    const int fd = ::open(filePath.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        struct stat st;
+        if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+            const size_t fileSize = scast<size_t>(st.st_size);
+            void* view = ::mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (view != MAP_FAILED) {
+                std::shared_ptr<uint8_t> owner(rcast<uint8_t*>(view), [fileSize](uint8_t* ptr) {
+                    ::munmap(ptr, fileSize);
+                });
+                result = MemStream(view, fileSize, owner, fileSize);
+            }
+        }
+        ::close(fd);
+    }
+#endif
+
+    return result;
+}
+
 size_t OSWriteFile(const fs::path& filePath, const void* data, const size_t dataLength) {
     size_t result = 0;
 
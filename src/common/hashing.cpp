@@ -8,3 +8,7 @@ uint32_t Hash_CalculateXX(const uint8_t* data, const size_t dataLength) {
 uint32_t Hash_CalculateXX(const StringView& view) {
     return view.empty() ? 0 : XXH32(view.data(), view.length(), 0);
 }
+
+uint64_t Hash_CalculateXX64(const uint8_t* data, const size_t dataLength, const uint64_t seed) {
+    return XXH64(data, dataLength, seed);
+}
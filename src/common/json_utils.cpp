@@ -0,0 +1,24 @@
+#include "json_utils.h"
+#include "jansson.h"
+
+
+CharString JsonDumpTree(json_t* root) {
+    CharString result;
+
+    if (root) {
+        char* str = json_dumps(root, JSON_INDENT(2) | JSON_PRESERVE_ORDER);
+        if (str) {
+            result = str;
+            free(str);
+        }
+
+        json_decref(root);
+    }
+
+    return result;
+}
+
+bool JsonSaveTree(json_t* root, const fs::path& filePath) {
+    const CharString json = JsonDumpTree(root);
+    return !json.empty() && OSWriteFile(filePath, json.data(), json.length()) == json.length();
+}
@@ -0,0 +1,12 @@
+#pragma once
+#include "mycommon.h"
+
+// Dumping of the jansson trees the benchmarks and reports build.
+//  Output is 2 spaces indented with the keys in the order they were added, both functions take the
+//  ownership of the tree and release it, so a tree is built and handed over in one go.
+
+struct json_t;
+
+CharString  JsonDumpTree(json_t* root);
+// false if the tree is null or the file didn't get all of it
+bool        JsonSaveTree(json_t* root, const fs::path& filePath);
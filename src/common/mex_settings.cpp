@@ -12,6 +12,12 @@ static const CharString sTexFormatNames[] = {
     "Tga",
     "Png"
 };
+static const CharString sPngLevelNames[] = {
+    "Store",
+    "Fast",
+    "Default",
+    "Best"
+};
 static const CharString sSndFormatNames[] = {
     "Ogg",
     "Wav"
@@ -118,6 +124,7 @@ void MEXSettings::InitDefaults() {
     this->extraction.modelSaveLods = false;
     // textures
     this->extraction.textureFormat = Extraction::TexFormat::Tga;
+    this->extraction.texturePngLevel = Extraction::PngLevel::Fast;
     // sounds
     this->extraction.soundFormat = Extraction::SndFormat::Ogg;
     //stuff
@@ -141,6 +148,11 @@ bool MEXSettings::LoadExtraction(pugi::xml_document& doc) {
 
         // textures
         this->extraction.textureFormat = NameToEnum<Extraction::TexFormat>(extractionNode.child("textureFormat").text().get(), sTexFormatNames);
+        if (extractionNode.child("texturePngLevel")) {
+            this->extraction.texturePngLevel = NameToEnum<Extraction::PngLevel>(extractionNode.child("texturePngLevel").text().get(), sPngLevelNames);
+        } else {
+            this->extraction.texturePngLevel = Extraction::PngLevel::Fast;
+        }
 
         // sounds
         this->extraction.soundFormat = NameToEnum<Extraction::SndFormat>(extractionNode.child("soundFormat").text().get(), sSndFormatNames);
@@ -169,6 +181,7 @@ bool MEXSettings::SaveExtraction(pugi::xml_document& doc) {
 
     // textures
     extractionNode.append_child("textureFormat").text() = sTexFormatNames[scast<size_t>(this->extraction.textureFormat)].c_str();
+    extractionNode.append_child("texturePngLevel").text() = sPngLevelNames[scast<size_t>(this->extraction.texturePngLevel)].c_str();
 
     // sounds
     extractionNode.append_child("soundFormat").text() = sSndFormatNames[scast<size_t>(this->extraction.soundFormat)].c_str();
@@ -39,6 +39,12 @@ public:
             Tga,
             Png
         };
+        enum class PngLevel : size_t {
+            Store,
+            Fast,
+            Default,
+            Best
+        };
         enum class SndFormat : size_t {
             Ogg,
             Wav
@@ -54,6 +60,7 @@ public:
         bool        modelSaveLods;
         // textures
         TexFormat   textureFormat;
+        PngLevel    texturePngLevel;
         // sounds
         SndFormat   soundFormat;
         // stuff
@@ -0,0 +1,333 @@
+#include "mip_utils.h"
+#include "cpu_utils.h"
+
+
+namespace {
+
+constexpr size_t kLinearToSRGBTableSize = 65536;
+constexpr float  kMinAlphaWeight = 1e-6f;
+constexpr size_t kMinRowsPerTask = 64;
+constexpr double kPi = 3.14159265358979323846;
+
+struct ColorTables {
+    ColorTables() {
+        for (size_t i = 0; i < 256; ++i) {
+            const float c = scast<float>(i) / 255.0f;
+            srgbToLinear[i] = (c <= 0.04045f) ? (c / 12.92f) : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+
+        for (size_t i = 0; i < kLinearToSRGBTableSize; ++i) {
+            const float l = scast<float>(i) / scast<float>(kLinearToSRGBTableSize - 1);
+            const float c = (l <= 0.0031308f) ? (l * 12.92f) : (1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f);
+            linearToSRGB[i] = scast<uint8_t>(std::clamp(c * 255.0f + 0.5f, 0.0f, 255.0f));
+        }
+    }
+
+    float   srgbToLinear[256];
+    uint8_t linearToSRGB[kLinearToSRGBTableSize];
+};
+
+static const ColorTables& GetColorTables() {
+    static const ColorTables sTables;
+    return sTables;
+}
+
+struct DownsampleCtx {
+    const uint8_t*      src;
+    uint8_t*            dst;
+    size_t              srcWidth;
+    size_t              srcHeight;
+    size_t              dstWidth;
+    size_t              dstHeight;
+    bool                srgb;
+    bool                alphaWeighted;
+    const ColorTables*  tables;
+};
+
+static inline float DecodeChannel(const DownsampleCtx& ctx, const uint8_t v) {
+    return ctx.srgb ? ctx.tables->srgbToLinear[v] : (scast<float>(v) * (1.0f / 255.0f));
+}
+
+static inline uint8_t EncodeChannel(const DownsampleCtx& ctx, const float v) {
+    const float c = std::clamp(v, 0.0f, 1.0f);
+    if (ctx.srgb) {
+        return ctx.tables->linearToSRGB[scast<size_t>(c * scast<float>(kLinearToSRGBTableSize - 1) + 0.5f)];
+    } else {
+        return scast<uint8_t>(c * 255.0f + 0.5f);
+    }
+}
+
+static inline uint8_t EncodeAlpha(const float v) {
+    return scast<uint8_t>(std::clamp(v, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+// sumWeighted is sum(color * alpha), sumPlain is sum(color), sumAlpha is sum(alpha), all over totalWeight texels
+static inline void ResolvePixel(const DownsampleCtx& ctx, uint8_t* dst, const float* sumWeighted, const float* sumPlain, const float sumAlpha, const float totalWeight) {
+    const bool useWeighted = ctx.alphaWeighted && sumAlpha > kMinAlphaWeight;
+    for (size_t c = 0; c < 3; ++c) {
+        dst[c] = EncodeChannel(ctx, useWeighted ? (sumWeighted[c] / sumAlpha) : (sumPlain[c] / totalWeight));
+    }
+    dst[3] = EncodeAlpha(sumAlpha / totalWeight);
+}
+
+static void DownsampleBoxRowsScalar(const DownsampleCtx& ctx, const size_t rowStart, const size_t rowEnd, const size_t colStart) {
+    const size_t srcPitch = ctx.srcWidth * 4;
+
+    for (size_t y = rowStart; y < rowEnd; ++y) {
+        const size_t sy0 = std::min(y * 2, ctx.srcHeight - 1);
+        const size_t sy1 = std::min(y * 2 + 1, ctx.srcHeight - 1);
+        const uint8_t* rows[2] = { ctx.src + sy0 * srcPitch, ctx.src + sy1 * srcPitch };
+
+        for (size_t x = colStart; x < ctx.dstWidth; ++x) {
+            const size_t sx[2] = { std::min(x * 2, ctx.srcWidth - 1), std::min(x * 2 + 1, ctx.srcWidth - 1) };
+
+            float sumWeighted[3] = { 0.0f }, sumPlain[3] = { 0.0f }, sumAlpha = 0.0f;
+            for (const uint8_t* row : rows) {
+                for (const size_t px : sx) {
+                    const uint8_t* p = row + px * 4;
+                    const float a = scast<float>(p[3]) * (1.0f / 255.0f);
+                    for (size_t c = 0; c < 3; ++c) {
+                        const float l = DecodeChannel(ctx, p[c]);
+                        sumWeighted[c] += l * a;
+                        sumPlain[c] += l;
+                    }
+                    sumAlpha += a;
+                }
+            }
+
+            ResolvePixel(ctx, ctx.dst + (y * ctx.dstWidth + x) * 4, sumWeighted, sumPlain, sumAlpha, 4.0f);
+        }
+    }
+}
+
+// two destination pixels per iteration, each 128-bit lane holds one RGBA pixel
+TARGET_AVX2 static void DownsampleBoxRowsAVX2(const DownsampleCtx& ctx, const size_t rowStart, const size_t rowEnd) {
+    const size_t srcPitch = ctx.srcWidth * 4;
+    const size_t simdWidth = (ctx.srcWidth >= 4) ? (ctx.dstWidth & ~scast<size_t>(1)) : 0;
+
+    const __m256 kInv255 = _mm256_set1_ps(1.0f / 255.0f);
+    const __m256 kQuarter = _mm256_set1_ps(0.25f);
+    const __m256 kZero = _mm256_setzero_ps();
+    const __m256 kOne = _mm256_set1_ps(1.0f);
+    const __m256 kMinWeight = _mm256_set1_ps(kMinAlphaWeight);
+    const __m256 kColorScale = _mm256_set1_ps(ctx.srgb ? scast<float>(kLinearToSRGBTableSize - 1) : 255.0f);
+    const __m256 k255 = _mm256_set1_ps(255.0f);
+    const __m256 kHalf = _mm256_set1_ps(0.5f);
+
+    alignas(32) int32_t encoded[8];
+
+    for (size_t y = rowStart; y < rowEnd; ++y) {
+        const size_t sy0 = std::min(y * 2, ctx.srcHeight - 1);
+        const size_t sy1 = std::min(y * 2 + 1, ctx.srcHeight - 1);
+        const uint8_t* rows[2] = { ctx.src + sy0 * srcPitch, ctx.src + sy1 * srcPitch };
+        uint8_t* dstRow = ctx.dst + y * ctx.dstWidth * 4;
+
+        for (size_t x = 0; x < simdWidth; x += 2) {
+            __m256 plain[2] = { kZero, kZero };
+            __m256 weighted[2] = { kZero, kZero };
+
+            for (const uint8_t* row : rows) {
+                for (size_t half = 0; half < 2; ++half) {
+                    // two horizontally adjacent source pixels for destination pixel (x + half)
+                    const __m128i bytes = _mm_loadl_epi64(rcast<const __m128i*>(row + (x + half) * 8));
+                    const __m256i ints = _mm256_cvtepu8_epi32(bytes);
+                    const __m256 unorm = _mm256_mul_ps(_mm256_cvtepi32_ps(ints), kInv255);
+                    __m256 lin = ctx.srgb ? _mm256_i32gather_ps(ctx.tables->srgbToLinear, ints, 4) : unorm;
+                    lin = _mm256_blend_ps(lin, unorm, 0x88);    // alpha is always linear
+
+                    const __m256 alpha = _mm256_permute_ps(lin, _MM_SHUFFLE(3, 3, 3, 3));
+                    const __m256 w = _mm256_blend_ps(_mm256_mul_ps(lin, alpha), lin, 0x88);
+
+                    plain[half] = _mm256_add_ps(plain[half], lin);
+                    weighted[half] = _mm256_add_ps(weighted[half], w);
+                }
+            }
+
+            // fold the two source columns: lane 0 = pixel x, lane 1 = pixel x + 1
+            const __m256 sumPlain = _mm256_add_ps(_mm256_permute2f128_ps(plain[0], plain[1], 0x20), _mm256_permute2f128_ps(plain[0], plain[1], 0x31));
+            const __m256 sumWeighted = _mm256_add_ps(_mm256_permute2f128_ps(weighted[0], weighted[1], 0x20), _mm256_permute2f128_ps(weighted[0], weighted[1], 0x31));
+
+            const __m256 sumAlpha = _mm256_permute_ps(sumPlain, _MM_SHUFFLE(3, 3, 3, 3));
+            const __m256 avgPlain = _mm256_mul_ps(sumPlain, kQuarter);
+            __m256 color = avgPlain;
+            if (ctx.alphaWeighted) {
+                const __m256 useWeighted = _mm256_cmp_ps(sumAlpha, kMinWeight, _CMP_GT_OQ);
+                const __m256 avgWeighted = _mm256_div_ps(sumWeighted, _mm256_max_ps(sumAlpha, kMinWeight));
+                color = _mm256_blendv_ps(avgPlain, avgWeighted, useWeighted);
+                color = _mm256_blend_ps(color, avgPlain, 0x88);
+            }
+
+            color = _mm256_min_ps(_mm256_max_ps(color, kZero), kOne);
+            const __m256 scale = _mm256_blend_ps(kColorScale, k255, 0x88);
+            const __m256i idx = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(color, scale), kHalf));
+            _mm256_store_si256(rcast<__m256i*>(encoded), idx);
+
+            uint8_t* dst = dstRow + x * 4;
+            for (size_t i = 0; i < 8; ++i) {
+                const bool isAlpha = (i & 3) == 3;
+                dst[i] = (ctx.srgb && !isAlpha) ? ctx.tables->linearToSRGB[encoded[i]] : scast<uint8_t>(encoded[i]);
+            }
+        }
+    }
+
+    // odd tail column (if any)
+    if (simdWidth < ctx.dstWidth) {
+        DownsampleBoxRowsScalar(ctx, rowStart, rowEnd, simdWidth);
+    }
+}
+
+static double BesselI0(const double x) {
+    double sum = 1.0, term = 1.0;
+    const double halfX = x * 0.5;
+    for (int k = 1; k < 32; ++k) {
+        term *= halfX / scast<double>(k);
+        sum += term * term;
+    }
+    return sum;
+}
+
+// weights for the 6 source taps around a destination texel, taps are at (2x - 2 .. 2x + 3)
+struct KaiserWeights {
+    KaiserWeights() {
+        constexpr double kAlpha = 4.0;
+        constexpr double kWidth = 1.5;   // in destination texels
+
+        double sum = 0.0;
+        for (int k = 0; k < 6; ++k) {
+            const double t = (scast<double>(k - 2) - 0.5) * 0.5;
+            const double pix = kPi * t;
+            const double sinc = (std::abs(t) < 1e-9) ? 1.0 : (std::sin(pix) / pix);
+            const double r = t / kWidth;
+            const double window = (std::abs(r) < 1.0) ? (BesselI0(kAlpha * std::sqrt(1.0 - r * r)) / BesselI0(kAlpha)) : 0.0;
+            const double w = sinc * window;
+            weights[k] = scast<float>(w);
+            sum += w;
+        }
+        for (float& w : weights) {
+            w = scast<float>(w / sum);
+        }
+    }
+
+    float weights[6];
+};
+
+static void DownsampleKaiserRows(const DownsampleCtx& ctx, const size_t rowStart, const size_t rowEnd) {
+    static const KaiserWeights sKaiser;
+
+    const size_t srcPitch = ctx.srcWidth * 4;
+
+    // per source column: weighted rgb, plain rgb, alpha, pad
+    MyArray<float> column(ctx.srcWidth * 8);
+
+    for (size_t y = rowStart; y < rowEnd; ++y) {
+        std::fill(column.begin(), column.end(), 0.0f);
+
+        // vertical pass into the column accumulator
+        for (int k = 0; k < 6; ++k) {
+            const int64_t sy = std::clamp<int64_t>(scast<int64_t>(y * 2) + k - 2, 0, scast<int64_t>(ctx.srcHeight) - 1);
+            const uint8_t* row = ctx.src + scast<size_t>(sy) * srcPitch;
+            const float wy = sKaiser.weights[k];
+
+            float* acc = column.data();
+            for (size_t x = 0; x < ctx.srcWidth; ++x, row += 4, acc += 8) {
+                const float a = scast<float>(row[3]) * (1.0f / 255.0f);
+                for (size_t c = 0; c < 3; ++c) {
+                    const float l = DecodeChannel(ctx, row[c]);
+                    acc[c] += l * a * wy;
+                    acc[3 + c] += l * wy;
+                }
+                acc[6] += a * wy;
+            }
+        }
+
+        // horizontal pass
+        uint8_t* dst = ctx.dst + y * ctx.dstWidth * 4;
+        for (size_t x = 0; x < ctx.dstWidth; ++x, dst += 4) {
+            float sum[7] = { 0.0f };
+            for (int k = 0; k < 6; ++k) {
+                const int64_t sx = std::clamp<int64_t>(scast<int64_t>(x * 2) + k - 2, 0, scast<int64_t>(ctx.srcWidth) - 1);
+                const float* acc = column.data() + scast<size_t>(sx) * 8;
+                const float wx = sKaiser.weights[k];
+                for (size_t c = 0; c < 7; ++c) {
+                    sum[c] += acc[c] * wx;
+                }
+            }
+
+            // negative lobes can push alpha below zero
+            const float sumAlpha = std::max(sum[6], 0.0f);
+            ResolvePixel(ctx, dst, sum, sum + 3, sumAlpha, 1.0f);
+        }
+    }
+}
+
+} // namespace
+
+
+size_t MIP_CalcNumMips(const size_t width, const size_t height) {
+    size_t result = 1;
+    size_t dim = std::max(width, height);
+    while (dim > 1) {
+        dim >>= 1;
+        ++result;
+    }
+    return result;
+}
+
+size_t MIP_GetLevelOffset(const size_t width, const size_t height, const size_t level) {
+    size_t result = 0;
+    for (size_t i = 0; i < level; ++i) {
+        result += std::max<size_t>(1, width >> i) * std::max<size_t>(1, height >> i) * 4;
+    }
+    return result;
+}
+
+size_t MIP_GetPyramidSize(const size_t width, const size_t height, const size_t numMips) {
+    return MIP_GetLevelOffset(width, height, numMips);
+}
+
+void MIP_Downsample2x(const uint8_t* srcRGBA, uint8_t* dstRGBA, const size_t width, const size_t height, const MipGenParams& params) {
+    static const bool sHasAVX2 = CPU_SupportsAVX2();
+
+    DownsampleCtx ctx;
+    ctx.src = srcRGBA;
+    ctx.dst = dstRGBA;
+    ctx.srcWidth = width;
+    ctx.srcHeight = height;
+    ctx.dstWidth = std::max<size_t>(1, width / 2);
+    ctx.dstHeight = std::max<size_t>(1, height / 2);
+    ctx.srgb = params.srgb;
+    ctx.alphaWeighted = params.alphaWeighted;
+    ctx.tables = &GetColorTables();
+
+    const bool useAVX2 = params.allowSIMD && sHasAVX2;
+
+    const size_t numTasks = std::max<size_t>(1, ctx.dstHeight / kMinRowsPerTask);
+    const size_t rowsPerTask = (ctx.dstHeight + numTasks - 1) / numTasks;
+
+    ParallelFor(numTasks, [&ctx, &params, useAVX2, rowsPerTask](const size_t idx, const size_t) {
+        const size_t rowStart = idx * rowsPerTask;
+        const size_t rowEnd = std::min(rowStart + rowsPerTask, ctx.dstHeight);
+
+        if (params.filter == MipFilter::Kaiser) {
+            DownsampleKaiserRows(ctx, rowStart, rowEnd);
+        } else if (useAVX2) {
+            DownsampleBoxRowsAVX2(ctx, rowStart, rowEnd);
+        } else {
+            DownsampleBoxRowsScalar(ctx, rowStart, rowEnd, 0);
+        }
+    });
+}
+
+void MIP_BuildPyramid(uint8_t* pyramid, const size_t width, const size_t height, const size_t numMips, const MipGenParams& params) {
+    uint8_t* src = pyramid;
+    size_t w = width, h = height;
+
+    for (size_t i = 1; i < numMips; ++i) {
+        uint8_t* dst = src + w * h * 4;
+        MIP_Downsample2x(src, dst, w, h, params);
+
+        src = dst;
+        w = std::max<size_t>(1, w / 2);
+        h = std::max<size_t>(1, h / 2);
+    }
+}
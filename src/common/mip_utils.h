@@ -0,0 +1,29 @@
+#pragma once
+#include "mycommon.h"
+
+// 2:1 mip chain generation for RGBA8 images
+//  The whole chain lives in one allocation (see MIP_GetPyramidSize), level 0 goes first,
+//  every next level is written right after the previous one.
+//  Averaging is done in linear space (for sRGB sources), color is weighted by alpha
+//  so fully transparent texels don't bleed into visible ones.
+
+enum class MipFilter : uint32_t {
+    Box,        // 2x2 average, AVX2 accelerated
+    Kaiser      // separable 6-tap windowed sinc, sharper but slower
+};
+
+struct MipGenParams {
+    MipFilter   filter = MipFilter::Box;
+    bool        srgb = true;            // false for normal maps and other non-color data
+    bool        alphaWeighted = true;
+    bool        allowSIMD = true;
+};
+
+size_t MIP_CalcNumMips(const size_t width, const size_t height);
+size_t MIP_GetLevelOffset(const size_t width, const size_t height, const size_t level);
+size_t MIP_GetPyramidSize(const size_t width, const size_t height, const size_t numMips);
+
+// src and dst must not overlap, dst is (max(1, w/2) x max(1, h/2))
+void   MIP_Downsample2x(const uint8_t* srcRGBA, uint8_t* dstRGBA, const size_t width, const size_t height, const MipGenParams& params = MipGenParams());
+// pyramid must hold MIP_GetPyramidSize() bytes with level 0 already filled in
+void   MIP_BuildPyramid(uint8_t* pyramid, const size_t width, const size_t height, const size_t numMips, const MipGenParams& params = MipGenParams());
@@ -194,6 +194,7 @@ private:
 
 uint32_t Hash_CalculateXX(const uint8_t* data, const size_t dataLength);
 uint32_t Hash_CalculateXX(const StringView& view);
+uint64_t Hash_CalculateXX64(const uint8_t* data, const size_t dataLength, const uint64_t seed = 0);
 
 // encoding
 CharString Encode_BytesToBase64(const uint8_t* data, const size_t dataLength);
@@ -397,24 +398,36 @@ public:
     MemStream()
         : data(nullptr)
         , length(0)
-        , cursor(0) {
+        , cursor(0)
+        , ownedLength(0) {
     }
 
     MemStream(const void* _data, const size_t _size, const bool _ownMem = false)
         : data(rcast<const uint8_t*>(_data))
         , length(_size)
         , cursor(0)
+        , ownedLength(0)
     {
         //#NOTE_SK: dirty hack to own a pointer
         if (_ownMem) {
             ownedPtr = OwnedPtrType(const_cast<uint8_t*>(data), free);
+            ownedLength = _size;
         }
     }
+    // keeps _owner (_ownerLength bytes) alive for as long as any copy of the stream exists (mapped files and such)
+    MemStream(const void* _data, const size_t _size, const std::shared_ptr<uint8_t>& _owner, const size_t _ownerLength)
+        : data(rcast<const uint8_t*>(_data))
+        , length(_size)
+        , cursor(0)
+        , ownedPtr(_owner)
+        , ownedLength(_ownerLength) {
+    }
     MemStream(const MemStream& other)
         : data(other.data)
         , length(other.length)
         , cursor(other.cursor)
         , ownedPtr(other.ownedPtr)
+        , ownedLength(other.ownedLength)
         , name(other.name) {
     }
     MemStream(MemStream&& other) noexcept
@@ -422,6 +435,7 @@ public:
         , length(other.length)
         , cursor(other.cursor)
         , ownedPtr(other.ownedPtr)
+        , ownedLength(other.ownedLength)
         , name(other.name) {
     }
     ~MemStream() {
@@ -432,6 +446,7 @@ public:
         this->length = other.length;
         this->cursor = other.cursor;
         this->ownedPtr = other.ownedPtr;
+        this->ownedLength = other.ownedLength;
         this->name = other.name;
         return *this;
     }
@@ -441,6 +456,7 @@ public:
         this->length = other.length;
         this->cursor = other.cursor;
         this->ownedPtr.swap(other.ownedPtr);
+        this->ownedLength = other.ownedLength;
         this->name.swap(other.name);
         return *this;
     }
@@ -560,15 +576,26 @@ public:
         return this->data + this->cursor;
     }
 
+    // substreams share ownership of our memory, so they stay valid even if we don't
     MemStream Substream(const size_t subStreamLength) const {
         const size_t allowedLength = ((this->cursor + subStreamLength) > this->Length()) ? (this->Length() - this->cursor) : subStreamLength;
-        return MemStream(this->GetDataAtCursor(), allowedLength);
+        return MemStream(this->GetDataAtCursor(), allowedLength, this->ownedPtr, this->ownedLength);
     }
 
     MemStream Substream(const size_t subStreamOffset, const size_t subStreamLength) const {
         const size_t allowedOffset = (subStreamOffset > this->Length()) ? this->Length() : subStreamOffset;
         const size_t allowedLength = ((allowedOffset + subStreamLength) > this->Length()) ? (this->Length() - allowedOffset) : subStreamLength;
-        return MemStream(this->data + allowedOffset, allowedLength);
+        return MemStream(this->data + allowedOffset, allowedLength, this->ownedPtr, this->ownedLength);
+    }
+
+    // empty if the stream doesn't own (or share) its memory
+    inline const OwnedPtrType& GetOwner() const {
+        return this->ownedPtr;
+    }
+
+    // size of the whole memory the owner keeps alive, substreams included
+    inline size_t GetOwnerLength() const {
+        return this->ownedLength;
     }
 
     MemStream Clone() const {
@@ -587,9 +614,112 @@ private:
     size_t          length;
     size_t          cursor;
     OwnedPtrType    ownedPtr;
+    size_t          ownedLength;
     CharString      name;
 };
 
+// Read-only bytes that can point right into a MemStream memory (usually the whole decompressed file) instead of copying it.
+//  Copy-on-write: the first mutable access (or resize) makes a private copy, copies of SharedBytes share memory until then.
+//  Keep in mind a view keeps the whole source buffer alive.
+class SharedBytes {
+    using OwnerPtrType = std::shared_ptr<uint8_t>;
+
+public:
+    SharedBytes()
+        : data(nullptr)
+        , size(0)
+        , ownerSize(0)
+        , isPrivate(false) {
+    }
+
+    // shares stream memory from the cursor to the end if the stream owns it, copies otherwise
+    void Assign(const MemStream& stream) {
+        if (stream.GetOwner()) {
+            this->data = stream.GetDataAtCursor();
+            this->size = stream.Remains();
+            this->owner = stream.GetOwner();
+            this->ownerSize = stream.GetOwnerLength();
+            this->isPrivate = false;
+        } else {
+            this->Assign(stream.GetDataAtCursor(), stream.Remains());
+        }
+    }
+
+    void Assign(const void* src, const size_t srcSize) {
+        this->Clear();
+        this->Resize(srcSize);
+        if (srcSize) {
+            memcpy(this->MutableData(), src, srcSize);
+        }
+    }
+
+    // always ends up with a private copy, keeps as much of the old content as fits
+    void Resize(const size_t newSize) {
+        if (!newSize) {
+            this->Clear();
+        } else {
+            OwnerPtrType newOwner(rcast<uint8_t*>(malloc(newSize)), free);
+            assert(newOwner != nullptr);
+            if (this->data) {
+                memcpy(newOwner.get(), this->data, std::min(this->size, newSize));
+            }
+
+            this->data = newOwner.get();
+            this->size = newSize;
+            this->owner.swap(newOwner);
+            this->ownerSize = newSize;
+            this->isPrivate = true;
+        }
+    }
+
+    void Clear() {
+        this->data = nullptr;
+        this->size = 0;
+        this->owner.reset();
+        this->ownerSize = 0;
+        this->isPrivate = false;
+    }
+
+    inline const uint8_t* Data() const {
+        return this->data;
+    }
+
+    inline size_t Size() const {
+        return this->size;
+    }
+
+    inline bool Empty() const {
+        return this->size == 0;
+    }
+
+    // the memory these bytes keep alive, a view keeps the whole source buffer, all the views of it share the same owner
+    inline const void* GetOwnerId() const {
+        return this->owner.get();
+    }
+
+    inline size_t GetOwnerSize() const {
+        return this->ownerSize;
+    }
+
+    inline bool IsShared() const {
+        return this->data != nullptr && (!this->isPrivate || this->owner.use_count() > 1);
+    }
+
+    uint8_t* MutableData() {
+        if (this->IsShared()) {
+            this->Resize(this->size);
+        }
+        return const_cast<uint8_t*>(this->data);
+    }
+
+private:
+    const uint8_t*  data;
+    size_t          size;
+    OwnerPtrType    owner;
+    size_t          ownerSize;
+    bool            isPrivate;  // owner is our own allocation, not the source stream
+};
+
 
 class MemWriteStream {
 public:
@@ -987,6 +1117,7 @@ using Base = superName;
 // File I/O
 MemStream           OSReadFile(const fs::path& filePath);
 MemStream           OSReadFileEX(const fs::path& filePath, const size_t subOffset, const size_t subLength);
+MemStream           OSMapFile(const fs::path& filePath);   // read-only mapping, unmapped when the last stream copy dies
 size_t              OSWriteFile(const fs::path& filePath, const void* data, const size_t dataLength);
 size_t              OSGetFileSize(const fs::path& filePath);
 bool                OSPathExists(const fs::path& pathToCheck);
@@ -996,6 +1127,15 @@ MyArray<fs::path>   OSPathGetEntriesList(const fs::path& pathToCheck, const bool
 
 #include "log.h"
 
+// parallel
+//  func receives the item index and the index of the worker thread running it (0 .. numThreads-1),
+//  items are handed out dynamically, in increasing order
+//  nested calls (from inside func) run serially on the calling worker
+using ParallelForFunc = std::function<void(const size_t idx, const size_t threadIdx)>;
+
+size_t  ParallelGetNumThreads(const size_t numThreads = 0);
+void    ParallelFor(const size_t count, const ParallelForFunc& func, const size_t numThreads = 0);
+
 // random
 int RandomIntRange(const int left, const int right);
 float RandomFloatRange(const float left, const float right);
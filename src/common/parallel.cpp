@@ -0,0 +1,49 @@
+#include "mycommon.h"
+#include <atomic>
+#include <thread>
+
+//#NOTE_SK: ParallelFor called from inside a ParallelFor task just runs in place,
+//          otherwise nested loads (model -> lod meshes -> children) would spawn threads exponentially
+static thread_local bool sInsideParallelFor = false;
+
+size_t ParallelGetNumThreads(const size_t numThreads) {
+    if (numThreads) {
+        return numThreads;
+    }
+
+    const size_t hwThreads = scast<size_t>(std::thread::hardware_concurrency());
+    return (hwThreads > 0) ? hwThreads : 1;
+}
+
+void ParallelFor(const size_t count, const ParallelForFunc& func, const size_t numThreads) {
+    const size_t threadsToUse = sInsideParallelFor ? 1 : std::min(count, ParallelGetNumThreads(numThreads));
+
+    if (threadsToUse <= 1) {
+        for (size_t i = 0; i < count; ++i) {
+            func(i, 0);
+        }
+    } else {
+        std::atomic_size_t nextIdx{ 0 };
+
+        auto worker = [&nextIdx, &func, count](const size_t threadIdx) {
+            const bool wasInside = sInsideParallelFor;
+            sInsideParallelFor = true;
+            for (size_t i = nextIdx++; i < count; i = nextIdx++) {
+                func(i, threadIdx);
+            }
+            sInsideParallelFor = wasInside;
+        };
+
+        MyArray<std::thread> threads;
+        threads.reserve(threadsToUse - 1);
+        for (size_t i = 1; i < threadsToUse; ++i) {
+            threads.emplace_back(worker, i);
+        }
+
+        worker(0);
+
+        for (std::thread& t : threads) {
+            t.join();
+        }
+    }
+}
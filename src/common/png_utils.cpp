@@ -0,0 +1,598 @@
+#include "png_utils.h"
+#include <fstream>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+
+namespace {
+
+constexpr size_t   kDeflateWindowSize = 32768;
+constexpr size_t   kDeflateWindowMask = kDeflateWindowSize - 1;
+constexpr size_t   kDeflateMinMatch = 3;
+constexpr size_t   kDeflateMaxMatch = 258;
+constexpr size_t   kDeflateHashBits = 15;
+constexpr uint32_t kDeflateNoPos = ~0u;
+constexpr size_t   kMaxStoredBlockSize = 65535;
+constexpr uint32_t kAdlerBase = 65521u;
+
+// per-level LZ77 search settings, index is compression level (0 is stored, never searches)
+struct DeflateLevelConfig {
+    uint32_t    maxChain;
+    uint32_t    niceLength;
+};
+
+constexpr DeflateLevelConfig sLevelConfigs[10] = {
+    {    0,   0 },
+    {    2,   8 },
+    {    4,  16 },
+    {    8,  32 },
+    {   12,  32 },
+    {   16,  64 },
+    {   32, 128 },
+    {   64, 258 },
+    {  256, 258 },
+    { 1024, 258 },
+};
+
+constexpr uint16_t sLengthBase[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+constexpr uint8_t sLengthExtra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+constexpr uint16_t sDistBase[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+constexpr uint8_t sDistExtra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+static uint32_t ReverseBits(uint32_t code, const uint32_t numBits) {
+    uint32_t result = 0;
+    for (uint32_t i = 0; i < numBits; ++i) {
+        result = (result << 1) | (code & 1);
+        code >>= 1;
+    }
+    return result;
+}
+
+// fixed huffman codes (RFC 1951, 3.2.6), already bit-reversed for LSB-first output
+struct FixedHuffmanTables {
+    FixedHuffmanTables() {
+        for (uint32_t i = 0; i < 288; ++i) {
+            if (i < 144) {
+                litCode[i] = scast<uint16_t>(ReverseBits(0x30 + i, 8));
+                litBits[i] = 8;
+            } else if (i < 256) {
+                litCode[i] = scast<uint16_t>(ReverseBits(0x190 + (i - 144), 9));
+                litBits[i] = 9;
+            } else if (i < 280) {
+                litCode[i] = scast<uint16_t>(ReverseBits(i - 256, 7));
+                litBits[i] = 7;
+            } else {
+                litCode[i] = scast<uint16_t>(ReverseBits(0xC0 + (i - 280), 8));
+                litBits[i] = 8;
+            }
+        }
+
+        for (uint32_t i = 0; i < 30; ++i) {
+            distCode[i] = scast<uint8_t>(ReverseBits(i, 5));
+        }
+
+        for (uint32_t code = 0; code < 29; ++code) {
+            const uint32_t first = sLengthBase[code];
+            const uint32_t last = (code == 28) ? 258 : (sLengthBase[code + 1] - 1);
+            for (uint32_t len = first; len <= last; ++len) {
+                lengthToCode[len] = scast<uint8_t>(code);
+            }
+        }
+
+        for (uint32_t code = 0; code < 30; ++code) {
+            const uint32_t first = sDistBase[code];
+            const uint32_t last = first + (1u << sDistExtra[code]) - 1;
+            for (uint32_t dist = first; dist <= last; ++dist) {
+                if (dist <= 256) {
+                    distToCodeLo[dist - 1] = scast<uint8_t>(code);
+                } else {
+                    distToCodeHi[(dist - 1) >> 7] = scast<uint8_t>(code);
+                }
+            }
+        }
+    }
+
+    inline uint32_t DistToCode(const uint32_t dist) const {
+        return (dist <= 256) ? distToCodeLo[dist - 1] : distToCodeHi[(dist - 1) >> 7];
+    }
+
+    uint16_t    litCode[288];
+    uint8_t     litBits[288];
+    uint8_t     distCode[30];
+    uint8_t     lengthToCode[259];
+    uint8_t     distToCodeLo[256];
+    uint8_t     distToCodeHi[256];
+};
+
+static const FixedHuffmanTables& GetFixedHuffmanTables() {
+    static const FixedHuffmanTables sTables;
+    return sTables;
+}
+
+class DeflateBitWriter {
+public:
+    DeflateBitWriter(BytesArray& out) : mOut(out), mBits(0), mCount(0) {}
+
+    inline void Put(const uint32_t value, const uint32_t numBits) {
+        mBits |= scast<uint64_t>(value) << mCount;
+        mCount += numBits;
+        while (mCount >= 8) {
+            mOut.push_back(scast<uint8_t>(mBits));
+            mBits >>= 8;
+            mCount -= 8;
+        }
+    }
+
+    inline void Align() {
+        if (mCount > 0) {
+            mOut.push_back(scast<uint8_t>(mBits));
+            mBits = 0;
+            mCount = 0;
+        }
+    }
+
+    inline void PutBytes(const uint8_t* data, const size_t length) {
+        mOut.insert(mOut.end(), data, data + length);
+    }
+
+private:
+    BytesArray& mOut;
+    uint64_t    mBits;
+    uint32_t    mCount;
+};
+
+static uint32_t Adler32(const uint8_t* data, size_t length) {
+    uint32_t a = 1, b = 0;
+    while (length > 0) {
+        // 5552 is the largest n such that 255n(n+1)/2 + (n+1)(BASE-1) fits in 32 bits
+        const size_t n = std::min<size_t>(length, 5552);
+        for (size_t i = 0; i < n; ++i) {
+            a += data[i];
+            b += a;
+        }
+        a %= kAdlerBase;
+        b %= kAdlerBase;
+        data += n;
+        length -= n;
+    }
+    return (b << 16) | a;
+}
+
+// same as zlib's adler32_combine
+static uint32_t Adler32Combine(const uint32_t adler1, const uint32_t adler2, const size_t length2) {
+    const uint32_t rem = scast<uint32_t>(length2 % kAdlerBase);
+    uint32_t sum1 = adler1 & 0xFFFF;
+    uint32_t sum2 = scast<uint32_t>((scast<uint64_t>(rem) * sum1) % kAdlerBase);
+    sum1 += (adler2 & 0xFFFF) + kAdlerBase - 1;
+    sum2 += ((adler1 >> 16) & 0xFFFF) + ((adler2 >> 16) & 0xFFFF) + kAdlerBase - rem;
+    if (sum1 >= kAdlerBase) sum1 -= kAdlerBase;
+    if (sum1 >= kAdlerBase) sum1 -= kAdlerBase;
+    if (sum2 >= (kAdlerBase << 1)) sum2 -= (kAdlerBase << 1);
+    if (sum2 >= kAdlerBase) sum2 -= kAdlerBase;
+    return sum1 | (sum2 << 16);
+}
+
+static void DeflateStored(DeflateBitWriter& bw, const uint8_t* data, size_t length) {
+    while (length > 0) {
+        const size_t blockSize = std::min(length, kMaxStoredBlockSize);
+        bw.Put(0, 1);   // BFINAL
+        bw.Put(0, 2);   // BTYPE = stored
+        bw.Align();
+
+        const uint16_t len = scast<uint16_t>(blockSize);
+        const uint16_t nlen = scast<uint16_t>(~len);
+        const uint8_t hdr[4] = { scast<uint8_t>(len & 0xFF), scast<uint8_t>(len >> 8), scast<uint8_t>(nlen & 0xFF), scast<uint8_t>(nlen >> 8) };
+        bw.PutBytes(hdr, sizeof(hdr));
+        bw.PutBytes(data, blockSize);
+
+        data += blockSize;
+        length -= blockSize;
+    }
+}
+
+static inline uint32_t DeflateHash(const uint8_t* p) {
+    const uint32_t v = scast<uint32_t>(p[0]) | (scast<uint32_t>(p[1]) << 8) | (scast<uint32_t>(p[2]) << 16);
+    return (v * 2654435761u) >> (32 - kDeflateHashBits);
+}
+
+static inline size_t DeflateMatchLength(const uint8_t* a, const uint8_t* b, const size_t maxLen) {
+    size_t len = 0;
+    while (len + 8 <= maxLen) {
+        uint64_t va, vb;
+        memcpy(&va, a + len, 8);
+        memcpy(&vb, b + len, 8);
+        const uint64_t diff = va ^ vb;
+        if (diff) {
+#ifdef _MSC_VER
+            unsigned long idx;
+            _BitScanForward64(&idx, diff);
+            return len + (idx >> 3);
+#else
+            return len + (scast<size_t>(__builtin_ctzll(diff)) >> 3);
+#endif
+        }
+        len += 8;
+    }
+    while (len < maxLen && a[len] == b[len]) {
+        ++len;
+    }
+    return len;
+}
+
+// greedy LZ77 + fixed huffman, the whole chunk goes into a single block
+static void DeflateFixed(DeflateBitWriter& bw, const uint8_t* data, const size_t length, const DeflateLevelConfig& cfg) {
+    const FixedHuffmanTables& tbl = GetFixedHuffmanTables();
+
+    MyArray<uint32_t> head(scast<size_t>(1) << kDeflateHashBits, kDeflateNoPos);
+    MyArray<uint32_t> prev(kDeflateWindowSize, kDeflateNoPos);
+
+    auto insertHash = [&head, &prev, data](const size_t pos) {
+        const uint32_t h = DeflateHash(data + pos);
+        prev[pos & kDeflateWindowMask] = head[h];
+        head[h] = scast<uint32_t>(pos);
+    };
+
+    bw.Put(0, 1);   // BFINAL
+    bw.Put(1, 2);   // BTYPE = fixed huffman
+
+    size_t pos = 0;
+    while (pos < length) {
+        size_t bestLen = 0, bestDist = 0;
+
+        if (pos + kDeflateMinMatch <= length) {
+            const size_t maxLen = std::min(kDeflateMaxMatch, length - pos);
+            const uint8_t* cur = data + pos;
+
+            uint32_t cand = head[DeflateHash(cur)];
+            uint32_t chain = cfg.maxChain;
+            while (cand != kDeflateNoPos && chain-- > 0) {
+                const size_t dist = pos - cand;
+                if (dist > kDeflateWindowSize) {
+                    break;
+                }
+
+                const uint8_t* ref = data + cand;
+                if (ref[bestLen] == cur[bestLen] && ref[0] == cur[0]) {
+                    const size_t len = DeflateMatchLength(ref, cur, maxLen);
+                    if (len > bestLen) {
+                        bestLen = len;
+                        bestDist = dist;
+                        if (len >= cfg.niceLength || len == maxLen) {
+                            break;
+                        }
+                    }
+                }
+
+                // the slot may have been overwritten by a newer position - this ends the chain
+                const uint32_t next = prev[cand & kDeflateWindowMask];
+                if (next == kDeflateNoPos || next >= cand) {
+                    break;
+                }
+                cand = next;
+            }
+        }
+
+        if (bestLen >= kDeflateMinMatch) {
+            const uint32_t lenCode = tbl.lengthToCode[bestLen];
+            bw.Put(tbl.litCode[257 + lenCode], tbl.litBits[257 + lenCode]);
+            if (sLengthExtra[lenCode]) {
+                bw.Put(scast<uint32_t>(bestLen - sLengthBase[lenCode]), sLengthExtra[lenCode]);
+            }
+
+            const uint32_t distCode = tbl.DistToCode(scast<uint32_t>(bestDist));
+            bw.Put(tbl.distCode[distCode], 5);
+            if (sDistExtra[distCode]) {
+                bw.Put(scast<uint32_t>(bestDist - sDistBase[distCode]), sDistExtra[distCode]);
+            }
+
+            const size_t end = pos + bestLen;
+            for (; pos < end; ++pos) {
+                if (pos + kDeflateMinMatch <= length) {
+                    insertHash(pos);
+                }
+            }
+        } else {
+            const uint8_t lit = data[pos];
+            bw.Put(tbl.litCode[lit], tbl.litBits[lit]);
+            if (pos + kDeflateMinMatch <= length) {
+                insertHash(pos);
+            }
+            ++pos;
+        }
+    }
+
+    bw.Put(tbl.litCode[256], tbl.litBits[256]);   // end of block
+}
+
+static inline uint8_t PaethPredictor(const int a, const int b, const int c) {
+    const int p = a + b - c;
+    const int pa = std::abs(p - a);
+    const int pb = std::abs(p - b);
+    const int pc = std::abs(p - c);
+    return scast<uint8_t>((pa <= pb && pa <= pc) ? a : ((pb <= pc) ? b : c));
+}
+
+// writes a filter byte + filtered row, picks the filter by the "minimum sum of absolute differences" heuristic
+static void FilterRow(uint8_t* dst, const uint8_t* row, const uint8_t* prevRow, const size_t stride, const size_t bpp, const bool adaptive, uint8_t* scratch) {
+    if (!adaptive) {
+        dst[0] = 0;
+        memcpy(dst + 1, row, stride);
+        return;
+    }
+
+    const bool hasPrev = (prevRow != nullptr);
+
+    uint8_t* outs[5] = { scratch, scratch + stride, scratch + stride * 2, scratch + stride * 3, scratch + stride * 4 };
+
+    // first pixel has no left neighbour
+    for (size_t i = 0; i < bpp; ++i) {
+        const int x = row[i];
+        const int b = hasPrev ? prevRow[i] : 0;
+        outs[0][i] = scast<uint8_t>(x);
+        outs[1][i] = scast<uint8_t>(x);
+        outs[2][i] = scast<uint8_t>(x - b);
+        outs[3][i] = scast<uint8_t>(x - (b >> 1));
+        outs[4][i] = scast<uint8_t>(x - b);
+    }
+
+    for (size_t i = bpp; i < stride; ++i) {
+        const int x = row[i];
+        const int a = row[i - bpp];
+        const int b = hasPrev ? prevRow[i] : 0;
+        const int c = hasPrev ? prevRow[i - bpp] : 0;
+        outs[0][i] = scast<uint8_t>(x);
+        outs[1][i] = scast<uint8_t>(x - a);
+        outs[2][i] = scast<uint8_t>(x - b);
+        outs[3][i] = scast<uint8_t>(x - ((a + b) >> 1));
+        outs[4][i] = scast<uint8_t>(x - PaethPredictor(a, b, c));
+    }
+
+    size_t bestSum = kInvalidValue;
+    int bestFilter = 0;
+    for (int filter = 0; filter < 5; ++filter) {
+        const uint8_t* out = outs[filter];
+        size_t sum = 0;
+        for (size_t i = 0; i < stride; ++i) {
+            sum += std::abs(scast<int>(scast<int8_t>(out[i])));
+        }
+        if (sum < bestSum) {
+            bestSum = sum;
+            bestFilter = filter;
+        }
+    }
+
+    dst[0] = scast<uint8_t>(bestFilter);
+    memcpy(dst + 1, scratch + bestFilter * stride, stride);
+}
+
+struct PngChunkJob {
+    const uint8_t*  rows;
+    const uint8_t*  prevRow;
+    size_t          numRows;
+    bool            isLast;
+
+    BytesArray      compressed;
+    uint32_t        adler;
+    size_t          filteredLength;
+};
+
+static void PngProcessChunk(PngChunkJob& job, const size_t stride, const size_t bpp, const int level) {
+    BytesArray filtered((stride + 1) * job.numRows);
+    BytesArray scratch(stride * 5);
+
+    const bool adaptiveFilter = (level > 0);
+    const uint8_t* prevRow = job.prevRow;
+    const uint8_t* row = job.rows;
+    for (size_t y = 0; y < job.numRows; ++y) {
+        FilterRow(filtered.data() + y * (stride + 1), row, prevRow, stride, bpp, adaptiveFilter, scratch.data());
+        prevRow = row;
+        row += stride;
+    }
+
+    job.filteredLength = filtered.size();
+    job.adler = Adler32(filtered.data(), filtered.size());
+
+    job.compressed.clear();
+    job.compressed.reserve(level > 0 ? (filtered.size() / 2) : (filtered.size() + filtered.size() / kMaxStoredBlockSize * 5 + 16));
+
+    DeflateBitWriter bw(job.compressed);
+    if (level > 0) {
+        DeflateFixed(bw, filtered.data(), filtered.size(), sLevelConfigs[level]);
+    } else {
+        DeflateStored(bw, filtered.data(), filtered.size());
+    }
+
+    // terminate the chunk with an empty stored block, this byte-aligns the stream so chunks can be concatenated
+    bw.Put(job.isLast ? 1 : 0, 1);
+    bw.Put(0, 2);
+    bw.Align();
+    const uint8_t emptyStored[4] = { 0x00, 0x00, 0xFF, 0xFF };
+    bw.PutBytes(emptyStored, sizeof(emptyStored));
+}
+
+static inline void WriteU32BE(uint8_t* dst, const uint32_t v) {
+    dst[0] = scast<uint8_t>(v >> 24);
+    dst[1] = scast<uint8_t>(v >> 16);
+    dst[2] = scast<uint8_t>(v >> 8);
+    dst[3] = scast<uint8_t>(v);
+}
+
+} // namespace
+
+
+PngStreamWriter::PngStreamWriter(const PngWriteFunc& writeFunc, const size_t width, const size_t height, const size_t numChannels, const PngWriteParams& params)
+    : mWriteFunc(writeFunc)
+    , mWidth(width)
+    , mHeight(height)
+    , mNumChannels(numChannels)
+    , mStride(width * numChannels)
+    , mLevel(std::clamp(params.level, 0, 9))
+    , mNumThreads(params.numThreads)
+    , mRowsPerChunk(params.rowsPerChunk)
+    , mRowsWritten(0)
+    , mRowsPending(0)
+    , mAdler(1)
+    , mHeaderWritten(false)
+    , mFinished(false)
+{
+    assert(numChannels >= 1 && numChannels <= 4);
+
+    mNumThreads = ParallelGetNumThreads(mNumThreads);
+    if (!mRowsPerChunk) {
+        mRowsPerChunk = std::max<size_t>(8, (512 * 1024) / std::max<size_t>(1, mStride));
+    }
+
+    mPendingRows.resize(mRowsPerChunk * mNumThreads * mStride);
+}
+PngStreamWriter::~PngStreamWriter() {
+}
+
+bool PngStreamWriter::WriteRows(const void* rows, const size_t numRows) {
+    if (mFinished || !mWidth || !mHeight || (mRowsWritten + mRowsPending + numRows) > mHeight) {
+        return false;
+    }
+
+    if (!mHeaderWritten) {
+        static const uint8_t kPngSignature[8] = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A };
+        mWriteFunc(kPngSignature, sizeof(kPngSignature));
+
+        static const uint8_t kColorTypes[5] = { 0, 0, 4, 2, 6 };   // gray, gray+alpha, rgb, rgba
+
+        uint8_t ihdr[13];
+        WriteU32BE(ihdr + 0, scast<uint32_t>(mWidth));
+        WriteU32BE(ihdr + 4, scast<uint32_t>(mHeight));
+        ihdr[8] = 8;                            // bit depth
+        ihdr[9] = kColorTypes[mNumChannels];
+        ihdr[10] = 0;                           // deflate
+        ihdr[11] = 0;                           // adaptive filtering
+        ihdr[12] = 0;                           // no interlace
+        this->WriteChunk(MakeFourcc<'I', 'H', 'D', 'R'>(), ihdr, sizeof(ihdr));
+
+        // zlib header, FLEVEL is informational only
+        const uint8_t zlibHdr[2] = { 0x78, scast<uint8_t>((mLevel <= 1) ? 0x01 : ((mLevel < 6) ? 0x5E : ((mLevel == 6) ? 0x9C : 0xDA))) };
+        this->WriteChunk(MakeFourcc<'I', 'D', 'A', 'T'>(), zlibHdr, sizeof(zlibHdr));
+
+        mHeaderWritten = true;
+    }
+
+    const size_t batchRows = mRowsPerChunk * mNumThreads;
+    const uint8_t* src = rcast<const uint8_t*>(rows);
+    size_t rowsLeft = numRows;
+    while (rowsLeft > 0) {
+        const size_t toCopy = std::min(rowsLeft, batchRows - mRowsPending);
+        memcpy(mPendingRows.data() + mRowsPending * mStride, src, toCopy * mStride);
+        mRowsPending += toCopy;
+        src += toCopy * mStride;
+        rowsLeft -= toCopy;
+
+        const bool lastBatch = (mRowsWritten + mRowsPending) == mHeight;
+        if (mRowsPending == batchRows || lastBatch) {
+            this->FlushPendingRows(lastBatch);
+        }
+    }
+
+    return true;
+}
+
+bool PngStreamWriter::Finish() {
+    if (mFinished || mRowsWritten != mHeight) {
+        return false;
+    }
+
+    uint8_t adler[4];
+    WriteU32BE(adler, mAdler);
+    this->WriteChunk(MakeFourcc<'I', 'D', 'A', 'T'>(), adler, sizeof(adler));
+    this->WriteChunk(MakeFourcc<'I', 'E', 'N', 'D'>(), nullptr, 0);
+
+    mFinished = true;
+    return true;
+}
+
+size_t PngStreamWriter::GetRowsWritten() const {
+    return mRowsWritten;
+}
+
+void PngStreamWriter::WriteChunk(const uint32_t type, const void* data, const size_t length) {
+    uint8_t lengthBE[4], crcBE[4];
+    WriteU32BE(lengthBE, scast<uint32_t>(length));
+
+    Crc32Stream crc;
+    crc.Update(&type, sizeof(type));
+    if (length) {
+        crc.Update(data, length);
+    }
+    WriteU32BE(crcBE, crc.Finalize());
+
+    mWriteFunc(lengthBE, sizeof(lengthBE));
+    mWriteFunc(&type, sizeof(type));
+    if (length) {
+        mWriteFunc(data, length);
+    }
+    mWriteFunc(crcBE, sizeof(crcBE));
+}
+
+void PngStreamWriter::FlushPendingRows(const bool lastBatch) {
+    const size_t numJobs = (mRowsPending + mRowsPerChunk - 1) / mRowsPerChunk;
+
+    MyArray<PngChunkJob> jobs(numJobs);
+    for (size_t i = 0; i < numJobs; ++i) {
+        PngChunkJob& job = jobs[i];
+        const size_t firstRow = i * mRowsPerChunk;
+        job.rows = mPendingRows.data() + firstRow * mStride;
+        job.prevRow = (i > 0) ? (job.rows - mStride) : (mPrevRow.empty() ? nullptr : mPrevRow.data());
+        job.numRows = std::min(mRowsPerChunk, mRowsPending - firstRow);
+        job.isLast = lastBatch && (i == numJobs - 1);
+    }
+
+    const size_t stride = mStride, bpp = mNumChannels;
+    const int level = mLevel;
+    ParallelFor(numJobs, [&jobs, stride, bpp, level](const size_t idx, const size_t) {
+        PngProcessChunk(jobs[idx], stride, bpp, level);
+    }, mNumThreads);
+
+    for (const PngChunkJob& job : jobs) {
+        mAdler = Adler32Combine(mAdler, job.adler, job.filteredLength);
+        this->WriteChunk(MakeFourcc<'I', 'D', 'A', 'T'>(), job.compressed.data(), job.compressed.size());
+    }
+
+    // keep the last row around, the next batch filters against it
+    mPrevRow.assign(mPendingRows.data() + (mRowsPending - 1) * mStride, mPendingRows.data() + mRowsPending * mStride);
+
+    mRowsWritten += mRowsPending;
+    mRowsPending = 0;
+}
+
+
+bool PNG_WriteToFunc(const PngWriteFunc& writeFunc, const void* pixels, const size_t width, const size_t height, const size_t numChannels, const PngWriteParams& params) {
+    PngStreamWriter writer(writeFunc, width, height, numChannels, params);
+    return writer.WriteRows(pixels, height) && writer.Finish();
+}
+
+bool PNG_WriteToFile(const fs::path& filePath, const void* pixels, const size_t width, const size_t height, const size_t numChannels, const PngWriteParams& params) {
+    bool result = false;
+
+    std::ofstream file(filePath, std::ofstream::binary);
+    if (file.good()) {
+        result = PNG_WriteToFunc([&file](const void* data, const size_t length) {
+            file.write(rcast<const char*>(data), length);
+        }, pixels, width, height, numChannels, params);
+
+        result = result && file.good();
+    }
+
+    return result;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include "mycommon.h"
+
+// Multi-threaded PNG encoder
+//  Rows are split into independent chunks, each chunk is filtered and deflated on its own thread,
+//  chunks are byte-aligned with an empty stored block (same trick pigz uses) and concatenated in order.
+//  Compression level follows zlib semantics: 0 - store only, 1 - fastest, 9 - best.
+
+enum class PngCompression : int {
+    Store   = 0,
+    Fast    = 1,
+    Default = 6,
+    Best    = 9
+};
+
+struct PngWriteParams {
+    int     level = scast<int>(PngCompression::Default);
+    size_t  numThreads = 0;     // 0 - use all hardware threads
+    size_t  rowsPerChunk = 0;   // 0 - pick automatically (~512 Kb of pixels per chunk)
+};
+
+using PngWriteFunc = std::function<void(const void* data, const size_t length)>;
+
+class PngStreamWriter {
+public:
+    PngStreamWriter(const PngWriteFunc& writeFunc, const size_t width, const size_t height, const size_t numChannels, const PngWriteParams& params = PngWriteParams());
+    ~PngStreamWriter();
+
+    // rows are tightly packed (width * numChannels bytes each), top to bottom
+    bool    WriteRows(const void* rows, const size_t numRows);
+    bool    Finish();
+
+    size_t  GetRowsWritten() const;
+
+private:
+    void    WriteChunk(const uint32_t type, const void* data, const size_t length);
+    void    FlushPendingRows(const bool lastBatch);
+
+private:
+    PngWriteFunc    mWriteFunc;
+    size_t          mWidth;
+    size_t          mHeight;
+    size_t          mNumChannels;
+    size_t          mStride;
+    int             mLevel;
+    size_t          mNumThreads;
+    size_t          mRowsPerChunk;
+    size_t          mRowsWritten;
+    size_t          mRowsPending;
+    uint32_t        mAdler;
+    bool            mHeaderWritten;
+    bool            mFinished;
+    BytesArray      mPendingRows;
+    BytesArray      mPrevRow;
+};
+
+bool PNG_WriteToFunc(const PngWriteFunc& writeFunc, const void* pixels, const size_t width, const size_t height, const size_t numChannels, const PngWriteParams& params = PngWriteParams());
+bool PNG_WriteToFile(const fs::path& filePath, const void* pixels, const size_t width, const size_t height, const size_t numChannels, const PngWriteParams& params = PngWriteParams());
@@ -2,15 +2,31 @@
 
 #include "metro/MetroSkeleton.h"
 #include "metro/MetroMotion.h"
+#include "metro/MetroMotionBaked.h"
+
+#include <immintrin.h>
+
+// 3x4 row-major affine transforms, the 4th row is always (0, 0, 0, 1) so it's never stored
+//  result row = a.x * b.row0 + a.y * b.row1 + a.z * b.row2 + (0, 0, 0, a.w)
+static inline __m128 Affine_MulRow(const __m128 a, const __m128 b0, const __m128 b1, const __m128 b2, const __m128 maskW) {
+    __m128 result = _mm_and_ps(a, maskW);
+    result = _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(0, 0, 0, 0)), b0));
+    result = _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(1, 1, 1, 1)), b1));
+    result = _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 2, 2, 2)), b2));
+    return result;
+}
 
 namespace u4a {
 
 Animator::Animator()
     : mSkeleton{}
     , mMotion{}
+    , mSampler(MakeStrongPtr<MetroMotionSampler>())
     , mState(AnimState::Stopped)
     , mTimer(0.0f)
     , mAnimTime(0.0f)
+    , mUseBakedTracks(false)
+    , mPoseStride(0)
 {
 }
 Animator::~Animator() {
@@ -26,46 +42,26 @@ void Animator::SetSkeleton(const RefPtr<MetroSkeleton>& skeleton) {
         //#NOTE_SK: this should be in skeleton!!!
         this->FlattenBones();
     }
+
+    this->PreparePose();
 }
 
 void Animator::SetMotion(const RefPtr<MetroMotion>& motion) {
     mMotion = motion;
+    mSampler->SetMotion(mMotion.get());
 
     if (mMotion) {
         mAnimTime = mMotion->GetMotionTimeInSeconds();
         mTimer = 0.0f;
     }
+
+    this->PreparePose();
 }
 
 void Animator::Update(const float dt) {
     if (mSkeleton && mMotion && AnimState::Playing == mState) {
         const size_t key = scast<size_t>(std::floorf((mTimer / mAnimTime) * mMotion->GetNumFrames()));
-
-        const size_t numBones = mSkeleton->GetNumBones();
-        for (size_t i = 0; i < numBones; ++i) {
-            const AnimBone& b = mFlattenedBones[i];
-
-            mat4& m = mAnimResult[b.id];
-
-            if (mMotion->IsBoneAnimated(b.id)) {
-                quat q = mMotion->GetBoneRotation(b.id, key);
-                vec3 t = mMotion->GetBonePosition(b.id, key);
-
-                m = MatFromQuat(q);
-                m[3] = vec4(t, 1.0f);
-            } else {
-                m = mSkeleton->GetBoneTransform(b.id);
-            }
-
-            if (b.pid != kInvalidValue) {
-                m = mAnimResult[b.pid] * m;
-            }
-        }
-
-        for (size_t i = 0; i < numBones; ++i) {
-            mat4& m = mAnimResult[i];
-            m = m * mSkeleton->GetBoneFullTransformInv(i);
-        }
+        this->EvaluatePose(key);
 
         mTimer += dt;
         if (mTimer > mAnimTime) {   // loop
@@ -74,6 +70,16 @@ void Animator::Update(const float dt) {
     }
 }
 
+// sample all the bones (SoA) -> local affine transforms (SoA, 4 bones at a time) -> model space in the flattened
+//  parent-first order with the inverse bind pose multiply fused in
+void Animator::EvaluatePose(const size_t frame) {
+    if (mSkeleton && mMotion && !mFlattenedBones.empty()) {
+        this->SamplePose(frame);
+        this->BuildLocalPose();
+        this->BuildModelPose();
+    }
+}
+
 void Animator::Stop() {
     mState = AnimState::Stopped;
 }
@@ -147,4 +153,186 @@ void Animator::FlattenBones() {
     }
 }
 
+void Animator::PreparePose() {
+    mUseBakedTracks = false;
+    mAnimatedBones.clear();
+    mStaticBones.clear();
+
+    const size_t numBones = mSkeleton ? mSkeleton->GetNumBones() : 0;
+    if (!numBones) {
+        mPoseStride = 0;
+        return;
+    }
+
+    // motions are shared and cached, baking one here would keep a copy of the whole motion alive for as long as
+    //  the motion is, so playback goes through the cursor cached sampler, unless somebody already baked the tracks
+    const MetroMotionBaked* baked = mMotion ? mMotion->GetBakedTracks() : nullptr;
+    if (baked && baked->GetNumBones() >= numBones) {
+        // baked frames are dequantized straight into our SoA, so the strides have to match
+        mUseBakedTracks = true;
+        mPoseStride = baked->GetNumBonesPadded();
+    } else {
+        mPoseStride = (numBones + MetroMotionBaked::kBonesAlign - 1) & ~(MetroMotionBaked::kBonesAlign - 1);
+    }
+
+    mPoseSoA.assign(MetroMotionBaked::kNumFrameComponents * mPoseStride, 0.0f);
+    mLocalPose.resize(mPoseStride * 3);
+    mModelPose.resize(numBones * 3);
+    mInvBindPose.resize(numBones * 3);
+    mBindRotations.resize(numBones);
+    mBindPositions.resize(numBones);
+
+    for (size_t i = 0; i < numBones; ++i) {
+        mBindRotations[i] = mSkeleton->GetBoneRotation(i);
+        mBindPositions[i] = mSkeleton->GetBonePosition(i);
+
+        // glm is column-major, our rows are its columns transposed, bind transforms are always affine
+        const mat4& ib = mSkeleton->GetBoneFullTransformInv(i);
+        for (size_t row = 0; row < 3; ++row) {
+            mInvBindPose[i * 3 + row] = vec4(ib[0][row], ib[1][row], ib[2][row], ib[3][row]);
+        }
+
+        if (mMotion && mMotion->IsBoneAnimated(i)) {
+            mAnimatedBones.push_back(i);
+        } else {
+            mStaticBones.push_back(i);
+        }
+    }
+}
+
+void Animator::SamplePose(const size_t frame) {
+    const size_t stride = mPoseStride;
+    float* soa = mPoseSoA.data();
+
+    if (mUseBakedTracks) {
+        mMotion->GetBakedTracks()->SampleFrameSoA(frame, soa);
+    } else {
+        const float time = scast<float>(frame) / scast<float>(MetroMotion::kFrameRate);
+        for (const size_t i : mAnimatedBones) {
+            const quat q = mSampler->GetBoneRotation(i, time);
+            const vec3 t = mSampler->GetBonePosition(i, time);
+
+            soa[0 * stride + i] = q.x;
+            soa[1 * stride + i] = q.y;
+            soa[2 * stride + i] = q.z;
+            soa[3 * stride + i] = q.w;
+            soa[4 * stride + i] = t.x;
+            soa[5 * stride + i] = t.y;
+            soa[6 * stride + i] = t.z;
+        }
+    }
+
+    for (const size_t i : mStaticBones) {
+        const quat& q = mBindRotations[i];
+        const vec3& t = mBindPositions[i];
+
+        soa[0 * stride + i] = q.x;
+        soa[1 * stride + i] = q.y;
+        soa[2 * stride + i] = q.z;
+        soa[3 * stride + i] = q.w;
+        soa[4 * stride + i] = t.x;
+        soa[5 * stride + i] = t.y;
+        soa[6 * stride + i] = t.z;
+    }
+}
+
+// quaternion + translation -> 3x4, same math as MatFromQuat, 4 bones per SSE op then transposed into rows
+void Animator::BuildLocalPose() {
+    const size_t stride = mPoseStride;
+    const float* soa = mPoseSoA.data();
+    float* dst = rcast<float*>(mLocalPose.data());
+
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 two = _mm_set1_ps(2.0f);
+
+    const size_t numBones = mSkeleton->GetNumBones();
+    for (size_t i = 0; i < numBones; i += 4) {
+        const __m128 x = _mm_loadu_ps(soa + 0 * stride + i);
+        const __m128 y = _mm_loadu_ps(soa + 1 * stride + i);
+        const __m128 z = _mm_loadu_ps(soa + 2 * stride + i);
+        const __m128 w = _mm_loadu_ps(soa + 3 * stride + i);
+
+        const __m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+        const __m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+        const __m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+        __m128 r00 = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz)));
+        __m128 r01 = _mm_mul_ps(two, _mm_sub_ps(xy, wz));
+        __m128 r02 = _mm_mul_ps(two, _mm_add_ps(xz, wy));
+        __m128 r03 = _mm_loadu_ps(soa + 4 * stride + i);
+        __m128 r10 = _mm_mul_ps(two, _mm_add_ps(xy, wz));
+        __m128 r11 = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz)));
+        __m128 r12 = _mm_mul_ps(two, _mm_sub_ps(yz, wx));
+        __m128 r13 = _mm_loadu_ps(soa + 5 * stride + i);
+        __m128 r20 = _mm_mul_ps(two, _mm_sub_ps(xz, wy));
+        __m128 r21 = _mm_mul_ps(two, _mm_add_ps(yz, wx));
+        __m128 r22 = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy)));
+        __m128 r23 = _mm_loadu_ps(soa + 6 * stride + i);
+
+        // SoA -> one row of 4 bones per register
+        _MM_TRANSPOSE4_PS(r00, r01, r02, r03);
+        _MM_TRANSPOSE4_PS(r10, r11, r12, r13);
+        _MM_TRANSPOSE4_PS(r20, r21, r22, r23);
+
+        float* bone = dst + i * 12;
+        _mm_storeu_ps(bone + 0, r00); _mm_storeu_ps(bone + 4, r10); _mm_storeu_ps(bone + 8, r20);
+        _mm_storeu_ps(bone + 12, r01); _mm_storeu_ps(bone + 16, r11); _mm_storeu_ps(bone + 20, r21);
+        _mm_storeu_ps(bone + 24, r02); _mm_storeu_ps(bone + 28, r12); _mm_storeu_ps(bone + 32, r22);
+        _mm_storeu_ps(bone + 36, r03); _mm_storeu_ps(bone + 40, r13); _mm_storeu_ps(bone + 44, r23);
+    }
+}
+
+// model = parent * local, skin = model * inverse bind, only the model transforms are kept for the children
+void Animator::BuildModelPose() {
+    const __m128 maskW = _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0));
+    const __m128 lastRow = _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f);
+
+    const float* local = rcast<const float*>(mLocalPose.data());
+    const float* invBind = rcast<const float*>(mInvBindPose.data());
+    float* model = rcast<float*>(mModelPose.data());
+
+    for (const AnimBone& b : mFlattenedBones) {
+        const float* l = local + b.id * 12;
+        __m128 m0 = _mm_loadu_ps(l + 0);
+        __m128 m1 = _mm_loadu_ps(l + 4);
+        __m128 m2 = _mm_loadu_ps(l + 8);
+
+        if (b.pid != kInvalidValue) {
+            const float* p = model + b.pid * 12;
+            const __m128 p0 = _mm_loadu_ps(p + 0);
+            const __m128 p1 = _mm_loadu_ps(p + 4);
+            const __m128 p2 = _mm_loadu_ps(p + 8);
+
+            const __m128 l0 = m0, l1 = m1, l2 = m2;
+            m0 = Affine_MulRow(p0, l0, l1, l2, maskW);
+            m1 = Affine_MulRow(p1, l0, l1, l2, maskW);
+            m2 = Affine_MulRow(p2, l0, l1, l2, maskW);
+        }
+
+        float* m = model + b.id * 12;
+        _mm_storeu_ps(m + 0, m0);
+        _mm_storeu_ps(m + 4, m1);
+        _mm_storeu_ps(m + 8, m2);
+
+        const float* ib = invBind + b.id * 12;
+        const __m128 ib0 = _mm_loadu_ps(ib + 0);
+        const __m128 ib1 = _mm_loadu_ps(ib + 4);
+        const __m128 ib2 = _mm_loadu_ps(ib + 8);
+
+        __m128 s0 = Affine_MulRow(m0, ib0, ib1, ib2, maskW);
+        __m128 s1 = Affine_MulRow(m1, ib0, ib1, ib2, maskW);
+        __m128 s2 = Affine_MulRow(m2, ib0, ib1, ib2, maskW);
+        __m128 s3 = lastRow;
+
+        // rows -> glm columns
+        _MM_TRANSPOSE4_PS(s0, s1, s2, s3);
+
+        float* dst = rcast<float*>(&mAnimResult[b.id]);
+        _mm_storeu_ps(dst + 0, s0);
+        _mm_storeu_ps(dst + 4, s1);
+        _mm_storeu_ps(dst + 8, s2);
+        _mm_storeu_ps(dst + 12, s3);
+    }
+}
+
 } // namespace u4a
@@ -4,6 +4,7 @@
 
 class MetroSkeleton;
 class MetroMotion;
+class MetroMotionSampler;
 
 namespace u4a {
 
@@ -28,6 +29,8 @@ public:
     void                    SetMotion(const RefPtr<MetroMotion>& motion);
 
     void                    Update(const float dt);
+    // whole pose of the motion frame into GetAnimResult(), needs no renderer so tools and benchmarks can run it headless
+    void                    EvaluatePose(const size_t frame);
     void                    Stop();
     void                    Play();
     void                    Pause();
@@ -37,15 +40,32 @@ public:
 
 private:
     void                    FlattenBones();
+    void                    PreparePose();
+    void                    SamplePose(const size_t frame);
+    void                    BuildLocalPose();
+    void                    BuildModelPose();
 
 private:
     RefPtr<MetroSkeleton>   mSkeleton;
     RefPtr<MetroMotion>     mMotion;
+    StrongPtr<MetroMotionSampler> mSampler;
     AnimState               mState;
     float                   mTimer;
     float                   mAnimTime;
     MyArray<AnimBone>       mFlattenedBones;
     Mat4Array               mAnimResult;
+
+    // pose pipeline, affine transforms are 3 rows per bone (row-major 3x4), indexed by the bone id
+    bool                    mUseBakedTracks;
+    size_t                  mPoseStride;        // floats per SoA component, bones padded
+    MyArray<float>          mPoseSoA;           // MetroMotionBaked::kNumFrameComponents x mPoseStride
+    MyArray<vec4>           mLocalPose;         // mPoseStride x 3 rows
+    MyArray<vec4>           mModelPose;
+    MyArray<vec4>           mInvBindPose;
+    MyArray<quat>           mBindRotations;     // local bind pose, for the bones the motion doesn't animate
+    MyArray<vec3>           mBindPositions;
+    MyArray<size_t>         mAnimatedBones;
+    MyArray<size_t>         mStaticBones;
 };
 
 } // namespace u4a
@@ -0,0 +1,237 @@
+#include "AnimatorBenchmark.h"
+#include "Animator.h"
+
+#include "metro/MetroSkeleton.h"
+#include "metro/MetroMotion.h"
+#include "metro/MetroMotionBenchmark.h"
+#include "jansson.h"
+
+#include <chrono>
+
+namespace u4a {
+
+static volatile float sPoseBenchSink = 0.0f;  // keeps the optimizer from dropping the poses
+
+static float PoseBench_MaxDiff(const mat4& a, const mat4& b) {
+    float result = 0.0f;
+    for (int i = 0; i < 4; ++i) {
+        const vec4 d = glm::abs(a[i] - b[i]);
+        result = std::max(result, std::max(std::max(d.x, d.y), std::max(d.z, d.w)));
+    }
+    return result;
+}
+
+
+AnimatorBenchmark::AnimatorBenchmark() {
+}
+AnimatorBenchmark::~AnimatorBenchmark() {
+}
+
+void AnimatorBenchmark::AddSyntheticSetup(const CharString& name, const size_t numBones, const size_t numFrames, const size_t staticEvery) {
+    Setup setup;
+    setup.name = name;
+    setup.skeleton = MakeSyntheticSkeleton(numBones);
+    setup.motion = MetroMotionBenchmark::MakeSyntheticMotion(name, numBones, numFrames, 1);
+    if (!setup.skeleton || !setup.motion) {
+        return;
+    }
+
+    if (staticEvery) {
+        for (size_t i = staticEvery - 1; i < numBones; i += staticEvery) {
+            setup.motion->mAffectedBones.SetBit(i, false);
+        }
+    }
+
+    mSetups.emplace_back(std::move(setup));
+}
+
+void AnimatorBenchmark::AddDefaultSyntheticSetups() {
+    // ~80 bones is the usual humanoid, 200 is a creature or a humanoid with the facial bones
+    this->AddSyntheticSetup("humanoid_80", 80, 900, 0);
+    this->AddSyntheticSetup("creature_200", 200, 900, 0);
+    this->AddSyntheticSetup("creature_200_partial", 200, 900, 4);
+}
+
+size_t AnimatorBenchmark::GetNumSetups() const {
+    return mSetups.size();
+}
+
+size_t AnimatorBenchmark::Run(const size_t numIterations) {
+    mResults.clear();
+    mResults.reserve(mSetups.size());
+
+    for (const Setup& setup : mSetups) {
+        PoseBenchResult result = {};
+        if (this->RunSingle(setup, std::max<size_t>(1, numIterations), result)) {
+            mResults.emplace_back(std::move(result));
+        } else {
+            LogPrintF(LogLevel::Warning, "Pose benchmark: %s failed", setup.name.c_str());
+        }
+    }
+
+    return mResults.size();
+}
+
+const MyArray<PoseBenchResult>& AnimatorBenchmark::GetResults() const {
+    return mResults;
+}
+
+json_t* AnimatorBenchmark::ToJsonTree() const {
+    json_t* root = json_object();
+    json_t* results = json_array();
+
+    for (const PoseBenchResult& r : mResults) {
+        json_t* jr = json_object();
+        json_object_set_new(jr, "name", json_string(r.name.c_str()));
+        json_object_set_new(jr, "bones", json_integer(scast<json_int_t>(r.numBones)));
+        json_object_set_new(jr, "animated_bones", json_integer(scast<json_int_t>(r.numAnimatedBones)));
+        json_object_set_new(jr, "poses", json_integer(scast<json_int_t>(r.numPoses)));
+        json_object_set_new(jr, "per_bone_ms", json_real(r.perBoneMs));
+        json_object_set_new(jr, "pose_ms", json_real(r.poseMs));
+        json_object_set_new(jr, "per_bone_ns_per_pose", json_real(r.perBoneNsPerPose));
+        json_object_set_new(jr, "pose_ns_per_pose", json_real(r.poseNsPerPose));
+        json_object_set_new(jr, "pose_ns_per_bone", json_real(r.poseNsPerBone));
+        json_object_set_new(jr, "max_error", json_real(r.maxError));
+
+        json_array_append_new(results, jr);
+    }
+
+    json_object_set_new(root, "results", results);
+
+    return root;
+}
+
+RefPtr<MetroSkeleton> AnimatorBenchmark::MakeSyntheticSkeleton(const size_t numBones) {
+    if (!numBones || numBones > 256) {
+        return nullptr;
+    }
+
+    MyArray<MetroBone> bones(numBones);
+    for (size_t i = 0; i < numBones; ++i) {
+        MetroBone& b = bones[i];
+        b.name = "bone_" + std::to_string(i);
+        if (i) {
+            const size_t parentIdx = (i % 4) ? (i - 1) : (i / 2 - 1);
+            b.parent = bones[parentIdx].name;
+        }
+
+        const float angle = scast<float>(i % 11) * 0.1f;
+        b.q = Normalize(quat(Cos(angle), Sin(angle) * 0.3f, 0.0f, Sin(angle) * 0.2f));
+        b.t = vec3(0.0f, 0.1f, scast<float>(i % 3) * 0.02f);
+        b.bp = 0;
+        b.bpf = 0;
+    }
+
+    RefPtr<MetroSkeleton> skeleton = MakeRefPtr<MetroSkeleton>();
+    skeleton->SetBones(bones);
+    return skeleton;
+}
+
+bool AnimatorBenchmark::RunSingle(const Setup& setup, const size_t numIterations, PoseBenchResult& result) const {
+    using Clock = std::chrono::high_resolution_clock;
+
+    const MetroSkeleton& skeleton = *setup.skeleton;
+    const MetroMotion& motion = *setup.motion;
+
+    const size_t numBones = skeleton.GetNumBones();
+    const size_t numFrames = motion.GetNumFrames();
+
+    // synthetic skeletons always have the parents before the children, so the bones order is the flattened one
+    MyArray<size_t> parents(numBones);
+    size_t numAnimatedBones = 0;
+    for (size_t i = 0; i < numBones; ++i) {
+        parents[i] = skeleton.GetBoneParentIdx(i);
+        if (parents[i] != kInvalidValue && parents[i] >= i) {
+            return false;
+        }
+        numAnimatedBones += motion.IsBoneAnimated(i) ? 1 : 0;
+    }
+
+    Animator animator;
+    animator.SetSkeleton(setup.skeleton);
+    animator.SetMotion(setup.motion);
+
+    MetroMotionSampler sampler(&motion);
+
+    // reference poses are kept from the first iteration to check the pipeline against
+    MyArray<mat4> reference(numFrames * numBones);
+    MyArray<mat4> pose(numBones);
+    float maxError = 0.0f;
+
+    double bestPerBoneMs = 0.0, bestPoseMs = 0.0;
+    float sink = 0.0f;
+
+    for (size_t iteration = 0; iteration < numIterations; ++iteration) {
+        const bool verify = (iteration == 0);
+
+        const auto t0 = Clock::now();
+        sampler.ResetCursors();
+        for (size_t frame = 0; frame < numFrames; ++frame) {
+            const float time = scast<float>(frame) / scast<float>(MetroMotion::kFrameRate);
+            for (size_t i = 0; i < numBones; ++i) {
+                mat4& m = pose[i];
+                if (motion.IsBoneAnimated(i)) {
+                    m = MatFromQuat(sampler.GetBoneRotation(i, time));
+                    m[3] = vec4(sampler.GetBonePosition(i, time), 1.0f);
+                } else {
+                    m = skeleton.GetBoneTransform(i);
+                }
+
+                if (parents[i] != kInvalidValue) {
+                    m = pose[parents[i]] * m;
+                }
+            }
+
+            for (size_t i = 0; i < numBones; ++i) {
+                const mat4 m = pose[i] * skeleton.GetBoneFullTransformInv(i);
+                if (verify) {
+                    reference[frame * numBones + i] = m;
+                }
+                sink += m[3].x;
+            }
+        }
+
+        const auto t1 = Clock::now();
+        for (size_t frame = 0; frame < numFrames; ++frame) {
+            animator.EvaluatePose(frame);
+
+            const Mat4Array& animResult = animator.GetAnimResult();
+            if (verify) {
+                for (size_t i = 0; i < numBones; ++i) {
+                    maxError = std::max(maxError, PoseBench_MaxDiff(reference[frame * numBones + i], animResult[i]));
+                }
+            }
+            sink += animResult.back()[3].x;
+        }
+        const auto t2 = Clock::now();
+
+        // the first iteration also fills and checks the reference, it doesn't count
+        if (!verify || numIterations == 1) {
+            const double perBoneMs = std::chrono::duration<double, std::milli>(t1 - t0).count();
+            const double poseMs = std::chrono::duration<double, std::milli>(t2 - t1).count();
+
+            const bool first = (bestPerBoneMs == 0.0);
+            bestPerBoneMs = first ? perBoneMs : std::min(bestPerBoneMs, perBoneMs);
+            bestPoseMs = first ? poseMs : std::min(bestPoseMs, poseMs);
+        }
+    }
+
+    const double nsScale = 1e6 / scast<double>(numFrames);
+
+    result.name = setup.name;
+    result.numBones = numBones;
+    result.numAnimatedBones = numAnimatedBones;
+    result.numPoses = numFrames;
+    result.perBoneMs = bestPerBoneMs;
+    result.poseMs = bestPoseMs;
+    result.perBoneNsPerPose = bestPerBoneMs * nsScale;
+    result.poseNsPerPose = bestPoseMs * nsScale;
+    result.poseNsPerBone = result.poseNsPerPose / scast<double>(numBones);
+    result.maxError = maxError;
+
+    sPoseBenchSink = sink;
+
+    return true;
+}
+
+} // namespace u4a
@@ -0,0 +1,62 @@
+#pragma once
+#include "mycommon.h"
+
+class MetroSkeleton;
+class MetroMotion;
+struct json_t;
+
+namespace u4a {
+
+// Evaluates whole poses headless (no renderer, no device) on synthetic skeletons:
+//  per_bone - the old Animator::Update, sampler + mat4 per bone, kept here as the reference
+//  pose     - Animator::EvaluatePose, cursor cached sampling into SoA + SIMD 3x4 hierarchy pass
+//  Both modes evaluate every frame of the same motion, their skinning matrices are compared per bone and the worst
+//  difference goes to max_error, timings are per pose and per bone, so skeletons of different sizes compare.
+
+struct PoseBenchResult {
+    CharString  name;
+    size_t      numBones;
+    size_t      numAnimatedBones;
+    size_t      numPoses;           // per mode and iteration, one per motion frame
+    double      perBoneMs;          // best of all iterations
+    double      poseMs;
+    double      perBoneNsPerPose;
+    double      poseNsPerPose;
+    double      poseNsPerBone;
+    float       maxError;           // biggest difference of the skinning matrices from the reference ones
+};
+
+class AnimatorBenchmark {
+public:
+    AnimatorBenchmark();
+    ~AnimatorBenchmark();
+
+    // bones come in chains of 4, every chain hangs off a bone of the first half of the skeleton,
+    //  staticEvery > 0 leaves every staticEvery-th bone out of the motion so it stays in the bind pose
+    void                                AddSyntheticSetup(const CharString& name, const size_t numBones, const size_t numFrames, const size_t staticEvery);
+    void                                AddDefaultSyntheticSetups();
+    size_t                              GetNumSetups() const;
+
+    // returns number of successful runs
+    size_t                              Run(const size_t numIterations = 1);
+
+    const MyArray<PoseBenchResult>&     GetResults() const;
+    json_t*                             ToJsonTree() const;
+
+    static RefPtr<MetroSkeleton>        MakeSyntheticSkeleton(const size_t numBones);
+
+private:
+    struct Setup {
+        CharString              name;
+        RefPtr<MetroSkeleton>   skeleton;
+        RefPtr<MetroMotion>     motion;
+    };
+
+    bool                                RunSingle(const Setup& setup, const size_t numIterations, PoseBenchResult& result) const;
+
+private:
+    MyArray<Setup>                      mSetups;
+    MyArray<PoseBenchResult>            mResults;
+};
+
+} // namespace u4a
@@ -250,11 +250,11 @@ static Texture* Util_LoadTexture(const StringArray& textureLevels, const size_t
 Surface ResourcesManager::LoadSurface(const HashString& name) {
     Surface result;
 
-    MetroSurfaceDescription desc = MetroContext::Get().GetTexturesDB().GetSurfaceSetFromName(name, true);
+    const RefPtr<const MetroSurfaceDescription> desc = MetroContext::Get().GetTexturesDB().GetSurfaceSetFromName(name, true);
 
-    result.base = Util_LoadTexture(desc.albedoPaths, Texture::Flag_SRGB, !mLoadHighRes);
-    result.normal = Util_LoadTexture(desc.normalmapPaths, 0, !mLoadHighRes);
-    result.bump = Util_LoadTexture(desc.bumpPaths, 0, !mLoadHighRes);
+    result.base = Util_LoadTexture(desc->albedoPaths, Texture::Flag_SRGB, !mLoadHighRes);
+    result.normal = Util_LoadTexture(desc->normalmapPaths, 0, !mLoadHighRes);
+    result.bump = Util_LoadTexture(desc->bumpPaths, 0, !mLoadHighRes);
 
     if (!result.base) {
         result.base = mFallbackBase;
@@ -346,7 +346,7 @@ Model* ResourcesManager::LoadModel(const HashString& name, const bool needAnimat
     }
 #else
     const uint32_t loadFlags = MetroModelLoadParams::LoadGeometry | MetroModelLoadParams::LoadSkeleton | MetroModelLoadParams::LoadTPresets;
-    RefPtr<MetroModelBase> srcModel = MetroModelFactory::CreateModelFromFullName(name.str, loadFlags);
+    RefPtr<MetroModelBase> srcModel = MetroModelFactory::GetSharedModelFromFullName(name.str, loadFlags);
     if (srcModel) {
         result = new Model();
         if (!result->Create(srcModel.get())) {
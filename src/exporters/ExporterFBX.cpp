@@ -4,6 +4,7 @@
 #include "metro/MetroMotion.h"
 #include "metro/MetroLevel.h"
 #include "metro/MetroContext.h"
+#include "metro/MetroVertexCodec.h"
 
 
 #define FBXSDK_NEW_API
@@ -23,32 +24,20 @@ static MyArray<MetroVertex> MakeCommonVertices(const MetroModelGeomData& gd) {
         const VertexSkinned* srcVerts = rcast<const VertexSkinned*>(gd.vertices);
 
         result.resize(gd.mesh->verticesCount);
-        MetroVertex* dstVerts = result.data();
-
-        for (size_t i = 0; i < gd.mesh->verticesCount; ++i) {
-            *dstVerts = ConvertVertex(*srcVerts);
-            dstVerts->pos *= gd.mesh->verticesScale;
-
-            //#NOTE_SK: need to remap bones
-            dstVerts->bones[0] = gd.mesh->bonesRemap[dstVerts->bones[0] / 3];
-            dstVerts->bones[1] = gd.mesh->bonesRemap[dstVerts->bones[1] / 3];
-            dstVerts->bones[2] = gd.mesh->bonesRemap[dstVerts->bones[2] / 3];
-            dstVerts->bones[3] = gd.mesh->bonesRemap[dstVerts->bones[3] / 3];
-
-            ++srcVerts;
-            ++dstVerts;
+        VTX_ConvertVertices(srcVerts, gd.mesh->verticesCount, gd.mesh->verticesScale, result.data());
+
+        //#NOTE_SK: need to remap bones
+        for (MetroVertex& v : result) {
+            v.bones[0] = gd.mesh->bonesRemap[v.bones[0] / 3];
+            v.bones[1] = gd.mesh->bonesRemap[v.bones[1] / 3];
+            v.bones[2] = gd.mesh->bonesRemap[v.bones[2] / 3];
+            v.bones[3] = gd.mesh->bonesRemap[v.bones[3] / 3];
         }
     } else if (gd.mesh->vertexType == MetroVertexType::Static) {
         const VertexStatic* srcVerts = rcast<const VertexStatic*>(gd.vertices);
 
         result.resize(gd.mesh->verticesCount);
-        MetroVertex* dstVerts = result.data();
-
-        for (size_t i = 0; i < gd.mesh->verticesCount; ++i) {
-            *dstVerts = ConvertVertex(*srcVerts);
-            ++srcVerts;
-            ++dstVerts;
-        }
+        VTX_ConvertVertices(srcVerts, gd.mesh->verticesCount, result.data());
     } else if (gd.mesh->vertexType == MetroVertexType::Soft) {
         const VertexSoft* srcVerts = rcast<const VertexSoft*>(gd.vertices);
 
@@ -145,9 +134,9 @@ static FbxVector4 MetroRotToFbxRot(const quat& q) {
 
 
 FbxSurfacePhong* FBXE_CreateMaterial(FbxManager* mgr, const CharString& textureName, const fs::path& texturesFolder, const CharString& extension) {
-    MetroSurfaceDescription surfaceSet = MetroContext::Get().GetTexturesDB().GetSurfaceSetFromName(textureName, false);
-    const CharString& albedoName = surfaceSet.albedo;
-    const CharString& normalmapName = surfaceSet.normalmap;
+    const RefPtr<const MetroSurfaceDescription> surfaceSet = MetroContext::Get().GetTexturesDB().GetSurfaceSetFromName(textureName, false);
+    const CharString& albedoName = surfaceSet->albedo;
+    const CharString& normalmapName = surfaceSet->normalmap;
 
     CharString albedoTextureName = fs::path(albedoName).filename().u8string();
     CharString textureFileName = albedoTextureName + extension;
@@ -437,8 +426,8 @@ static void FBXE_AddAnimTrackToScene(FbxScene* scene, const MetroMotion* motion,
         FbxNode* boneNode = skelNodes[i];
 
         if (motion->IsBoneAnimated(i)) {
-            const auto& posCurve = motion->mBonesPositions[i];
-            const auto& rotCurve = motion->mBonesRotations[i];
+            const AttributeCurve posCurve = motion->GetBonePositionsCurve(i);
+            const AttributeCurve rotCurve = motion->GetBoneRotationsCurve(i);
 
             boneNode->LclRotation.GetCurveNode(animLayer, true);
             boneNode->LclTranslation.GetCurveNode(animLayer, true);
@@ -852,13 +841,14 @@ bool ExporterFBX::ExportLevel(const MetroLevel& level, const fs::path& filePath)
             uv1Element->SetReferenceMode(FbxGeometryElement::eDirect);
 
             // build vertices
-            for (size_t k = 0; k < ss.desc.numVertices; ++k) {
-                const MetroVertex& v = ConvertVertex(sector.vertices[ss.desc.vbOffset + k]);
+            MetroVertexStreams streams;
+            VTX_DecodeLevel(sector.vertices.data() + ss.desc.vbOffset, ss.desc.numVertices, streams);
 
-                *ptrCtrlPoints = MetroVecToFbxVec(v.pos);
-                normalElement->GetDirectArray().Add(MetroVecToFbxVec(v.normal));
-                uv0Element->GetDirectArray().Add(FbxVector2(v.uv0.x, 1.0f - v.uv0.y));
-                uv1Element->GetDirectArray().Add(FbxVector2(v.uv1.x, 1.0f - v.uv1.y));
+            for (size_t k = 0; k < ss.desc.numVertices; ++k) {
+                *ptrCtrlPoints = FbxVector4(streams.px[k], streams.py[k], streams.pz[k]);
+                normalElement->GetDirectArray().Add(FbxVector4(streams.nx[k], streams.ny[k], streams.nz[k]));
+                uv0Element->GetDirectArray().Add(FbxVector2(streams.u0[k], 1.0f - streams.v0[k]));
+                uv1Element->GetDirectArray().Add(FbxVector2(streams.u1[k], 1.0f - streams.v1[k]));
 
                 ++ptrCtrlPoints;
             }
@@ -912,7 +902,7 @@ bool ExporterFBX::ExportLevel(const MetroLevel& level, const fs::path& filePath)
                 modelNode = FBXE_InstantiateModel(scene, entityName, it->second);
             } else {
                 const uint32_t loadFlags = MetroModelLoadParams::LoadGeometry | MetroModelLoadParams::LoadTPresets;
-                RefPtr<MetroModelBase> mdl = MetroModelFactory::CreateModelFromFullName(visual, loadFlags);
+                RefPtr<MetroModelBase> mdl = MetroModelFactory::GetSharedModelFromFullName(visual, loadFlags);
                 if (mdl) {
                     MyFbxMeshModel newFbxModel;
                     FBXE_CreateMeshModel(mgr, scene, *mdl, entityName, newFbxModel, fbxMaterials, mTexturesFolder, mTexturesExtension, mExcludeCollision);
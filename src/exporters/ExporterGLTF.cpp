@@ -4,6 +4,7 @@
 #include "metro/MetroMotion.h"
 #include "metro/MetroLevel.h"
 #include "metro/MetroContext.h"
+#include "metro/MetroVertexCodec.h"
 
 #define TINYGLTF_IMPLEMENTATION
 #define TINYGLTF_NOEXCEPTION
@@ -21,13 +22,11 @@ static MyArray<MetroVertex> MakeCommonVertices(const MetroModelGeomData& gd) {
         const VertexSkinned* srcVerts = rcast<const VertexSkinned*>(gd.vertices);
 
         result.resize(gd.mesh->verticesCount);
-        MetroVertex* dstVerts = result.data();
+        VTX_ConvertVertices(srcVerts, gd.mesh->verticesCount, gd.mesh->verticesScale, result.data());
 
+        //#NOTE_SK: need to remap bones
+        MetroVertex* dstVerts = result.data();
         for (size_t i = 0; i < gd.mesh->verticesCount; ++i) {
-            *dstVerts = ConvertVertex(*srcVerts);
-            dstVerts->pos *= gd.mesh->verticesScale;
-
-            //#NOTE_SK: need to remap bones
             dstVerts->bones[0] = gd.mesh->bonesRemap[srcVerts->bones[0] / 3];
             dstVerts->bones[1] = gd.mesh->bonesRemap[srcVerts->bones[1] / 3];
             dstVerts->bones[2] = gd.mesh->bonesRemap[srcVerts->bones[2] / 3];
@@ -40,13 +39,7 @@ static MyArray<MetroVertex> MakeCommonVertices(const MetroModelGeomData& gd) {
         const VertexStatic* srcVerts = rcast<const VertexStatic*>(gd.vertices);
 
         result.resize(gd.mesh->verticesCount);
-        MetroVertex* dstVerts = result.data();
-
-        for (size_t i = 0; i < gd.mesh->verticesCount; ++i) {
-            *dstVerts = ConvertVertex(*srcVerts);
-            ++srcVerts;
-            ++dstVerts;
-        }
+        VTX_ConvertVertices(srcVerts, gd.mesh->verticesCount, result.data());
     } else if (gd.mesh->vertexType == MetroVertexType::Soft) {
         const VertexSoft* srcVerts = rcast<const VertexSoft*>(gd.vertices);
 
@@ -67,80 +60,239 @@ static MyArray<MetroVertex> MakeCommonVertices(const MetroModelGeomData& gd) {
 
 using MyGLTFMaterialsDict = MyDict<HashString, int>;
 
+static int GetOrCreateGLTFMaterial(const CharString& texture,
+                                   MyGLTFMaterialsDict& materialsDict,
+                                   tinygltf::Model& gltfModel,
+                                   const CharString& textureExtension) {
+    HashString textureHash(texture);
+    auto it = materialsDict.find(textureHash);
+    if (it != materialsDict.end()) {
+        return it->second;
+    }
+
+    const RefPtr<const MetroSurfaceDescription> surfaceSet = MetroContext::Get().GetTexturesDB().GetSurfaceSetFromName(texture, false);
+    const CharString& albedoName = surfaceSet->albedo;
+
+    CharString textureName = fs::path(albedoName).filename().string();
+    CharString textureFileName = textureName + textureExtension;
+
+    tinygltf::Image gltfImage;
+    gltfImage.uri = textureFileName;
+
+    tinygltf::Texture gltfTexture;
+    gltfTexture.name = textureName;
+    gltfTexture.source = scast<int>(gltfModel.images.size());
+    gltfTexture.sampler = 0;
+
+    tinygltf::Material gltfMaterial;
+    gltfMaterial.name = textureName;
+    gltfMaterial.pbrMetallicRoughness.baseColorFactor = { 1.0, 1.0, 1.0, 1.0 };
+    gltfMaterial.pbrMetallicRoughness.baseColorTexture.index = scast<int>(gltfModel.textures.size());
+    gltfMaterial.pbrMetallicRoughness.baseColorTexture.texCoord = 0;
+    gltfMaterial.pbrMetallicRoughness.metallicFactor = 0.0;
+    gltfMaterial.pbrMetallicRoughness.roughnessFactor = 1.0;
+    gltfMaterial.doubleSided = true;
+
+    const int materialIdx = scast<int>(gltfModel.materials.size());
+
+    gltfModel.images.push_back(gltfImage);
+    gltfModel.textures.push_back(gltfTexture);
+    gltfModel.materials.push_back(gltfMaterial);
+
+    materialsDict[textureHash] = materialIdx;
+
+    return materialIdx;
+}
+
 void CreateGLTFMaterials(const MyArray<MetroModelGeomData>& gds,
                          MyGLTFMaterialsDict& materialsDict,
                          tinygltf::Model& gltfModel,
                          const CharString& textureExtension) {
-    int materialIdx = 0;
     for (auto& gd : gds) {
         const CharString& gdTexture = gd.model->GetMaterialString(MetroModelBase::kMaterialStringTexture);
-        HashString gdTextureHash(gdTexture);
-        if (materialsDict.find(gdTextureHash) == materialsDict.end()) {
-            MetroSurfaceDescription surfaceSet = MetroContext::Get().GetTexturesDB().GetSurfaceSetFromName(gdTexture, false);
-            const CharString& albedoName = surfaceSet.albedo;
-            const CharString& normalmapName = surfaceSet.normalmap;
-
-            CharString textureName = fs::path(albedoName).filename().string();
-            CharString textureFileName = textureName + textureExtension;
-
-            tinygltf::Image gltfImage;
-            gltfImage.uri = textureFileName;
-
-            tinygltf::Texture gltfTexture;
-            gltfTexture.name = textureName;
-            gltfTexture.source = materialIdx;
-            gltfTexture.sampler = 0;
-
-            gltfModel.images.push_back(gltfImage);
-            gltfModel.textures.push_back(gltfTexture);
-
-            tinygltf::Material gltfMaterial;
-            gltfMaterial.name = textureName;
-            gltfMaterial.pbrMetallicRoughness.baseColorFactor = { 1.0, 1.0, 1.0, 1.0 };
-            gltfMaterial.pbrMetallicRoughness.baseColorTexture.index = materialIdx;
-            gltfMaterial.pbrMetallicRoughness.baseColorTexture.texCoord = 0;
-            gltfMaterial.pbrMetallicRoughness.metallicFactor = 0.0;
-            gltfMaterial.pbrMetallicRoughness.roughnessFactor = 1.0;
-            gltfMaterial.doubleSided = true;
-            gltfModel.materials.push_back(gltfMaterial);
-
-            materialsDict[gdTextureHash] = materialIdx;
-
-            materialIdx++;
+        GetOrCreateGLTFMaterial(gdTexture, materialsDict, gltfModel, textureExtension);
+    }
+}
+
+static inline size_t AlignGLTFSize(const size_t size) {
+    return (size + 3) & ~scast<size_t>(3);
+}
+
+static int AddGLTFAccessor(tinygltf::Model& gltfModel,
+                           const int bufferView,
+                           const size_t byteOffset,
+                           const int componentType,
+                           const int type,
+                           const size_t count) {
+    tinygltf::Accessor gltfAccessor;
+    gltfAccessor.bufferView = bufferView;
+    gltfAccessor.byteOffset = byteOffset;
+    gltfAccessor.componentType = componentType;
+    gltfAccessor.type = type;
+    gltfAccessor.count = count;
+
+    gltfModel.accessors.push_back(gltfAccessor);
+    return scast<int>(gltfModel.accessors.size() - 1);
+}
+
+// Binary data of the model export, all in buffer 0 and planned up front from the meshes metadata.
+//  Segments are produced only when written, straight into the file for .glb or into the single tinygltf buffer otherwise,
+//  so no more than one mesh worth of decoded vertices is alive at a time
+using MyGLTFBinSink = std::function<void(const void* data, const size_t size)>;
+
+struct MyGLTFBinLayout {
+    struct Segment {
+        size_t                                      size;
+        std::function<void(const MyGLTFBinSink&)>   produce;
+    };
+
+    MyArray<Segment>    segments;
+    size_t              totalSize = 0;
+
+    // returns the new buffer view index, every segment starts 4 bytes aligned
+    int AddView(tinygltf::Model& gltfModel,
+                const size_t size,
+                const size_t stride,
+                const int target,
+                std::function<void(const MyGLTFBinSink&)> produce) {
+        tinygltf::BufferView gltfView;
+        gltfView.buffer = 0;
+        gltfView.byteOffset = totalSize;
+        gltfView.byteLength = size;
+        gltfView.byteStride = stride;
+        gltfView.target = target;
+        gltfModel.bufferViews.push_back(gltfView);
+
+        segments.push_back({ size, std::move(produce) });
+        totalSize += AlignGLTFSize(size);
+
+        return scast<int>(gltfModel.bufferViews.size() - 1);
+    }
+
+    void Write(const MyGLTFBinSink& sink) const {
+        static const uint8_t kZeroes[4] = { 0, 0, 0, 0 };
+
+        for (const Segment& seg : segments) {
+            size_t written = 0;
+            seg.produce([&sink, &written](const void* data, const size_t size) {
+                sink(data, size);
+                written += size;
+            });
+            assert(written == seg.size);
+
+            const size_t padding = AlignGLTFSize(seg.size) - seg.size;
+            if (padding) {
+                sink(kZeroes, padding);
+            }
+        }
+    }
+};
+
+static AABBox CalcGeomDataBounds(const MetroModelGeomData& gd) {
+    AABBox result;
+    result.Reset();
+
+    const size_t numVertices = gd.mesh->verticesCount;
+    if (gd.mesh->vertexType == MetroVertexType::Skin) {
+        const VertexSkinned* verts = rcast<const VertexSkinned*>(gd.vertices);
+        for (size_t i = 0; i < numVertices; ++i) {
+            result.Absorb(DecodeSkinnedPosition(verts[i].pos) * gd.mesh->verticesScale);
+        }
+    } else if (gd.mesh->vertexType == MetroVertexType::Static) {
+        const VertexStatic* verts = rcast<const VertexStatic*>(gd.vertices);
+        for (size_t i = 0; i < numVertices; ++i) {
+            result.Absorb(verts[i].pos);
+        }
+    } else if (gd.mesh->vertexType == MetroVertexType::Soft) {
+        const VertexSoft* verts = rcast<const VertexSoft*>(gd.vertices);
+        for (size_t i = 0; i < numVertices; ++i) {
+            result.Absorb(verts[i].pos);
         }
     }
+
+    return result;
 }
 
-void CreateGLTFSkeleton(const RefPtr<MetroSkeleton>& skeleton, tinygltf::Scene& gltfScene, tinygltf::Model& gltfModel) {
-    tinygltf::Skin       gltfSkin;
-    tinygltf::Buffer     gltfInverseBindMatricesBuffer;
-    tinygltf::BufferView gltfInverseBindMatricesBufferView;
-    tinygltf::Accessor   gltfInverseBindMatricesAccessor;
+// GLB straight to the file, the JSON chunk is serialized by tinygltf from the buffer-less model and the BIN chunk
+//  is streamed from the layout
+static bool WriteGLBStreamed(tinygltf::Model& gltfModel, const MyGLTFBinLayout& binLayout, const fs::path& filePath) {
+    const uint32_t kGLBMagic = 0x46546C67;      // glTF
+    const uint32_t kGLBVersion = 2;
+    const uint32_t kGLBChunkJSON = 0x4E4F534A;  // JSON
+    const uint32_t kGLBChunkBIN = 0x004E4942;   // BIN
 
-    const size_t numBones = skeleton->GetNumBones();
+    std::stringstream jsonStream;
+    tinygltf::TinyGLTF gltf;
+    if (!gltf.WriteGltfSceneToStream(&gltfModel, jsonStream, false, false)) {
+        return false;
+    }
 
-    gltfInverseBindMatricesBuffer.data.resize(numBones * sizeof(mat4));
-    mat4* dstMatricesPtr = rcast<mat4*>(gltfInverseBindMatricesBuffer.data.data());
-    for (size_t i = 0; i < numBones; ++i) {
-        dstMatricesPtr[i] = skeleton->GetBoneFullTransformInv(i);
+    nlohmann::json jsonDoc = nlohmann::json::parse(jsonStream.str(), nullptr, false);
+    if (jsonDoc.is_discarded()) {
+        return false;
     }
 
-    gltfInverseBindMatricesBufferView.buffer = 0;
-    gltfInverseBindMatricesBufferView.byteOffset = 0;
-    gltfInverseBindMatricesBufferView.byteLength = gltfInverseBindMatricesBuffer.data.size();
+    // the only buffer is the BIN chunk, no uri
+    if (binLayout.totalSize) {
+        nlohmann::json jsonBuffer;
+        jsonBuffer["byteLength"] = binLayout.totalSize;
+        jsonDoc["buffers"] = nlohmann::json::array();
+        jsonDoc["buffers"].push_back(jsonBuffer);
+    }
+
+    CharString jsonString = jsonDoc.dump();
+    jsonString.resize(AlignGLTFSize(jsonString.size()), ' ');
 
-    gltfInverseBindMatricesAccessor.bufferView = 0;
-    gltfInverseBindMatricesAccessor.byteOffset = 0;
-    gltfInverseBindMatricesAccessor.componentType = TINYGLTF_COMPONENT_TYPE_FLOAT;
-    gltfInverseBindMatricesAccessor.type = TINYGLTF_TYPE_MAT4;
-    gltfInverseBindMatricesAccessor.count = numBones;
+    const size_t binChunkSize = binLayout.totalSize ? (8 + binLayout.totalSize) : 0;
+    const size_t totalSize = 12 + 8 + jsonString.size() + binChunkSize;
+    if (totalSize > std::numeric_limits<uint32_t>::max()) {
+        return false;
+    }
+
+    std::ofstream file(filePath, std::ofstream::binary);
+    if (!file.good()) {
+        return false;
+    }
 
-    gltfModel.buffers.push_back(gltfInverseBindMatricesBuffer);
-    gltfModel.bufferViews.push_back(gltfInverseBindMatricesBufferView);
-    gltfModel.accessors.push_back(gltfInverseBindMatricesAccessor);
+    auto writeU32 = [&file](const uint32_t v) {
+        file.write(rcast<const char*>(&v), sizeof(v));
+    };
+
+    writeU32(kGLBMagic);
+    writeU32(kGLBVersion);
+    writeU32(scast<uint32_t>(totalSize));
+
+    writeU32(scast<uint32_t>(jsonString.size()));
+    writeU32(kGLBChunkJSON);
+    file.write(jsonString.data(), jsonString.size());
+
+    if (binLayout.totalSize) {
+        writeU32(scast<uint32_t>(binLayout.totalSize));
+        writeU32(kGLBChunkBIN);
+        binLayout.Write([&file](const void* data, const size_t size) {
+            file.write(rcast<const char*>(data), size);
+        });
+    }
+
+    return file.good();
+}
+
+void CreateGLTFSkeleton(const RefPtr<MetroSkeleton>& skeleton, tinygltf::Scene& gltfScene, tinygltf::Model& gltfModel, MyGLTFBinLayout& binLayout) {
+    tinygltf::Skin gltfSkin;
+
+    const size_t numBones = skeleton->GetNumBones();
+    const int firstBoneNode = scast<int>(gltfModel.nodes.size());
+
+    const int inverseBindMatricesView = binLayout.AddView(gltfModel, numBones * sizeof(mat4), 0, 0, [skeleton, numBones](const MyGLTFBinSink& sink) {
+        MyArray<mat4> matrices(numBones);
+        for (size_t i = 0; i < numBones; ++i) {
+            matrices[i] = skeleton->GetBoneFullTransformInv(i);
+        }
+        sink(matrices.data(), matrices.size() * sizeof(mat4));
+    });
 
     gltfSkin.name = "skin_01";
-    gltfSkin.inverseBindMatrices = 0;
+    gltfSkin.inverseBindMatrices = AddGLTFAccessor(gltfModel, inverseBindMatricesView, 0, TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_MAT4, numBones);
 
     // create bones nodes
     for (size_t i = 0; i < numBones; ++i) {
@@ -157,22 +309,229 @@ void CreateGLTFSkeleton(const RefPtr<MetroSkeleton>& skeleton, tinygltf::Scene&
 
         gltfModel.nodes.push_back(gltfNode);
         if (skeleton->GetBoneParentIdx(i) == kInvalidValue) { // only root bones
-            gltfScene.nodes.push_back(scast<int>(i));
+            gltfScene.nodes.push_back(firstBoneNode + scast<int>(i));
         }
-        gltfSkin.joints.push_back(scast<int>(i));
+        gltfSkin.joints.push_back(firstBoneNode + scast<int>(i));
     }
 
     // now assign children
     for (size_t i = 0; i < numBones; ++i) {
         const size_t parentIdx = skeleton->GetBoneParentIdx(i);
         if (parentIdx != kInvalidValue) {
-            gltfModel.nodes[parentIdx].children.push_back(scast<int>(i));
+            gltfModel.nodes[firstBoneNode + parentIdx].children.push_back(firstBoneNode + scast<int>(i));
         }
     }
 
     gltfModel.skins.push_back(gltfSkin);
 }
 
+// Level export shares one buffer between all the meshes, every attribute (and instances data) gets its own
+//  tightly packed buffer view, primitives and instanced nodes are just accessors with offsets into those
+struct MyGLTFLevelBuffers {
+    enum View : int {
+        ViewPositions = 0,
+        ViewNormals,
+        ViewUV0,
+        ViewUV1,
+        ViewIndices,
+        ViewTranslations,
+        ViewRotations,
+        ViewScales,
+
+        NumViews
+    };
+
+    MyArray<vec3>       positions;
+    MyArray<vec3>       normals;
+    MyArray<vec2>       uv0;
+    MyArray<vec2>       uv1;
+    MyArray<uint16_t>   indices;
+    MyArray<vec3>       translations;
+    MyArray<vec4>       rotations;      // xyzw
+    MyArray<vec3>       scales;
+};
+
+struct MyGLTFLevelInstance {
+    vec3    pos;
+    quat    rot;
+    vec3    scale;
+};
+
+struct MyGLTFLevelMesh {
+    CharString                  name;
+    int                         meshIdx;
+    MyArray<MyGLTFLevelInstance> instances;
+};
+
+// level accessors get MyGLTFLevelBuffers::View as a bufferView, remapped to the real views once the buffer is built
+static int AddGLTFLevelAccessor(tinygltf::Model& gltfModel,
+                                const MyGLTFLevelBuffers::View view,
+                                const size_t byteOffset,
+                                const int componentType,
+                                const int type,
+                                const size_t count) {
+    return AddGLTFAccessor(gltfModel, scast<int>(view), byteOffset, componentType, type, count);
+}
+
+static tinygltf::Primitive AddGLTFLevelPrimitive(tinygltf::Model& gltfModel,
+                                                 MyGLTFLevelBuffers& buffers,
+                                                 const MetroVertex* vertices,
+                                                 const size_t numVertices,
+                                                 const uint16_t* indices,
+                                                 const size_t numIndices,
+                                                 const bool withUV1,
+                                                 const int materialIdx) {
+    const size_t firstVertex = buffers.positions.size();
+    const size_t firstIndex = buffers.indices.size();
+
+    AABBox bbox;
+    bbox.Reset();
+    for (size_t i = 0; i < numVertices; ++i) {
+        const MetroVertex& v = vertices[i];
+        buffers.positions.push_back(v.pos);
+        buffers.normals.push_back(vec3(v.normal));
+        buffers.uv0.push_back(v.uv0);
+        if (withUV1) {
+            buffers.uv1.push_back(v.uv1);
+        }
+        bbox.Absorb(v.pos);
+    }
+    buffers.indices.insert(buffers.indices.end(), indices, indices + numIndices);
+
+    tinygltf::Primitive gltfPrimitive;
+    gltfPrimitive.indices = AddGLTFLevelAccessor(gltfModel, MyGLTFLevelBuffers::ViewIndices, firstIndex * sizeof(uint16_t),
+                                                 TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT, TINYGLTF_TYPE_SCALAR, numIndices);
+
+    const int posAccessorIdx = AddGLTFLevelAccessor(gltfModel, MyGLTFLevelBuffers::ViewPositions, firstVertex * sizeof(vec3),
+                                                    TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC3, numVertices);
+    // min/max are mandatory for positions
+    gltfModel.accessors[posAccessorIdx].minValues = { bbox.minimum.x, bbox.minimum.y, bbox.minimum.z };
+    gltfModel.accessors[posAccessorIdx].maxValues = { bbox.maximum.x, bbox.maximum.y, bbox.maximum.z };
+
+    gltfPrimitive.attributes["POSITION"] = posAccessorIdx;
+    gltfPrimitive.attributes["NORMAL"] = AddGLTFLevelAccessor(gltfModel, MyGLTFLevelBuffers::ViewNormals, firstVertex * sizeof(vec3),
+                                                              TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC3, numVertices);
+    gltfPrimitive.attributes["TEXCOORD_0"] = AddGLTFLevelAccessor(gltfModel, MyGLTFLevelBuffers::ViewUV0, firstVertex * sizeof(vec2),
+                                                                  TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC2, numVertices);
+    if (withUV1) {
+        const size_t firstVertexUV1 = buffers.uv1.size() - numVertices;
+        gltfPrimitive.attributes["TEXCOORD_1"] = AddGLTFLevelAccessor(gltfModel, MyGLTFLevelBuffers::ViewUV1, firstVertexUV1 * sizeof(vec2),
+                                                                      TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC2, numVertices);
+    }
+    gltfPrimitive.material = materialIdx;
+    gltfPrimitive.mode = TINYGLTF_MODE_TRIANGLES;
+
+    return gltfPrimitive;
+}
+
+// super static meshes are hierarchies referencing other meshes of the sector by index
+static void CollectSuperStaticLeaves(const LevelSector& sector, const size_t meshIdx, MyArray<bool>& visited, MyArray<size_t>& leaves) {
+    if (meshIdx >= sector.superStaticMeshes.size() || visited[meshIdx]) {
+        return;
+    }
+    visited[meshIdx] = true;
+
+    const RefPtr<MetroModelBase>& ssm = sector.superStaticMeshes[meshIdx];
+    if (ssm->IsHierarchy()) {
+        RefPtr<MetroModelHierarchy> hierarchy = SCastRefPtr<MetroModelHierarchy>(ssm);
+        const size_t numChildren = hierarchy->GetChildrenRefsCount();
+        for (size_t i = 0; i < numChildren; ++i) {
+            CollectSuperStaticLeaves(sector, hierarchy->GetChildRef(i), visited, leaves);
+        }
+    } else if (ssm->MeshValid() && !ssm->IsCollisionModel()) {
+        leaves.push_back(meshIdx);
+    }
+}
+
+// puts all the instances into the buffer, nodes get the real accessor indices after the remap
+static void AddGLTFLevelInstances(tinygltf::Model& gltfModel,
+                                  MyGLTFLevelBuffers& buffers,
+                                  const MyGLTFLevelMesh& levelMesh,
+                                  tinygltf::Node& gltfNode) {
+    const size_t firstInstance = buffers.translations.size();
+    const size_t numInstances = levelMesh.instances.size();
+
+    for (const MyGLTFLevelInstance& inst : levelMesh.instances) {
+        const quat rot = Normalize(inst.rot);
+        buffers.translations.push_back(inst.pos);
+        buffers.rotations.push_back(vec4(rot.x, rot.y, rot.z, rot.w));
+        buffers.scales.push_back(inst.scale);
+    }
+
+    const int translationIdx = AddGLTFLevelAccessor(gltfModel, MyGLTFLevelBuffers::ViewTranslations, firstInstance * sizeof(vec3),
+                                                    TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC3, numInstances);
+    const int rotationIdx = AddGLTFLevelAccessor(gltfModel, MyGLTFLevelBuffers::ViewRotations, firstInstance * sizeof(vec4),
+                                                 TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC4, numInstances);
+    const int scaleIdx = AddGLTFLevelAccessor(gltfModel, MyGLTFLevelBuffers::ViewScales, firstInstance * sizeof(vec3),
+                                              TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC3, numInstances);
+
+    tinygltf::Value::Object attributes;
+    attributes["TRANSLATION"] = tinygltf::Value(translationIdx);
+    attributes["ROTATION"] = tinygltf::Value(rotationIdx);
+    attributes["SCALE"] = tinygltf::Value(scaleIdx);
+
+    tinygltf::Value::Object instancing;
+    instancing["attributes"] = tinygltf::Value(attributes);
+
+    gltfNode.extensions["EXT_mesh_gpu_instancing"] = tinygltf::Value(instancing);
+}
+
+// lays out all the non-empty views one after another (4 bytes aligned) in a single buffer and fixes the accessors
+static void BuildGLTFLevelBuffer(tinygltf::Model& gltfModel, const MyGLTFLevelBuffers& buffers, MyGLTFBinLayout& binLayout) {
+    struct ViewData {
+        const void* data;
+        size_t      size;
+        size_t      stride;
+        int         target;
+    };
+
+    const ViewData views[MyGLTFLevelBuffers::NumViews] = {
+        { buffers.positions.data(),     buffers.positions.size() * sizeof(vec3),    sizeof(vec3),   TINYGLTF_TARGET_ARRAY_BUFFER },
+        { buffers.normals.data(),       buffers.normals.size() * sizeof(vec3),      sizeof(vec3),   TINYGLTF_TARGET_ARRAY_BUFFER },
+        { buffers.uv0.data(),           buffers.uv0.size() * sizeof(vec2),          sizeof(vec2),   TINYGLTF_TARGET_ARRAY_BUFFER },
+        { buffers.uv1.data(),           buffers.uv1.size() * sizeof(vec2),          sizeof(vec2),   TINYGLTF_TARGET_ARRAY_BUFFER },
+        { buffers.indices.data(),       buffers.indices.size() * sizeof(uint16_t),  0,              TINYGLTF_TARGET_ELEMENT_ARRAY_BUFFER },
+        // instances data is not vertex data, so no target and no stride
+        { buffers.translations.data(),  buffers.translations.size() * sizeof(vec3), 0,              0 },
+        { buffers.rotations.data(),     buffers.rotations.size() * sizeof(vec4),    0,              0 },
+        { buffers.scales.data(),        buffers.scales.size() * sizeof(vec3),       0,              0 }
+    };
+
+    int viewsRemap[MyGLTFLevelBuffers::NumViews];
+    for (size_t i = 0; i < MyGLTFLevelBuffers::NumViews; ++i) {
+        const ViewData& vd = views[i];
+        if (!vd.size) {
+            viewsRemap[i] = -1;
+        } else {
+            viewsRemap[i] = binLayout.AddView(gltfModel, vd.size, vd.stride, vd.target, [vd](const MyGLTFBinSink& sink) {
+                sink(vd.data, vd.size);
+            });
+        }
+    }
+
+    for (tinygltf::Accessor& accessor : gltfModel.accessors) {
+        accessor.bufferView = viewsRemap[accessor.bufferView];
+    }
+}
+
+// .glb gets streamed, otherwise the layout is copied into the single buffer and tinygltf writes it
+static bool WriteGLTFFile(tinygltf::Model& gltfModel, const MyGLTFBinLayout& binLayout, const fs::path& filePath, const bool embedBuffers) {
+    if (StrEndsWith(filePath.extension().string(), ".glb")) {
+        return WriteGLBStreamed(gltfModel, binLayout, filePath);
+    } else {
+        tinygltf::Buffer gltfBuffer;
+        gltfBuffer.data.resize(binLayout.totalSize);
+        uint8_t* dstPtr = gltfBuffer.data.data();
+        binLayout.Write([&dstPtr](const void* data, const size_t size) {
+            memcpy(dstPtr, data, size);
+            dstPtr += size;
+        });
+        gltfModel.buffers.push_back(std::move(gltfBuffer));
+
+        tinygltf::TinyGLTF gltf;
+        return gltf.WriteGltfSceneToFile(&gltfModel, filePath.u8string(), false, embedBuffers, true, false);
+    }
+}
 
 ExporterGLTF::ExporterGLTF()
     : mExcludeCollision(false)
@@ -218,6 +577,7 @@ bool ExporterGLTF::ExportModel(const MetroModelBase& model, const fs::path& file
 
     tinygltf::Model gltfModel;
     tinygltf::Scene gltfScene;
+    MyGLTFBinLayout binLayout;
 
     // common samnpler
     tinygltf::Sampler gltfSampler;
@@ -237,97 +597,45 @@ bool ExporterGLTF::ExportModel(const MetroModelBase& model, const fs::path& file
     MyGLTFMaterialsDict materialsDict;
     CreateGLTFMaterials(gds, materialsDict, gltfModel, mTexturesExtension);
 
-    int bufViewAccessAddition = 0;
     if (skeleton) {
-        CreateGLTFSkeleton(skeleton, gltfScene, gltfModel);
-        // we've added buffer + view + accessor for inverseBindMatrices, so have to offset everything below
-        bufViewAccessAddition = 1;
+        CreateGLTFSkeleton(skeleton, gltfScene, gltfModel, binLayout);
     }
 
     int gltfMeshIdx = 0;
-    for (auto& gd : gds) {
-        MyArray<MetroVertex> vertices = MakeCommonVertices(gd);
+    for (const MetroModelGeomData& gd : gds) {
+        const size_t numVertices = gd.mesh->verticesCount;
+        const size_t numIndices = scast<size_t>(gd.mesh->facesCount) * 3;
 
         auto materialIt = materialsDict.find(HashString(gd.model->GetMaterialString(MetroModelBase::kMaterialStringTexture)));
         const int materialIdx = (materialIt == materialsDict.end()) ? 0 : materialIt->second;
 
-        tinygltf::Buffer gltfIB;
-        gltfIB.data.resize(scast<size_t>(gd.mesh->facesCount) * 3 * sizeof(uint16_t));
-        memcpy(gltfIB.data.data(), gd.faces, gltfIB.data.size());
-
-        tinygltf::Buffer gltfVB;
-        gltfVB.data.resize(vertices.size() * sizeof(MetroVertex));
-        memcpy(gltfVB.data.data(), vertices.data(), gltfVB.data.size());
-
-        tinygltf::BufferView gltfIBView;
-        gltfIBView.buffer = gltfMeshIdx * 2 + bufViewAccessAddition;
-        gltfIBView.byteOffset = 0;
-        gltfIBView.byteLength = gltfIB.data.size();
-        gltfIBView.byteStride = 0;
-        gltfIBView.target = TINYGLTF_TARGET_ELEMENT_ARRAY_BUFFER;
-
-        tinygltf::BufferView gltfVBView;
-        gltfVBView.buffer = gltfMeshIdx * 2 + 1 + bufViewAccessAddition;
-        gltfVBView.byteOffset = 0;
-        gltfVBView.byteLength = gltfVB.data.size();
-        gltfVBView.byteStride = sizeof(MetroVertex);
-        gltfVBView.target = TINYGLTF_TARGET_ARRAY_BUFFER;
-
-        tinygltf::Accessor gltfIBAccessor;
-        gltfIBAccessor.bufferView = gltfMeshIdx * 2 + bufViewAccessAddition;
-        gltfIBAccessor.byteOffset = 0;
-        gltfIBAccessor.componentType = TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT;
-        gltfIBAccessor.type = TINYGLTF_TYPE_SCALAR;
-        gltfIBAccessor.count = scast<size_t>(gd.mesh->facesCount) * 3;
-
-        tinygltf::Accessor gltfVBAccessorPos;
-        gltfVBAccessorPos.bufferView = gltfMeshIdx * 2 + 1 + bufViewAccessAddition;
-        gltfVBAccessorPos.byteOffset = 0;
-        gltfVBAccessorPos.componentType = TINYGLTF_COMPONENT_TYPE_FLOAT;
-        gltfVBAccessorPos.type = TINYGLTF_TYPE_VEC3;
-        gltfVBAccessorPos.count = vertices.size();
-
-        tinygltf::Accessor gltfVBAccessorNormal;
-        gltfVBAccessorNormal.bufferView = gltfMeshIdx * 2 + 1 + bufViewAccessAddition;
-        gltfVBAccessorNormal.byteOffset = offsetof(MetroVertex, normal);
-        gltfVBAccessorNormal.componentType = TINYGLTF_COMPONENT_TYPE_FLOAT;
-        gltfVBAccessorNormal.type = TINYGLTF_TYPE_VEC3;
-        gltfVBAccessorNormal.count = vertices.size();
-
-        tinygltf::Accessor gltfVBAccessorUV;
-        gltfVBAccessorUV.bufferView = gltfMeshIdx * 2 + 1 + bufViewAccessAddition;
-        gltfVBAccessorUV.byteOffset = offsetof(MetroVertex, uv0);
-        gltfVBAccessorUV.componentType = TINYGLTF_COMPONENT_TYPE_FLOAT;
-        gltfVBAccessorUV.type = TINYGLTF_TYPE_VEC2;
-        gltfVBAccessorUV.count = vertices.size();
-
-        tinygltf::Accessor gltfVBAccessorBones;
-        tinygltf::Accessor gltfVBAccessorWeights;
-        if (skeleton) {
-            gltfVBAccessorBones.bufferView = gltfMeshIdx * 2 + 1 + bufViewAccessAddition;
-            gltfVBAccessorBones.byteOffset = offsetof(MetroVertex, bones);
-            gltfVBAccessorBones.componentType = TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE;
-            gltfVBAccessorBones.type = TINYGLTF_TYPE_VEC4;
-            gltfVBAccessorBones.count = vertices.size();
-
-            gltfVBAccessorWeights.bufferView = gltfMeshIdx * 2 + 1 + bufViewAccessAddition;
-            gltfVBAccessorWeights.byteOffset = offsetof(MetroVertex, weights);
-            gltfVBAccessorWeights.componentType = TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE;
-            gltfVBAccessorWeights.normalized = true;
-            gltfVBAccessorWeights.type = TINYGLTF_TYPE_VEC4;
-            gltfVBAccessorWeights.count = vertices.size();
-        }
-
-        const int numAccessors = (skeleton != nullptr) ? 6 : 4;
+        // indices go as is from the model, vertices are decoded only when written
+        const int ibView = binLayout.AddView(gltfModel, numIndices * sizeof(uint16_t), 0, TINYGLTF_TARGET_ELEMENT_ARRAY_BUFFER, [gd, numIndices](const MyGLTFBinSink& sink) {
+            sink(gd.faces, numIndices * sizeof(uint16_t));
+        });
+        const int vbView = binLayout.AddView(gltfModel, numVertices * sizeof(MetroVertex), sizeof(MetroVertex), TINYGLTF_TARGET_ARRAY_BUFFER, [gd](const MyGLTFBinSink& sink) {
+            MyArray<MetroVertex> vertices = MakeCommonVertices(gd);
+            sink(vertices.data(), vertices.size() * sizeof(MetroVertex));
+        });
 
         tinygltf::Primitive gltfPrimitive;
-        gltfPrimitive.indices = gltfMeshIdx * numAccessors + bufViewAccessAddition;                         // The index of the accessor for the vertex indices
-        gltfPrimitive.attributes["POSITION"] = gltfMeshIdx * numAccessors + 1 + bufViewAccessAddition;      // The index of the accessor for positions
-        gltfPrimitive.attributes["NORMAL"] = gltfMeshIdx * numAccessors + 2 + bufViewAccessAddition;        // The index of the accessor for normals
-        gltfPrimitive.attributes["TEXCOORD_0"] = gltfMeshIdx * numAccessors + 3 + bufViewAccessAddition;    // The index of the accessor for texcoords
+        gltfPrimitive.indices = AddGLTFAccessor(gltfModel, ibView, 0, TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT, TINYGLTF_TYPE_SCALAR, numIndices);
+
+        const int posAccessorIdx = AddGLTFAccessor(gltfModel, vbView, 0, TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC3, numVertices);
+        // min/max are mandatory for positions
+        const AABBox bbox = CalcGeomDataBounds(gd);
+        gltfModel.accessors[posAccessorIdx].minValues = { bbox.minimum.x, bbox.minimum.y, bbox.minimum.z };
+        gltfModel.accessors[posAccessorIdx].maxValues = { bbox.maximum.x, bbox.maximum.y, bbox.maximum.z };
+
+        gltfPrimitive.attributes["POSITION"] = posAccessorIdx;
+        gltfPrimitive.attributes["NORMAL"] = AddGLTFAccessor(gltfModel, vbView, offsetof(MetroVertex, normal), TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC3, numVertices);
+        gltfPrimitive.attributes["TEXCOORD_0"] = AddGLTFAccessor(gltfModel, vbView, offsetof(MetroVertex, uv0), TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC2, numVertices);
         if (skeleton) {
-            gltfPrimitive.attributes["JOINTS_0"] = gltfMeshIdx * numAccessors + 4 + bufViewAccessAddition;  // The index of the accessor for bones ids
-            gltfPrimitive.attributes["WEIGHTS_0"] = gltfMeshIdx * numAccessors + 5 + bufViewAccessAddition; // The index of the accessor for bones weights
+            gltfPrimitive.attributes["JOINTS_0"] = AddGLTFAccessor(gltfModel, vbView, offsetof(MetroVertex, bones), TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE, TINYGLTF_TYPE_VEC4, numVertices);
+
+            const int weightsAccessorIdx = AddGLTFAccessor(gltfModel, vbView, offsetof(MetroVertex, weights), TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE, TINYGLTF_TYPE_VEC4, numVertices);
+            gltfModel.accessors[weightsAccessorIdx].normalized = true;
+            gltfPrimitive.attributes["WEIGHTS_0"] = weightsAccessorIdx;
         }
         gltfPrimitive.material = materialIdx;
         gltfPrimitive.mode = TINYGLTF_MODE_TRIANGLES;
@@ -341,22 +649,10 @@ bool ExporterGLTF::ExportModel(const MetroModelBase& model, const fs::path& file
         if (skeleton) {
             gltfNode.skin = 0;
         }
-        gltfScene.nodes.push_back(gltfMeshIdx);
+        gltfScene.nodes.push_back(scast<int>(gltfModel.nodes.size()));
 
         gltfModel.meshes.push_back(gltfMesh);
         gltfModel.nodes.push_back(gltfNode);
-        gltfModel.buffers.push_back(gltfIB);
-        gltfModel.buffers.push_back(gltfVB);
-        gltfModel.bufferViews.push_back(gltfIBView);
-        gltfModel.bufferViews.push_back(gltfVBView);
-        gltfModel.accessors.push_back(gltfIBAccessor);
-        gltfModel.accessors.push_back(gltfVBAccessorPos);
-        gltfModel.accessors.push_back(gltfVBAccessorNormal);
-        gltfModel.accessors.push_back(gltfVBAccessorUV);
-        if (skeleton) {
-            gltfModel.accessors.push_back(gltfVBAccessorBones);
-            gltfModel.accessors.push_back(gltfVBAccessorWeights);
-        }
 
         gltfMeshIdx++;
     }
@@ -365,8 +661,7 @@ bool ExporterGLTF::ExportModel(const MetroModelBase& model, const fs::path& file
     gltfModel.asset.version = "2.0";
     gltfModel.asset.generator = mExporterName;
 
-    tinygltf::TinyGLTF gltf;
-    const bool result = gltf.WriteGltfSceneToFile(&gltfModel, filePath.u8string(), false, true, true, false);
+    const bool result = WriteGLTFFile(gltfModel, binLayout, filePath, true);
 
     if (result) {
         mUsedTextures.clear();
@@ -379,7 +674,204 @@ bool ExporterGLTF::ExportModel(const MetroModelBase& model, const fs::path& file
 }
 
 bool ExporterGLTF::ExportLevel(const MetroLevel& level, const fs::path& filePath) {
-    return false;
+    tinygltf::Model gltfModel;
+    tinygltf::Scene gltfScene;
+
+    // common samnpler
+    tinygltf::Sampler gltfSampler;
+    gltfSampler.name = "trilinear";
+    gltfSampler.magFilter = TINYGLTF_TEXTURE_FILTER_LINEAR;
+    gltfSampler.minFilter = TINYGLTF_TEXTURE_FILTER_LINEAR_MIPMAP_LINEAR;
+    gltfSampler.wrapS = TINYGLTF_TEXTURE_WRAP_REPEAT;
+    gltfSampler.wrapT = TINYGLTF_TEXTURE_WRAP_REPEAT;
+    gltfModel.samplers.push_back(gltfSampler);
+
+    mTexturesFolder = filePath.parent_path();
+
+    MyGLTFMaterialsDict materialsDict;
+    MyGLTFLevelBuffers buffers;
+    MyArray<MyGLTFLevelMesh> levelMeshes;
+
+    // level geo, every sector is a single mesh with all of its unique super static meshes as primitives.
+    //  Super static geometry is already in world space (instances only reference the meshes), so no transforms here
+    const size_t numSectors = level.GetNumSectors();
+    for (size_t i = 0; i < numSectors; ++i) {
+        const LevelSector& sector = level.GetSector(i);
+
+        MyArray<bool> visited(sector.superStaticMeshes.size(), false);
+        MyArray<size_t> leaves;
+        for (const uint32_t instanceIdx : sector.superStaticInstances) {
+            CollectSuperStaticLeaves(sector, instanceIdx, visited, leaves);
+        }
+
+        if (leaves.empty()) {
+            continue;
+        }
+
+        tinygltf::Mesh gltfMesh;
+        gltfMesh.name = sector.name.empty() ? (CharString("sector_") + std::to_string(i)) : sector.name;
+
+        MyArray<MetroVertex> vertices;
+        for (const size_t leafIdx : leaves) {
+            const MetroModelMesh* mesh = sector.superStaticMeshes[leafIdx]->GetMesh().get();
+            if (!mesh->verticesCount || !mesh->facesCount ||
+                scast<size_t>(mesh->verticesOffset) + mesh->verticesCount > sector.vertices.size() ||
+                scast<size_t>(mesh->indicesOffset) + mesh->facesCount * 3 > sector.indices.size()) {
+                continue;
+            }
+
+            vertices.resize(mesh->verticesCount);
+            VTX_ConvertVertices(sector.vertices.data() + mesh->verticesOffset, mesh->verticesCount, vertices.data());
+
+            int materialIdx = -1;
+            if (mesh->materialId < level.GetNumMaterials()) {
+                const CharString& texture = level.GetMaterial(mesh->materialId).texture;
+                if (!texture.empty()) {
+                    materialIdx = GetOrCreateGLTFMaterial(texture, materialsDict, gltfModel, mTexturesExtension);
+                }
+            }
+
+            gltfMesh.primitives.push_back(AddGLTFLevelPrimitive(gltfModel,
+                                                                buffers,
+                                                                vertices.data(),
+                                                                vertices.size(),
+                                                                sector.indices.data() + mesh->indicesOffset,
+                                                                scast<size_t>(mesh->facesCount) * 3,
+                                                                true,
+                                                                materialIdx));
+        }
+
+        if (!gltfMesh.primitives.empty()) {
+            levelMeshes.push_back({ gltfMesh.name, scast<int>(gltfModel.meshes.size()), { { vec3(0.0f), quat(1.0f, 0.0f, 0.0f, 0.0f), vec3(1.0f) } } });
+            gltfModel.meshes.push_back(gltfMesh);
+        }
+    }
+
+    // entities, every visual is written once and gets all of its placements as instances
+    MyDict<HashString, size_t> visualsCache;    // visual -> levelMeshes index, kInvalidValue if failed to load
+
+    const size_t numEntities = level.GetNumEntities();
+    for (size_t i = 0; i < numEntities; ++i) {
+        const CharString& visual = level.GetEntityVisual(i);
+        if (visual.empty()) {
+            continue;
+        }
+
+        HashString hashName = visual;
+        auto it = visualsCache.find(hashName);
+        if (it == visualsCache.end()) {
+            size_t levelMeshIdx = kInvalidValue;
+
+            const uint32_t loadFlags = MetroModelLoadParams::LoadGeometry | MetroModelLoadParams::LoadTPresets;
+            RefPtr<MetroModelBase> mdl = MetroModelFactory::GetSharedModelFromFullName(visual, loadFlags);
+            if (mdl) {
+                MyArray<MetroModelGeomData> gds;
+                mdl->CollectGeomData(gds);
+
+                //#NOTE_SK: skinned models go in their bind pose, no skins in the level export
+                tinygltf::Mesh gltfMesh;
+                gltfMesh.name = visual;
+                for (const MetroModelGeomData& gd : gds) {
+                    if (!gd.vertices || !gd.faces || !gd.mesh->verticesCount || !gd.mesh->facesCount) {
+                        continue;
+                    }
+
+                    MyArray<MetroVertex> vertices = MakeCommonVertices(gd);
+
+                    const CharString& texture = gd.model->GetMaterialString(MetroModelBase::kMaterialStringTexture);
+                    const int materialIdx = GetOrCreateGLTFMaterial(texture, materialsDict, gltfModel, mTexturesExtension);
+
+                    gltfMesh.primitives.push_back(AddGLTFLevelPrimitive(gltfModel,
+                                                                        buffers,
+                                                                        vertices.data(),
+                                                                        vertices.size(),
+                                                                        rcast<const uint16_t*>(gd.faces),
+                                                                        scast<size_t>(gd.mesh->facesCount) * 3,
+                                                                        false,
+                                                                        materialIdx));
+                }
+
+                if (!gltfMesh.primitives.empty()) {
+                    levelMeshIdx = levelMeshes.size();
+                    levelMeshes.push_back({ visual, scast<int>(gltfModel.meshes.size()), {} });
+                    gltfModel.meshes.push_back(gltfMesh);
+                }
+            }
+
+            it = visualsCache.insert({ hashName, levelMeshIdx }).first;
+        }
+
+        if (it->second != kInvalidValue) {
+            MyGLTFLevelMesh& levelMesh = levelMeshes[it->second];
+
+            MyGLTFLevelInstance instance;
+            mat4 pose = MatFromPose(level.GetEntityTransform(i));
+            MatDecomposeSimple(pose, instance.pos, instance.scale, instance.rot);
+            levelMesh.instances.push_back(instance);
+
+            // single placement keeps the entity name on its node
+            if (levelMesh.instances.size() == 1) {
+                levelMesh.name = level.GetEntityName(i);
+            } else {
+                levelMesh.name = visual;
+            }
+        }
+    }
+
+    if (levelMeshes.empty()) {
+        return false;
+    }
+
+    // nodes, meshes placed more than once get a single node with EXT_mesh_gpu_instancing
+    bool hasInstancing = false;
+    for (const MyGLTFLevelMesh& levelMesh : levelMeshes) {
+        if (levelMesh.instances.empty()) {
+            continue;
+        }
+
+        tinygltf::Node gltfNode;
+        gltfNode.name = levelMesh.name;
+        gltfNode.mesh = levelMesh.meshIdx;
+
+        if (levelMesh.instances.size() == 1) {
+            const MyGLTFLevelInstance& inst = levelMesh.instances.front();
+            const quat rot = Normalize(inst.rot);
+            gltfNode.translation = { inst.pos.x, inst.pos.y, inst.pos.z };
+            gltfNode.rotation = { rot.x, rot.y, rot.z, rot.w };
+            gltfNode.scale = { inst.scale.x, inst.scale.y, inst.scale.z };
+        } else {
+            AddGLTFLevelInstances(gltfModel, buffers, levelMesh, gltfNode);
+            hasInstancing = true;
+        }
+
+        gltfScene.nodes.push_back(scast<int>(gltfModel.nodes.size()));
+        gltfModel.nodes.push_back(gltfNode);
+    }
+
+    MyGLTFBinLayout binLayout;
+    BuildGLTFLevelBuffer(gltfModel, buffers, binLayout);
+
+    if (hasInstancing) {
+        // without the extension instanced meshes would end up in a single spot, so it's required
+        gltfModel.extensionsUsed.push_back("EXT_mesh_gpu_instancing");
+        gltfModel.extensionsRequired.push_back("EXT_mesh_gpu_instancing");
+    }
+
+    gltfModel.scenes.push_back(gltfScene);
+    gltfModel.asset.version = "2.0";
+    gltfModel.asset.generator = mExporterName;
+
+    // levels are way too big for base64, so it's either a .glb or a .gltf with a side .bin
+    const bool result = WriteGLTFFile(gltfModel, binLayout, filePath, false);
+
+    if (result) {
+        mUsedTextures.clear();
+        for (auto& it : materialsDict) {
+            mUsedTextures.push_back(it.first.str);
+        }
+    }
+
+    return result;
 }
 
 const StringArray& ExporterGLTF::GetUsedTextures() const {
@@ -1,7 +1,9 @@
 #include "ExporterOBJ.h"
 #include "metro/MetroModel.h"
 #include "metro/MetroContext.h"
+#include "metro/MetroVertexCodec.h"
 
+#include <charconv>
 #include <fstream>
 #include <sstream>
 
@@ -33,31 +35,125 @@ static MyArray<MetroVertex> MakeCommonVertices(const MetroModelGeomData& gd) {
         const VertexSkinned* srcVerts = rcast<const VertexSkinned*>(gd.vertices);
 
         result.resize(gd.mesh->verticesCount);
-        MetroVertex* dstVerts = result.data();
-
-        for (size_t i = 0; i < gd.mesh->verticesCount; ++i) {
-            *dstVerts = ConvertVertex(*srcVerts);
-            dstVerts->pos *= gd.mesh->verticesScale;
-            ++srcVerts;
-            ++dstVerts;
-        }
+        VTX_ConvertVertices(srcVerts, gd.mesh->verticesCount, gd.mesh->verticesScale, result.data());
     } else {
         const VertexStatic* srcVerts = rcast<const VertexStatic*>(gd.vertices);
 
         result.resize(gd.mesh->verticesCount);
-        MetroVertex* dstVerts = result.data();
+        VTX_ConvertVertices(srcVerts, gd.mesh->verticesCount, result.data());
 
-        for (size_t i = 0; i < gd.mesh->verticesCount; ++i) {
-            *dstVerts = ConvertVertex(*srcVerts);
-            dstVerts->pos *= gd.mesh->verticesScale;
-            ++srcVerts;
-            ++dstVerts;
+        for (MetroVertex& v : result) {
+            v.pos *= gd.mesh->verticesScale;
         }
     }
 
     return std::move(result);
 }
 
+// Appends obj text to a string, numbers go through std::to_chars (locale-independent, shortest round-trip floats)
+class ObjTextWriter {
+public:
+    explicit ObjTextWriter(CharString& dst)
+        : mDst(dst) {
+    }
+
+    inline void Reserve(const size_t numBytes) {
+        mDst.reserve(mDst.size() + numBytes);
+    }
+
+    inline ObjTextWriter& Append(const char c) {
+        mDst.push_back(c);
+        return *this;
+    }
+
+    inline ObjTextWriter& Append(const StringView& str) {
+        mDst.append(str.data(), str.size());
+        return *this;
+    }
+
+    inline ObjTextWriter& Append(const size_t v) {
+        char buffer[24];
+        const std::to_chars_result r = std::to_chars(buffer, buffer + sizeof(buffer), v);
+        mDst.append(buffer, r.ptr);
+        return *this;
+    }
+
+    inline ObjTextWriter& Append(const float v) {
+        char buffer[32];
+        const std::to_chars_result r = std::to_chars(buffer, buffer + sizeof(buffer), v);
+        mDst.append(buffer, r.ptr);
+        return *this;
+    }
+
+    inline ObjTextWriter& AppendVec(const StringView& tag, const float x, const float y) {
+        return this->Append(tag).Append(x).Append(' ').Append(y).Append('\n');
+    }
+
+    inline ObjTextWriter& AppendVec(const StringView& tag, const float x, const float y, const float z) {
+        return this->Append(tag).Append(x).Append(' ').Append(y).Append(' ').Append(z).Append('\n');
+    }
+
+    inline ObjTextWriter& AppendFaceVertex(const size_t idx) {
+        return this->Append(' ').Append(idx).Append('/').Append(idx).Append('/').Append(idx);
+    }
+
+private:
+    CharString& mDst;
+};
+
+static void WriteObjMesh(ObjTextWriter& writer, const MetroModelGeomData& gd, const size_t meshIdx, const size_t firstVertex) {
+    // rough upper bound, saves most of the reallocations
+    constexpr size_t kBytesPerVertex = 128;
+    constexpr size_t kBytesPerFace = 64;
+
+    const MyArray<MetroVertex> vertices = MakeCommonVertices(gd);
+    writer.Reserve(vertices.size() * kBytesPerVertex + gd.mesh->facesCount * kBytesPerFace);
+
+    for (const MetroVertex& v : vertices) {
+        writer.AppendVec("v ", v.pos.x, v.pos.y, v.pos.z);
+    }
+    writer.Append("# ").Append(vertices.size()).Append(" vertices\n\n");
+
+    for (const MetroVertex& v : vertices) {
+        writer.AppendVec("vt ", v.uv0.x, 1.0f - v.uv0.y);
+    }
+    writer.Append("# ").Append(vertices.size()).Append(" texcoords\n\n");
+
+    for (const MetroVertex& v : vertices) {
+        writer.AppendVec("vn ", v.normal.x, v.normal.y, v.normal.z);
+    }
+    writer.Append("# ").Append(vertices.size()).Append(" normals\n\n");
+
+    writer.Append("g Mesh_").Append(meshIdx).Append('\n');
+    writer.Append("usemtl Material_").Append(meshIdx).Append('\n');
+
+    const MetroFace* faces = scast<const MetroFace*>(gd.faces);
+    for (size_t i = 0; i < gd.mesh->facesCount; ++i) {
+        writer.Append('f');
+        writer.AppendFaceVertex(faces[i].a + firstVertex + 1);
+        writer.AppendFaceVertex(faces[i].b + firstVertex + 1);
+        writer.AppendFaceVertex(faces[i].c + firstVertex + 1);
+        writer.Append('\n');
+    }
+    writer.Append("# ").Append(scast<size_t>(gd.mesh->facesCount)).Append(" faces\n\n");
+}
+
+void ExporterOBJ::FormatMeshes(const MyArray<MetroModelGeomData>& gds, MyArray<CharString>& chunks, const size_t numThreads) {
+    // obj indices are global, so every mesh needs to know where its vertices start
+    MyArray<size_t> firstVertices(gds.size());
+    for (size_t i = 0, lastIdx = 0; i < gds.size(); ++i) {
+        firstVertices[i] = lastIdx;
+        lastIdx += gds[i].mesh->verticesCount;
+    }
+
+    chunks.clear();
+    chunks.resize(gds.size());
+    ParallelFor(gds.size(), [&gds, &firstVertices, &chunks](const size_t idx, const size_t) {
+        ObjTextWriter writer(chunks[idx]);
+        WriteObjMesh(writer, gds[idx], idx, firstVertices[idx]);
+    }, numThreads);
+}
+
 bool ExporterOBJ::ExportModel(const MetroModelBase& model, const fs::path& filePath) const {
     bool result = false;
 
@@ -68,53 +164,21 @@ bool ExporterOBJ::ExportModel(const MetroModelBase& model, const fs::path& fileP
         matName[matName.size() - 2] = 't';
         matName[matName.size() - 1] = 'l';
 
-        std::ostringstream stringBuilder;
-        stringBuilder << "# Generated from Metro model file" << std::endl;
-        stringBuilder << CharString("# using ").append(mExporterName).append(" tool made by iOrange") << std::endl << std::endl;
-        stringBuilder << "mtllib " << matName << std::endl << std::endl;
+        CharString header;
+        header.append("# Generated from Metro model file\n");
+        header.append("# using ").append(mExporterName).append(" tool made by iOrange\n\n");
+        header.append("mtllib ").append(matName).append("\n\n");
 
         MyArray<MetroModelGeomData> gds;
         model.CollectGeomData(gds);
-        size_t lastIdx = 0, meshIdx = 0;
-        for (const auto& gd : gds) {
-            MyArray<MetroVertex> vertices = MakeCommonVertices(gd);
-
-            for (const MetroVertex& v : vertices) {
-                stringBuilder << "v " << v.pos.x << ' ' << v.pos.y << ' ' << v.pos.z << std::endl;
-            }
-            stringBuilder << "# " << vertices.size() << " vertices" << std::endl << std::endl;
 
-            for (const MetroVertex& v : vertices) {
-                stringBuilder << "vt " << v.uv0.x << ' ' << (1.0f - v.uv0.y) << std::endl;
-            }
-            stringBuilder << "# " << vertices.size() << " texcoords" << std::endl << std::endl;
-
-            for (const MetroVertex& v : vertices) {
-                stringBuilder << "vn " << v.normal.x << ' ' << v.normal.y << ' ' << v.normal.z << std::endl;
-            }
-            stringBuilder << "# " << vertices.size() << " normals" << std::endl << std::endl;
+        MyArray<CharString> chunks;
+        ExporterOBJ::FormatMeshes(gds, chunks);
 
-            stringBuilder << "g Mesh_" << meshIdx << std::endl;
-            stringBuilder << "usemtl " << "Material_" << meshIdx << std::endl;
-
-            const MetroFace* faces = scast<const MetroFace*>(gd.faces);
-            for (size_t i = 0; i < gd.mesh->facesCount; ++i) {
-                const size_t a = faces[i].a + lastIdx + 1;
-                const size_t b = faces[i].b + lastIdx + 1;
-                const size_t c = faces[i].c + lastIdx + 1;
-
-                stringBuilder << "f " << a << '/' << a << '/' << a <<
-                                  ' ' << b << '/' << b << '/' << b <<
-                                  ' ' << c << '/' << c << '/' << c << std::endl;
-            }
-            stringBuilder << "# " << gd.mesh->facesCount << " faces" << std::endl << std::endl;
-
-            ++meshIdx;
-            lastIdx += vertices.size();
+        file.write(header.data(), header.size());
+        for (const CharString& chunk : chunks) {
+            file.write(chunk.data(), chunk.size());
         }
-
-        const CharString& str = stringBuilder.str();
-        file.write(str.c_str(), str.length());
         file.flush();
 
         CharString matPath = filePath.string();
@@ -128,15 +192,15 @@ bool ExporterOBJ::ExportModel(const MetroModelBase& model, const fs::path& fileP
             mtlBuilder << "# Generated from Metro model file" << std::endl;
             mtlBuilder << CharString("# using ").append(mExporterName).append(" tool made by iOrange") << std::endl << std::endl;
 
-            meshIdx = 0;
+            size_t meshIdx = 0;
             for (const auto& gd : gds) {
                 mtlBuilder << "newmtl " << "Material_" << meshIdx << std::endl;
 
                 const StringView& textureName = gd.model->GetMaterialString(MetroModelBase::kMaterialStringTexture);
 
-                MetroSurfaceDescription surfaceSet = MetroContext::Get().GetTexturesDB().GetSurfaceSetFromName(textureName, false);
-                const CharString& albedoName = surfaceSet.albedo;
-                const CharString& normalmapName = surfaceSet.normalmap;
+                const RefPtr<const MetroSurfaceDescription> surfaceSet = MetroContext::Get().GetTexturesDB().GetSurfaceSetFromName(textureName, false);
+                const CharString& albedoName = surfaceSet->albedo;
+                const CharString& normalmapName = surfaceSet->normalmap;
 
                 CharString textureFileName = fs::path(albedoName).filename().string() + mTexturesExtension;
 
@@ -2,6 +2,7 @@
 #include "mycommon.h"
 
 class MetroModelBase;
+struct MetroModelGeomData;
 
 class ExporterOBJ {
 public:
@@ -13,6 +14,10 @@ public:
     void        SetTexturesExtension(const CharString& ext);
     bool        ExportModel(const MetroModelBase& model, const fs::path& filePath) const;
 
+    // obj text of every mesh (vertices, texcoords, normals and faces) into its own chunk, meshes are formatted
+    //  in parallel, chunks concatenated in order are the body of the .obj file, 0 threads - all hardware threads
+    static void FormatMeshes(const MyArray<MetroModelGeomData>& gds, MyArray<CharString>& chunks, const size_t numThreads = 0);
+
 private:
     bool        mExcludeCollision;
     CharString  mExporterName;
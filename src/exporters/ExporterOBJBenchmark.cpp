@@ -0,0 +1,314 @@
+#include "ExporterOBJBenchmark.h"
+#include "ExporterOBJ.h"
+#include "metro/MetroModel.h"
+#include "metro/MetroVertexCodec.h"
+#include "jansson.h"
+
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <sstream>
+
+
+static RefPtr<MetroModelStd> Bench_MakeMesh(const size_t meshIdx, const size_t facesPerMesh) {
+    const size_t gridSize = std::min<size_t>(255, std::max<size_t>(2, scast<size_t>(std::ceil(std::sqrt(scast<double>(facesPerMesh) / 2.0))) + 1));
+    const size_t numVertices = gridSize * gridSize;
+
+    MyArray<VertexStatic> vertices(numVertices);
+    for (size_t y = 0; y < gridSize; ++y) {
+        for (size_t x = 0; x < gridSize; ++x) {
+            const float fx = scast<float>(x), fy = scast<float>(y);
+
+            VertexStatic& v = vertices[y * gridSize + x];
+            v.pos = vec3(fx * 0.0137f + scast<float>(meshIdx) * 3.71f, std::sin(fx * 0.05f) * std::cos(fy * 0.07f) * 1.3f, fy * 0.0173f);
+            v.normal = 0x7F000000u | (scast<uint32_t>((x * 37) & 0xFF) << 16) | (scast<uint32_t>((y * 53) & 0xFF) << 8) | 0x7Fu;
+            v.aux0 = v.aux1 = 0;
+            v.uv = vec2(fx / scast<float>(gridSize - 1), fy / scast<float>(gridSize - 1));
+        }
+    }
+
+    MyArray<MetroFace> faces;
+    faces.reserve((gridSize - 1) * (gridSize - 1) * 2);
+    for (size_t y = 0; y + 1 < gridSize; ++y) {
+        for (size_t x = 0; x + 1 < gridSize; ++x) {
+            const uint16_t i0 = scast<uint16_t>(y * gridSize + x);
+            const uint16_t i1 = scast<uint16_t>(i0 + 1);
+            const uint16_t i2 = scast<uint16_t>(i0 + gridSize);
+            const uint16_t i3 = scast<uint16_t>(i2 + 1);
+            faces.push_back({ i0, i2, i1 });
+            faces.push_back({ i1, i2, i3 });
+        }
+    }
+
+    RefPtr<MetroModelStd> mesh = MakeRefPtr<MetroModelStd>();
+    mesh->CreateMesh(numVertices, faces.size(), 0, 0);
+    mesh->CopyVerticesData(vertices.data());
+    mesh->CopyFacesData(faces.data());
+    return mesh;
+}
+
+// what ExporterOBJ::ExportModel did before FormatMeshes, kept here as the reference
+static CharString Bench_FormatMeshesLegacy(const MyArray<MetroModelGeomData>& gds) {
+    std::ostringstream stringBuilder;
+
+    size_t lastIdx = 0, meshIdx = 0;
+    for (const auto& gd : gds) {
+        MyArray<MetroVertex> vertices(gd.mesh->verticesCount);
+        VTX_ConvertVertices(rcast<const VertexStatic*>(gd.vertices), vertices.size(), vertices.data());
+        for (MetroVertex& v : vertices) {
+            v.pos *= gd.mesh->verticesScale;
+        }
+
+        for (const MetroVertex& v : vertices) {
+            stringBuilder << "v " << v.pos.x << ' ' << v.pos.y << ' ' << v.pos.z << std::endl;
+        }
+        stringBuilder << "# " << vertices.size() << " vertices" << std::endl << std::endl;
+
+        for (const MetroVertex& v : vertices) {
+            stringBuilder << "vt " << v.uv0.x << ' ' << (1.0f - v.uv0.y) << std::endl;
+        }
+        stringBuilder << "# " << vertices.size() << " texcoords" << std::endl << std::endl;
+
+        for (const MetroVertex& v : vertices) {
+            stringBuilder << "vn " << v.normal.x << ' ' << v.normal.y << ' ' << v.normal.z << std::endl;
+        }
+        stringBuilder << "# " << vertices.size() << " normals" << std::endl << std::endl;
+
+        stringBuilder << "g Mesh_" << meshIdx << std::endl;
+        stringBuilder << "usemtl " << "Material_" << meshIdx << std::endl;
+
+        const MetroFace* faces = scast<const MetroFace*>(gd.faces);
+        for (size_t i = 0; i < gd.mesh->facesCount; ++i) {
+            const size_t a = faces[i].a + lastIdx + 1;
+            const size_t b = faces[i].b + lastIdx + 1;
+            const size_t c = faces[i].c + lastIdx + 1;
+
+            stringBuilder << "f " << a << '/' << a << '/' << a <<
+                              ' ' << b << '/' << b << '/' << b <<
+                              ' ' << c << '/' << c << '/' << c << std::endl;
+        }
+        stringBuilder << "# " << gd.mesh->facesCount << " faces" << std::endl << std::endl;
+
+        ++meshIdx;
+        lastIdx += vertices.size();
+    }
+
+    return stringBuilder.str();
+}
+
+static size_t Bench_CountLines(const CharString& text) {
+    return scast<size_t>(std::count(text.begin(), text.end(), '\n'));
+}
+
+// all the v/vt/vn floats of the chunks must parse back into exactly what the exporter had
+static bool Bench_CheckRoundTrip(const MyArray<MetroModelGeomData>& gds, const MyArray<CharString>& chunks) {
+    for (size_t meshIdx = 0; meshIdx < gds.size(); ++meshIdx) {
+        const MetroModelGeomData& gd = gds[meshIdx];
+
+        MyArray<MetroVertex> vertices(gd.mesh->verticesCount);
+        VTX_ConvertVertices(rcast<const VertexStatic*>(gd.vertices), vertices.size(), vertices.data());
+
+        MyArray<float> expected;
+        expected.reserve(vertices.size() * 8);
+        for (const MetroVertex& v : vertices) {
+            const vec3 pos = v.pos * gd.mesh->verticesScale;
+            expected.insert(expected.end(), { pos.x, pos.y, pos.z });
+        }
+        for (const MetroVertex& v : vertices) {
+            expected.insert(expected.end(), { v.uv0.x, 1.0f - v.uv0.y });
+        }
+        for (const MetroVertex& v : vertices) {
+            expected.insert(expected.end(), { v.normal.x, v.normal.y, v.normal.z });
+        }
+
+        MyArray<float> parsed;
+        parsed.reserve(expected.size());
+
+        const char* ptr = chunks[meshIdx].data();
+        const char* end = ptr + chunks[meshIdx].size();
+        while (ptr < end) {
+            const char* eol = std::find(ptr, end, '\n');
+            if (ptr[0] == 'v') {
+                const char* p = std::find(ptr, eol, ' ');
+                while (p < eol) {
+                    float value = 0.0f;
+                    const std::from_chars_result r = std::from_chars(p + 1, eol, value);
+                    if (r.ec != std::errc()) {
+                        return false;
+                    }
+                    parsed.push_back(value);
+                    p = r.ptr;
+                }
+            }
+            ptr = eol + 1;
+        }
+
+        if (parsed.size() != expected.size() || std::memcmp(parsed.data(), expected.data(), parsed.size() * sizeof(float)) != 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+ExporterOBJBenchmark::ExporterOBJBenchmark() {
+}
+ExporterOBJBenchmark::~ExporterOBJBenchmark() {
+}
+
+bool ExporterOBJBenchmark::AddSyntheticModel(const CharString& name, const size_t numMeshes, const size_t facesPerMesh) {
+    if (!numMeshes || !facesPerMesh) {
+        return false;
+    }
+
+    Setup setup;
+    setup.name = name;
+    setup.model = MakeRefPtr<MetroModelHierarchy>();
+    setup.numVertices = 0;
+    setup.numFaces = 0;
+
+    for (size_t i = 0; i < numMeshes; ++i) {
+        RefPtr<MetroModelStd> mesh = Bench_MakeMesh(i, facesPerMesh);
+        setup.numVertices += mesh->GetVerticesCount();
+        setup.numFaces += mesh->GetFacesCount();
+        setup.model->AddChild(mesh);
+    }
+
+    mSetups.emplace_back(std::move(setup));
+    return true;
+}
+
+void ExporterOBJBenchmark::AddDefaultSyntheticModels() {
+    // 50 x ~100k = 5M triangles
+    this->AddSyntheticModel("static_5m_tris", 50, 100000);
+}
+
+size_t ExporterOBJBenchmark::GetNumModels() const {
+    return mSetups.size();
+}
+
+size_t ExporterOBJBenchmark::Run(const size_t numIterations) {
+    mResults.clear();
+
+    for (const Setup& setup : mSetups) {
+        this->RunSingle(setup, std::max<size_t>(1, numIterations));
+    }
+
+    return mResults.size();
+}
+
+const MyArray<ObjExportBenchResult>& ExporterOBJBenchmark::GetResults() const {
+    return mResults;
+}
+
+json_t* ExporterOBJBenchmark::ToJsonTree() const {
+    json_t* root = json_object();
+    json_t* results = json_array();
+
+    for (const ObjExportBenchResult& r : mResults) {
+        json_t* jr = json_object();
+        json_object_set_new(jr, "model", json_string(r.model.c_str()));
+        json_object_set_new(jr, "method", json_string(r.method.c_str()));
+        json_object_set_new(jr, "meshes", json_integer(scast<json_int_t>(r.numMeshes)));
+        json_object_set_new(jr, "vertices", json_integer(scast<json_int_t>(r.numVertices)));
+        json_object_set_new(jr, "faces", json_integer(scast<json_int_t>(r.numFaces)));
+        json_object_set_new(jr, "threads", json_integer(scast<json_int_t>(r.numThreads)));
+        json_object_set_new(jr, "format_ms", json_real(r.formatMs));
+        json_object_set_new(jr, "format_mb_s", json_real(r.formatMBPerSec));
+        json_object_set_new(jr, "text_size", json_integer(scast<json_int_t>(r.textSize)));
+        json_object_set_new(jr, "round_trip", json_boolean(r.roundTrip));
+        json_array_append_new(results, jr);
+    }
+
+    // speedup of every method over stringstream on the same model
+    json_t* summary = json_object();
+    for (const ObjExportBenchResult& r : mResults) {
+        const auto baseline = std::find_if(mResults.begin(), mResults.end(), [&r](const ObjExportBenchResult& b) {
+            return b.model == r.model && b.method == "stringstream";
+        });
+
+        if (baseline != mResults.end() && r.formatMs > 0.0) {
+            json_t* model = json_object_get(summary, r.model.c_str());
+            if (!model) {
+                model = json_object();
+                json_object_set_new(summary, r.model.c_str(), model);
+            }
+
+            json_object_set_new(model, r.method.c_str(), json_real(baseline->formatMs / r.formatMs));
+        }
+    }
+
+    json_object_set_new(root, "results", results);
+    json_object_set_new(root, "speedup", summary);
+
+    return root;
+}
+
+void ExporterOBJBenchmark::RunSingle(const Setup& setup, const size_t numIterations) {
+    using Clock = std::chrono::high_resolution_clock;
+
+    MyArray<MetroModelGeomData> gds;
+    setup.model->CollectGeomData(gds);
+
+    ObjExportBenchResult result = {};
+    result.model = setup.name;
+    result.numMeshes = gds.size();
+    result.numVertices = setup.numVertices;
+    result.numFaces = setup.numFaces;
+
+    auto finishResult = [&result](const double bestMs) {
+        result.formatMs = bestMs;
+        result.formatMBPerSec = (bestMs > 0.0) ? (scast<double>(result.textSize) / (1024.0 * 1024.0)) / (bestMs / 1000.0) : 0.0;
+    };
+
+    // reference, the text is only kept long enough to count its lines
+    size_t legacyLines = 0;
+    double bestMs = 0.0;
+    for (size_t iteration = 0; iteration < numIterations; ++iteration) {
+        const auto t0 = Clock::now();
+        const CharString text = Bench_FormatMeshesLegacy(gds);
+        const auto t1 = Clock::now();
+
+        const double ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+        bestMs = (iteration == 0) ? ms : std::min(bestMs, ms);
+        result.textSize = text.size();
+        legacyLines = Bench_CountLines(text);
+    }
+
+    result.method = "stringstream";
+    result.numThreads = 1;
+    result.roundTrip = true;
+    finishResult(bestMs);
+    mResults.push_back(result);
+
+    const size_t threadCounts[] = { 1, 0 };
+    for (const size_t numThreads : threadCounts) {
+        MyArray<CharString> chunks;
+        for (size_t iteration = 0; iteration < numIterations; ++iteration) {
+            const auto t0 = Clock::now();
+            ExporterOBJ::FormatMeshes(gds, chunks, numThreads);
+            const auto t1 = Clock::now();
+
+            const double ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+            bestMs = (iteration == 0) ? ms : std::min(bestMs, ms);
+        }
+
+        size_t textSize = 0, numLines = 0;
+        for (const CharString& chunk : chunks) {
+            textSize += chunk.size();
+            numLines += Bench_CountLines(chunk);
+        }
+
+        result.method = numThreads ? "to_chars_1t" : "to_chars";
+        result.numThreads = ParallelGetNumThreads(numThreads);
+        result.textSize = textSize;
+        result.roundTrip = (numLines == legacyLines) && Bench_CheckRoundTrip(gds, chunks);
+        finishResult(bestMs);
+        mResults.push_back(result);
+
+        if (!result.roundTrip) {
+            LogPrintF(LogLevel::Warning, "OBJ benchmark: %s output of %s doesn't match the source", result.method.c_str(), setup.name.c_str());
+        }
+    }
+}
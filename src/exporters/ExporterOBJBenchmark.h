@@ -0,0 +1,55 @@
+#pragma once
+#include "mycommon.h"
+
+class MetroModelHierarchy;
+struct json_t;
+
+// Formats big synthetic static models into .obj text, once the way ExporterOBJ used to (std::ostringstream with
+//  std::endl on every line) and then with ExporterOBJ::FormatMeshes on one and on all threads. Only the text is
+//  timed, nothing goes to disk. The new text must parse back to the exact same floats and have as many lines as
+//  the old one.
+
+struct ObjExportBenchResult {
+    CharString  model;
+    CharString  method;         // stringstream, to_chars_1t, to_chars
+    size_t      numMeshes;
+    size_t      numVertices;
+    size_t      numFaces;
+    size_t      numThreads;
+    double      formatMs;       // best of all iterations
+    double      formatMBPerSec;
+    size_t      textSize;
+    bool        roundTrip;      // every float parses back bit exact, always true for stringstream (reference)
+};
+
+class ExporterOBJBenchmark {
+public:
+    ExporterOBJBenchmark();
+    ~ExporterOBJBenchmark();
+
+    // numMeshes grids of about facesPerMesh triangles each, faces are 16 bit so a mesh stays under 64k vertices
+    bool                                AddSyntheticModel(const CharString& name, const size_t numMeshes, const size_t facesPerMesh);
+    // 5M triangles in 50 meshes, a big level chunk or prop dump
+    void                                AddDefaultSyntheticModels();
+    size_t                              GetNumModels() const;
+
+    // returns number of successful runs (models x methods)
+    size_t                              Run(const size_t numIterations = 1);
+
+    const MyArray<ObjExportBenchResult>& GetResults() const;
+    json_t*                             ToJsonTree() const;
+
+private:
+    struct Setup {
+        CharString                  name;
+        RefPtr<MetroModelHierarchy> model;
+        size_t                      numVertices;
+        size_t                      numFaces;
+    };
+
+    void                                RunSingle(const Setup& setup, const size_t numIterations);
+
+private:
+    MyArray<Setup>                      mSetups;
+    MyArray<ObjExportBenchResult>       mResults;
+};
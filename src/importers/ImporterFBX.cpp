@@ -3,6 +3,8 @@
 #include "metro/MetroSkeleton.h"
 #include "metro/MetroMotion.h"
 #include "metro/MetroModel.h"
+#include "metro/MetroVertexCodec.h"
+#include "VerticesWelder.h"
 
 #define FBXSDK_NEW_API 1
 #define FBXSDK_SHARED 1
@@ -155,29 +157,66 @@ static fbxsdk::FbxVector4 GetNormalFromElement(T* element, const int controlPoin
     return normal;
 }
 
-template <typename T>
-struct VerticesCollector {
-    MyArray<T>        vertices;
-    MyArray<uint16_t> indices;
-
-    void AddVertex(const T& v) {
-        const auto begin = this->vertices.begin();
-        const auto end = this->vertices.end();
-        const auto it = std::find(begin, end, v);
-
-        if (it == end) {
-            indices.push_back(scast<uint16_t>(this->vertices.size()));
-            this->vertices.push_back(v);
-        } else {
-            const size_t idx = std::distance(begin, it);
-            this->indices.push_back(scast<uint16_t>(idx));
-        }
+// bone influences are ignored, same as UniversalVertex::operator ==
+template <>
+struct VerticesWelderTraits<ImporterFBX::UniversalVertex> {
+    static vec3 GetPosition(const ImporterFBX::UniversalVertex& v) {
+        return v.pos;
+    }
+
+    static bool IsSame(const ImporterFBX::UniversalVertex& a, const ImporterFBX::UniversalVertex& b, const float epsilon) {
+        return WeldEqual(a.pos, b.pos, epsilon) &&
+               WeldEqual(a.normal, b.normal, epsilon) &&
+               WeldEqual(a.tangent, b.tangent, epsilon) &&
+               WeldEqual(a.bitangent, b.bitangent, epsilon) &&
+               WeldEqual(a.uv, b.uv, epsilon);
     }
 };
 
+// imported vertices have no vao, so it's 1 everywhere, same as tangent sign
+static void FillVertexStreams(const MyArray<ImporterFBX::UniversalVertex>& vertices, const uint32_t components, MetroVertexStreams& streams) {
+    const bool withSkin = TestBit<uint32_t>(components, MetroVertexStreams::Skin);
+
+    streams.Resize(vertices.size(), components);
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        const ImporterFBX::UniversalVertex& src = vertices[i];
+
+        streams.px[i] = src.pos.x;
+        streams.py[i] = src.pos.y;
+        streams.pz[i] = src.pos.z;
+        streams.nx[i] = src.normal.x;
+        streams.ny[i] = src.normal.y;
+        streams.nz[i] = src.normal.z;
+        streams.ao[i] = 1.0f;
+        streams.tx[i] = src.tangent.x;
+        streams.ty[i] = src.tangent.y;
+        streams.tz[i] = src.tangent.z;
+        streams.tw[i] = 1.0f;
+        streams.bx[i] = src.bitangent.x;
+        streams.by[i] = src.bitangent.y;
+        streams.bz[i] = src.bitangent.z;
+        streams.u0[i] = src.uv.x;
+        streams.v0[i] = src.uv.y;
+
+        if (withSkin) {
+            uint8_t bones[4], weights[4];
+            for (size_t j = 0; j < 4; ++j) {
+                bones[j] = scast<uint8_t>(Clamp(src.boneInfluences[j].idx * 3, 0u, 255u));
+                weights[j] = scast<uint8_t>(Clamp(src.boneInfluences[j].weight * 255.0f, 0.0f, 255.0f));
+            }
+            MetroSwizzle(bones);
+            MetroSwizzle(weights);
+
+            streams.bones[i] = *rcast<const uint32_t*>(bones);
+            streams.weights[i] = *rcast<const uint32_t*>(weights);
+        }
+    }
+}
+
 
 ImporterFBX::ImporterFBX()
     : mGameVersion(MetroGameVersion::Redux)
+    , mWeldEpsilon(0.0f)
     , mAnimStartTime(0.0)
     , mAnimEndTime(0.0)
 {
@@ -191,6 +230,10 @@ void ImporterFBX::SetGameVersion(const MetroGameVersion gameVersion) {
     mGameVersion = gameVersion;
 }
 
+void ImporterFBX::SetWeldEpsilon(const float epsilon) {
+    mWeldEpsilon = epsilon;
+}
+
 void ImporterFBX::SetSkeleton(const fs::path& path) {
     MemStream stream = OSReadFile(path);
     if (stream) {
@@ -691,7 +734,8 @@ void ImporterFBX::AddMeshToModel(RefPtr<MetroModelBase>& model, fbxsdk::FbxMesh*
 
     myControlPoints.clear();
 
-    VerticesCollector<UniversalVertex> collector;
+    VerticesWelder<UniversalVertex> collector(mWeldEpsilon);
+    collector.Reserve(vertices.size());
     for (const UniversalVertex& v : vertices) {
         collector.AddVertex(v);
     }
@@ -703,7 +747,8 @@ void ImporterFBX::AddMeshToModel(RefPtr<MetroModelBase>& model, fbxsdk::FbxMesh*
         std::swap(collector.indices[f * 3 + 0], collector.indices[f * 3 + 2]);
     }
 
-    VerticesCollector<vec3> shadowCollector;
+    VerticesWelder<vec3> shadowCollector(mWeldEpsilon);
+    shadowCollector.Reserve(myShadowPoints.size());
     for (const vec3& v : myShadowPoints) {
         shadowCollector.AddVertex(v);
     }
@@ -722,25 +767,12 @@ void ImporterFBX::AddMeshToModel(RefPtr<MetroModelBase>& model, fbxsdk::FbxMesh*
         BytesArray bonesRemapTable =  this->BuildBonesRemapTable(collector.vertices);
 
         const float vscale = bbox.MaximumValue();
-        const float invVScale = 1.0f / vscale;
+
+        MetroVertexStreams streams;
+        FillVertexStreams(collector.vertices, MetroVertexStreams::Skin, streams);
 
         MyArray<VertexSkinned> skinnedVertices(numVertices);
-        for (size_t i = 0; i < numVertices; ++i) {
-            VertexSkinned& dst = skinnedVertices[i];
-            const UniversalVertex& src = collector.vertices[i];
-
-            EncodeSkinnedPosition(src.pos * invVScale, dst.pos);
-            dst.normal = EncodeNormal(src.normal, 1.0f);
-            dst.aux0 = EncodeNormal(src.tangent, 1.0f);
-            dst.aux1 = EncodeNormal(src.bitangent, 1.0f);
-            for (size_t i = 0; i < 4; ++i) {
-                dst.bones[i] = scast<uint8_t>(Clamp(src.boneInfluences[i].idx * 3, 0u, 255u));
-                dst.weights[i] = scast<uint8_t>(Clamp(src.boneInfluences[i].weight * 255.0f, 0.0f, 255.0f));
-            }
-            MetroSwizzle(dst.bones);
-            MetroSwizzle(dst.weights);
-            EncodeSkinnedUV(src.uv, dst.uv);
-        }
+        VTX_EncodeSkinned(streams, vscale, skinnedVertices.data());
 
 
         RefPtr<MetroModelSkin> skinnedMesh = MakeRefPtr<MetroModelSkin>();
@@ -757,17 +789,11 @@ void ImporterFBX::AddMeshToModel(RefPtr<MetroModelBase>& model, fbxsdk::FbxMesh*
 
         mesh = skinnedMesh;
     } else {
+        MetroVertexStreams streams;
+        FillVertexStreams(collector.vertices, MetroVertexStreams::Base, streams);
+
         MyArray<VertexStatic> staticVertices(numVertices);
-        for (size_t i = 0; i < numVertices; ++i) {
-            VertexStatic& dst = staticVertices[i];
-            const UniversalVertex& src = collector.vertices[i];
-
-            dst.pos = src.pos;
-            dst.normal = EncodeNormal(src.normal, 1.0f);
-            dst.aux0 = EncodeNormal(src.tangent, 1.0f);
-            dst.aux1 = EncodeNormal(src.bitangent, 1.0f);
-            dst.uv = src.uv;
-        }
+        VTX_EncodeStatic(streams, staticVertices.data());
 
         MyArray<VertexStaticShadow> shadowVertices(numShadowVertices);
         for (size_t i = 0; i < numShadowVertices; ++i) {
@@ -934,17 +960,15 @@ void ImporterFBX::FixUpSkinnedVertices(MyArray<UniversalVertex>& vertices) {
 BytesArray ImporterFBX::BuildBonesRemapTable(MyArray<UniversalVertex>& vertices) {
     BytesArray remapTable;
 
-    auto addToRemapTable = [&remapTable](const uint8_t v)->uint8_t {
-        auto beg = remapTable.begin();
-        auto end = remapTable.end();
-        auto it = std::find(beg, end, v);
-        if (it != end) {
-            return scast<uint8_t>(std::distance(beg, it));
-        } else {
-            const uint8_t result = scast<uint8_t>(remapTable.size());
+    // bone idx -> remapped idx + 1, 0 is not in the table yet
+    uint16_t remapLookup[256] = {};
+
+    auto addToRemapTable = [&remapTable, &remapLookup](const uint8_t v)->uint8_t {
+        if (!remapLookup[v]) {
             remapTable.push_back(v);
-            return result;
+            remapLookup[v] = scast<uint16_t>(remapTable.size());
         }
+        return scast<uint8_t>(remapLookup[v] - 1);
     };
 
     for (UniversalVertex& v : vertices) {
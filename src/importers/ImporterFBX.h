@@ -97,6 +97,8 @@ public:
     ~ImporterFBX();
 
     void                        SetGameVersion(const MetroGameVersion gameVersion);
+    // vertices closer than epsilon (every attribute, per component) get welded, 0 welds only the exact duplicates
+    void                        SetWeldEpsilon(const float epsilon);
     void                        SetSkeleton(const fs::path& path);
     bool                        ImportAnimation(const fs::path& path, MetroMotion& motion);
 
@@ -115,6 +117,7 @@ private:
 
 private:
     MetroGameVersion            mGameVersion;
+    float                       mWeldEpsilon;
     MyArray<JointFromFbx>       mJointsBones;
     MyArray<JointFromFbx>       mJointsLocators;
     RefPtr<MetroSkeleton>       mSkeleton;
@@ -1,39 +1,40 @@
 #include "ImporterOBJ.h"
 
 #include "metro/MetroModel.h"
+#include "VerticesWelder.h"
 
 #define TINYOBJLOADER_IMPLEMENTATION
 #include "tiny_obj_loader.h"
 
 
-struct VerticesCollector {
-    MyArray<VertexStatic>   vertices;
-    MyArray<uint16_t>       indices;
-
-    void AddVertex(const VertexStatic& v) {
-        const auto begin = this->vertices.begin();
-        const auto end = this->vertices.end();
-        const auto it = std::find_if(begin, end, [&v](const VertexStatic& vertex)->bool {
-            return (v.pos == vertex.pos && v.normal == vertex.normal && v.aux0 == vertex.aux0 && v.aux1 == vertex.aux1 && v.uv == vertex.uv);
-        });
+template <>
+struct VerticesWelderTraits<VertexStatic> {
+    static vec3 GetPosition(const VertexStatic& v) {
+        return v.pos;
+    }
 
-        if (it == end) {
-            indices.push_back(scast<uint16_t>(this->vertices.size()));
-            this->vertices.push_back(v);
-        } else {
-            const size_t idx = std::distance(begin, it);
-            this->indices.push_back(scast<uint16_t>(idx));
-        }
+    // packed normal and aux are compared as is
+    static bool IsSame(const VertexStatic& a, const VertexStatic& b, const float epsilon) {
+        const vec3 posA = a.pos, posB = b.pos;
+        const vec2 uvA = a.uv, uvB = b.uv;
+        return WeldEqual(posA, posB, epsilon) &&
+               a.normal == b.normal && a.aux0 == b.aux0 && a.aux1 == b.aux1 &&
+               WeldEqual(uvA, uvB, epsilon);
     }
 };
 
 
 
-ImporterOBJ::ImporterOBJ() {
+ImporterOBJ::ImporterOBJ()
+    : mWeldEpsilon(0.0f) {
 }
 ImporterOBJ::~ImporterOBJ() {
 }
 
+void ImporterOBJ::SetWeldEpsilon(const float epsilon) {
+    mWeldEpsilon = epsilon;
+}
+
 RefPtr<MetroModelBase> ImporterOBJ::ImportModel(const fs::path& path) {
     RefPtr<MetroModelBase> result;
 
@@ -61,10 +62,11 @@ RefPtr<MetroModelBase> ImporterOBJ::ImportModel(const fs::path& path) {
 }
 
 RefPtr<MetroModelStd> ImporterOBJ::CreateStdModel(const tinyobj::shape_t& shape, const tinyobj::attrib_t& attrib) {
-    VerticesCollector collector;
-
     const size_t numObjFaces = shape.mesh.num_face_vertices.size();
 
+    VerticesWelder<VertexStatic> collector(mWeldEpsilon);
+    collector.Reserve(numObjFaces * 3);
+
     AABBox bbox;
     bbox.Reset();
 
@@ -15,8 +15,14 @@ public:
     ImporterOBJ();
     ~ImporterOBJ();
 
+    // vertices closer than epsilon (position and uv, per component) get welded, 0 welds only the exact duplicates
+    void                    SetWeldEpsilon(const float epsilon);
+
     RefPtr<MetroModelBase>  ImportModel(const fs::path& path);
 
 private:
     RefPtr<MetroModelStd>   CreateStdModel(const tinyobj::shape_t& shape, const tinyobj::attrib_t& attrib);
+
+private:
+    float                   mWeldEpsilon;
 };
@@ -0,0 +1,241 @@
+#include "ImporterOBJBenchmark.h"
+#include "ImporterOBJ.h"
+#include "metro/MetroModel.h"
+#include "jansson.h"
+
+#include <charconv>
+#include <chrono>
+#include <cmath>
+
+
+static void Bench_AppendFloat(CharString& dst, const float v) {
+    char buffer[32];
+    const std::to_chars_result r = std::to_chars(buffer, buffer + sizeof(buffer), v);
+    dst.append(buffer, r.ptr);
+}
+
+static void Bench_AppendIndex(CharString& dst, const size_t v) {
+    char buffer[24];
+    const std::to_chars_result r = std::to_chars(buffer, buffer + sizeof(buffer), v);
+    dst.append(buffer, r.ptr);
+}
+
+// rolling terrain-like grid, one v/vt/vn per grid vertex, faces reference them so obj shares them between triangles
+static CharString Bench_MakeGridObj(const size_t gridSize) {
+    CharString result;
+    result.reserve(gridSize * gridSize * 96 + gridSize * gridSize * 2 * 48);
+
+    const float invSize = 1.0f / scast<float>(gridSize - 1);
+    for (size_t y = 0; y < gridSize; ++y) {
+        for (size_t x = 0; x < gridSize; ++x) {
+            const float fx = scast<float>(x), fy = scast<float>(y);
+            result.append("v ");
+            Bench_AppendFloat(result, fx * 0.01f);
+            result.push_back(' ');
+            Bench_AppendFloat(result, std::sin(fx * 0.05f) * std::cos(fy * 0.07f) * 0.5f);
+            result.push_back(' ');
+            Bench_AppendFloat(result, fy * 0.01f);
+            result.push_back('\n');
+        }
+    }
+    for (size_t y = 0; y < gridSize; ++y) {
+        for (size_t x = 0; x < gridSize; ++x) {
+            result.append("vt ");
+            Bench_AppendFloat(result, scast<float>(x) * invSize);
+            result.push_back(' ');
+            Bench_AppendFloat(result, scast<float>(y) * invSize);
+            result.push_back('\n');
+        }
+    }
+    for (size_t y = 0; y < gridSize; ++y) {
+        for (size_t x = 0; x < gridSize; ++x) {
+            const vec3 n = Normalize(vec3(std::cos(scast<float>(x) * 0.05f) * -0.1f, 1.0f, std::sin(scast<float>(y) * 0.07f) * 0.1f));
+            result.append("vn ");
+            Bench_AppendFloat(result, n.x);
+            result.push_back(' ');
+            Bench_AppendFloat(result, n.y);
+            result.push_back(' ');
+            Bench_AppendFloat(result, n.z);
+            result.push_back('\n');
+        }
+    }
+
+    result.append("g grid\n");
+
+    auto appendFaceVertex = [&result](const size_t idx) {
+        result.push_back(' ');
+        Bench_AppendIndex(result, idx);
+        result.push_back('/');
+        Bench_AppendIndex(result, idx);
+        result.push_back('/');
+        Bench_AppendIndex(result, idx);
+    };
+
+    for (size_t y = 0; y + 1 < gridSize; ++y) {
+        for (size_t x = 0; x + 1 < gridSize; ++x) {
+            // obj indices are 1-based
+            const size_t i0 = y * gridSize + x + 1;
+            const size_t i1 = i0 + 1;
+            const size_t i2 = i0 + gridSize;
+            const size_t i3 = i2 + 1;
+
+            result.push_back('f');
+            appendFaceVertex(i0);
+            appendFaceVertex(i2);
+            appendFaceVertex(i1);
+            result.append("\nf");
+            appendFaceVertex(i1);
+            appendFaceVertex(i2);
+            appendFaceVertex(i3);
+            result.push_back('\n');
+        }
+    }
+
+    return result;
+}
+
+
+ImporterOBJBenchmark::ImporterOBJBenchmark() {
+}
+ImporterOBJBenchmark::~ImporterOBJBenchmark() {
+}
+
+bool ImporterOBJBenchmark::AddSyntheticMesh(const size_t gridSize) {
+    if (gridSize < 2 || gridSize > 255) {
+        return false;
+    }
+
+    Setup setup;
+    setup.name = "grid_" + std::to_string(gridSize);
+    setup.numTriangles = (gridSize - 1) * (gridSize - 1) * 2;
+    setup.numVertices = gridSize * gridSize;
+    setup.objText = Bench_MakeGridObj(gridSize);
+
+    mSetups.emplace_back(std::move(setup));
+    return true;
+}
+
+void ImporterOBJBenchmark::AddDefaultSyntheticMeshes() {
+    this->AddSyntheticMesh(32);
+    this->AddSyntheticMesh(64);
+    this->AddSyntheticMesh(128);
+    this->AddSyntheticMesh(181);
+    this->AddSyntheticMesh(255);
+}
+
+size_t ImporterOBJBenchmark::GetNumMeshes() const {
+    return mSetups.size();
+}
+
+size_t ImporterOBJBenchmark::Run(const MyArray<float>& weldEpsilons, const size_t numIterations) {
+    mResults.clear();
+    mResults.reserve(mSetups.size() * weldEpsilons.size());
+
+    // tinyobjloader only reads files
+    std::error_code ec;
+    const fs::path tempFolder = fs::temp_directory_path(ec);
+    if (ec) {
+        LogPrintF(LogLevel::Error, "Import benchmark: no temp folder to put the obj files in");
+        return 0;
+    }
+
+    for (const Setup& setup : mSetups) {
+        const fs::path objPath = tempFolder / ("metro_import_bench_" + setup.name + ".obj");
+        if (OSWriteFile(objPath, setup.objText.data(), setup.objText.length()) != setup.objText.length()) {
+            LogPrintF(LogLevel::Warning, "Import benchmark: failed to write %s", objPath.u8string().c_str());
+            continue;
+        }
+
+        for (const float epsilon : weldEpsilons) {
+            ImportBenchResult result = {};
+            if (this->RunSingle(setup, objPath, epsilon, std::max<size_t>(1, numIterations), result)) {
+                mResults.emplace_back(std::move(result));
+            } else {
+                LogPrintF(LogLevel::Warning, "Import benchmark: failed to import %s", setup.name.c_str());
+            }
+        }
+
+        fs::remove(objPath, ec);
+    }
+
+    // how time grows compared to the previous (smaller) mesh imported with the same epsilon
+    for (size_t i = 0; i < mResults.size(); ++i) {
+        ImportBenchResult& r = mResults[i];
+        for (size_t j = i; j-- > 0;) {
+            const ImportBenchResult& prev = mResults[j];
+            if (prev.weldEpsilon == r.weldEpsilon && prev.numTriangles < r.numTriangles && prev.importMs > 0.0) {
+                r.scaling = std::log(r.importMs / prev.importMs) / std::log(scast<double>(r.numTriangles) / scast<double>(prev.numTriangles));
+                break;
+            }
+        }
+    }
+
+    return mResults.size();
+}
+
+const MyArray<ImportBenchResult>& ImporterOBJBenchmark::GetResults() const {
+    return mResults;
+}
+
+json_t* ImporterOBJBenchmark::ToJsonTree() const {
+    json_t* root = json_object();
+    json_t* results = json_array();
+
+    for (const ImportBenchResult& r : mResults) {
+        json_t* jr = json_object();
+        json_object_set_new(jr, "name", json_string(r.name.c_str()));
+        json_object_set_new(jr, "triangles", json_integer(scast<json_int_t>(r.numTriangles)));
+        json_object_set_new(jr, "obj_vertices", json_integer(scast<json_int_t>(r.numObjVertices)));
+        json_object_set_new(jr, "vertices", json_integer(scast<json_int_t>(r.numVertices)));
+        json_object_set_new(jr, "weld_epsilon", json_real(r.weldEpsilon));
+        json_object_set_new(jr, "import_ms", json_real(r.importMs));
+        json_object_set_new(jr, "ns_per_triangle", json_real(r.nsPerTriangle));
+        json_object_set_new(jr, "scaling", json_real(r.scaling));
+        json_array_append_new(results, jr);
+    }
+
+    json_object_set_new(root, "results", results);
+
+    return root;
+}
+
+bool ImporterOBJBenchmark::RunSingle(const Setup& setup, const fs::path& objPath, const float weldEpsilon, const size_t numIterations, ImportBenchResult& result) const {
+    using Clock = std::chrono::high_resolution_clock;
+
+    RefPtr<MetroModelBase> model;
+    double bestMs = 0.0;
+    for (size_t iteration = 0; iteration < numIterations; ++iteration) {
+        ImporterOBJ importer;
+        importer.SetWeldEpsilon(weldEpsilon);
+
+        const auto t0 = Clock::now();
+        model = importer.ImportModel(objPath);
+        const auto t1 = Clock::now();
+
+        if (!model) {
+            return false;
+        }
+
+        const double ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+        bestMs = (iteration == 0) ? ms : std::min(bestMs, ms);
+    }
+
+    MyArray<MetroModelGeomData> gds;
+    model->CollectGeomData(gds);
+
+    size_t numVertices = 0;
+    for (const MetroModelGeomData& gd : gds) {
+        numVertices += gd.mesh->verticesCount;
+    }
+
+    result.name = setup.name;
+    result.numTriangles = setup.numTriangles;
+    result.numObjVertices = setup.numTriangles * 3;
+    result.numVertices = numVertices;
+    result.weldEpsilon = weldEpsilon;
+    result.importMs = bestMs;
+    result.nsPerTriangle = (bestMs * 1e6) / scast<double>(setup.numTriangles);
+    result.scaling = 0.0;
+
+    return true;
+}
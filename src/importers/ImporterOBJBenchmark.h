@@ -0,0 +1,52 @@
+#pragma once
+#include "mycommon.h"
+
+struct json_t;
+
+// Imports synthetic grid meshes of growing size through ImporterOBJ, parsing and vertices welding included.
+//  Every obj face has its own 3 vertices, so the welder sees 3 vertices per triangle and has to merge them back
+//  into the grid. Time per triangle should stay flat as the mesh grows, the scaling exponent between two sizes
+//  is ~1 for linear and ~2 for the quadratic welding the importers used before.
+
+struct ImportBenchResult {
+    CharString  name;
+    size_t      numTriangles;
+    size_t      numObjVertices;     // before welding
+    size_t      numVertices;        // after welding
+    float       weldEpsilon;
+    double      importMs;           // best of all iterations
+    double      nsPerTriangle;
+    double      scaling;            // log(time ratio) / log(triangles ratio) vs the previous size with the same epsilon, 0 for the first
+};
+
+class ImporterOBJBenchmark {
+public:
+    ImporterOBJBenchmark();
+    ~ImporterOBJBenchmark();
+
+    // gridSize x gridSize vertices, faces are 16 bit so gridSize is at most 255
+    bool                                AddSyntheticMesh(const size_t gridSize);
+    // 1k to 65k vertices, 2k to 129k triangles
+    void                                AddDefaultSyntheticMeshes();
+    size_t                              GetNumMeshes() const;
+
+    // every mesh is imported with every epsilon, returns number of successful runs
+    size_t                              Run(const MyArray<float>& weldEpsilons, const size_t numIterations = 1);
+
+    const MyArray<ImportBenchResult>&   GetResults() const;
+    json_t*                             ToJsonTree() const;
+
+private:
+    struct Setup {
+        CharString  name;
+        size_t      numTriangles;
+        size_t      numVertices;
+        CharString  objText;
+    };
+
+    bool                                RunSingle(const Setup& setup, const fs::path& objPath, const float weldEpsilon, const size_t numIterations, ImportBenchResult& result) const;
+
+private:
+    MyArray<Setup>                      mSetups;
+    MyArray<ImportBenchResult>          mResults;
+};
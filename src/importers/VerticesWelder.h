@@ -0,0 +1,137 @@
+#pragma once
+#include "mycommon.h"
+#include "mymath.h"
+
+// Vertices deduplication for the importers, builds the unique vertices + indices out of a triangles soup.
+//  Vertices are bucketed by their position (bit-exact with epsilon 0, or a grid of epsilon sized cells otherwise)
+//  and only compared against the candidates of their own bucket (and the neighbour cells when welding by epsilon),
+//  so it's O(1) per vertex instead of the linear search over all the collected vertices.
+//
+//  Traits need
+//      static vec3 GetPosition(const T& v);
+//      static bool IsSame(const T& a, const T& b, const float epsilon);   // epsilon 0 means exact comparison
+
+template <typename T>
+struct VerticesWelderTraits;
+
+// per component, epsilon 0 means exact comparison
+template <typename V>
+inline bool WeldEqual(const V& a, const V& b, const float epsilon) {
+    return (epsilon > 0.0f) ? glm::all(glm::lessThanEqual(glm::abs(a - b), V(epsilon))) : (a == b);
+}
+
+template <>
+struct VerticesWelderTraits<vec3> {
+    static vec3 GetPosition(const vec3& v) {
+        return v;
+    }
+
+    static bool IsSame(const vec3& a, const vec3& b, const float epsilon) {
+        return WeldEqual(a, b, epsilon);
+    }
+};
+
+template <typename T, typename Traits = VerticesWelderTraits<T>>
+struct VerticesWelder {
+    static const uint32_t kEndOfChain = ~0u;
+
+    MyArray<T>                  vertices;
+    MyArray<uint16_t>           indices;
+
+    explicit VerticesWelder(const float weldEpsilon = 0.0f)
+        : epsilon(weldEpsilon) {
+    }
+
+    void Reserve(const size_t numVertices) {
+        this->vertices.reserve(numVertices);
+        this->indices.reserve(numVertices);
+        this->chains.reserve(numVertices);
+        this->buckets.reserve(numVertices);
+    }
+
+    void AddVertex(const T& v) {
+        const vec3 pos = Traits::GetPosition(v);
+
+        uint32_t foundIdx = kEndOfChain;
+        int32_t cell[3];
+        if (epsilon > 0.0f) {
+            this->GetCell(pos, cell);
+            // candidates within epsilon may sit in any of the 27 surrounding cells
+            for (int32_t dz = -1; dz <= 1 && foundIdx == kEndOfChain; ++dz) {
+                for (int32_t dy = -1; dy <= 1 && foundIdx == kEndOfChain; ++dy) {
+                    for (int32_t dx = -1; dx <= 1 && foundIdx == kEndOfChain; ++dx) {
+                        foundIdx = this->FindInBucket(v, HashCell(cell[0] + dx, cell[1] + dy, cell[2] + dz));
+                    }
+                }
+            }
+        } else {
+            this->GetExactKey(pos, cell);
+            foundIdx = this->FindInBucket(v, HashCell(cell[0], cell[1], cell[2]));
+        }
+
+        if (foundIdx != kEndOfChain) {
+            this->indices.push_back(scast<uint16_t>(foundIdx));
+        } else {
+            const uint32_t newIdx = scast<uint32_t>(this->vertices.size());
+            const uint64_t key = HashCell(cell[0], cell[1], cell[2]);
+
+            auto it = this->buckets.find(key);
+            if (it == this->buckets.end()) {
+                this->chains.push_back(kEndOfChain);
+                this->buckets[key] = newIdx;
+            } else {
+                this->chains.push_back(it->second);
+                it->second = newIdx;
+            }
+
+            this->indices.push_back(scast<uint16_t>(newIdx));
+            this->vertices.push_back(v);
+        }
+    }
+
+private:
+    // -0 and +0 have to land into the same bucket as they are equal
+    static uint32_t FloatKey(const float f) {
+        const float positiveZero = f + 0.0f;
+        uint32_t result;
+        memcpy(&result, &positiveZero, sizeof(result));
+        return result;
+    }
+
+    void GetExactKey(const vec3& pos, int32_t (&cell)[3]) const {
+        cell[0] = scast<int32_t>(FloatKey(pos.x));
+        cell[1] = scast<int32_t>(FloatKey(pos.y));
+        cell[2] = scast<int32_t>(FloatKey(pos.z));
+    }
+
+    void GetCell(const vec3& pos, int32_t (&cell)[3]) const {
+        cell[0] = scast<int32_t>(std::floor(pos.x / epsilon));
+        cell[1] = scast<int32_t>(std::floor(pos.y / epsilon));
+        cell[2] = scast<int32_t>(std::floor(pos.z / epsilon));
+    }
+
+    static uint64_t HashCell(const int32_t x, const int32_t y, const int32_t z) {
+        uint64_t h = scast<uint32_t>(x);
+        h = (h ^ (h >> 16)) * 0x9E3779B97F4A7C15ull + scast<uint32_t>(y);
+        h = (h ^ (h >> 16)) * 0x9E3779B97F4A7C15ull + scast<uint32_t>(z);
+        return h ^ (h >> 32);
+    }
+
+    // different cells may share the hash, but IsSame sorts that out
+    uint32_t FindInBucket(const T& v, const uint64_t key) const {
+        auto it = this->buckets.find(key);
+        if (it != this->buckets.end()) {
+            for (uint32_t idx = it->second; idx != kEndOfChain; idx = this->chains[idx]) {
+                if (Traits::IsSame(this->vertices[idx], v, epsilon)) {
+                    return idx;
+                }
+            }
+        }
+        return kEndOfChain;
+    }
+
+private:
+    float                       epsilon;
+    MyDict<uint64_t, uint32_t>  buckets;    // key -> last added vertex of the bucket
+    MyArray<uint32_t>           chains;     // per vertex, previous vertex of the same bucket
+};
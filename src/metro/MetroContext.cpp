@@ -1,5 +1,6 @@
 #include "MetroContext.h"
 #include "VFXReader.h"
+#include "MetroModel.h"
 
 
 MetroContext::MetroContext()
@@ -62,6 +63,8 @@ bool MetroContext::InitFromSingleArchive(const fs::path& archivePath) {
 }
 
 void MetroContext::Shutdown() {
+    MetroModelFactory::ClearSharedCache();
+
     this->GetFilesystem().Shutdown();
     this->GetTexturesDB().Shutdown();
     this->GetConfigsDB().Shutdown();
@@ -2,6 +2,8 @@
 #include "MetroContext.h"
 #include "MetroSkeleton.h"
 #include "MetroMotion.h"
+#include "MetroModelOptimizer.h"
+#include <mutex>
 #if 0
 #include "physics/MetroPhysics.h"
 #endif
@@ -392,7 +394,51 @@ void MetroModelBase::CollectGeomData(MyArray<MetroModelGeomData>& result, const
     }
 }
 
+void MetroModelBase::CollectGeometryOwners(MetroGeometryOwners& owners) const {
+    // plain arrays, the data pointers tell who owns them
+    if (this->GetVerticesMemData()) {
+        owners.insert({ this->GetVerticesMemData(), this->GetVerticesMemSize() });
+    }
+    if (this->GetFacesMemData()) {
+        owners.insert({ this->GetFacesMemData(), this->GetFacesMemSize() });
+    }
+}
+
 void MetroModelBase::ApplyTPresetInternal(const MetroModelTPreset& tpreset) {
+    const MetroModelTPreset::Item* item = this->FindTPresetItem(tpreset);
+    if (item) {
+        if (!item->t_dst.empty()) {
+            mMaterialTexture = item->t_dst;
+        }
+        if (!item->s_dst.empty()) {
+            mMaterialShader = item->s_dst;
+        }
+    }
+}
+
+void MetroModelBase::ResetTPresetInternal() {
+    mMaterialTexture.clear();
+    mMaterialShader.clear();
+}
+
+RefPtr<MetroModelBase> MetroModelBase::Clone() const {
+    return MakeRefPtr<MetroModelBase>(*this);
+}
+
+RefPtr<MetroModelBase> MetroModelBase::CopyWithTPreset(const MetroModelTPreset& tpreset, const bool forceCopy) const {
+    RefPtr<MetroModelBase> result;
+
+    if (forceCopy || this->FindTPresetItem(tpreset) != nullptr) {
+        result = this->Clone();
+        result->ApplyTPresetInternal(tpreset);
+    }
+
+    return result;
+}
+
+const MetroModelTPreset::Item* MetroModelBase::FindTPresetItem(const MetroModelTPreset& tpreset) const {
+    const MetroModelTPreset::Item* result = nullptr;
+
     if (this->MeshValid()) {
         const CharString& mname = mMaterialStrings[kMaterialStringSrcMaterial];
         if (!mname.empty()) {
@@ -401,26 +447,23 @@ void MetroModelBase::ApplyTPresetInternal(const MetroModelTPreset& tpreset) {
             });
 
             if (iit != tpreset.items.end()) {
-                const MetroModelTPreset::Item& item = *iit;
-                if (!item.t_dst.empty()) {
-                    mMaterialTexture = item.t_dst;
-                }
-                if (!item.s_dst.empty()) {
-                    mMaterialShader = item.s_dst;
-                }
+                result = &(*iit);
             }
         }
     }
-}
 
-void MetroModelBase::ResetTPresetInternal() {
-    mMaterialTexture.clear();
-    mMaterialShader.clear();
+    return result;
 }
 
 
 
 // Simple static model, could be just a *.mesh file
+static void AddGeometryOwner(MetroGeometryOwners& owners, const SharedBytes& bytes) {
+    if (bytes.GetOwnerId()) {
+        owners.insert({ bytes.GetOwnerId(), bytes.GetOwnerSize() });
+    }
+}
+
 MetroModelStd::MetroModelStd()
     : Base()
 {
@@ -470,8 +513,7 @@ bool MetroModelStd::Load(MemStream& stream, MetroModelLoadParams& params) {
         }
 
         if (TestBit<uint32_t>(params.loadFlags, MetroModelLoadParams::LoadGeometry)) {
-            mVerticesData.resize(verticesStream.Remains());
-            verticesStream.ReadToBuffer(mVerticesData.data(), mVerticesData.size());
+            mVerticesData.Assign(verticesStream);
         }
 
         // faces
@@ -486,8 +528,7 @@ bool MetroModelStd::Load(MemStream& stream, MetroModelLoadParams& params) {
         }
 
         if (TestBit<uint32_t>(params.loadFlags, MetroModelLoadParams::LoadGeometry)) {
-            mFacesData.resize(facesStream.Remains());
-            facesStream.ReadToBuffer(mFacesData.data(), mFacesData.size());
+            mFacesData.Assign(facesStream);
         }
     }
 
@@ -509,6 +550,13 @@ bool MetroModelStd::Save(MemWriteStream& stream, const MetroModelSaveParams& par
 
         const uint16_t version = params.IsSaveForGameVersion() ? GetModelVersionFromGameVersion(params.gameVersion) : mVersion;
 
+        // optimization works on copies, the model itself stays as loaded
+        SharedBytes verticesData = mVerticesData;
+        SharedBytes facesData = mFacesData;
+        if (params.IsOptimizeGeometry()) {
+            this->OptimizeGeometry(verticesData, facesData, params.optimizeStats);
+        }
+
         // vertices
         {
             ChunkWriteHelper verticesChunk(stream, MC_VerticesChunk);
@@ -519,7 +567,7 @@ bool MetroModelStd::Save(MemWriteStream& stream, const MetroModelSaveParams& par
                 stream.WriteU16(scast<uint16_t>(mMesh->shadowVerticesCount));
             }
 
-            stream.Write(mVerticesData.data(), mVerticesData.size());
+            stream.Write(verticesData.Data(), verticesData.Size());
         }
 
         // faces
@@ -532,7 +580,7 @@ bool MetroModelStd::Save(MemWriteStream& stream, const MetroModelSaveParams& par
                 stream.WriteU32(mMesh->facesCount);
                 stream.WriteU16(scast<uint16_t>(mMesh->shadowFacesCount));
             }
-            stream.Write(mFacesData.data(), mFacesData.size());
+            stream.Write(facesData.Data(), facesData.Size());
         }
 
         result = true;
@@ -542,24 +590,62 @@ bool MetroModelStd::Save(MemWriteStream& stream, const MetroModelSaveParams& par
 }
 
 size_t MetroModelStd::GetVerticesMemSize() const {
-    return mVerticesData.size();
+    return mVerticesData.Size();
 }
 
 const void* MetroModelStd::GetVerticesMemData() const {
-    return mVerticesData.data();
+    return mVerticesData.Data();
 }
 
 size_t MetroModelStd::GetFacesMemSize() const {
-    return mFacesData.size();
+    return mFacesData.Size();
 }
 
 const void* MetroModelStd::GetFacesMemData() const {
-    return mFacesData.data();
+    return mFacesData.Data();
 }
 
 void MetroModelStd::FreeGeometryMem() {
-    mVerticesData.clear();
-    mFacesData.clear();
+    mVerticesData.Clear();
+    mFacesData.Clear();
+}
+
+void MetroModelStd::MakeGeometryUnique() {
+    mVerticesData.MutableData();
+    mFacesData.MutableData();
+}
+
+void MetroModelStd::CollectGeometryOwners(MetroGeometryOwners& owners) const {
+    AddGeometryOwner(owners, mVerticesData);
+    AddGeometryOwner(owners, mFacesData);
+}
+
+RefPtr<MetroModelBase> MetroModelStd::Clone() const {
+    return MakeRefPtr<MetroModelStd>(*this);
+}
+
+void MetroModelStd::OptimizeGeometry(SharedBytes& vertices, SharedBytes& faces, MetroGeometryOptimizeStats* stats) const {
+    const size_t verticesDataSize = mMesh->verticesCount * sizeof(VertexStatic);
+    const size_t shadowVerticesDataSize = mMesh->shadowVerticesCount * sizeof(VertexStaticShadow);
+    const size_t facesDataSize = mMesh->facesCount * sizeof(MetroFace);
+    const size_t shadowFacesDataSize = mMesh->shadowFacesCount * sizeof(MetroFace);
+    if (vertices.Size() < verticesDataSize + shadowVerticesDataSize || faces.Size() < facesDataSize + shadowFacesDataSize) {
+        return;
+    }
+
+    uint8_t* vb = vertices.MutableData();
+    uint16_t* ib = rcast<uint16_t*>(faces.MutableData());
+
+    // shadow mesh indices are local to the shadow vertices
+    MDL_OptimizeMeshGeometry(vb, mMesh->verticesCount, sizeof(VertexStatic),
+                             rcast<const float*>(vb), sizeof(VertexStatic),
+                             ib, mMesh->facesCount * 3, stats);
+
+    uint8_t* shadowVb = vb + verticesDataSize;
+    uint16_t* shadowIb = ib + mMesh->facesCount * 3;
+    MDL_OptimizeMeshGeometry(shadowVb, mMesh->shadowVerticesCount, sizeof(VertexStaticShadow),
+                             rcast<const float*>(shadowVb), sizeof(VertexStaticShadow),
+                             shadowIb, mMesh->shadowFacesCount * 3, stats);
 }
 
 // model creation
@@ -575,30 +661,30 @@ void MetroModelStd::CreateMesh(const size_t numVertices, const size_t numFaces,
     mMesh->vertexType = MetroVertexType::Static;
     mMesh->verticesScale = 1.0f;
 
-    mVerticesData.resize(numVertices * sizeof(VertexStatic) + numShadowVertices * sizeof(VertexStaticShadow));
-    mFacesData.resize(numFaces * sizeof(MetroFace) + numShadowFaces * sizeof(MetroFace));
+    mVerticesData.Resize(numVertices * sizeof(VertexStatic) + numShadowVertices * sizeof(VertexStaticShadow));
+    mFacesData.Resize(numFaces * sizeof(MetroFace) + numShadowFaces * sizeof(MetroFace));
 }
 
 void MetroModelStd::CopyVerticesData(const void* vertices) {
     const size_t verticesDataSize = mMesh->verticesCount * sizeof(VertexStatic);
-    memcpy(mVerticesData.data(), vertices, verticesDataSize);
+    memcpy(mVerticesData.MutableData(), vertices, verticesDataSize);
 }
 
 void MetroModelStd::CopyFacesData(const void* faces) {
     const size_t facesDataSize = mMesh->facesCount * sizeof(MetroFace);
-    memcpy(mFacesData.data(), faces, facesDataSize);
+    memcpy(mFacesData.MutableData(), faces, facesDataSize);
 }
 
 void MetroModelStd::CopyShadowVerticesData(const void* shadowVertices) {
     const size_t verticesDataSize = mMesh->verticesCount * sizeof(VertexStatic);
     const size_t shadowVerticesDataSize = mMesh->shadowVerticesCount * sizeof(VertexStaticShadow);
-    memcpy(mVerticesData.data() + verticesDataSize, shadowVertices, shadowVerticesDataSize);
+    memcpy(mVerticesData.MutableData() + verticesDataSize, shadowVertices, shadowVerticesDataSize);
 }
 
 void MetroModelStd::CopyShadowFacesData(const void* shadowFaces) {
     const size_t facesDataSize = mMesh->facesCount * sizeof(MetroFace);
     const size_t shadowFacesDataSize = mMesh->shadowFacesCount * sizeof(MetroFace);
-    memcpy(mFacesData.data() + facesDataSize, shadowFaces, shadowFacesDataSize);
+    memcpy(mFacesData.MutableData() + facesDataSize, shadowFaces, shadowFacesDataSize);
 }
 
 
@@ -639,8 +725,7 @@ bool MetroModelSkin::Load(MemStream& stream, MetroModelLoadParams& params) {
     mMesh->vertexType = MetroVertexType::Skin;
 
     if (TestBit<uint32_t>(params.loadFlags, MetroModelLoadParams::LoadGeometry)) {
-        mVerticesData.resize(verticesStream.Remains());
-        verticesStream.ReadToBuffer(mVerticesData.data(), mVerticesData.size());
+        mVerticesData.Assign(verticesStream);
     }
 
 
@@ -656,8 +741,7 @@ bool MetroModelSkin::Load(MemStream& stream, MetroModelLoadParams& params) {
     }
 
     if (TestBit<uint32_t>(params.loadFlags, MetroModelLoadParams::LoadGeometry)) {
-        mFacesData.resize(facesStream.Remains());
-        facesStream.ReadToBuffer(mFacesData.data(), mFacesData.size());
+        mFacesData.Assign(facesStream);
     }
 
 
@@ -679,6 +763,13 @@ bool MetroModelSkin::Save(MemWriteStream& stream, const MetroModelSaveParams& pa
 
         const uint16_t version = params.IsSaveForGameVersion() ? GetModelVersionFromGameVersion(params.gameVersion) : mVersion;
 
+        // optimization works on copies, the model itself stays as loaded
+        SharedBytes verticesData = mVerticesData;
+        SharedBytes facesData = mFacesData;
+        if (params.IsOptimizeGeometry()) {
+            this->OptimizeGeometry(verticesData, facesData, params.optimizeStats);
+        }
+
         // vertices
         {
             ChunkWriteHelper verticesChunk(stream, MC_SkinnedVerticesChunk);
@@ -694,7 +785,7 @@ bool MetroModelSkin::Save(MemWriteStream& stream, const MetroModelSaveParams& pa
 
             if (version < kModelVersionEarlyArktika1) {
                 // old versions use constant vertex scale of 12
-                const VertexSkinned* skinnedVerts = reinterpret_cast<const VertexSkinned*>(mVerticesData.data());
+                const VertexSkinned* skinnedVerts = reinterpret_cast<const VertexSkinned*>(verticesData.Data());
 
                 for (size_t i = 0; i < mMesh->verticesCount; ++i) {
                     VertexSkinned vs = skinnedVerts[i];
@@ -703,7 +794,7 @@ bool MetroModelSkin::Save(MemWriteStream& stream, const MetroModelSaveParams& pa
                     stream.Write(vs);
                 }
             } else {
-                stream.Write(mVerticesData.data(), mVerticesData.size());
+                stream.Write(verticesData.Data(), verticesData.Size());
             }
         }
 
@@ -718,7 +809,7 @@ bool MetroModelSkin::Save(MemWriteStream& stream, const MetroModelSaveParams& pa
                 stream.WriteU16(scast<uint16_t>(mMesh->shadowFacesCount));
             }
 
-            stream.Write(mFacesData.data(), mFacesData.size());
+            stream.Write(facesData.Data(), facesData.Size());
         }
     }
 
@@ -726,24 +817,74 @@ bool MetroModelSkin::Save(MemWriteStream& stream, const MetroModelSaveParams& pa
 }
 
 size_t MetroModelSkin::GetVerticesMemSize() const {
-    return mVerticesData.size();
+    return mVerticesData.Size();
 }
 
 const void* MetroModelSkin::GetVerticesMemData() const {
-    return mVerticesData.data();
+    return mVerticesData.Data();
 }
 
 size_t MetroModelSkin::GetFacesMemSize() const {
-    return mFacesData.size();
+    return mFacesData.Size();
 }
 
 const void* MetroModelSkin::GetFacesMemData() const {
-    return mFacesData.data();
+    return mFacesData.Data();
 }
 
 void MetroModelSkin::FreeGeometryMem() {
-    mVerticesData.clear();
-    mFacesData.clear();
+    mVerticesData.Clear();
+    mFacesData.Clear();
+}
+
+void MetroModelSkin::MakeGeometryUnique() {
+    mVerticesData.MutableData();
+    mFacesData.MutableData();
+}
+
+void MetroModelSkin::CollectGeometryOwners(MetroGeometryOwners& owners) const {
+    AddGeometryOwner(owners, mVerticesData);
+    AddGeometryOwner(owners, mFacesData);
+}
+
+RefPtr<MetroModelBase> MetroModelSkin::Clone() const {
+    return MakeRefPtr<MetroModelSkin>(*this);
+}
+
+template <typename T>
+static MyArray<vec3> DecodeSkinnedPositions(const T* vertices, const size_t numVertices) {
+    MyArray<vec3> result(numVertices);
+    for (size_t i = 0; i < numVertices; ++i) {
+        result[i] = DecodeSkinnedPosition(vertices[i].pos);
+    }
+    return result;
+}
+
+void MetroModelSkin::OptimizeGeometry(SharedBytes& vertices, SharedBytes& faces, MetroGeometryOptimizeStats* stats) const {
+    const size_t verticesDataSize = mMesh->verticesCount * sizeof(VertexSkinned);
+    const size_t shadowVerticesDataSize = mMesh->shadowVerticesCount * sizeof(VertexSkinnedShadow);
+    const size_t facesDataSize = mMesh->facesCount * sizeof(MetroFace);
+    const size_t shadowFacesDataSize = mMesh->shadowFacesCount * sizeof(MetroFace);
+    if (vertices.Size() < verticesDataSize + shadowVerticesDataSize || faces.Size() < facesDataSize + shadowFacesDataSize) {
+        return;
+    }
+
+    uint8_t* vb = vertices.MutableData();
+    uint16_t* ib = rcast<uint16_t*>(faces.MutableData());
+
+    // overdraw pass needs float positions, scale doesn't matter for it
+    const MyArray<vec3> positions = DecodeSkinnedPositions(rcast<const VertexSkinned*>(vb), mMesh->verticesCount);
+    MDL_OptimizeMeshGeometry(vb, mMesh->verticesCount, sizeof(VertexSkinned),
+                             rcast<const float*>(positions.data()), sizeof(vec3),
+                             ib, mMesh->facesCount * 3, stats);
+
+    // shadow mesh indices are local to the shadow vertices
+    uint8_t* shadowVb = vb + verticesDataSize;
+    uint16_t* shadowIb = ib + mMesh->facesCount * 3;
+    const MyArray<vec3> shadowPositions = DecodeSkinnedPositions(rcast<const VertexSkinnedShadow*>(shadowVb), mMesh->shadowVerticesCount);
+    MDL_OptimizeMeshGeometry(shadowVb, mMesh->shadowVerticesCount, sizeof(VertexSkinnedShadow),
+                             rcast<const float*>(shadowPositions.data()), sizeof(vec3),
+                             shadowIb, mMesh->shadowFacesCount * 3, stats);
 }
 
 MetroModelSkeleton* MetroModelSkin::GetParent() const {
@@ -773,16 +914,16 @@ void MetroModelSkin::CreateMesh(const size_t numVertices, const size_t numFaces,
     mMesh->vertexType = MetroVertexType::Skin;
     mMesh->verticesScale = vscale;
 
-    mVerticesData.resize(numVertices * sizeof(VertexSkinned));
-    mFacesData.resize(numFaces * sizeof(MetroFace));
+    mVerticesData.Resize(numVertices * sizeof(VertexSkinned));
+    mFacesData.Resize(numFaces * sizeof(MetroFace));
 }
 
 void MetroModelSkin::CopyVerticesData(const void* vertices) {
-    memcpy(mVerticesData.data(), vertices, mVerticesData.size());
+    memcpy(mVerticesData.MutableData(), vertices, mVerticesData.Size());
 }
 
 void MetroModelSkin::CopyFacesData(const void* faces) {
-    memcpy(mFacesData.data(), faces, mFacesData.size());
+    memcpy(mFacesData.MutableData(), faces, mFacesData.Size());
 }
 
 void MetroModelSkin::SetBonesRemapTable(const BytesArray& bonesRemapTable) {
@@ -828,54 +969,68 @@ bool MetroModelHierarchy::Load(MemStream& stream, MetroModelLoadParams& params)
 
             result = true;
         } else {
+            //#NOTE_SK: hacky-hack to workaround Metro bug when the model/mesh file has improper type
+            //          it has ZERO while it should have proper type
+            MetroModelLoadParams childrenLoadParams = params;
+            if (this->IsSkinnedHierarchy()) {
+                childrenLoadParams.loadFlags |= MetroModelLoadParams::LoadForceSkin;
+            }
+
+            //#NOTE_SK: children and lods are independent, so we load them all in parallel into their own slots
+            //          and then add them in the original order
+            MyArray<MemStream> streams;
+            MyArray<const MetroModelLoadParams*> streamsParams;
+
             MemStream childrenStream = chunker.GetChunkStream(MC_ChildrenChunk);
             if (childrenStream) {
                 StreamChunker childrenChunks(childrenStream);
                 const size_t childrenChunksCount = childrenChunks.GetChunksCount();
+                for (size_t i = 0; i < childrenChunksCount; ++i) {
+                    if (childrenChunks.GetChunkIDByIdx(i) == i) {
+                        streams.push_back(childrenChunks.GetChunkStreamByIdx(i));
+                        streamsParams.push_back(&childrenLoadParams);
+                    }
+                }
 
                 result = true;
+            }
 
-                //#NOTE_SK: hacky-hack to workaround Metro bug when the model/mesh file has improper type
-                //          it has ZERO while it should have proper type
-                MetroModelLoadParams childrenLoadParams = params;
-                if (this->IsSkinnedHierarchy()) {
-                    childrenLoadParams.loadFlags |= MetroModelLoadParams::LoadForceSkin;
-                }
+            const size_t numChildren = streams.size();
 
-                mChildren.reserve(childrenChunksCount);
-                for (size_t i = 0; i < childrenChunksCount; ++i) {
-                    const size_t childChunkId = childrenChunks.GetChunkIDByIdx(i);
-                    if (childChunkId == i) {
-                        MemStream childStream = childrenChunks.GetChunkStreamByIdx(i);
-                        RefPtr<MetroModelBase> child = MetroModelFactory::CreateModelFromStream(childStream, childrenLoadParams);
-                        if (child) {
-                            bool skipChild = false;
-                            if (!TestBit<uint32_t>(params.loadFlags, MetroModelLoadParams::LoadCollision) && child->IsCollisionModel()) {
-                                skipChild = true;
-                            }
+            streams.push_back(chunker.GetChunkStream(MC_Lod_1_Chunk));
+            streamsParams.push_back(&params);
+            streams.push_back(chunker.GetChunkStream(MC_Lod_2_Chunk));
+            streamsParams.push_back(&params);
 
-                            if (!skipChild) {
-                                this->AddChild(child);
-                            }
-                        } else {
-                            result = false;
-                            break;
-                        }
+            MyArray<RefPtr<MetroModelBase>> models(streams.size());
+            ParallelFor(streams.size(), [&streams, &streamsParams, &models](const size_t idx, const size_t) {
+                if (streams[idx]) {
+                    models[idx] = MetroModelFactory::CreateModelFromStream(streams[idx], *streamsParams[idx]);
+                }
+            }, params.numThreads);
+
+            mChildren.reserve(numChildren);
+            for (size_t i = 0; i < numChildren; ++i) {
+                const RefPtr<MetroModelBase>& child = models[i];
+                if (child) {
+                    bool skipChild = false;
+                    if (!TestBit<uint32_t>(params.loadFlags, MetroModelLoadParams::LoadCollision) && child->IsCollisionModel()) {
+                        skipChild = true;
                     }
+
+                    if (!skipChild) {
+                        this->AddChild(child);
+                    }
+                } else {
+                    result = false;
+                    break;
                 }
             }
 
-            MemStream lod1Stream = chunker.GetChunkStream(MC_Lod_1_Chunk);
-            RefPtr<MetroModelBase> lod1Model = lod1Stream ? MetroModelFactory::CreateModelFromStream(lod1Stream, params) : nullptr;
-
-            MemStream lod2Stream = chunker.GetChunkStream(MC_Lod_2_Chunk);
-            RefPtr<MetroModelBase> lod2Model = lod2Stream ? MetroModelFactory::CreateModelFromStream(lod2Stream, params) : nullptr;
-
-            if (lod1Model) {
-                mLods.push_back(lod1Model);
-            }
-            if (lod2Model) {
-                mLods.push_back(lod2Model);
+            for (size_t i = numChildren; i < models.size(); ++i) {
+                if (models[i]) {
+                    mLods.push_back(models[i]);
+                }
             }
         }
 
@@ -949,6 +1104,40 @@ void MetroModelHierarchy::FreeGeometryMem() {
     }
 }
 
+void MetroModelHierarchy::MakeGeometryUnique() {
+    for (auto& child : mChildren) {
+        child->MakeGeometryUnique();
+    }
+
+    for (auto& lod : mLods) {
+        lod->MakeGeometryUnique();
+    }
+}
+
+size_t MetroModelHierarchy::GetGeometryMemSize() const {
+    size_t result = 0;
+
+    for (auto& child : mChildren) {
+        result += child->GetGeometryMemSize();
+    }
+
+    for (auto& lod : mLods) {
+        result += lod->GetGeometryMemSize();
+    }
+
+    return result;
+}
+
+void MetroModelHierarchy::CollectGeometryOwners(MetroGeometryOwners& owners) const {
+    for (auto& child : mChildren) {
+        child->CollectGeometryOwners(owners);
+    }
+
+    for (auto& lod : mLods) {
+        lod->CollectGeometryOwners(owners);
+    }
+}
+
 void MetroModelHierarchy::CollectGeomData(MyArray<MetroModelGeomData>& result, const size_t lodIdx) const {
     if (kInvalidValue == lodIdx) {
         for (auto& child : mChildren) {
@@ -1114,6 +1303,41 @@ void MetroModelHierarchy::ResetTPresetInternal() {
     }
 }
 
+RefPtr<MetroModelBase> MetroModelHierarchy::Clone() const {
+    return MakeRefPtr<MetroModelHierarchy>(*this);
+}
+
+RefPtr<MetroModelBase> MetroModelHierarchy::CopyWithTPreset(const MetroModelTPreset& tpreset, const bool forceCopy) const {
+    MyArray<ModelPtr> children(mChildren.size()), lods(mLods.size());
+
+    bool changed = forceCopy;
+    for (size_t i = 0; i < mChildren.size(); ++i) {
+        children[i] = mChildren[i]->CopyWithTPreset(tpreset, forceCopy);
+        changed = changed || (children[i] != nullptr);
+    }
+    for (size_t i = 0; i < mLods.size(); ++i) {
+        lods[i] = mLods[i]->CopyWithTPreset(tpreset, forceCopy);
+        changed = changed || (lods[i] != nullptr);
+    }
+
+    RefPtr<MetroModelHierarchy> result;
+    if (changed) {
+        result = SCastRefPtr<MetroModelHierarchy>(this->Clone());
+        for (size_t i = 0; i < children.size(); ++i) {
+            if (children[i]) {
+                result->mChildren[i] = children[i];
+            }
+        }
+        for (size_t i = 0; i < lods.size(); ++i) {
+            if (lods[i]) {
+                result->mLods[i] = lods[i];
+            }
+        }
+    }
+
+    return result;
+}
+
 
 // Complete animated model, can consist of multiple Skin models (inline or external *.mesh files)
 MetroModelSkeleton::MetroModelSkeleton()
@@ -1182,23 +1406,18 @@ bool MetroModelSkeleton::Load(MemStream& stream, MetroModelLoadParams& params) {
         meshesLoadParams.treplacements = mTReplacements;
     }
 
+    MyArray<LodMeshTask> lodTasks;
+    bool lodPresent[3] = { false, false, false };
+    bool lodCollected[3] = { false, false, false };
+
     MemStream meshesLinksStream = chunker.GetChunkStream(MC_MeshesLinks);
     if (meshesLinksStream) {
         const size_t numStrings = meshesLinksStream.ReadU32();  // not used ???
         mLodMeshes.resize(3);
         for (size_t i = 0; i < 3; ++i) {
             CharString meshesNames = meshesLinksStream.ReadStringZ();
-            if (!i) {
-                if (!this->LoadLodMeshes(this, meshesNames, meshesLoadParams, i)) {
-                    result = false;
-                    break;
-                }
-            } else {
-                RefPtr<MetroModelHierarchy> lodModel = SCastRefPtr<MetroModelHierarchy>(MetroModelFactory::CreateModelFromType(MetroModelType::Hierarchy2));
-                if (this->LoadLodMeshes(lodModel.get(), meshesNames, meshesLoadParams, i)) {
-                    mLods.push_back(lodModel);
-                }
-            }
+            lodPresent[i] = true;
+            lodCollected[i] = this->CollectLodMeshes(lodTasks, meshesNames, meshesLoadParams, i);
         }
     } else {
         MemStream meshesStream = chunker.GetChunkStream(MC_MeshesInline);
@@ -1208,22 +1427,43 @@ bool MetroModelSkeleton::Load(MemStream& stream, MetroModelLoadParams& params) {
             for (size_t i = 0; i < 3 && i < lodsChunks.GetChunksCount(); ++i) {
                 if (lodsChunks.GetChunkIDByIdx(i) == i) {
                     MemStream lodStream = lodsChunks.GetChunkStreamByIdx(i);
-                    if (!i) {
-                        if (!this->LoadLodMeshes(this, lodStream, meshesLoadParams, i)) {
-                            result = false;
-                            break;
-                        }
-                    } else {
-                        RefPtr<MetroModelHierarchy> lodModel = SCastRefPtr<MetroModelHierarchy>(MetroModelFactory::CreateModelFromType(MetroModelType::Hierarchy2));
-                        if (this->LoadLodMeshes(lodModel.get(), lodStream, meshesLoadParams, i)) {
-                            mLods.push_back(lodModel);
-                        }
-                    }
+                    lodPresent[i] = true;
+                    lodCollected[i] = this->CollectLodMeshes(lodTasks, lodStream, meshesLoadParams, i);
                 }
             }
         }
     }
 
+    //#NOTE_SK: every task only touches its own slot, inline streams point into our source stream which outlives this
+    ParallelFor(lodTasks.size(), [this, &lodTasks](const size_t idx, const size_t) {
+        this->LoadLodMesh(lodTasks[idx]);
+    }, params.numThreads);
+
+    // lod0 meshes go straight to us, lod1 and lod2 get their own hierarchies
+    for (size_t i = 0, taskIdx = 0; i < 3; ++i) {
+        if (!lodPresent[i]) {
+            continue;
+        }
+
+        RefPtr<MetroModelHierarchy> lodModel = i ? SCastRefPtr<MetroModelHierarchy>(MetroModelFactory::CreateModelFromType(MetroModelType::Hierarchy2)) : nullptr;
+        MetroModelHierarchy* target = i ? lodModel.get() : this;
+
+        bool lodLoaded = true;
+        for (; taskIdx < lodTasks.size() && lodTasks[taskIdx].lodIdx == i; ++taskIdx) {
+            lodLoaded = lodLoaded && this->AttachLodMesh(target, lodTasks[taskIdx]);
+        }
+        lodLoaded = lodLoaded && lodCollected[i];
+
+        if (!i) {
+            if (!lodLoaded) {
+                result = false;
+                break;
+            }
+        } else if (lodLoaded) {
+            mLods.push_back(lodModel);
+        }
+    }
+
     MemStream hitpmtlsStream = chunker.GetChunkStream(MC_HitPresetAndMtls);
     if (hitpmtlsStream) {
         if (mVersion >= kModelVersion2033) {
@@ -1532,6 +1772,42 @@ size_t MetroModelSkeleton::GetLodCount() const {
     return mLodMeshes.size();
 }
 
+RefPtr<MetroModelBase> MetroModelSkeleton::Clone() const {
+    return MakeRefPtr<MetroModelSkeleton>(*this);
+}
+
+RefPtr<MetroModelBase> MetroModelSkeleton::CopyWithTPreset(const MetroModelTPreset& tpreset, const bool forceCopy) const {
+    //#NOTE_SK: skins point back to their skeleton, so we can't share them between two skeletons,
+    //          once anything changes - everything gets copied
+    bool changed = forceCopy;
+    for (size_t i = 0; i < mChildren.size() && !changed; ++i) {
+        changed = (mChildren[i]->FindTPresetItem(tpreset) != nullptr);
+    }
+    for (size_t i = 0; i < mLods.size() && !changed; ++i) {
+        const MetroModelHierarchy* lod = scast<const MetroModelHierarchy*>(mLods[i].get());
+        for (size_t j = 0; j < lod->GetChildrenCount() && !changed; ++j) {
+            changed = (lod->GetChild(j)->FindTPresetItem(tpreset) != nullptr);
+        }
+    }
+
+    RefPtr<MetroModelSkeleton> result;
+    if (changed) {
+        result = SCastRefPtr<MetroModelSkeleton>(Base::CopyWithTPreset(tpreset, true));
+        for (auto& child : result->mChildren) {
+            SCastRefPtr<MetroModelSkin>(child)->SetParent(result.get());
+        }
+        for (auto& lod : result->mLods) {
+            RefPtr<MetroModelHierarchy> hm = SCastRefPtr<MetroModelHierarchy>(lod);
+            for (size_t j = 0; j < hm->GetChildrenCount(); ++j) {
+                SCastRefPtr<MetroModelSkin>(hm->GetChild(j))->SetParent(result.get());
+            }
+        }
+        //#NOTE_SK: mLodMeshes are only needed for saving and stay shared with the source model
+    }
+
+    return result;
+}
+
 const RefPtr<MetroSkeleton>& MetroModelSkeleton::GetSkeleton() const {
     return mSkeleton;
 }
@@ -1565,14 +1841,68 @@ void MetroModelSkeleton::AddChildEx(const RefPtr<MetroModelBase>& child) {
     MetroModelHierarchy::AddChild(child);
 }
 
-bool MetroModelSkeleton::LoadLodMeshes(MetroModelHierarchy* target, CharString& meshesNames, MetroModelLoadParams& params, const size_t lodIdx) {
+void MetroModelSkeleton::AddLodMesh(const size_t lodIdx, const RefPtr<MetroModelHierarchy>& lodMesh) {
+    assert(lodIdx < 3 && lodIdx <= mLods.size() + 1);
+    if (lodIdx >= 3 || lodIdx > mLods.size() + 1 || !lodMesh) {
+        return;
+    }
+
+    if (mLodMeshes.size() < 3) {
+        mLodMeshes.resize(3);
+    }
+    mLodMeshes[lodIdx].push_back(lodMesh);
+
+    // same as loading does, lod0 parts are our children, the other lods get their own hierarchies
+    if (lodIdx > mLods.size()) {
+        MetroModelHierarchy::AddLOD(MetroModelFactory::CreateModelFromType(MetroModelType::Hierarchy2));
+    }
+    MetroModelHierarchy* target = lodIdx ? scast<MetroModelHierarchy*>(mLods[lodIdx - 1].get()) : this;
+
+    const size_t childrenCount = lodMesh->GetChildrenCount();
+    for (size_t i = 0; i < childrenCount; ++i) {
+        const RefPtr<MetroModelBase>& child = lodMesh->GetChild(i);
+        SCastRefPtr<MetroModelSkin>(child)->SetParent(this);
+        target->AddChild(child);
+    }
+}
+
+void MetroModelSkeleton::AddLOD(const RefPtr<MetroModelBase>& lod) {
+    const size_t lodIdx = mLods.size() + 1;
+    assert(lodIdx < 3);
+    if (lodIdx >= 3) {
+        return;
+    }
+
+    //#NOTE_SK: Save always goes through all 3 lod slots
+    if (mLodMeshes.size() < 3) {
+        mLodMeshes.resize(3);
+    }
+    mLodMeshes[lodIdx] = { lod };
+
+    RefPtr<MetroModelHierarchy> hm = SCastRefPtr<MetroModelHierarchy>(lod);
+    const size_t childrenCount = hm->GetChildrenCount();
+    for (size_t i = 0; i < childrenCount; ++i) {
+        SCastRefPtr<MetroModelSkin>(hm->GetChild(i))->SetParent(this);
+    }
+
+    MetroModelHierarchy::AddLOD(lod);
+}
+
+void MetroModelSkeleton::RemoveLODs() {
+    for (size_t i = 1; i < mLodMeshes.size(); ++i) {
+        mLodMeshes[i].clear();
+    }
+
+    MetroModelHierarchy::RemoveLODs();
+}
+
+bool MetroModelSkeleton::CollectLodMeshes(MyArray<LodMeshTask>& tasks, CharString& meshesNames, const MetroModelLoadParams& params, const size_t lodIdx) const {
     bool result = true;
 
     MyArray<StringView> names = StrSplitViews(meshesNames, ',');
     if (!names.empty()) {
+        MetroFileSystem& mfs = MetroContext::Get().GetFilesystem();
         for (StringView n : names) {
-            MetroFileSystem& mfs = MetroContext::Get().GetFilesystem();
-
             MetroFSPath file(MetroFSPath::Invalid);
             if (n[0] == '.' && n[1] == kPathSeparator) { // relative path
                 MetroFSPath folder = mfs.GetParentFolder(params.srcFile);
@@ -1583,14 +1913,9 @@ bool MetroModelSkeleton::LoadLodMeshes(MetroModelHierarchy* target, CharString&
             }
 
             if (file.IsValid()) {
-                MemStream stream = mfs.OpenFileStream(file);
-                stream.SetName(mfs.GetName(file));
-                MetroModelLoadParams loadParams = params;
-                loadParams.srcFile = file;
-                if (!this->LoadLodMesh(target, stream, loadParams, lodIdx)) {
-                    result = false;
-                    break;
-                }
+                LodMeshTask task = { lodIdx, file, MemStream(), params, nullptr, false };
+                task.params.srcFile = file;
+                tasks.push_back(task);
             } else {
                 assert(false);
             }
@@ -1602,7 +1927,7 @@ bool MetroModelSkeleton::LoadLodMeshes(MetroModelHierarchy* target, CharString&
     return result;
 }
 
-bool MetroModelSkeleton::LoadLodMeshes(MetroModelHierarchy* target, MemStream& meshesStream, MetroModelLoadParams& params, const size_t lodIdx) {
+bool MetroModelSkeleton::CollectLodMeshes(MyArray<LodMeshTask>& tasks, MemStream& meshesStream, const MetroModelLoadParams& params, const size_t lodIdx) const {
     bool result = true;
 
     StreamChunker chunker(meshesStream);
@@ -1613,11 +1938,8 @@ bool MetroModelSkeleton::LoadLodMeshes(MetroModelHierarchy* target, MemStream& m
                 break;
             }
 
-            MemStream stream = chunker.GetChunkStreamByIdx(i);
-            if (!this->LoadLodMesh(target, stream, params, lodIdx)) {
-                result = false;
-                break;
-            }
+            LodMeshTask task = { lodIdx, MetroFSPath(MetroFSPath::Invalid), chunker.GetChunkStreamByIdx(i), params, nullptr, false };
+            tasks.push_back(task);
         }
     } else {
         result = false;
@@ -1626,39 +1948,51 @@ bool MetroModelSkeleton::LoadLodMeshes(MetroModelHierarchy* target, MemStream& m
     return result;
 }
 
-bool MetroModelSkeleton::LoadLodMesh(MetroModelHierarchy* target, MemStream& stream, MetroModelLoadParams& params, const size_t lodIdx) {
-    bool result = false;
+// runs on worker threads, must not touch anything but the task
+void MetroModelSkeleton::LoadLodMesh(LodMeshTask& task) const {
+    if (task.file.IsValid()) {
+        const MetroFileSystem& mfs = MetroContext::Get().GetFilesystem();
+        task.stream = mfs.OpenFileStream(task.file);
+        task.stream.SetName(mfs.GetName(task.file));
+    }
 
-    if (stream) {
+    if (task.stream) {
         //#NOTE_SK: 4A Engine is actually checking it at this moment, and so do I
-        StreamChunker chunker(stream);
+        StreamChunker chunker(task.stream);
         MemStream bonesCRCStream = chunker.GetChunkStream(MC_SkeletonBonesCRC);
         const uint32_t meshBonesCRC = bonesCRCStream.ReadU32();
         if (meshBonesCRC == this->GetSkeleton()->GetBonesCRC()) {
-            MetroModelLoadParams loadParams = params;
+            MetroModelLoadParams loadParams = task.params;
             //#NOTE_SK: for some weird reason some of the child meshes have empty header (all nulls, still 64 bytes)
             //          so we detect it as static mesh and fail miserably, so now we enforce skinned hierarchy mesh type
             loadParams.loadFlags |= MetroModelLoadParams::LoadForceSkinH;
 
-            RefPtr<MetroModelBase> mesh = MetroModelFactory::CreateModelFromStream(stream, loadParams);
-            if (mesh) {
-                //#NOTE_SK: are we sure it's always hierarchy/skeleton ?
-                RefPtr<MetroModelHierarchy> hm = SCastRefPtr<MetroModelHierarchy>(mesh);
-                const size_t childrenCount = hm->GetChildrenCount();
-                for (size_t i = 0; i < childrenCount; ++i) {
-                    //#NOTE_SK: are we sure it's always skin mesh ?
-                    RefPtr<MetroModelSkin> child = SCastRefPtr<MetroModelSkin>(hm->GetChild(i));
-                    target->AddChild(child);
-                    child->SetParent(this);
-                }
+            task.mesh = MetroModelFactory::CreateModelFromStream(task.stream, loadParams);
+        } else {
+            task.badBonesCRC = true;
+        }
+    }
+}
 
-                mLodMeshes[lodIdx].push_back(mesh);
+bool MetroModelSkeleton::AttachLodMesh(MetroModelHierarchy* target, const LodMeshTask& task) {
+    bool result = false;
 
-                result = true;
-            }
-        } else {
-            LogPrint(LogLevel::Error, "Can't load skinned lod mesh, invalid mesh bones!");
+    if (task.mesh) {
+        //#NOTE_SK: are we sure it's always hierarchy/skeleton ?
+        RefPtr<MetroModelHierarchy> hm = SCastRefPtr<MetroModelHierarchy>(task.mesh);
+        const size_t childrenCount = hm->GetChildrenCount();
+        for (size_t i = 0; i < childrenCount; ++i) {
+            //#NOTE_SK: are we sure it's always skin mesh ?
+            RefPtr<MetroModelSkin> child = SCastRefPtr<MetroModelSkin>(hm->GetChild(i));
+            target->AddChild(child);
+            child->SetParent(this);
         }
+
+        mLodMeshes[task.lodIdx].push_back(task.mesh);
+
+        result = true;
+    } else if (task.badBonesCRC) {
+        LogPrint(LogLevel::Error, "Can't load skinned lod mesh, invalid mesh bones!");
     }
 
     return result;
@@ -1732,6 +2066,10 @@ const void* MetroModelSoft::GetFacesMemData() const {
 void MetroModelSoft::FreeGeometryMem() {
 }
 
+RefPtr<MetroModelBase> MetroModelSoft::Clone() const {
+    return MakeRefPtr<MetroModelSoft>(*this);
+}
+
 
 MetroClothModel::MetroClothModel()
     : mFormat(0)
@@ -1921,14 +2259,11 @@ RefPtr<MetroModelBase> MetroModelFactory::CreateModelFromFile(const MetroFSPath&
     }
 }
 
-RefPtr<MetroModelBase> MetroModelFactory::CreateModelFromFullName(const CharString& fullName, const uint32_t loadFlags) {
-    // break full name into:
-    //  model name
-    //  tpreset name
-    //  modifier name (???)
-
-    CharString modelName, tpresetName, modifierName;
-
+// break full name into:
+//  model name
+//  tpreset name
+//  modifier name (???)
+static void SplitModelFullName(const CharString& fullName, CharString& modelName, CharString& tpresetName, CharString& modifierName) {
     size_t atPos = fullName.find('@');
     if (atPos != CharString::npos) {
         modelName = fullName.substr(0, atPos);
@@ -1942,6 +2277,11 @@ RefPtr<MetroModelBase> MetroModelFactory::CreateModelFromFullName(const CharStri
     } else {
         modelName = fullName;
     }
+}
+
+RefPtr<MetroModelBase> MetroModelFactory::CreateModelFromFullName(const CharString& fullName, const uint32_t loadFlags) {
+    CharString modelName, tpresetName, modifierName;
+    SplitModelFullName(fullName, modelName, tpresetName, modifierName);
 
     CharString fullPath = MetroFileSystem::Paths::MeshesFolder + modelName + ".model";
     MetroFSPath file = MetroContext::Get().GetFilesystem().FindFile(fullPath);
@@ -1963,3 +2303,183 @@ RefPtr<MetroModelBase> MetroModelFactory::CreateModelFromFullName(const CharStri
     return nullptr;
 }
 
+
+// shared models cache
+static const size_t kDefaultSharedModelsBudget = 512 * 1024 * 1024;
+
+struct SharedModelsCache {
+    struct Entry {
+        RefPtr<MetroModelBase>  model;
+        size_t                  memSize;
+        size_t                  lastUse;
+    };
+
+    std::mutex                  lock;
+    MyDict<CharString, Entry>   entries;
+    size_t                      useCounter = 0;
+    MetroModelCacheStats        stats = { 0, 0, kDefaultSharedModelsBudget, 0, 0, 0, 0 };
+};
+
+static SharedModelsCache sSharedModels;
+
+// drops least recently used models until we fit the budget, never the one we've just added
+static void EvictSharedModels(SharedModelsCache& cache, const CharString& keepKey) {
+    while (cache.stats.memUsed > cache.stats.memBudget && cache.entries.size() > 1) {
+        auto oldest = cache.entries.end();
+        for (auto it = cache.entries.begin(); it != cache.entries.end(); ++it) {
+            if (it->first != keepKey && (oldest == cache.entries.end() || it->second.lastUse < oldest->second.lastUse)) {
+                oldest = it;
+            }
+        }
+
+        cache.stats.memUsed -= oldest->second.memSize;
+        cache.entries.erase(oldest);
+        ++cache.stats.evictions;
+    }
+
+    cache.stats.numModels = cache.entries.size();
+}
+
+static size_t GetGeometryOwnersSize(const MetroGeometryOwners& owners) {
+    size_t result = 0;
+    for (const auto& it : owners) {
+        result += it.second;
+    }
+    return result;
+}
+
+// a tpreset copy clones the nodes, but their geometry still lives in the buffers of the source, paid for by the source entry
+static size_t GetTPresetCopyMemSize(const MetroModelBase* copy, const MetroModelBase* source) {
+    MetroGeometryOwners sourceOwners, copyOwners;
+    source->CollectGeometryOwners(sourceOwners);
+    copy->CollectGeometryOwners(copyOwners);
+
+    size_t result = 0;
+    for (const auto& it : copyOwners) {
+        if (sourceOwners.find(it.first) == sourceOwners.end()) {
+            result += it.second;
+        }
+    }
+
+    return result;
+}
+
+RefPtr<MetroModelBase> MetroModelFactory::GetSharedModelFromFile(const MetroFSPath& file, const uint32_t loadFlags, const CharString& tpresetName) {
+    const MetroFileSystem& mfs = MetroContext::Get().GetFilesystem();
+    const CharString key = mfs.GetFullPath(file) + '|' + std::to_string(loadFlags) + '|' + tpresetName;
+
+    SharedModelsCache& cache = sSharedModels;
+    {
+        std::lock_guard<std::mutex> guard(cache.lock);
+        auto it = cache.entries.find(key);
+        if (it != cache.entries.end()) {
+            it->second.lastUse = ++cache.useCounter;
+            ++cache.stats.hits;
+            return it->second.model;
+        }
+
+        ++cache.stats.misses;
+    }
+
+    //#NOTE_SK: models are loaded outside of the lock, so two threads could load the same one,
+    //          first one to finish wins and the other one just uses it
+    RefPtr<MetroModelBase> model;
+    size_t memSize = 0;
+    bool isTPresetCopy = false;
+    if (!tpresetName.empty()) {
+        // copy-on-write from the plain model, so all the tpresets of the same model share the geometry that doesn't change
+        RefPtr<MetroModelBase> source = MetroModelFactory::GetSharedModelFromFile(file, loadFlags | MetroModelLoadParams::LoadTPresets);
+        if (source) {
+            model = MetroModelFactory::ApplyTPresetShared(source, tpresetName);
+            memSize = (model != source) ? GetTPresetCopyMemSize(model.get(), source.get()) : 0;
+            isTPresetCopy = true;
+        }
+    } else {
+        MemStream stream = mfs.OpenFileStream(file);
+        if (stream) {
+            MetroModelLoadParams params = {
+                kEmptyString,
+                kEmptyString,
+                0,
+                loadFlags,
+                file
+            };
+            model = MetroModelFactory::CreateModelFromStream(stream, params);
+            if (model) {
+                MetroGeometryOwners owners;
+                model->CollectGeometryOwners(owners);
+                memSize = GetGeometryOwnersSize(owners);
+            }
+        }
+    }
+
+    if (model) {
+        std::lock_guard<std::mutex> guard(cache.lock);
+        auto it = cache.entries.find(key);
+        if (it != cache.entries.end()) {
+            model = it->second.model;
+        } else {
+            cache.entries.insert({ key, { model, memSize, ++cache.useCounter } });
+            cache.stats.memUsed += memSize;
+            if (isTPresetCopy) {
+                ++cache.stats.tpresetCopies;
+            }
+
+            EvictSharedModels(cache, key);
+        }
+    }
+
+    return model;
+}
+
+RefPtr<MetroModelBase> MetroModelFactory::GetSharedModelFromFullName(const CharString& fullName, const uint32_t loadFlags) {
+    CharString modelName, tpresetName, modifierName;
+    SplitModelFullName(fullName, modelName, tpresetName, modifierName);
+
+    CharString fullPath = MetroFileSystem::Paths::MeshesFolder + modelName + ".model";
+    MetroFSPath file = MetroContext::Get().GetFilesystem().FindFile(fullPath);
+    if (file.IsValid()) {
+        return MetroModelFactory::GetSharedModelFromFile(file, loadFlags, tpresetName);
+    }
+
+    return nullptr;
+}
+
+RefPtr<MetroModelBase> MetroModelFactory::ApplyTPresetShared(const RefPtr<MetroModelBase>& model, const CharString& tpresetName) {
+    RefPtr<MetroModelBase> result = model;
+
+    if (model && model->IsHierarchy()) {
+        const MetroModelHierarchy* hierarchy = scast<const MetroModelHierarchy*>(model.get());
+        for (size_t i = 0; i < hierarchy->GetNumTPresets(); ++i) {
+            const MetroModelTPreset& tpreset = hierarchy->GetTPreset(i);
+            if (tpreset.name == tpresetName) {
+                RefPtr<MetroModelBase> copy = model->CopyWithTPreset(tpreset, false);
+                if (copy) {
+                    result = copy;
+                }
+                break;
+            }
+        }
+    }
+
+    return result;
+}
+
+void MetroModelFactory::SetSharedCacheBudget(const size_t budgetInBytes) {
+    std::lock_guard<std::mutex> guard(sSharedModels.lock);
+    sSharedModels.stats.memBudget = budgetInBytes;
+    EvictSharedModels(sSharedModels, kEmptyString);
+}
+
+void MetroModelFactory::ClearSharedCache() {
+    std::lock_guard<std::mutex> guard(sSharedModels.lock);
+    sSharedModels.entries.clear();
+    sSharedModels.stats.numModels = 0;
+    sSharedModels.stats.memUsed = 0;
+}
+
+MetroModelCacheStats MetroModelFactory::GetSharedCacheStats() {
+    std::lock_guard<std::mutex> guard(sSharedModels.lock);
+    return sSharedModels.stats;
+}
+
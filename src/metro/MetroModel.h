@@ -3,6 +3,7 @@
 
 class MetroSkeleton;
 class MetroMotion;
+struct MetroGeometryOptimizeStats;
 
 using MetroModelTReplacements = MyDict<CharString, CharString>;
 
@@ -27,6 +28,7 @@ struct MetroModelLoadParams {
     uint32_t                loadFlags;
     MetroFSPath             srcFile;
     MetroModelTReplacements treplacements;
+    size_t                  numThreads = 0;     // for the lod meshes and children, 0 - all hardware threads, 1 - serial
 };
 
 struct MetroModelSaveParams {
@@ -34,11 +36,13 @@ struct MetroModelSaveParams {
         SaveForGameVersion  = 1,
         InlineMeshes        = 2,
         InlineSkeleton      = 8,
+        OptimizeGeometry    = 16,   // vertex cache, overdraw and vertex fetch reordering (see MetroModelOptimizer.h)
     };
 
-    fs::path            dstFile;
-    uint32_t            saveFlags = 0;
-    MetroGameVersion    gameVersion = MetroGameVersion::Unknown;
+    fs::path                    dstFile;
+    uint32_t                    saveFlags = 0;
+    MetroGameVersion            gameVersion = MetroGameVersion::Unknown;
+    MetroGeometryOptimizeStats* optimizeStats = nullptr;    // optional, accumulated over all saved meshes
 
     inline bool IsSaveForGameVersion() const {
         return TestBit<uint32_t>(saveFlags, SaveFlags::SaveForGameVersion);
@@ -49,6 +53,9 @@ struct MetroModelSaveParams {
     inline bool IsInlineSkeleton() const {
         return TestBit<uint32_t>(saveFlags, SaveFlags::InlineSkeleton);
     }
+    inline bool IsOptimizeGeometry() const {
+        return TestBit<uint32_t>(saveFlags, SaveFlags::OptimizeGeometry);
+    }
 };
 
 struct MetroModelTPreset {
@@ -109,6 +116,9 @@ struct MetroModelGeomData {
     const void*             faces;
 };
 
+// memory blocks the geometry lives in -> their whole size, so the blocks shared by many meshes (or models) count once
+using MetroGeometryOwners = MyDict<const void*, size_t>;
+
 enum class MetroModelType : size_t {
     Std             = 0,
     Hierarchy       = 1,
@@ -131,6 +141,7 @@ class MetroModelBase {
     friend class MetroModelHierarchy;
     friend class MetroModelSkeleton;
     friend class MetroModelSoft;
+    friend class MetroModelFactory;
 
 public:
     static const size_t kMaterialStringTexture      = 0;
@@ -189,6 +200,11 @@ public:
     virtual const void*             GetFacesMemData() const     { return nullptr; }
 
     virtual void                    FreeGeometryMem()           { }
+    // geometry may be a read-only view into the source file, call this before modifying vertices/faces in place
+    virtual void                    MakeGeometryUnique()        { }
+    virtual size_t                  GetGeometryMemSize() const  { return this->GetVerticesMemSize() + this->GetFacesMemSize(); }
+    // what the geometry really keeps alive, a view into the source file keeps the whole file
+    virtual void                    CollectGeometryOwners(MetroGeometryOwners& owners) const;
 
     virtual void                    CollectGeomData(MyArray<MetroModelGeomData>& result, const size_t lodIdx = kInvalidValue) const;
 
@@ -201,6 +217,12 @@ protected:
     virtual void                    ApplyTPresetInternal(const MetroModelTPreset& tpreset);
     virtual void                    ResetTPresetInternal();
 
+    // copy-on-write for shared models, returns nullptr if tpreset changes nothing in this model (and forceCopy is false),
+    //  otherwise a copy with tpreset applied that shares all the untouched children with us
+    virtual RefPtr<MetroModelBase>  Clone() const;
+    virtual RefPtr<MetroModelBase>  CopyWithTPreset(const MetroModelTPreset& tpreset, const bool forceCopy) const;
+    const MetroModelTPreset::Item*  FindTPresetItem(const MetroModelTPreset& tpreset) const;
+
 protected:
     uint16_t                        mVersion;
     uint16_t                        mType;
@@ -236,6 +258,8 @@ public:
     virtual const void*     GetFacesMemData() const override;
 
     virtual void            FreeGeometryMem() override;
+    virtual void            MakeGeometryUnique() override;
+    virtual void            CollectGeometryOwners(MetroGeometryOwners& owners) const override;
 
     // model creation
     void                    CreateMesh(const size_t numVertices, const size_t numFaces, const size_t numShadowVertices, const size_t numShadowFaces);
@@ -245,8 +269,12 @@ public:
     void                    CopyShadowFacesData(const void* shadowFaces);
 
 protected:
-    BytesArray              mVerticesData;
-    BytesArray              mFacesData;
+    virtual RefPtr<MetroModelBase> Clone() const override;
+    void                    OptimizeGeometry(SharedBytes& vertices, SharedBytes& faces, MetroGeometryOptimizeStats* stats) const;
+
+protected:
+    SharedBytes             mVerticesData;  // views into the source file until modified
+    SharedBytes             mFacesData;
 };
 
 // Simple skinned model, could be just a *.mesh file
@@ -265,6 +293,8 @@ public:
     virtual const void*     GetFacesMemData() const override;
 
     virtual void            FreeGeometryMem() override;
+    virtual void            MakeGeometryUnique() override;
+    virtual void            CollectGeometryOwners(MetroGeometryOwners& owners) const override;
 
     MetroModelSkeleton*     GetParent() const;
     void                    SetParent(MetroModelSkeleton* parent);
@@ -279,10 +309,14 @@ public:
     void                    SetBonesRemapTable(const BytesArray& bonesRemapTable);
     void                    SetBonesOBB(const MyArray<OBBox>& bonesOBB);
 
+protected:
+    virtual RefPtr<MetroModelBase> Clone() const override;
+    void                    OptimizeGeometry(SharedBytes& vertices, SharedBytes& faces, MetroGeometryOptimizeStats* stats) const;
+
 protected:
     MetroModelSkeleton*     mParent;
-    BytesArray              mVerticesData;
-    BytesArray              mFacesData;
+    SharedBytes             mVerticesData;  // views into the source file until modified
+    SharedBytes             mFacesData;
 };
 
 // Complete static model, can consist of multiple Std models (inline or external *.mesh files)
@@ -299,6 +333,9 @@ public:
     virtual RefPtr<MetroModelBase>  GetLod(const size_t idx) const override;
 
     virtual void                    FreeGeometryMem() override;
+    virtual void                    MakeGeometryUnique() override;
+    virtual size_t                  GetGeometryMemSize() const override;
+    virtual void                    CollectGeometryOwners(MetroGeometryOwners& owners) const override;
 
     virtual void                    CollectGeomData(MyArray<MetroModelGeomData>& result, const size_t lodIdx = kInvalidValue) const override;
 
@@ -331,6 +368,8 @@ protected:
     void                            SaveTPresets(MemWriteStream& stream, const uint16_t version);
     virtual void                    ApplyTPresetInternal(const MetroModelTPreset& tpreset) override;
     virtual void                    ResetTPresetInternal() override;
+    virtual RefPtr<MetroModelBase>  Clone() const override;
+    virtual RefPtr<MetroModelBase>  CopyWithTPreset(const MetroModelTPreset& tpreset, const bool forceCopy) const override;
 
 protected:
     using ModelPtr = RefPtr<MetroModelBase>;
@@ -376,11 +415,32 @@ public:
     void                    SetPhysXLinks(const StringArray& newLinks);
 
     void                    AddChildEx(const RefPtr<MetroModelBase>& child);
+    // one more mesh of the lod (a Hierarchy2 of Skin meshes), saved to its own *.mesh file with external meshes,
+    //  characters are usually split into many of them, lods have to be added in order
+    void                    AddLodMesh(const size_t lodIdx, const RefPtr<MetroModelHierarchy>& lodMesh);
+    // lod is a Hierarchy2 of Skin meshes, goes to both mLods and mLodMeshes (lod1 and lod2 only)
+    virtual void            AddLOD(const RefPtr<MetroModelBase>& lod) override;
+    virtual void            RemoveLODs() override;
 
 protected:
-    bool                    LoadLodMeshes(MetroModelHierarchy* target, CharString& meshesNames, MetroModelLoadParams& params, const size_t lodIdx);
-    bool                    LoadLodMeshes(MetroModelHierarchy* target, MemStream& meshesStream, MetroModelLoadParams& params, const size_t lodIdx);
-    bool                    LoadLodMesh(MetroModelHierarchy* target, MemStream& stream, MetroModelLoadParams& params, const size_t lodIdx);
+    // lod meshes are independent from each other, so they are loaded in parallel
+    //  and then attached in the original order
+    struct LodMeshTask {
+        size_t                  lodIdx;
+        MetroFSPath             file;       // external *.mesh, opened by the task itself
+        MemStream               stream;     // inline mesh
+        MetroModelLoadParams    params;
+        RefPtr<MetroModelBase>  mesh;
+        bool                    badBonesCRC;
+    };
+
+    bool                    CollectLodMeshes(MyArray<LodMeshTask>& tasks, CharString& meshesNames, const MetroModelLoadParams& params, const size_t lodIdx) const;
+    bool                    CollectLodMeshes(MyArray<LodMeshTask>& tasks, MemStream& meshesStream, const MetroModelLoadParams& params, const size_t lodIdx) const;
+    void                    LoadLodMesh(LodMeshTask& task) const;
+    bool                    AttachLodMesh(MetroModelHierarchy* target, const LodMeshTask& task);
+
+    virtual RefPtr<MetroModelBase> Clone() const override;
+    virtual RefPtr<MetroModelBase> CopyWithTPreset(const MetroModelTPreset& tpreset, const bool forceCopy) const override;
 
 protected:
     using ModelPtr = RefPtr<MetroModelBase>;
@@ -419,6 +479,9 @@ public:
 
     virtual bool            IsSoft() const override { return true; }
 
+protected:
+    virtual RefPtr<MetroModelBase> Clone() const override;
+
 protected:
     RefPtr<MetroClothModel> mClothModel;
 };
@@ -456,6 +519,16 @@ private:
 };
 
 
+struct MetroModelCacheStats {
+    size_t  numModels;
+    size_t  memUsed;        // geometry memory of all cached models, every source file or buffer counted once, tpreset copies only count what they don't share
+    size_t  memBudget;
+    size_t  hits;
+    size_t  misses;         // every miss is a file load or a tpreset copy
+    size_t  tpresetCopies;  // misses served by copying an already cached model with another tpreset
+    size_t  evictions;
+};
+
 class MetroModelFactory {
     MetroModelFactory() = delete;
     MetroModelFactory(const MetroModelFactory&) = delete;
@@ -466,5 +539,17 @@ public:
     static RefPtr<MetroModelBase>   CreateModelFromStream(MemStream& stream, const MetroModelLoadParams& params);
     static RefPtr<MetroModelBase>   CreateModelFromFile(const MetroFSPath& file, const uint32_t loadFlags);
     static RefPtr<MetroModelBase>   CreateModelFromFullName(const CharString& fullName, const uint32_t loadFlags);
+
+    // shared models cache, keyed by (resolved path, load flags, tpreset)
+    //  models returned from here are shared between all the callers and must be treated as read-only,
+    //  use ApplyTPresetShared instead of ApplyTPreset on them
+    static RefPtr<MetroModelBase>   GetSharedModelFromFile(const MetroFSPath& file, const uint32_t loadFlags, const CharString& tpresetName = kEmptyString);
+    static RefPtr<MetroModelBase>   GetSharedModelFromFullName(const CharString& fullName, const uint32_t loadFlags);
+    // copy-on-write ApplyTPreset, returns the model itself if tpreset changes nothing
+    static RefPtr<MetroModelBase>   ApplyTPresetShared(const RefPtr<MetroModelBase>& model, const CharString& tpresetName);
+
+    static void                     SetSharedCacheBudget(const size_t budgetInBytes);
+    static void                     ClearSharedCache();
+    static MetroModelCacheStats     GetSharedCacheStats();
 };
 
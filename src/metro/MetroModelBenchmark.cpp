@@ -0,0 +1,346 @@
+#include "MetroModelBenchmark.h"
+#include "MetroModel.h"
+#include "MetroSkeleton.h"
+#include "MetroContext.h"
+#include "jansson.h"
+
+#include <chrono>
+#include <cmath>
+
+
+static const size_t kBenchNumBones = 64;
+
+static RefPtr<MetroSkeleton> Bench_MakeSkeleton() {
+    MyArray<MetroBone> bones(kBenchNumBones);
+    for (size_t i = 0; i < kBenchNumBones; ++i) {
+        MetroBone& b = bones[i];
+        b.name = "bone_" + std::to_string(i);
+        if (i) {
+            b.parent = bones[(i - 1) / 2].name;
+        }
+        b.q = quat(1.0f, 0.0f, 0.0f, 0.0f);
+        b.t = vec3(0.0f, 0.1f, 0.0f);
+        b.bp = 0;
+        b.bpf = 0;
+    }
+
+    RefPtr<MetroSkeleton> skeleton = MakeRefPtr<MetroSkeleton>();
+    skeleton->SetBones(bones);
+    return skeleton;
+}
+
+// a grid of verticesPerPart vertices, every part skinned to its own 4 bones
+static RefPtr<MetroModelSkin> Bench_MakePart(const size_t partIdx, const size_t verticesPerPart) {
+    const size_t gridSize = std::max<size_t>(2, scast<size_t>(std::sqrt(scast<double>(verticesPerPart))));
+    const size_t numVertices = gridSize * gridSize;
+    const size_t numFaces = (gridSize - 1) * (gridSize - 1) * 2;
+
+    MyArray<VertexSkinned> vertices(numVertices);
+    for (size_t y = 0; y < gridSize; ++y) {
+        for (size_t x = 0; x < gridSize; ++x) {
+            VertexSkinned& v = vertices[y * gridSize + x];
+            memset(&v, 0, sizeof(v));
+            v.pos[0] = scast<int16_t>(x * 32767 / gridSize);
+            v.pos[1] = scast<int16_t>(y * 32767 / gridSize);
+            v.pos[2] = scast<int16_t>(partIdx * 256);
+            v.normal = 0x7F7FFF7F;
+            v.bones[0] = 0; v.bones[1] = 1; v.bones[2] = 2; v.bones[3] = 3;
+            v.weights[0] = 255;
+            v.uv[0] = scast<int16_t>(x * 2048 / gridSize);
+            v.uv[1] = scast<int16_t>(y * 2048 / gridSize);
+        }
+    }
+
+    MyArray<MetroFace> faces;
+    faces.reserve(numFaces);
+    for (size_t y = 0; y + 1 < gridSize; ++y) {
+        for (size_t x = 0; x + 1 < gridSize; ++x) {
+            const uint16_t i0 = scast<uint16_t>(y * gridSize + x);
+            const uint16_t i1 = scast<uint16_t>(i0 + 1);
+            const uint16_t i2 = scast<uint16_t>(i0 + gridSize);
+            const uint16_t i3 = scast<uint16_t>(i2 + 1);
+            faces.push_back({ i0, i2, i1 });
+            faces.push_back({ i1, i2, i3 });
+        }
+    }
+
+    BytesArray bonesRemap(4);
+    for (size_t i = 0; i < bonesRemap.size(); ++i) {
+        bonesRemap[i] = scast<uint8_t>((partIdx + i) % kBenchNumBones);
+    }
+
+    OBBox identityOBB;
+    identityOBB.matrix = mat3(1.0f);
+    identityOBB.hsize = vec3(0.1f, 0.1f, 0.1f);
+    identityOBB.offset = vec3(0.0f, 0.0f, 0.0f);
+
+    RefPtr<MetroModelSkin> part = MakeRefPtr<MetroModelSkin>();
+    part->CreateMesh(numVertices, faces.size(), 1.0f);
+    part->CopyVerticesData(vertices.data());
+    part->CopyFacesData(faces.data());
+    part->SetBonesRemapTable(bonesRemap);
+    part->SetBonesOBB(MyArray<OBBox>(bonesRemap.size(), identityOBB));
+    part->SetMaterialString(kEmptyString, MetroModelBase::kMaterialStringTexture);  // force-create material strings array
+    part->SetMaterialString("bench\\part_" + std::to_string(partIdx), MetroModelBase::kMaterialStringTexture);
+
+    AABBox bbox;
+    bbox.minimum = vec3(0.0f);
+    bbox.maximum = vec3(1.0f);
+    part->SetBBox(bbox);
+    part->SetBSphere({ bbox.Center(), Length(bbox.Extent()) });
+
+    return part;
+}
+
+static MyArray<MetroModelGeomData> Bench_CollectParts(const RefPtr<MetroModelBase>& model) {
+    MyArray<MetroModelGeomData> result;
+    if (model) {
+        model->CollectGeomData(result);
+    }
+    return result;
+}
+
+static size_t Bench_GetFileSize(const fs::path& filePath) {
+    std::error_code ec;
+    const uintmax_t size = fs::file_size(filePath, ec);
+    return ec ? 0 : scast<size_t>(size);
+}
+
+
+MetroModelBenchmark::MetroModelBenchmark() {
+}
+MetroModelBenchmark::~MetroModelBenchmark() {
+    if (!mContentFolder.empty()) {
+        std::error_code ec;
+        fs::remove_all(mContentFolder.parent_path(), ec);
+    }
+}
+
+bool MetroModelBenchmark::AddSyntheticModel(const CharString& name, const size_t numParts, const size_t verticesPerPart, const size_t numLods) {
+    // faces count is 16 bit in the file
+    if (!numParts || verticesPerPart < 4 || verticesPerPart > 32768 || !numLods || numLods > 3) {
+        return false;
+    }
+
+    // the filesystem only takes a folder named "content", links to the meshes are relative to content\meshes
+    std::error_code ec;
+    if (mContentFolder.empty()) {
+        const fs::path tempFolder = fs::temp_directory_path(ec);
+        if (ec) {
+            LogPrintF(LogLevel::Error, "Model benchmark: no temp folder to put the model files in");
+            return false;
+        }
+        mContentFolder = tempFolder / "metro_model_bench" / "content";
+    }
+
+    const fs::path meshesFolder = mContentFolder / "meshes" / "bench";
+    fs::create_directories(meshesFolder, ec);
+    if (ec) {
+        return false;
+    }
+
+    RefPtr<MetroModelSkeleton> model = MakeRefPtr<MetroModelSkeleton>();
+    model->SetSkeleton(Bench_MakeSkeleton());
+
+    Setup setup;
+    setup.name = name;
+    setup.numParts = numParts;
+    setup.numLods = numLods;
+    setup.numFiles = 1 + numParts * numLods;
+    setup.numVertices = 0;
+    setup.numFaces = 0;
+    setup.filesSize = 0;
+
+    // every part of every lod is a lod mesh of its own, so every one of them gets its own file
+    for (size_t lod = 0; lod < numLods; ++lod) {
+        const size_t lodVertices = std::max<size_t>(4, verticesPerPart >> (lod * 2));
+        for (size_t i = 0; i < numParts; ++i) {
+            RefPtr<MetroModelSkin> part = Bench_MakePart(i, lodVertices);
+            setup.numVertices += part->GetVerticesCount();
+            setup.numFaces += part->GetFacesCount();
+
+            RefPtr<MetroModelHierarchy> lodMesh = MakeRefPtr<MetroModelHierarchy>();
+            lodMesh->SetModelType(MetroModelType::Hierarchy2);
+            lodMesh->AddChild(part);
+            model->AddLodMesh(lod, lodMesh);
+        }
+    }
+
+    MetroModelSaveParams saveParams;
+    saveParams.dstFile = meshesFolder / (name + ".model");
+    saveParams.saveFlags = MetroModelSaveParams::SaveForGameVersion | MetroModelSaveParams::InlineSkeleton;
+    saveParams.gameVersion = MetroGameVersion::Exodus;
+
+    MemWriteStream stream;
+    if (!model->Save(stream, saveParams) ||
+        OSWriteFile(saveParams.dstFile, stream.Data(), stream.GetWrittenBytesCount()) != stream.GetWrittenBytesCount()) {
+        LogPrintF(LogLevel::Warning, "Model benchmark: failed to write %s", saveParams.dstFile.u8string().c_str());
+        return false;
+    }
+
+    setup.filesSize += Bench_GetFileSize(saveParams.dstFile);
+    for (size_t lod = 0; lod < numLods; ++lod) {
+        for (size_t i = 0; i < numParts; ++i) {
+            const CharString meshName = name + "_l" + std::to_string(lod) + "_m" + std::to_string(i) + ".mesh";
+            setup.filesSize += Bench_GetFileSize(meshesFolder / meshName);
+        }
+    }
+
+    mSetups.emplace_back(std::move(setup));
+    return true;
+}
+
+void MetroModelBenchmark::AddDefaultSyntheticModels() {
+    // ~40 parts is a dressed up character with all the gear, parts are a few thousands vertices each
+    this->AddSyntheticModel("skinned_40_parts", 40, 4096, 1);
+    this->AddSyntheticModel("skinned_40_parts_3_lods", 40, 4096, 3);
+    this->AddSyntheticModel("skinned_40_parts_3_lods_heavy", 40, 16384, 3);
+}
+
+size_t MetroModelBenchmark::GetNumModels() const {
+    return mSetups.size();
+}
+
+size_t MetroModelBenchmark::Run(const size_t numIterations) {
+    mResults.clear();
+    mResults.reserve(mSetups.size());
+
+    if (mSetups.empty()) {
+        return 0;
+    }
+
+    // lod meshes are looked up through the context's filesystem, so the content folder takes it over for the run
+    MetroContext& context = MetroContext::Get();
+    if (!context.GetFilesystem().InitFromContentFolder(mContentFolder)) {
+        LogPrintF(LogLevel::Error, "Model benchmark: failed to mount %s", mContentFolder.u8string().c_str());
+        return 0;
+    }
+    context.SetGameVersion(MetroGameVersion::Exodus);
+
+    for (const Setup& setup : mSetups) {
+        ModelLoadBenchResult result = {};
+        if (this->RunSingle(setup, std::max<size_t>(1, numIterations), result)) {
+            mResults.emplace_back(std::move(result));
+        } else {
+            LogPrintF(LogLevel::Warning, "Model benchmark: failed to load %s", setup.name.c_str());
+        }
+    }
+
+    context.GetFilesystem().Shutdown();
+
+    return mResults.size();
+}
+
+const MyArray<ModelLoadBenchResult>& MetroModelBenchmark::GetResults() const {
+    return mResults;
+}
+
+json_t* MetroModelBenchmark::ToJsonTree() const {
+    json_t* root = json_object();
+    json_t* results = json_array();
+
+    for (const ModelLoadBenchResult& r : mResults) {
+        json_t* jr = json_object();
+        json_object_set_new(jr, "name", json_string(r.name.c_str()));
+        json_object_set_new(jr, "parts", json_integer(scast<json_int_t>(r.numParts)));
+        json_object_set_new(jr, "lods", json_integer(scast<json_int_t>(r.numLods)));
+        json_object_set_new(jr, "files", json_integer(scast<json_int_t>(r.numFiles)));
+        json_object_set_new(jr, "vertices", json_integer(scast<json_int_t>(r.numVertices)));
+        json_object_set_new(jr, "faces", json_integer(scast<json_int_t>(r.numFaces)));
+        json_object_set_new(jr, "files_size", json_integer(scast<json_int_t>(r.filesSize)));
+        json_object_set_new(jr, "threads", json_integer(scast<json_int_t>(r.numThreads)));
+        json_object_set_new(jr, "serial_ms", json_real(r.serialMs));
+        json_object_set_new(jr, "parallel_ms", json_real(r.parallelMs));
+        json_object_set_new(jr, "speedup", json_real(r.speedup));
+        json_object_set_new(jr, "matches", json_boolean(r.matches));
+        json_array_append_new(results, jr);
+    }
+
+    json_object_set_new(root, "results", results);
+
+    return root;
+}
+
+bool MetroModelBenchmark::RunSingle(const Setup& setup, const size_t numIterations, ModelLoadBenchResult& result) const {
+    using Clock = std::chrono::high_resolution_clock;
+
+    const MetroFileSystem& mfs = MetroContext::Get().GetFilesystem();
+    const CharString modelName = "bench\\" + setup.name;
+
+    // finding and reading the .model is part of the load, same as loading by name does it
+    auto loadModel = [&mfs, &modelName](const size_t numThreads) -> RefPtr<MetroModelBase> {
+        const MetroFSPath file = mfs.FindFile(MetroFileSystem::Paths::MeshesFolder + modelName + ".model");
+        if (!file.IsValid()) {
+            return nullptr;
+        }
+
+        MemStream stream = mfs.OpenFileStream(file);
+        if (!stream) {
+            return nullptr;
+        }
+
+        MetroModelLoadParams params = {
+            modelName,
+            kEmptyString,
+            0,
+            MetroModelLoadParams::LoadGeometry | MetroModelLoadParams::LoadSkeleton,
+            file
+        };
+        params.numThreads = numThreads;
+
+        return MetroModelFactory::CreateModelFromStream(stream, params);
+    };
+
+    double bestSerialMs = 0.0, bestParallelMs = 0.0;
+    RefPtr<MetroModelBase> serialModel, parallelModel;
+
+    for (size_t iteration = 0; iteration < numIterations; ++iteration) {
+        const auto t0 = Clock::now();
+        serialModel = loadModel(1);
+        const auto t1 = Clock::now();
+        parallelModel = loadModel(0);
+        const auto t2 = Clock::now();
+
+        if (!serialModel || !parallelModel) {
+            return false;
+        }
+
+        const double serialMs = std::chrono::duration<double, std::milli>(t1 - t0).count();
+        const double parallelMs = std::chrono::duration<double, std::milli>(t2 - t1).count();
+        bestSerialMs = iteration ? std::min(bestSerialMs, serialMs) : serialMs;
+        bestParallelMs = iteration ? std::min(bestParallelMs, parallelMs) : parallelMs;
+    }
+
+    // every lod has to come out of both loads with all the parts, in the same order and with the same geometry
+    bool matches = true;
+    for (size_t lod = 0; matches && lod < setup.numLods; ++lod) {
+        const MyArray<MetroModelGeomData> serialParts = Bench_CollectParts(lod ? serialModel->GetLod(lod - 1) : serialModel);
+        const MyArray<MetroModelGeomData> parallelParts = Bench_CollectParts(lod ? parallelModel->GetLod(lod - 1) : parallelModel);
+
+        matches = (serialParts.size() == setup.numParts) && (parallelParts.size() == serialParts.size());
+        for (size_t i = 0; matches && i < serialParts.size(); ++i) {
+            const MetroModelBase* a = serialParts[i].model;
+            const MetroModelBase* b = parallelParts[i].model;
+            matches = a->GetVerticesCount() == b->GetVerticesCount() &&
+                      a->GetFacesCount() == b->GetFacesCount() &&
+                      a->GetMaterialString(MetroModelBase::kMaterialStringTexture) == b->GetMaterialString(MetroModelBase::kMaterialStringTexture) &&
+                      a->GetVerticesMemSize() == b->GetVerticesMemSize() &&
+                      std::memcmp(a->GetVerticesMemData(), b->GetVerticesMemData(), a->GetVerticesMemSize()) == 0;
+        }
+    }
+
+    result.name = setup.name;
+    result.numParts = setup.numParts;
+    result.numLods = setup.numLods;
+    result.numFiles = setup.numFiles;
+    result.numVertices = setup.numVertices;
+    result.numFaces = setup.numFaces;
+    result.filesSize = setup.filesSize;
+    result.numThreads = ParallelGetNumThreads();
+    result.serialMs = bestSerialMs;
+    result.parallelMs = bestParallelMs;
+    result.speedup = (bestParallelMs > 0.0) ? bestSerialMs / bestParallelMs : 0.0;
+    result.matches = matches;
+
+    return true;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include "mycommon.h"
+
+struct json_t;
+
+// Loads synthetic skinned models laid out the way the game ships the characters: a .model file with the skeleton
+//  inline and every part (of every lod) in its own .mesh file, so every part is one more file to find, open and read.
+//  The files go to a content folder in the temp folder that becomes the MetroContext filesystem for the run, so the
+//  benchmark is for the command line only. Loose files aren't compressed, archives would add the decompression.
+//  Every model is loaded once with the lod meshes loaded serially and once in parallel, both loads must end up with
+//  the same parts and geometry, the json tells how much the parallel load saves.
+
+struct ModelLoadBenchResult {
+    CharString  name;
+    size_t      numParts;           // per lod
+    size_t      numLods;
+    size_t      numFiles;           // the .model and all the .mesh files
+    size_t      numVertices;        // all the parts of all the lods
+    size_t      numFaces;
+    size_t      filesSize;
+    size_t      numThreads;
+    double      serialMs;           // best of all iterations
+    double      parallelMs;
+    double      speedup;
+    bool        matches;            // parallel load gave the same parts in the same order as the serial one
+};
+
+class MetroModelBenchmark {
+public:
+    MetroModelBenchmark();
+    ~MetroModelBenchmark();
+
+    // numParts skinned meshes of verticesPerPart vertices (and twice as many faces) each in lod0,
+    //  every next lod (up to 3) has the same parts with a quarter of the vertices
+    bool                                AddSyntheticModel(const CharString& name, const size_t numParts, const size_t verticesPerPart, const size_t numLods);
+    void                                AddDefaultSyntheticModels();
+    size_t                              GetNumModels() const;
+
+    // returns number of successful runs
+    size_t                              Run(const size_t numIterations = 1);
+
+    const MyArray<ModelLoadBenchResult>& GetResults() const;
+    json_t*                             ToJsonTree() const;
+
+private:
+    struct Setup {
+        CharString  name;
+        size_t      numParts;
+        size_t      numLods;
+        size_t      numFiles;
+        size_t      numVertices;
+        size_t      numFaces;
+        size_t      filesSize;
+    };
+
+    bool                                RunSingle(const Setup& setup, const size_t numIterations, ModelLoadBenchResult& result) const;
+
+private:
+    fs::path                            mContentFolder;
+    MyArray<Setup>                      mSetups;
+    MyArray<ModelLoadBenchResult>       mResults;
+};
@@ -0,0 +1,51 @@
+#include "MetroModelOptimizer.h"
+#include "meshoptimizer.h"
+
+// overdraw pass may cost up to 5% of the vertex cache efficiency
+static const float kOverdrawThreshold = 1.05f;
+
+void MDL_OptimizeMeshGeometry(uint8_t* vertices,
+                              const size_t numVertices,
+                              const size_t vertexStride,
+                              const float* positions,
+                              const size_t positionsStride,
+                              uint16_t* indices,
+                              const size_t numIndices,
+                              MetroGeometryOptimizeStats* stats) {
+    if (!numVertices || numIndices < 3) {
+        return;
+    }
+
+    const uint32_t kCacheSize = MetroGeometryOptimizeStats::kCacheSize;
+
+    if (stats) {
+        const meshopt_VertexCacheStatistics vcs = meshopt_analyzeVertexCache<uint16_t>(indices, numIndices, numVertices, kCacheSize, 0, 0);
+        stats->transformedBefore += vcs.vertices_transformed;
+    }
+
+    // vertex cache, then overdraw on top of it
+    MyArray<uint16_t> tmpIndices(numIndices);
+    meshopt_optimizeVertexCache<uint16_t>(tmpIndices.data(), indices, numIndices, numVertices);
+    meshopt_optimizeOverdraw<uint16_t>(indices, tmpIndices.data(), numIndices, positions, numVertices, positionsStride, kOverdrawThreshold);
+
+    // vertex fetch, remap gets ~0u for unreferenced vertices, keep them at the end so the counts stay the same
+    MyArray<uint32_t> remap(numVertices);
+    size_t nextIdx = meshopt_optimizeVertexFetchRemap<uint16_t>(remap.data(), indices, numIndices, numVertices);
+    for (uint32_t& idx : remap) {
+        if (idx == ~0u) {
+            idx = scast<uint32_t>(nextIdx++);
+        }
+    }
+    assert(nextIdx == numVertices);
+
+    meshopt_remapIndexBuffer<uint16_t>(indices, indices, numIndices, remap.data());
+    meshopt_remapVertexBuffer(vertices, vertices, numVertices, vertexStride, remap.data());
+
+    if (stats) {
+        const meshopt_VertexCacheStatistics vcs = meshopt_analyzeVertexCache<uint16_t>(indices, numIndices, numVertices, kCacheSize, 0, 0);
+        stats->transformedAfter += vcs.vertices_transformed;
+        stats->numMeshes++;
+        stats->numVertices += numVertices;
+        stats->numFaces += numIndices / 3;
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include "mycommon.h"
+
+// GPU-friendly reordering of model geometry, done on save
+//  post-transform vertex cache -> overdraw -> vertex fetch, all through meshoptimizer.
+//  Vertex and face counts never change, vertices no face references are moved to the end.
+
+struct MetroGeometryOptimizeStats {
+    static const uint32_t kCacheSize = 16;  // simulated FIFO post-transform cache, same for before and after
+
+    size_t  numMeshes = 0;
+    size_t  numVertices = 0;
+    size_t  numFaces = 0;
+    size_t  transformedBefore = 0;  // vertices that missed the simulated cache
+    size_t  transformedAfter = 0;
+
+    // average cache miss ratio, transformed vertices per triangle (0.5 .. 3.0)
+    inline float GetACMRBefore() const { return numFaces ? scast<float>(transformedBefore) / scast<float>(numFaces) : 0.0f; }
+    inline float GetACMRAfter() const { return numFaces ? scast<float>(transformedAfter) / scast<float>(numFaces) : 0.0f; }
+    // average transformed vertex ratio, transformed vertices per vertex (1.0 .. 6.0)
+    inline float GetATVRBefore() const { return numVertices ? scast<float>(transformedBefore) / scast<float>(numVertices) : 0.0f; }
+    inline float GetATVRAfter() const { return numVertices ? scast<float>(transformedAfter) / scast<float>(numVertices) : 0.0f; }
+};
+
+// vertices and indices are rewritten in place
+//  positions are float3 with positionsStride, may point into vertices (e.g. static vertices),
+//  skinned models have to pass decoded positions
+void MDL_OptimizeMeshGeometry(uint8_t* vertices,
+                              const size_t numVertices,
+                              const size_t vertexStride,
+                              const float* positions,
+                              const size_t positionsStride,
+                              uint16_t* indices,
+                              const size_t numIndices,
+                              MetroGeometryOptimizeStats* stats);
@@ -1,4 +1,6 @@
 #include "MetroMotion.h"
+#include "MetroMotionBaked.h"
+#include "MetroMotionOptimizer.h"
 #include "MetroContext.h"
 
 static const size_t kMotionVersionRedux     = 14;  // Last Light has the same version
@@ -44,48 +46,285 @@ enum MotionFlags : uint16_t {
 
 
 
-template <typename TConvertion, typename TLerpFunc>
-static vec4 Util_CurveResolve(const AttributeCurve& curve, const float curveT, TLerpFunc lerpFunc) {
-    vec4 result;
+enum class AttribCurveType : uint8_t {
+    Invalid         = 0,
+    Uncompressed    = 1,    // raw float values
+    OneValue        = 2,    // constant value, no curve
+    Unknown_3       = 3,
+    CompressedPos   = 4,    // quantized position, scale + offset + u16 values
+    CompressedQuat  = 5,    // quantized quaternion (xyz, we restore w), s16_snorm values
+    Unknown_6       = 6,
+    Empty           = 7     // no curve, why not just filter it out with mask ???
+};
 
-    if (curve.points.size() == 1) { // constant value
-        result = curve.points.front().value;
-    } else {
-        const size_t numPoints = curve.points.size();
-        size_t pointA = numPoints, pointB = numPoints;
-        for (size_t i = 0; i < numPoints; ++i) {
-            const auto& p = curve.points[i];
-            if (p.time >= curveT) {
-                pointB = i;
-                break;
-            }
+inline vec3 EndianSwapBytes(const vec3& v) {
+    return vec3(EndianSwapBytes(v.x), EndianSwapBytes(v.y), EndianSwapBytes(v.z));
+}
+
+inline vec4 EndianSwapBytes(const vec4& v) {
+    return vec4(EndianSwapBytes(v.x), EndianSwapBytes(v.y), EndianSwapBytes(v.z), EndianSwapBytes(v.w));
+}
+
+template <typename T>
+inline T Util_ReadPacked(const uint8_t* ptr, const size_t idx, const bool bswap) {
+    const T v = rcast<const T*>(ptr)[idx];
+    return bswap ? EndianSwapBytes(v) : v;
+}
+
+// Read-only access to the points of a curve, either the decoded AttributeCurve or straight the packed curve data
+//  as it was loaded (any AttribCurveType), so sampling a loaded motion never has to expand its curves.
+class MotionCurveReader {
+public:
+    MotionCurveReader()
+        : mCurve(nullptr)
+        , mType(AttribCurveType::Empty)
+        , mNumPoints(0)
+        , mAttribSize(0)
+        , mBSwap(false)
+        , mTimings(nullptr)
+        , mValues(nullptr)
+        , mTimingScale(1.0f)
+        , mScale(1.0f)
+        , mOffset(0.0f) {
+    }
+
+    explicit MotionCurveReader(const AttributeCurve& curve)
+        : MotionCurveReader() {
+        mCurve = &curve;
+        mNumPoints = curve.points.size();
+    }
+
+    MotionCurveReader(const uint8_t* curveData, const size_t attribSize, const bool bswap)
+        : MotionCurveReader() {
+        const uint32_t curveHeader = Util_ReadPacked<uint32_t>(curveData, 0, bswap);
+        const size_t pointSize = ((curveHeader >> 24) & 0xF);
+
+        assert(pointSize == attribSize);
+        assert(attribSize <= 4);
+
+        mType = scast<AttribCurveType>((curveHeader >> 16) & 0xF);
+        mAttribSize = attribSize;
+        mBSwap = bswap;
+        curveData += 4;
+
+        switch (mType) {
+            case AttribCurveType::OneValue: {
+                mNumPoints = 1;
+                mValues = curveData;
+            } break;
+
+            case AttribCurveType::Uncompressed: {
+                mNumPoints = scast<size_t>(curveHeader & 0xFFFF);
+                mTimings = curveData;
+                mValues = curveData + mNumPoints * sizeof(float);
+            } break;
+
+            case AttribCurveType::CompressedPos: {
+                mNumPoints = scast<size_t>(curveHeader & 0xFFFF);
+                mTimingScale = 1.0f / Util_ReadPacked<float>(curveData, 0, bswap);
+                mScale = vec3(Util_ReadPacked<float>(curveData, 1, bswap), Util_ReadPacked<float>(curveData, 2, bswap), Util_ReadPacked<float>(curveData, 3, bswap));
+                mOffset = vec3(Util_ReadPacked<float>(curveData, 4, bswap), Util_ReadPacked<float>(curveData, 5, bswap), Util_ReadPacked<float>(curveData, 6, bswap));
+                mTimings = curveData + sizeof(float) + sizeof(vec3[2]);
+                mValues = mTimings + mNumPoints * sizeof(uint16_t);
+            } break;
+
+            case AttribCurveType::CompressedQuat: {
+                mNumPoints = scast<size_t>(curveHeader & 0xFFFF);
+                mTimingScale = 1.0f / Util_ReadPacked<float>(curveData, 0, bswap);
+                mTimings = curveData + sizeof(float);
+                mValues = mTimings + mNumPoints * sizeof(uint16_t);
+            } break;
+
+            case AttribCurveType::Unknown_3:
+            case AttribCurveType::Unknown_6: {
+                assert(false);
+            } break;
+        }
+    }
+
+    inline size_t GetNumPoints() const {
+        return mNumPoints;
+    }
+
+    inline float GetTime(const size_t idx) const {
+        if (mCurve) {
+            return mCurve->points[idx].time;
         }
 
-        if (pointB == numPoints) {
-            pointB--;
-            pointA = pointB;
-        } else if (pointB == 0) {
-            pointA = 0;
-        } else {
-            pointA = pointB - 1;
+        switch (mType) {
+            case AttribCurveType::Uncompressed:
+                return Util_ReadPacked<float>(mTimings, idx, mBSwap);
+            case AttribCurveType::CompressedPos:
+            case AttribCurveType::CompressedQuat:
+                return scast<float>(Util_ReadPacked<uint16_t>(mTimings, idx, mBSwap)) * mTimingScale;
+            default:
+                return 0.0f;
         }
+    }
 
-        const auto& pA = curve.points[pointA];
+    vec4 GetValue(const size_t idx) const {
+        if (mCurve) {
+            return mCurve->points[idx].value;
+        }
 
-        if (pointA == pointB) {
-            result = pA.value;
+        vec4 result(0.0f);
+        switch (mType) {
+            case AttribCurveType::OneValue:
+            case AttribCurveType::Uncompressed: {
+                for (size_t i = 0; i < mAttribSize; ++i) {
+                    result[scast<int>(i)] = Util_ReadPacked<float>(mValues, idx * mAttribSize + i, mBSwap);
+                }
+            } break;
+
+            case AttribCurveType::CompressedPos: {
+                const float px = scast<float>(Util_ReadPacked<uint16_t>(mValues, idx * 3 + 0, mBSwap));
+                const float py = scast<float>(Util_ReadPacked<uint16_t>(mValues, idx * 3 + 1, mBSwap));
+                const float pz = scast<float>(Util_ReadPacked<uint16_t>(mValues, idx * 3 + 2, mBSwap));
+                result = vec4(vec3(px, py, pz) * mScale + mOffset, 0.0f);
+            } break;
+
+            case AttribCurveType::CompressedQuat: {
+                const float normFactor = 0.0000215805f; // (1 / 32766) * (1 / sqrt(2))
+
+                const int16_t px = Util_ReadPacked<int16_t>(mValues, idx * 3 + 0, mBSwap);
+                const int16_t py = Util_ReadPacked<int16_t>(mValues, idx * 3 + 1, mBSwap);
+                const int16_t pz = Util_ReadPacked<int16_t>(mValues, idx * 3 + 2, mBSwap);
+
+                const int permutation = (py & 1) | (2 * (px & 1));
+                const int wsign = (pz & 1);
+
+                const float qx = scast<float>(px) * normFactor;
+                const float qy = scast<float>(py) * normFactor;
+                const float qz = scast<float>(pz) * normFactor;
+                const float t = 1.0f - (qx * qx) - (qy * qy) - (qz * qz);
+                const float qw = (t < 0.0f) ? 0.0f : (wsign ? -std::sqrtf(t) : std::sqrtf(t));
+
+                switch (permutation) {
+                    case 0: result = vec4(qw, qx, qy, qz); break;
+                    case 1: result = vec4(qx, qw, qy, qz); break;
+                    case 2: result = vec4(qx, qy, qw, qz); break;
+                    case 3: result = vec4(qx, qy, qz, qw); break;
+                }
+
+                *rcast<quat*>(&result) = Normalize(*rcast<quat*>(&result));
+            } break;
+        }
+
+        return result;
+    }
+
+private:
+    const AttributeCurve*   mCurve;
+    AttribCurveType         mType;
+    size_t                  mNumPoints;
+    size_t                  mAttribSize;
+    bool                    mBSwap;
+    const uint8_t*          mTimings;
+    const uint8_t*          mValues;
+    float                   mTimingScale;
+    vec3                    mScale;
+    vec3                    mOffset;
+};
+
+// decoded curve wins (imported or synthetic motions), loaded motions only have the packed ones
+static MotionCurveReader Util_GetCurveReader(const MetroMotion& motion,
+                                             const MyArray<AttributeCurve>& curves,
+                                             const MyArray<MetroMotion::PackedCurve>& packedCurves,
+                                             const size_t idx,
+                                             const size_t attribSize) {
+    if (idx < curves.size() && !curves[idx].points.empty()) {
+        return MotionCurveReader(curves[idx]);
+    } else if (idx < packedCurves.size() && packedCurves[idx].offset) {
+        const MetroMotion::PackedCurve& pc = packedCurves[idx];
+        return MotionCurveReader(motion.mMotionsData.data() + pc.offset, attribSize, pc.bswap);
+    } else {
+        return MotionCurveReader();
+    }
+}
+
+static void Util_DecodeCurve(const MotionCurveReader& reader, AttributeCurve& curve) {
+    curve.points.resize(reader.GetNumPoints());
+    for (size_t i = 0; i < curve.points.size(); ++i) {
+        curve.points[i].time = reader.GetTime(i);
+        curve.points[i].value = reader.GetValue(i);
+    }
+}
+
+// First point at or after curveT (numPoints if there's none) within [first, last), points are sorted by time
+static size_t Util_CurveFindPoint(const MotionCurveReader& curve, const float curveT, size_t first, size_t last) {
+    while (first < last) {
+        const size_t mid = first + (last - first) / 2;
+        if (curve.GetTime(mid) < curveT) {
+            first = mid + 1;
         } else {
-            const auto& pB = curve.points[pointB];
-            const float t = (curveT - pA.time) / (pB.time - pA.time);
+            last = mid;
+        }
+    }
+    return first;
+}
 
-            TConvertion temp = lerpFunc(*rcast<const TConvertion*>(&pA.value), *rcast<const TConvertion*>(&pB.value), t);
-            result = *rcast<const vec4*>(&temp);
+static size_t Util_CurveFindPoint(const MotionCurveReader& curve, const float curveT) {
+    return Util_CurveFindPoint(curve, curveT, 0, curve.GetNumPoints());
+}
+
+// Same as Util_CurveFindPoint, but starts from the point found last time (cursor).
+//  Playback going forward stays on the same segment or moves to the next one, so it's O(1) most of the time,
+//  bigger steps forward gallop from the cursor (O(log distance)), going back (e.g. looping) searches the whole curve.
+static size_t Util_CurveFindPointCached(const MotionCurveReader& curve, const float curveT, uint32_t& cursor) {
+    const size_t numPoints = curve.GetNumPoints();
+
+    size_t result = std::min<size_t>(cursor, numPoints);
+    if (result > 0 && curve.GetTime(result - 1) >= curveT) {
+        result = Util_CurveFindPoint(curve, curveT);
+    } else if (result < numPoints && curve.GetTime(result) < curveT) {
+        size_t first = result + 1, step = 1;
+        while (first + step < numPoints && curve.GetTime(first + step - 1) < curveT) {
+            first += step;
+            step *= 2;
         }
+        const size_t last = std::min(first + step, numPoints);
+
+        result = Util_CurveFindPoint(curve, curveT, first, last);
     }
 
+    cursor = scast<uint32_t>(result);
     return result;
 }
 
+// pointB is the first point at or after curveT
+template <typename TConvertion, typename TLerpFunc>
+static vec4 Util_CurveInterpolate(const MotionCurveReader& curve, const size_t pointB, const float curveT, TLerpFunc lerpFunc) {
+    vec4 result;
+
+    const size_t numPoints = curve.GetNumPoints();
+    if (numPoints == 1) { // constant value
+        result = curve.GetValue(0);
+    } else if (pointB == 0 || pointB == numPoints) {
+        result = curve.GetValue(pointB ? (numPoints - 1) : 0);
+    } else {
+        const float timeA = curve.GetTime(pointB - 1);
+        const float timeB = curve.GetTime(pointB);
+        const vec4 valueA = curve.GetValue(pointB - 1);
+        const vec4 valueB = curve.GetValue(pointB);
+        const float t = (curveT - timeA) / (timeB - timeA);
+
+        TConvertion temp = lerpFunc(*rcast<const TConvertion*>(&valueA), *rcast<const TConvertion*>(&valueB), t);
+        result = *rcast<const vec4*>(&temp);
+    }
+
+    return result;
+}
+
+template <typename TConvertion, typename TLerpFunc>
+static vec4 Util_CurveResolve(const MotionCurveReader& curve, const float curveT, TLerpFunc lerpFunc) {
+    return Util_CurveInterpolate<TConvertion>(curve, Util_CurveFindPoint(curve, curveT), curveT, lerpFunc);
+}
+
+template <typename TConvertion, typename TLerpFunc>
+static vec4 Util_CurveResolveCached(const MotionCurveReader& curve, const float curveT, uint32_t& cursor, TLerpFunc lerpFunc) {
+    return Util_CurveInterpolate<TConvertion>(curve, Util_CurveFindPointCached(curve, curveT, cursor), curveT, lerpFunc);
+}
+
 
 
 
@@ -207,8 +446,9 @@ bool MetroMotion::LoadFromData(MemStream& stream) {
     }
 
     result = this->LoadInternal();
-
-    mMotionsData.clear();
+    if (!result) {
+        mMotionsData.clear();
+    }
 
     return result;
 }
@@ -274,9 +514,9 @@ bool MetroMotion::LoadFromData_2033(MemStream& stream) {
     return result;
 }
 
-bool MetroMotion::SaveToStream(MemWriteStream& stream) {
+bool MetroMotion::SaveToStream(MemWriteStream& stream, const MetroMotionOptimizeParams* optimizeParams, MetroMotionOptimizeStats* optimizeStats) {
     MemWriteStream motionDataStream;
-    this->WriteMotionData(motionDataStream);
+    this->WriteMotionData(motionDataStream, optimizeParams, optimizeStats);
 
     // write header chunk
     {
@@ -358,13 +598,11 @@ bool MetroMotion::IsBoneAnimated(const size_t boneIdx) const {
 quat MetroMotion::GetBoneRotation(const size_t boneIdx, const size_t key) const {
     quat result(1.0f, 0.0f, 0.0f, 0.0f);
 
-    if (!mBonesRotations.empty()) {
-        const AttributeCurve& curve = mBonesRotations[boneIdx];
-        if (!curve.points.empty()) {
-            const float timing = scast<float>(key) / scast<float>(kFrameRate);
-            vec4 v = Util_CurveResolve<quat>(curve, timing, QuatSlerp);
-            result = *rcast<const quat*>(&v);
-        }
+    const MotionCurveReader curve = Util_GetCurveReader(*this, mBonesRotations, mPackedBonesRotations, boneIdx, 4);
+    if (curve.GetNumPoints()) {
+        const float timing = scast<float>(key) / scast<float>(kFrameRate);
+        vec4 v = Util_CurveResolve<quat>(curve, timing, QuatSlerp);
+        result = *rcast<const quat*>(&v);
     }
 
     return result;
@@ -373,12 +611,10 @@ quat MetroMotion::GetBoneRotation(const size_t boneIdx, const size_t key) const
 vec3 MetroMotion::GetBonePosition(const size_t boneIdx, const size_t key) const {
     vec3 result(0.0f);
 
-    if (!mBonesPositions.empty()) {
-        const AttributeCurve& curve = mBonesPositions[boneIdx];
-        if (!curve.points.empty()) {
-            const float timing = scast<float>(key) / scast<float>(kFrameRate);
-            result = Util_CurveResolve<vec4>(curve, timing, Lerp<vec4>);
-        }
+    const MotionCurveReader curve = Util_GetCurveReader(*this, mBonesPositions, mPackedBonesPositions, boneIdx, 3);
+    if (curve.GetNumPoints()) {
+        const float timing = scast<float>(key) / scast<float>(kFrameRate);
+        result = Util_CurveResolve<vec4>(curve, timing, Lerp<vec4>);
     }
 
     return result;
@@ -387,27 +623,83 @@ vec3 MetroMotion::GetBonePosition(const size_t boneIdx, const size_t key) const
 vec3 MetroMotion::GetBoneScale(const size_t boneIdx, const size_t key) const {
     vec3 result(0.0f);
 
-    if (!mBonesScales.empty()) {
-        const AttributeCurve& curve = mBonesScales[boneIdx];
-        if (!curve.points.empty()) {
-            const float timing = scast<float>(key) / scast<float>(kFrameRate);
-            result = Util_CurveResolve<vec4>(curve, timing, Lerp<vec4>);
+    const MotionCurveReader curve = Util_GetCurveReader(*this, mBonesScales, mPackedBonesScales, boneIdx, 3);
+    if (curve.GetNumPoints()) {
+        const float timing = scast<float>(key) / scast<float>(kFrameRate);
+        result = Util_CurveResolve<vec4>(curve, timing, Lerp<vec4>);
+    }
+
+    return result;
+}
+
+bool MetroMotion::HasBoneScales(const size_t boneIdx) const {
+    return Util_GetCurveReader(*this, mBonesScales, mPackedBonesScales, boneIdx, 3).GetNumPoints() > 0;
+}
+
+AttributeCurve MetroMotion::GetBoneRotationsCurve(const size_t boneIdx) const {
+    AttributeCurve result;
+    Util_DecodeCurve(Util_GetCurveReader(*this, mBonesRotations, mPackedBonesRotations, boneIdx, 4), result);
+    return result;
+}
+
+AttributeCurve MetroMotion::GetBonePositionsCurve(const size_t boneIdx) const {
+    AttributeCurve result;
+    Util_DecodeCurve(Util_GetCurveReader(*this, mBonesPositions, mPackedBonesPositions, boneIdx, 3), result);
+    return result;
+}
+
+AttributeCurve MetroMotion::GetBoneScalesCurve(const size_t boneIdx) const {
+    AttributeCurve result;
+    Util_DecodeCurve(Util_GetCurveReader(*this, mBonesScales, mPackedBonesScales, boneIdx, 3), result);
+    return result;
+}
+
+size_t MetroMotion::GetMemorySize() const {
+    size_t result = sizeof(MetroMotion) + mMotionsData.size();
+
+    for (const MyArray<PackedCurve>* packed : { &mPackedBonesRotations, &mPackedBonesPositions, &mPackedBonesScales,
+                                                &mPackedLocatorsRotations, &mPackedLocatorsPositions, &mPackedLocatorsScales }) {
+        result += packed->size() * sizeof(PackedCurve);
+    }
+
+    for (const MyArray<AttributeCurve>* curves : { &mBonesRotations, &mBonesPositions, &mBonesScales,
+                                                   &mLocatorsRotations, &mLocatorsPositions, &mLocatorsScales,
+                                                   &mXFormsRotations, &mXFormsPositions, &mXFormsScales }) {
+        for (const AttributeCurve& c : *curves) {
+            result += sizeof(AttributeCurve) + c.points.size() * sizeof(AttributeCurve::AttribPoint);
         }
     }
 
+    if (mBakedTracks) {
+        result += mBakedTracks->GetMemorySize();
+    }
+
     return result;
 }
 
+bool MetroMotion::BakeTracks() {
+    if (!mBakedTracks) {
+        StrongPtr<MetroMotionBaked> baked = MakeStrongPtr<MetroMotionBaked>();
+        if (baked->Bake(*this)) {
+            mBakedTracks = std::move(baked);
+        }
+    }
+
+    return mBakedTracks != nullptr;
+}
+
+const MetroMotionBaked* MetroMotion::GetBakedTracks() const {
+    return mBakedTracks.get();
+}
+
 quat MetroMotion::GetLocatorRotation(const size_t boneIdx, const size_t key) const {
     quat result(1.0f, 0.0f, 0.0f, 0.0f);
 
-    if (!mLocatorsRotations.empty()) {
-        const AttributeCurve& curve = mLocatorsRotations[boneIdx];
-        if (!curve.points.empty()) {
-            const float timing = scast<float>(key) / scast<float>(kFrameRate);
-            vec4 v = Util_CurveResolve<quat>(curve, timing, QuatSlerp);
-            result = *rcast<const quat*>(&v);
-        }
+    const MotionCurveReader curve = Util_GetCurveReader(*this, mLocatorsRotations, mPackedLocatorsRotations, boneIdx, 4);
+    if (curve.GetNumPoints()) {
+        const float timing = scast<float>(key) / scast<float>(kFrameRate);
+        vec4 v = Util_CurveResolve<quat>(curve, timing, QuatSlerp);
+        result = *rcast<const quat*>(&v);
     }
 
     return result;
@@ -416,12 +708,10 @@ quat MetroMotion::GetLocatorRotation(const size_t boneIdx, const size_t key) con
 vec3 MetroMotion::GetLocatorPosition(const size_t boneIdx, const size_t key) const {
     vec3 result(0.0f);
 
-    if (!mLocatorsPositions.empty()) {
-        const AttributeCurve& curve = mLocatorsPositions[boneIdx];
-        if (!curve.points.empty()) {
-            const float timing = scast<float>(key) / scast<float>(kFrameRate);
-            result = Util_CurveResolve<vec4>(curve, timing, Lerp<vec4>);
-        }
+    const MotionCurveReader curve = Util_GetCurveReader(*this, mLocatorsPositions, mPackedLocatorsPositions, boneIdx, 3);
+    if (curve.GetNumPoints()) {
+        const float timing = scast<float>(key) / scast<float>(kFrameRate);
+        result = Util_CurveResolve<vec4>(curve, timing, Lerp<vec4>);
     }
 
     return result;
@@ -430,12 +720,10 @@ vec3 MetroMotion::GetLocatorPosition(const size_t boneIdx, const size_t key) con
 vec3 MetroMotion::GetLocatorScale(const size_t boneIdx, const size_t key) const {
     vec3 result(0.0f);
 
-    if (!mLocatorsScales.empty()) {
-        const AttributeCurve& curve = mLocatorsScales[boneIdx];
-        if (!curve.points.empty()) {
-            const float timing = scast<float>(key) / scast<float>(kFrameRate);
-            result = Util_CurveResolve<vec4>(curve, timing, Lerp<vec4>);
-        }
+    const MotionCurveReader curve = Util_GetCurveReader(*this, mLocatorsScales, mPackedLocatorsScales, boneIdx, 3);
+    if (curve.GetNumPoints()) {
+        const float timing = scast<float>(key) / scast<float>(kFrameRate);
+        result = Util_CurveResolve<vec4>(curve, timing, Lerp<vec4>);
     }
 
     return result;
@@ -529,6 +817,8 @@ void MetroMotion::ReadInfoChunk_2033(MemStream& stream) {
 }
 
 void MetroMotion::ReadBonesMotionChunk_2033(MemStream& stream) {
+    mBakedTracks.reset();
+
     mBonesRotations.resize(mNumBones);
     mBonesPositions.resize(mNumBones);
 
@@ -542,17 +832,6 @@ void MetroMotion::ReadBonesMotionChunk_2033(MemStream& stream) {
     }
 }
 
-enum class AttribCurveType : uint8_t {
-    Invalid         = 0,
-    Uncompressed    = 1,    // raw float values
-    OneValue        = 2,    // constant value, no curve
-    Unknown_3       = 3,
-    CompressedPos   = 4,    // quantized position, scale + offset + u16 values
-    CompressedQuat  = 5,    // quantized quaternion (xyz, we restore w), s16_snorm values
-    Unknown_6       = 6,
-    Empty           = 7     // no curve, why not just filter it out with mask ???
-};
-
 bool MetroMotion::LoadInternal() {
     bool result = false;
 
@@ -572,14 +851,36 @@ bool MetroMotion::LoadInternal() {
             stopBswapIdx = numOffsetsToSwap;
         }
 
-        mBonesRotations.resize(mNumBones);
-        mBonesPositions.resize(mNumBones);
+        mBakedTracks.reset();
+
+        //#NOTE_SK: curves stay packed in mMotionsData, we only remember where each one is,
+        //          readers decode them on the fly, so a loaded motion costs about its file size
+        mBonesRotations.clear();
+        mBonesPositions.clear();
+        mBonesScales.clear();
+        mLocatorsRotations.clear();
+        mLocatorsPositions.clear();
+        mLocatorsScales.clear();
+
+        mPackedBonesRotations.assign(mNumBones, PackedCurve{});
+        mPackedBonesPositions.assign(mNumBones, PackedCurve{});
+        mPackedBonesScales.clear();
+        mPackedLocatorsRotations.clear();
+        mPackedLocatorsPositions.clear();
+        mPackedLocatorsScales.clear();
 
         const size_t offsetsStride = (MetroContext::Get().GetGameVersion() == MetroGameVersion::OGLastLight) ? 2 : 3;
         if (offsetsStride == 3) {
-            mBonesScales.resize(mNumBones);
+            mPackedBonesScales.assign(mNumBones, PackedCurve{});
         }
 
+        auto makePackedCurve = [this, offsetsTable, stopBswapIdx](const size_t offsetIdx, const size_t bswapIdx) -> PackedCurve {
+            PackedCurve result;
+            result.offset = offsetsTable[offsetIdx];
+            result.bswap = (mVersion < kMotionVersionArktika1) && (bswapIdx < stopBswapIdx);
+            return result;
+        };
+
         size_t flatIdx = 0;
         for (size_t boneIdx = 0; boneIdx < mNumBones; ++boneIdx) {
             const bool bonePresent = mAffectedBones.IsPresent(boneIdx);
@@ -589,16 +890,12 @@ bool MetroMotion::LoadInternal() {
                 const size_t offsetQIdx = flatIdx * offsetsStride + 0;
                 const size_t offsetTIdx = flatIdx * offsetsStride + 1;
 
-                const size_t offsetQ = offsetsTable[offsetQIdx];
-                const size_t offsetT = offsetsTable[offsetTIdx];
-
-                this->ReadAttributeCurve(ptr + offsetQ, mBonesRotations[boneIdx], 4, offsetQIdx >= stopBswapIdx);
-                this->ReadAttributeCurve(ptr + offsetT, mBonesPositions[boneIdx], 3, offsetTIdx >= stopBswapIdx);
+                mPackedBonesRotations[boneIdx] = makePackedCurve(offsetQIdx, offsetQIdx);
+                mPackedBonesPositions[boneIdx] = makePackedCurve(offsetTIdx, offsetTIdx);
 
                 if (offsetsStride == 3) {
                     const size_t offsetSIdx = flatIdx * offsetsStride + 2;
-                    const size_t offsetS = offsetsTable[offsetSIdx];
-                    this->ReadAttributeCurve(ptr + offsetS, mBonesScales[boneIdx], 3, offsetSIdx >= stopBswapIdx);
+                    mPackedBonesScales[boneIdx] = makePackedCurve(offsetSIdx, offsetSIdx);
                 }
 
                 ++flatIdx;
@@ -606,26 +903,22 @@ bool MetroMotion::LoadInternal() {
         }
 
         if (mNumLocators) {
-            mLocatorsRotations.resize(mNumLocators);
-            mLocatorsPositions.resize(mNumLocators);
+            mPackedLocatorsRotations.assign(mNumLocators, PackedCurve{});
+            mPackedLocatorsPositions.assign(mNumLocators, PackedCurve{});
             if (offsetsStride == 3) {
-                mLocatorsScales.resize(mNumLocators);
+                mPackedLocatorsScales.assign(mNumLocators, PackedCurve{});
             }
 
             for (size_t locatorIdx = 0; locatorIdx < mNumLocators; ++locatorIdx, ++flatIdx) {
                 const size_t offsetQIdx = flatIdx * offsetsStride + 0;
                 const size_t offsetTIdx = flatIdx * offsetsStride + 1;
 
-                const size_t offsetQ = offsetsTable[offsetQIdx];
-                const size_t offsetT = offsetsTable[offsetTIdx];
-
-                this->ReadAttributeCurve(ptr + offsetQ, mLocatorsRotations[locatorIdx], 4, offsetQIdx >= stopBswapIdx);
-                this->ReadAttributeCurve(ptr + offsetT, mLocatorsPositions[locatorIdx], 3, offsetTIdx >= stopBswapIdx);
+                mPackedLocatorsRotations[locatorIdx] = makePackedCurve(offsetQIdx, offsetQIdx);
+                mPackedLocatorsPositions[locatorIdx] = makePackedCurve(offsetTIdx, offsetTIdx);
 
                 if (offsetsStride == 3) {
                     const size_t offsetSIdx = flatIdx * offsetsStride + 2;
-                    const size_t offsetS = offsetsTable[offsetSIdx];
-                    this->ReadAttributeCurve(ptr + offsetS, mLocatorsScales[locatorIdx], 3, offsetTIdx >= stopBswapIdx);
+                    mPackedLocatorsScales[locatorIdx] = makePackedCurve(offsetSIdx, offsetTIdx);
                 }
 
                 ++flatIdx;
@@ -665,160 +958,9 @@ bool MetroMotion::LoadInternal() {
     return result;
 }
 
-inline vec3 EndianSwapBytes(const vec3& v) {
-    return vec3(EndianSwapBytes(v.x), EndianSwapBytes(v.y), EndianSwapBytes(v.z));
-}
-
-inline vec4 EndianSwapBytes(const vec4& v) {
-    return vec4(EndianSwapBytes(v.x), EndianSwapBytes(v.y), EndianSwapBytes(v.z), EndianSwapBytes(v.w));
-}
-
 void MetroMotion::ReadAttributeCurve(const uint8_t* curveData, AttributeCurve& curve, const size_t attribSize, const bool disableBswap) {
-    uint32_t curveHeader = *rcast<const uint32_t*>(curveData);
-    if (mVersion < kMotionVersionArktika1 && !disableBswap) {
-        curveHeader = EndianSwapBytes(curveHeader);
-    }
-
-    const size_t numPoints = scast<size_t>(curveHeader & 0xFFFF);
-    const size_t pointSize = ((curveHeader >> 24) & 0xF);
-    const AttribCurveType ctype = scast<AttribCurveType>((curveHeader >> 16) & 0xF);
-
-    assert(pointSize == attribSize);
-    assert(attribSize <= 4);
-
-    curveData += 4;
-
-    if (ctype == AttribCurveType::Empty) {
-        curve.points.clear();
-    } else if (ctype == AttribCurveType::OneValue) {
-        curve.points.resize(1);
-        auto& p = curve.points.back();
-        p.time = 0.0f;
-        memcpy(&p.value, curveData, attribSize * sizeof(float));
-
-        if (mVersion < kMotionVersionArktika1 && !disableBswap) {
-            p.value = EndianSwapBytes(p.value);
-        }
-    } else if (ctype == AttribCurveType::Unknown_3 || ctype == AttribCurveType::Unknown_6) {
-        assert(false);
-    } else {
-        curve.points.resize(numPoints);
-
-        switch (ctype) {
-            case AttribCurveType::Uncompressed: {
-                const float* timingsPtr = rcast<const float*>(curveData);
-                const float* valuesPtr = rcast<const float*>(curveData + (numPoints * sizeof(float)));
-
-                for (auto& p : curve.points) {
-                    p.time = *timingsPtr;
-                    memcpy(&p.value, valuesPtr, attribSize * sizeof(float));
-
-                    if (mVersion < kMotionVersionArktika1 && !disableBswap) {
-                        p.time = EndianSwapBytes(p.time);
-                        p.value = EndianSwapBytes(p.value);
-                    }
-
-                    timingsPtr++;
-                    valuesPtr += attribSize;
-                }
-            } break;
-
-            case AttribCurveType::CompressedPos: {
-                float timingScale = *rcast<const float*>(curveData);
-                curveData += 4;
-
-                vec3 scale = rcast<const vec3*>(curveData)[0];
-                vec3 offset = rcast<const vec3*>(curveData)[1];
-                curveData += sizeof(vec3[2]);
-
-                if (mVersion < kMotionVersionArktika1 && !disableBswap) {
-                    timingScale = 1.0f / EndianSwapBytes(timingScale);
-                    scale = EndianSwapBytes(scale);
-                    offset = EndianSwapBytes(offset);
-                } else {
-                    timingScale = 1.0f / timingScale;
-                }
-
-                const uint16_t* timingsPtr = rcast<const uint16_t*>(curveData);
-                const uint16_t* valuesPtr = rcast<const uint16_t*>(curveData + (numPoints * sizeof(uint16_t)));
-
-                for (auto& p : curve.points) {
-                    uint16_t pt = *timingsPtr;
-                    uint16_t px = valuesPtr[0];
-                    uint16_t py = valuesPtr[1];
-                    uint16_t pz = valuesPtr[2];
-
-                    if (mVersion < kMotionVersionArktika1 && !disableBswap) {
-                        pt = EndianSwapBytes(pt);
-                        px = EndianSwapBytes(px);
-                        py = EndianSwapBytes(py);
-                        pz = EndianSwapBytes(pz);
-                    }
-
-                    p.time = scast<float>(pt) * timingScale;
-
-                    p.value.x = scast<float>(px) * scale.x + offset.x;
-                    p.value.y = scast<float>(py) * scale.y + offset.y;
-                    p.value.z = scast<float>(pz) * scale.z + offset.z;
-
-                    timingsPtr++;
-                    valuesPtr += 3;
-                }
-            } break;
-
-            case AttribCurveType::CompressedQuat: {
-                const float normFactor = 0.0000215805f; // (1 / 32766) * (1 / sqrt(2))
-                float timingScale = *rcast<const float*>(curveData);
-                curveData += 4;
-
-                if (mVersion < kMotionVersionArktika1 && !disableBswap) {
-                    timingScale = 1.0f / EndianSwapBytes(timingScale);
-                } else {
-                    timingScale = 1.0f / timingScale;
-                }
-
-                const uint16_t* timingsPtr = rcast<const uint16_t*>(curveData);
-                const int16_t* valuesPtr = rcast<const int16_t*>(curveData + (numPoints * sizeof(uint16_t)));
-
-                for (auto& p : curve.points) {
-                    uint16_t pt = *timingsPtr;
-                    int16_t px = valuesPtr[0];
-                    int16_t py = valuesPtr[1];
-                    int16_t pz = valuesPtr[2];
-
-                    if (mVersion < kMotionVersionArktika1 && !disableBswap) {
-                        pt = EndianSwapBytes(pt);
-                        px = EndianSwapBytes(px);
-                        py = EndianSwapBytes(py);
-                        pz = EndianSwapBytes(pz);
-                    }
-
-                    p.time = scast<float>(pt) * timingScale;
-
-                    const int permutation = (py & 1) | (2 * (px & 1));
-                    const int wsign = (pz & 1);
-
-                    const float qx = scast<float>(px) * normFactor;
-                    const float qy = scast<float>(py) * normFactor;
-                    const float qz = scast<float>(pz) * normFactor;
-                    const float t = 1.0f - (qx * qx) - (qy * qy) - (qz * qz);
-                    const float qw = (t < 0.0f) ? 0.0f : (wsign ? -std::sqrtf(t) : std::sqrtf(t));
-
-                    switch (permutation) {
-                        case 0: p.value = vec4(qw, qx, qy, qz); break;
-                        case 1: p.value = vec4(qx, qw, qy, qz); break;
-                        case 2: p.value = vec4(qx, qy, qw, qz); break;
-                        case 3: p.value = vec4(qx, qy, qz, qw); break;
-                    }
-
-                    *rcast<quat*>(&p.value) = Normalize(*rcast<quat*>(&p.value));
-
-                    timingsPtr++;
-                    valuesPtr += 3;
-                }
-            } break;
-        }
-    }
+    const bool bswap = (mVersion < kMotionVersionArktika1) && !disableBswap;
+    Util_DecodeCurve(MotionCurveReader(curveData, attribSize, bswap), curve);
 }
 
 void MetroMotion::ReadBoneCurve_2033(MemStream& stream, AttributeCurve& rotations, AttributeCurve& positions) {
@@ -902,7 +1044,7 @@ void MetroMotion::ReadBoneCurve_2033(MemStream& stream, AttributeCurve& rotation
     }
 }
 
-void MetroMotion::WriteMotionData(MemWriteStream& stream) {
+void MetroMotion::WriteMotionData(MemWriteStream& stream, const MetroMotionOptimizeParams* optimizeParams, MetroMotionOptimizeStats* optimizeStats) {
     MemWriteStream motionDataHdrStream;
 
     size_t totalSizeOffset = 0;
@@ -931,20 +1073,24 @@ void MetroMotion::WriteMotionData(MemWriteStream& stream) {
     MemWriteStream curvesDataStream;
     const size_t numOffsetsToSwap = (mVersion < kMotionVersionArktika1) ? this->CalcNumOffsetsToBSwap() : 0;
 
+    // stats accumulate over all the saved motions, this motion only adds its own curves
+    const size_t curvesSizeBefore = optimizeStats ? optimizeStats->curvesSizeBefore : 0;
+
     MyArray<uint32_t> offsetsTable;
     size_t flatIdx = 0;
     for (size_t i = 0; i < mNumBones; ++i) {
+        // loaded motions only have the packed curves, decode them one at a time
         // Q
         offsetsTable.push_back(scast<uint32_t>(curvesDataStream.GetWrittenBytesCount()));
-        this->WriteMotionCurve(curvesDataStream, mBonesRotations[i], 4, flatIdx >= numOffsetsToSwap);
+        this->WriteBoneCurve(curvesDataStream, this->GetBoneRotationsCurve(i), MotionCurveChannel::Rotation, flatIdx >= numOffsetsToSwap, optimizeParams, optimizeStats);
         ++flatIdx;
         // T
         offsetsTable.push_back(scast<uint32_t>(curvesDataStream.GetWrittenBytesCount()));
-        this->WriteMotionCurve(curvesDataStream, mBonesPositions[i], 3, flatIdx >= numOffsetsToSwap);
+        this->WriteBoneCurve(curvesDataStream, this->GetBonePositionsCurve(i), MotionCurveChannel::Position, flatIdx >= numOffsetsToSwap, optimizeParams, optimizeStats);
         ++flatIdx;
         // S
         offsetsTable.push_back(scast<uint32_t>(curvesDataStream.GetWrittenBytesCount()));
-        this->WriteMotionCurve(curvesDataStream, mBonesScales[i], 3, flatIdx >= numOffsetsToSwap);
+        this->WriteBoneCurve(curvesDataStream, this->GetBoneScalesCurve(i), MotionCurveChannel::Scale, flatIdx >= numOffsetsToSwap, optimizeParams, optimizeStats);
         ++flatIdx;
     }
 
@@ -965,6 +1111,11 @@ void MetroMotion::WriteMotionData(MemWriteStream& stream) {
     mMotionsDataSize = offsetAddition + curvesDataStream.GetWrittenBytesCount();
     mMotionsOffsetsSize = offsetsTableSize;
 
+    if (optimizeParams && optimizeStats) {
+        optimizeStats->dataSizeBefore += offsetAddition + (optimizeStats->curvesSizeBefore - curvesSizeBefore);
+        optimizeStats->dataSizeAfter += mMotionsDataSize;
+    }
+
     uint32_t& totalSizeToFixUp = *rcast<uint32_t*>(rcast<uint8_t*>(motionDataHdrStream.Data()) + totalSizeOffset);
     totalSizeToFixUp = (mVersion < kMotionVersionArktika1) ? EndianSwapBytes(scast<uint32_t>(mMotionsDataSize)) : scast<uint32_t>(mMotionsDataSize);
 
@@ -1009,3 +1160,154 @@ void MetroMotion::WriteMotionCurve(MemWriteStream& stream, const AttributeCurve&
         }
     }
 }
+
+void MetroMotion::WriteBoneCurve(MemWriteStream& stream,
+                                 const AttributeCurve& curve,
+                                 const MotionCurveChannel channel,
+                                 const bool disableBswap,
+                                 const MetroMotionOptimizeParams* optimizeParams,
+                                 MetroMotionOptimizeStats* optimizeStats) {
+    const size_t attribSize = (channel == MotionCurveChannel::Rotation) ? 4 : 3;
+
+    MetroMotionOptimizedCurve optimized;
+    if (optimizeParams && MOT_OptimizeCurve(curve, channel, *optimizeParams, optimized, optimizeStats)) {
+        this->WriteOptimizedMotionCurve(stream, optimized, attribSize, disableBswap);
+    } else {
+        this->WriteMotionCurve(stream, curve, attribSize, disableBswap);
+    }
+}
+
+void MetroMotion::WriteOptimizedMotionCurve(MemWriteStream& stream, const MetroMotionOptimizedCurve& curve, const size_t attribSize, const bool disableBswap) {
+    using Storage = MetroMotionOptimizedCurve::Storage;
+
+    AttribCurveType ctype = AttribCurveType::Empty;
+    switch (curve.storage) {
+        case Storage::OneValue:         ctype = AttribCurveType::OneValue;          break;
+        case Storage::Uncompressed:     ctype = AttribCurveType::Uncompressed;      break;
+        case Storage::CompressedPos:    ctype = AttribCurveType::CompressedPos;     break;
+        case Storage::CompressedQuat:   ctype = AttribCurveType::CompressedQuat;    break;
+        default:                                                                    break;
+    }
+
+    const uint32_t numPoints = scast<uint32_t>(curve.GetNumKeys()) & 0xFFFF;
+    const uint32_t pointSize = attribSize & 0xF;
+    const uint32_t curveHeader = (pointSize << 24) | (scast<uint32_t>(ctype) << 16) | numPoints;
+    stream.WriteU32(disableBswap ? curveHeader : EndianSwapBytes(curveHeader));
+
+    auto writeF32 = [&stream, disableBswap](const float f) {
+        stream.WriteF32(disableBswap ? f : EndianSwapBytes(f));
+    };
+    auto writeU16 = [&stream, disableBswap](const uint16_t u) {
+        stream.WriteU16(disableBswap ? u : EndianSwapBytes(u));
+    };
+
+    switch (curve.storage) {
+        case Storage::OneValue: {
+            for (size_t i = 0; i < attribSize; ++i) {
+                writeF32(curve.values.front()[scast<int>(i)]);
+            }
+        } break;
+
+        case Storage::Uncompressed: {
+            // timings
+            for (const float t : curve.times) {
+                writeF32(t);
+            }
+            // values
+            for (const vec4& value : curve.values) {
+                for (size_t i = 0; i < attribSize; ++i) {
+                    writeF32(value[scast<int>(i)]);
+                }
+            }
+        } break;
+
+        case Storage::CompressedPos:
+        case Storage::CompressedQuat: {
+            writeF32(curve.timingsPerSecond);
+            if (curve.storage == Storage::CompressedPos) {
+                writeF32(curve.scale.x);
+                writeF32(curve.scale.y);
+                writeF32(curve.scale.z);
+                writeF32(curve.offset.x);
+                writeF32(curve.offset.y);
+                writeF32(curve.offset.z);
+            }
+            for (const uint16_t t : curve.timings) {
+                writeU16(t);
+            }
+            for (const uint16_t q : curve.quantized) {
+                writeU16(q);
+            }
+        } break;
+
+        default:
+            break;
+    }
+}
+
+
+MetroMotionSampler::MetroMotionSampler(const MetroMotion* motion)
+    : mMotion(nullptr)
+{
+    this->SetMotion(motion);
+}
+MetroMotionSampler::~MetroMotionSampler() {
+}
+
+void MetroMotionSampler::SetMotion(const MetroMotion* motion) {
+    mMotion = motion;
+
+    mCursors.clear();
+    if (mMotion) {
+        const size_t numTracks = std::max({ mMotion->GetNumBones(), mMotion->mBonesRotations.size(), mMotion->mBonesPositions.size(), mMotion->mBonesScales.size() });
+        mCursors.resize(numTracks * Track_Count, 0);
+    }
+}
+
+const MetroMotion* MetroMotionSampler::GetMotion() const {
+    return mMotion;
+}
+
+void MetroMotionSampler::ResetCursors() {
+    std::fill(mCursors.begin(), mCursors.end(), 0);
+}
+
+quat MetroMotionSampler::GetBoneRotation(const size_t boneIdx, const float time) {
+    quat result(1.0f, 0.0f, 0.0f, 0.0f);
+
+    if (mMotion && boneIdx * Track_Count < mCursors.size()) {
+        const MotionCurveReader curve = Util_GetCurveReader(*mMotion, mMotion->mBonesRotations, mMotion->mPackedBonesRotations, boneIdx, 4);
+        if (curve.GetNumPoints()) {
+            vec4 v = Util_CurveResolveCached<quat>(curve, time, mCursors[boneIdx * Track_Count + Track_Rotation], QuatSlerp);
+            result = *rcast<const quat*>(&v);
+        }
+    }
+
+    return result;
+}
+
+vec3 MetroMotionSampler::GetBonePosition(const size_t boneIdx, const float time) {
+    vec3 result(0.0f);
+
+    if (mMotion && boneIdx * Track_Count < mCursors.size()) {
+        const MotionCurveReader curve = Util_GetCurveReader(*mMotion, mMotion->mBonesPositions, mMotion->mPackedBonesPositions, boneIdx, 3);
+        if (curve.GetNumPoints()) {
+            result = Util_CurveResolveCached<vec4>(curve, time, mCursors[boneIdx * Track_Count + Track_Position], Lerp<vec4>);
+        }
+    }
+
+    return result;
+}
+
+vec3 MetroMotionSampler::GetBoneScale(const size_t boneIdx, const float time) {
+    vec3 result(0.0f);
+
+    if (mMotion && boneIdx * Track_Count < mCursors.size()) {
+        const MotionCurveReader curve = Util_GetCurveReader(*mMotion, mMotion->mBonesScales, mMotion->mPackedBonesScales, boneIdx, 3);
+        if (curve.GetNumPoints()) {
+            result = Util_CurveResolveCached<vec4>(curve, time, mCursors[boneIdx * Track_Count + Track_Scale], Lerp<vec4>);
+        }
+    }
+
+    return result;
+}
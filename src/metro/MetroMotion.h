@@ -1,6 +1,12 @@
 #pragma once
 #include "MetroTypes.h"
 
+class MetroMotionBaked;
+struct MetroMotionOptimizeParams;
+struct MetroMotionOptimizeStats;
+struct MetroMotionOptimizedCurve;
+enum class MotionCurveChannel : uint8_t;
+
 struct AttributeCurve {
     struct AttribPoint {
         float   time;
@@ -26,6 +32,12 @@ class MetroMotion {
 public:
     static const size_t kFrameRate = 30;
 
+    // curve left packed in mMotionsData the way it was loaded, decoded on the fly when sampled
+    struct PackedCurve {
+        uint32_t    offset;     // 0 is no curve
+        bool        bswap;
+    };
+
 public:
     MetroMotion(const CharString& name = kEmptyString);
     ~MetroMotion();
@@ -37,7 +49,8 @@ public:
     bool                    LoadHeader_2033(MemStream& stream);
     bool                    LoadFromData_2033(MemStream& stream);
 
-    bool                    SaveToStream(MemWriteStream& stream);
+    // optimizeParams enable the keys reduction and per track compression (see MetroMotionOptimizer.h), stats are optional
+    bool                    SaveToStream(MemWriteStream& stream, const MetroMotionOptimizeParams* optimizeParams = nullptr, MetroMotionOptimizeStats* optimizeStats = nullptr);
 
     const CharString&       GetName() const;
 
@@ -52,6 +65,17 @@ public:
     quat                    GetBoneRotation(const size_t boneIdx, const size_t key) const;
     vec3                    GetBonePosition(const size_t boneIdx, const size_t key) const;
     vec3                    GetBoneScale(const size_t boneIdx, const size_t key) const;
+    bool                    HasBoneScales(const size_t boneIdx) const;
+    // decoded copies of the bone curves, for the tools that need the keys themselves (export, save)
+    AttributeCurve          GetBoneRotationsCurve(const size_t boneIdx) const;
+    AttributeCurve          GetBonePositionsCurve(const size_t boneIdx) const;
+    AttributeCurve          GetBoneScalesCurve(const size_t boneIdx) const;
+    // what the motion holds in memory: packed data, decoded curves and baked tracks
+    size_t                  GetMemorySize() const;
+
+    // uniform rate copy of the bones tracks for batch sampling (see MetroMotionBaked), the curves stay as they are
+    bool                    BakeTracks();
+    const MetroMotionBaked* GetBakedTracks() const;
 
     // locators
     quat                    GetLocatorRotation(const size_t boneIdx, const size_t key) const;
@@ -71,8 +95,10 @@ public:
     void                    ReadAttributeCurve(const uint8_t* curveData, AttributeCurve& curve, const size_t attribSize, const bool disableBswap);
     void                    ReadBoneCurve_2033(MemStream& stream, AttributeCurve& rotations, AttributeCurve& positions);
 
-    void                    WriteMotionData(MemWriteStream& stream);
+    void                    WriteMotionData(MemWriteStream& stream, const MetroMotionOptimizeParams* optimizeParams, MetroMotionOptimizeStats* optimizeStats);
+    void                    WriteBoneCurve(MemWriteStream& stream, const AttributeCurve& curve, const MotionCurveChannel channel, const bool disableBswap, const MetroMotionOptimizeParams* optimizeParams, MetroMotionOptimizeStats* optimizeStats);
     void                    WriteMotionCurve(MemWriteStream& stream, const AttributeCurve& curve, const size_t attribSize, const bool disableBswap);
+    void                    WriteOptimizedMotionCurve(MemWriteStream& stream, const MetroMotionOptimizedCurve& curve, const size_t attribSize, const bool disableBswap);
 
 //private:
     CharString              mName;
@@ -97,8 +123,14 @@ public:
     Bitset256               mHighQualityBones;
     // data
     MotionDataHeader        mMotionDataHeader;  // Last Light and newer
-    BytesArray              mMotionsData;
-    // curves
+    BytesArray              mMotionsData;       // kept after loading, the packed curves point into it
+    MyArray<PackedCurve>    mPackedBonesRotations;
+    MyArray<PackedCurve>    mPackedBonesPositions;
+    MyArray<PackedCurve>    mPackedBonesScales;
+    MyArray<PackedCurve>    mPackedLocatorsRotations;
+    MyArray<PackedCurve>    mPackedLocatorsPositions;
+    MyArray<PackedCurve>    mPackedLocatorsScales;
+    // curves, decoded ones (imported or 2033 motions) take precedence over the packed ones
     //  bones
     MyArray<AttributeCurve> mBonesRotations;
     MyArray<AttributeCurve> mBonesPositions;
@@ -111,4 +143,36 @@ public:
     MyArray<AttributeCurve> mXFormsRotations;
     MyArray<AttributeCurve> mXFormsPositions;
     MyArray<AttributeCurve> mXFormsScales;
+    //  baked bones tracks, optional
+    StrongPtr<MetroMotionBaked> mBakedTracks;
+};
+
+// Samples the bones of one motion, keeps the last found keyframe (cursor) of every track,
+//  so playing forward resolves every sample in O(1) amortized instead of searching the curves again.
+//  Random access still works (falls back to the binary search), one sampler per playing instance as it's not thread-safe.
+class MetroMotionSampler {
+    enum : size_t {
+        Track_Rotation = 0,
+        Track_Position,
+        Track_Scale,
+
+        Track_Count
+    };
+
+public:
+    MetroMotionSampler(const MetroMotion* motion = nullptr);
+    ~MetroMotionSampler();
+
+    void                    SetMotion(const MetroMotion* motion);
+    const MetroMotion*      GetMotion() const;
+    void                    ResetCursors();
+
+    // time is in seconds
+    quat                    GetBoneRotation(const size_t boneIdx, const float time);
+    vec3                    GetBonePosition(const size_t boneIdx, const float time);
+    vec3                    GetBoneScale(const size_t boneIdx, const float time);
+
+private:
+    const MetroMotion*      mMotion;
+    MyArray<uint32_t>       mCursors;   // Track_Count per bone
 };
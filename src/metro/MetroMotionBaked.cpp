@@ -0,0 +1,236 @@
+#include "MetroMotionBaked.h"
+#include "MetroMotion.h"
+#include "cpu_utils.h"
+
+static const float kRotationQuant   = 32767.0f;
+static const float kRotationDequant = 1.0f / 32767.0f;
+static const float kRangeQuant      = 65535.0f;
+
+
+
+MetroMotionBaked::MetroMotionBaked()
+    : mNumBones(0)
+    , mNumBonesPadded(0)
+    , mNumFrames(0)
+    , mHasScales(false)
+{
+}
+MetroMotionBaked::~MetroMotionBaked() {
+}
+
+bool MetroMotionBaked::Bake(const MetroMotion& motion) {
+    const size_t numBones = motion.GetNumBones();
+    if (!numBones || numBones > kMaxBones || !motion.GetNumFrames()) {
+        return false;
+    }
+
+    mNumBones = numBones;
+    mNumBonesPadded = (numBones + kBonesAlign - 1) & ~(kBonesAlign - 1);
+    mNumFrames = motion.GetNumFrames() + 1;
+
+    MyArray<bool> animated(numBones), scaled(numBones);
+    for (size_t i = 0; i < numBones; ++i) {
+        animated[i] = motion.IsBoneAnimated(i);
+        scaled[i] = motion.HasBoneScales(i);
+    }
+    mHasScales = std::any_of(scaled.begin(), scaled.end(), [](const bool b) { return b; });
+
+    // frames go forward, so every lookup continues from the previous one
+    MetroMotionSampler sampler(&motion);
+
+    MyArray<vec3> positions(mNumFrames * numBones, vec3(0.0f));
+    MyArray<vec3> scales(mHasScales ? (mNumFrames * numBones) : 0, vec3(1.0f));
+    mRotations.assign(mNumFrames * 4 * mNumBonesPadded, 0);
+
+    for (size_t frame = 0; frame < mNumFrames; ++frame) {
+        const float time = scast<float>(frame) / scast<float>(MetroMotion::kFrameRate);
+        int16_t* dstRotations = mRotations.data() + frame * 4 * mNumBonesPadded;
+
+        for (size_t i = 0; i < numBones; ++i) {
+            quat q(1.0f, 0.0f, 0.0f, 0.0f);
+            if (animated[i]) {
+                q = Normalize(sampler.GetBoneRotation(i, time));
+                positions[frame * numBones + i] = sampler.GetBonePosition(i, time);
+                if (scaled[i]) {
+                    scales[frame * numBones + i] = sampler.GetBoneScale(i, time);
+                }
+            }
+
+            dstRotations[0 * mNumBonesPadded + i] = scast<int16_t>(std::round(Clamp(q.x, -1.0f, 1.0f) * kRotationQuant));
+            dstRotations[1 * mNumBonesPadded + i] = scast<int16_t>(std::round(Clamp(q.y, -1.0f, 1.0f) * kRotationQuant));
+            dstRotations[2 * mNumBonesPadded + i] = scast<int16_t>(std::round(Clamp(q.z, -1.0f, 1.0f) * kRotationQuant));
+            dstRotations[3 * mNumBonesPadded + i] = scast<int16_t>(std::round(Clamp(q.w, -1.0f, 1.0f) * kRotationQuant));
+        }
+
+        // padding bones are identity, keeps the normalization away from zero length
+        for (size_t i = numBones; i < mNumBonesPadded; ++i) {
+            dstRotations[3 * mNumBonesPadded + i] = scast<int16_t>(kRotationQuant);
+        }
+    }
+
+    QuantizeRange(positions, numBones, mNumBonesPadded, mNumFrames, mPositionsRange, mPositions);
+    if (mHasScales) {
+        QuantizeRange(scales, numBones, mNumBonesPadded, mNumFrames, mScalesRange, mScales);
+    } else {
+        mScalesRange = QuantRange();
+        mScales.clear();
+    }
+
+    return true;
+}
+
+size_t MetroMotionBaked::GetNumBones() const {
+    return mNumBones;
+}
+
+size_t MetroMotionBaked::GetNumFrames() const {
+    return mNumFrames;
+}
+
+size_t MetroMotionBaked::GetNumBonesPadded() const {
+    return mNumBonesPadded;
+}
+
+bool MetroMotionBaked::HasScales() const {
+    return mHasScales;
+}
+
+size_t MetroMotionBaked::GetMemorySize() const {
+    return mRotations.size() * sizeof(int16_t) +
+           (mPositions.size() + mScales.size()) * sizeof(uint16_t) +
+           (mPositionsRange.base.size() + mPositionsRange.step.size() + mScalesRange.base.size() + mScalesRange.step.size()) * sizeof(float);
+}
+
+void MetroMotionBaked::SampleFrame(const size_t frame, quat* rotations, vec3* positions, vec3* scales) const {
+    if (!mNumFrames) {
+        return;
+    }
+
+    //#NOTE_SK: dequantized into a small SoA block first, SIMD-friendly for the decoding and cheap to scatter from
+    alignas(32) float soa[kNumFrameComponents * kMaxBones];
+    this->SampleFrameSoA(frame, soa);
+
+    const size_t stride = mNumBonesPadded;
+    for (size_t i = 0; i < mNumBones; ++i) {
+        if (rotations) {
+            rotations[i] = quat(soa[3 * stride + i], soa[0 * stride + i], soa[1 * stride + i], soa[2 * stride + i]);
+        }
+        if (positions) {
+            positions[i] = vec3(soa[4 * stride + i], soa[5 * stride + i], soa[6 * stride + i]);
+        }
+        if (scales) {
+            scales[i] = vec3(soa[7 * stride + i], soa[8 * stride + i], soa[9 * stride + i]);
+        }
+    }
+}
+
+void MetroMotionBaked::SampleFrameSoA(const size_t frame, float* dst) const {
+    static const bool sHasAVX2 = CPU_SupportsAVX2();
+
+    if (!mNumFrames) {
+        return;
+    }
+
+    const size_t clampedFrame = std::min(frame, mNumFrames - 1);
+    if (sHasAVX2) {
+        this->SampleFrameAVX2(clampedFrame, dst);
+    } else {
+        this->SampleFrameScalar(clampedFrame, dst);
+    }
+}
+
+void MetroMotionBaked::QuantizeRange(const MyArray<vec3>& values, const size_t numBones, const size_t numBonesPadded, const size_t numFrames, QuantRange& range, MyArray<uint16_t>& result) {
+    range.base.assign(3 * numBonesPadded, 0.0f);
+    range.step.assign(3 * numBonesPadded, 0.0f);
+
+    for (size_t i = 0; i < numBones; ++i) {
+        vec3 minV = values[i], maxV = values[i];
+        for (size_t frame = 1; frame < numFrames; ++frame) {
+            minV = glm::min(minV, values[frame * numBones + i]);
+            maxV = glm::max(maxV, values[frame * numBones + i]);
+        }
+
+        for (size_t c = 0; c < 3; ++c) {
+            range.base[c * numBonesPadded + i] = minV[c];
+            range.step[c * numBonesPadded + i] = (maxV[c] - minV[c]) / kRangeQuant;
+        }
+    }
+
+    result.assign(numFrames * 3 * numBonesPadded, 0);
+    for (size_t frame = 0; frame < numFrames; ++frame) {
+        uint16_t* dst = result.data() + frame * 3 * numBonesPadded;
+        for (size_t i = 0; i < numBones; ++i) {
+            const vec3& v = values[frame * numBones + i];
+            for (size_t c = 0; c < 3; ++c) {
+                const size_t idx = c * numBonesPadded + i;
+                const float step = range.step[idx];
+                dst[idx] = (step > 0.0f) ? scast<uint16_t>(Clamp(std::round((v[c] - range.base[idx]) / step), 0.0f, kRangeQuant)) : 0;
+            }
+        }
+    }
+}
+
+void MetroMotionBaked::SampleFrameScalar(const size_t frame, float* dst) const {
+    const size_t stride = mNumBonesPadded;
+    const int16_t* rotations = mRotations.data() + frame * 4 * stride;
+    const uint16_t* positions = mPositions.data() + frame * 3 * stride;
+    const uint16_t* scales = mHasScales ? (mScales.data() + frame * 3 * stride) : nullptr;
+
+    for (size_t i = 0; i < stride; ++i) {
+        vec4 q = vec4(rotations[0 * stride + i], rotations[1 * stride + i], rotations[2 * stride + i], rotations[3 * stride + i]) * kRotationDequant;
+        q /= Sqrt(glm::dot(q, q));
+
+        for (size_t c = 0; c < 4; ++c) {
+            dst[c * stride + i] = q[c];
+        }
+        for (size_t c = 0; c < 3; ++c) {
+            const size_t idx = c * stride + i;
+            dst[(4 + c) * stride + i] = mPositionsRange.base[idx] + scast<float>(positions[idx]) * mPositionsRange.step[idx];
+            dst[(7 + c) * stride + i] = scales ? (mScalesRange.base[idx] + scast<float>(scales[idx]) * mScalesRange.step[idx]) : 1.0f;
+        }
+    }
+}
+
+TARGET_AVX2 void MetroMotionBaked::SampleFrameAVX2(const size_t frame, float* dst) const {
+    const size_t stride = mNumBonesPadded;
+    const int16_t* rotations = mRotations.data() + frame * 4 * stride;
+    const uint16_t* positions = mPositions.data() + frame * 3 * stride;
+    const uint16_t* scales = mHasScales ? (mScales.data() + frame * 3 * stride) : nullptr;
+
+    const __m256 kDequant = _mm256_set1_ps(kRotationDequant);
+    const __m256 kOne = _mm256_set1_ps(1.0f);
+
+    for (size_t i = 0; i < stride; i += kBonesAlign) {
+        __m256 q[4];
+        for (size_t c = 0; c < 4; ++c) {
+            const __m128i packed = _mm_loadu_si128(rcast<const __m128i*>(rotations + c * stride + i));
+            q[c] = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(packed)), kDequant);
+        }
+
+        __m256 lenSq = _mm256_mul_ps(q[0], q[0]);
+        lenSq = _mm256_add_ps(lenSq, _mm256_mul_ps(q[1], q[1]));
+        lenSq = _mm256_add_ps(lenSq, _mm256_mul_ps(q[2], q[2]));
+        lenSq = _mm256_add_ps(lenSq, _mm256_mul_ps(q[3], q[3]));
+        const __m256 invLen = _mm256_div_ps(kOne, _mm256_sqrt_ps(lenSq));
+
+        for (size_t c = 0; c < 4; ++c) {
+            _mm256_storeu_ps(dst + c * stride + i, _mm256_mul_ps(q[c], invLen));
+        }
+
+        for (size_t c = 0; c < 3; ++c) {
+            const size_t idx = c * stride + i;
+
+            const __m128i packedT = _mm_loadu_si128(rcast<const __m128i*>(positions + idx));
+            const __m256 t = _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(packedT));
+            _mm256_storeu_ps(dst + (4 + c) * stride + i, _mm256_add_ps(_mm256_loadu_ps(mPositionsRange.base.data() + idx), _mm256_mul_ps(t, _mm256_loadu_ps(mPositionsRange.step.data() + idx))));
+
+            if (scales) {
+                const __m128i packedS = _mm_loadu_si128(rcast<const __m128i*>(scales + idx));
+                const __m256 s = _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(packedS));
+                _mm256_storeu_ps(dst + (7 + c) * stride + i, _mm256_add_ps(_mm256_loadu_ps(mScalesRange.base.data() + idx), _mm256_mul_ps(s, _mm256_loadu_ps(mScalesRange.step.data() + idx))));
+            } else {
+                _mm256_storeu_ps(dst + (7 + c) * stride + i, kOne);
+            }
+        }
+    }
+}
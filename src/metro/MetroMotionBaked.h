@@ -0,0 +1,60 @@
+#pragma once
+#include "mycommon.h"
+#include "mymath.h"
+
+class MetroMotion;
+
+// Motion resampled once at MetroMotion::kFrameRate, every bone at every frame, for the batch consumers
+//  (retargeting, export) that walk the whole motion frame by frame anyway.
+//  Every frame is a structure of arrays, one array per component with the bones padded to kBonesAlign:
+//      rotations   - int16 snorm x, y, z, w
+//      positions   - uint16 inside the per bone (and per component) range of the whole motion
+//      scales      - same as positions, only kept if the motion has any scale keys
+//  Sampling a frame is no search and no slerp, just dequantizing all the bones at once (8 per AVX2 op).
+class MetroMotionBaked {
+public:
+    static const size_t kBonesAlign = 8;
+    static const size_t kMaxBones = 256;
+    // SampleFrameSoA layout, GetNumBonesPadded() floats each: rotations x, y, z, w, positions x, y, z, scales x, y, z
+    static const size_t kNumFrameComponents = 10;
+
+public:
+    MetroMotionBaked();
+    ~MetroMotionBaked();
+
+    bool                    Bake(const MetroMotion& motion);
+
+    size_t                  GetNumBones() const;
+    size_t                  GetNumBonesPadded() const;
+    size_t                  GetNumFrames() const;      // motion frames + 1, the last frame is baked too
+    bool                    HasScales() const;
+    size_t                  GetMemorySize() const;
+
+    // frame is clamped to the baked ones, every output array must hold GetNumBones() entries, any of them may be nullptr
+    //  bones that aren't animated come out as identity rotation, zero position and unit scale
+    void                    SampleFrame(const size_t frame, quat* rotations, vec3* positions, vec3* scales) const;
+    // same, straight into kNumFrameComponents x GetNumBonesPadded() floats
+    void                    SampleFrameSoA(const size_t frame, float* dst) const;
+
+private:
+    struct QuantRange {
+        MyArray<float>      base;       // 3 x mNumBonesPadded
+        MyArray<float>      step;
+    };
+
+    static void             QuantizeRange(const MyArray<vec3>& values, const size_t numBones, const size_t numBonesPadded, const size_t numFrames, QuantRange& range, MyArray<uint16_t>& result);
+
+    void                    SampleFrameScalar(const size_t frame, float* dst) const;
+    void                    SampleFrameAVX2(const size_t frame, float* dst) const;
+
+private:
+    size_t                  mNumBones;
+    size_t                  mNumBonesPadded;
+    size_t                  mNumFrames;
+    bool                    mHasScales;
+    MyArray<int16_t>        mRotations;     // per frame 4 x mNumBonesPadded
+    MyArray<uint16_t>       mPositions;     // per frame 3 x mNumBonesPadded
+    MyArray<uint16_t>       mScales;
+    QuantRange              mPositionsRange;
+    QuantRange              mScalesRange;
+};
@@ -0,0 +1,302 @@
+#include "MetroMotionBenchmark.h"
+#include "MetroMotionBaked.h"
+#include "jansson.h"
+
+#include <chrono>
+
+
+// what Util_CurveResolve used to do before the binary search
+template <typename TConvertion, typename TLerpFunc>
+static vec4 Bench_CurveResolveLinear(const AttributeCurve& curve, const float curveT, TLerpFunc lerpFunc) {
+    const size_t numPoints = curve.points.size();
+    if (numPoints == 1) {
+        return curve.points.front().value;
+    }
+
+    size_t pointB = numPoints;
+    for (size_t i = 0; i < numPoints; ++i) {
+        if (curve.points[i].time >= curveT) {
+            pointB = i;
+            break;
+        }
+    }
+
+    if (pointB == 0 || pointB == numPoints) {
+        return curve.points[pointB ? (numPoints - 1) : 0].value;
+    }
+
+    const auto& pA = curve.points[pointB - 1];
+    const auto& pB = curve.points[pointB];
+    const float t = (curveT - pA.time) / (pB.time - pA.time);
+
+    TConvertion temp = lerpFunc(*rcast<const TConvertion*>(&pA.value), *rcast<const TConvertion*>(&pB.value), t);
+    return *rcast<const vec4*>(&temp);
+}
+
+static volatile float sBenchSink = 0.0f;  // keeps the optimizer from dropping the lookups
+
+static float Bench_MaxDiff(const vec4& a, const vec4& b) {
+    const vec4 d = glm::abs(a - b);
+    return std::max(std::max(d.x, d.y), std::max(d.z, d.w));
+}
+
+
+MetroMotionBenchmark::MetroMotionBenchmark() {
+}
+MetroMotionBenchmark::~MetroMotionBenchmark() {
+}
+
+void MetroMotionBenchmark::AddMotion(const RefPtr<MetroMotion>& motion) {
+    if (motion && motion->GetNumFrames() && motion->GetNumBones()) {
+        mMotions.push_back(motion);
+    }
+}
+
+RefPtr<MetroMotion> MetroMotionBenchmark::MakeSyntheticMotion(const CharString& name, const size_t numBones, const size_t numFrames, const size_t keyStep) {
+    if (!numBones || numBones > 256 || !numFrames || !keyStep) {
+        return nullptr;
+    }
+
+    RefPtr<MetroMotion> motion = MakeRefPtr<MetroMotion>(name);
+    motion->mNumBones = numBones;
+    motion->mNumFrames = numFrames;
+    motion->mAffectedBones.Fill();
+    motion->mMotionDataHeader.bonesMask.Fill();
+    motion->mBonesRotations.resize(numBones);
+    motion->mBonesPositions.resize(numBones);
+
+    // smooth-ish made up movement, the values don't matter for the lookup cost, only the keys count does
+    const float frameTime = 1.0f / scast<float>(MetroMotion::kFrameRate);
+    for (size_t i = 0; i < numBones; ++i) {
+        AttributeCurve& rotations = motion->mBonesRotations[i];
+        AttributeCurve& positions = motion->mBonesPositions[i];
+
+        for (size_t frame = 0; frame <= numFrames; frame += keyStep) {
+            const float time = scast<float>(frame) * frameTime;
+            const float phase = time * (1.0f + scast<float>(i % 7) * 0.25f);
+
+            const quat q = Normalize(quat(Cos(phase), Sin(phase) * 0.5f, Cos(phase * 0.7f) * 0.3f, Sin(phase * 1.3f) * 0.2f));
+            rotations.points.push_back({ time, vec4(q.x, q.y, q.z, q.w) });
+            positions.points.push_back({ time, vec4(Sin(phase), Cos(phase * 0.5f), scast<float>(i) * 0.01f, 0.0f) });
+        }
+    }
+
+    return motion;
+}
+
+void MetroMotionBenchmark::AddSyntheticMotion(const CharString& name, const size_t numBones, const size_t numFrames, const size_t keyStep) {
+    RefPtr<MetroMotion> motion = MakeSyntheticMotion(name, numBones, numFrames, keyStep);
+    if (motion) {
+        mMotions.push_back(motion);
+    }
+}
+
+void MetroMotionBenchmark::AddDefaultSyntheticMotions() {
+    // ~80 bones is the usual humanoid, 30 fps
+    this->AddSyntheticMotion("short_3s", 80, 90, 1);
+    this->AddSyntheticMotion("long_60s", 80, 1800, 1);
+    this->AddSyntheticMotion("long_60s_sparse", 80, 1800, 4);
+    this->AddSyntheticMotion("cutscene_5min", 80, 9000, 1);
+}
+
+size_t MetroMotionBenchmark::GetNumMotions() const {
+    return mMotions.size();
+}
+
+size_t MetroMotionBenchmark::Run(const size_t numIterations) {
+    mResults.clear();
+    mResults.reserve(mMotions.size());
+
+    for (const RefPtr<MetroMotion>& motion : mMotions) {
+        MotionBenchResult result = {};
+        if (this->RunSingle(*motion, std::max<size_t>(1, numIterations), result)) {
+            mResults.emplace_back(std::move(result));
+        } else {
+            LogPrintF(LogLevel::Warning, "Motion benchmark: %s has no animated bones", motion->GetName().c_str());
+        }
+    }
+
+    return mResults.size();
+}
+
+const MyArray<MotionBenchResult>& MetroMotionBenchmark::GetResults() const {
+    return mResults;
+}
+
+json_t* MetroMotionBenchmark::ToJsonTree() const {
+    json_t* root = json_object();
+    json_t* results = json_array();
+
+    for (const MotionBenchResult& r : mResults) {
+        json_t* jr = json_object();
+        json_object_set_new(jr, "motion", json_string(r.motion.c_str()));
+        json_object_set_new(jr, "bones", json_integer(scast<json_int_t>(r.numBones)));
+        json_object_set_new(jr, "frames", json_integer(scast<json_int_t>(r.numFrames)));
+        json_object_set_new(jr, "keys_per_track", json_real(r.keysPerTrack));
+        json_object_set_new(jr, "samples", json_integer(scast<json_int_t>(r.numSamples)));
+        json_object_set_new(jr, "linear_ms", json_real(r.linearMs));
+        json_object_set_new(jr, "binary_ms", json_real(r.binaryMs));
+        json_object_set_new(jr, "cursor_ms", json_real(r.cursorMs));
+        json_object_set_new(jr, "baked_ms", json_real(r.bakedMs));
+        json_object_set_new(jr, "bake_ms", json_real(r.bakeMs));
+        json_object_set_new(jr, "linear_ns_per_sample", json_real(r.linearNsPerSample));
+        json_object_set_new(jr, "binary_ns_per_sample", json_real(r.binaryNsPerSample));
+        json_object_set_new(jr, "cursor_ns_per_sample", json_real(r.cursorNsPerSample));
+        json_object_set_new(jr, "baked_ns_per_sample", json_real(r.bakedNsPerSample));
+        json_object_set_new(jr, "max_error", json_real(r.maxError));
+        json_object_set_new(jr, "baked_max_error", json_real(r.bakedMaxError));
+        json_object_set_new(jr, "curves_size", json_integer(scast<json_int_t>(r.curvesSize)));
+        json_object_set_new(jr, "baked_size", json_integer(scast<json_int_t>(r.bakedSize)));
+        json_object_set_new(jr, "motion_size", json_integer(scast<json_int_t>(r.motionSize)));
+
+        json_array_append_new(results, jr);
+    }
+
+    json_object_set_new(root, "results", results);
+
+    return root;
+}
+
+bool MetroMotionBenchmark::RunSingle(const MetroMotion& motion, const size_t numIterations, MotionBenchResult& result) const {
+    using Clock = std::chrono::high_resolution_clock;
+
+    // the linear reference scans decoded curves, loaded motions keep theirs packed
+    MyArray<size_t> bones;
+    MyArray<AttributeCurve> rotationCurves, positionCurves;
+    size_t numKeys = 0;
+    for (size_t i = 0; i < motion.GetNumBones(); ++i) {
+        if (motion.IsBoneAnimated(i)) {
+            bones.push_back(i);
+            rotationCurves.push_back(motion.GetBoneRotationsCurve(i));
+            positionCurves.push_back(motion.GetBonePositionsCurve(i));
+            numKeys += rotationCurves.back().points.size() + positionCurves.back().points.size();
+        }
+    }
+
+    if (bones.empty()) {
+        return false;
+    }
+
+    const size_t numFrames = motion.GetNumFrames();
+    const size_t numSamples = numFrames * bones.size() * 2;
+
+    // linear results are the reference, both checked against them on the first iteration
+    MyArray<vec4> reference(numSamples);
+    float maxError = 0.0f;
+
+    double bestLinearMs = 0.0, bestBinaryMs = 0.0, bestCursorMs = 0.0, bestBakedMs = 0.0;
+    vec4 sink(0.0f);
+
+    MetroMotionSampler sampler(&motion);
+
+    const auto tBake = Clock::now();
+    MetroMotionBaked baked;
+    if (!baked.Bake(motion)) {
+        return false;
+    }
+    const double bakeMs = std::chrono::duration<double, std::milli>(Clock::now() - tBake).count();
+
+    MyArray<quat> bakedRotations(baked.GetNumBones());
+    MyArray<vec3> bakedPositions(baked.GetNumBones());
+    float bakedMaxError = 0.0f;
+
+    for (size_t iteration = 0; iteration < numIterations; ++iteration) {
+        const bool verify = (iteration == 0);
+
+        const auto t0 = Clock::now();
+        for (size_t frame = 0, s = 0; frame < numFrames; ++frame) {
+            const float time = scast<float>(frame) / scast<float>(MetroMotion::kFrameRate);
+            for (size_t j = 0; j < bones.size(); ++j) {
+                const vec4 q = Bench_CurveResolveLinear<quat>(rotationCurves[j], time, QuatSlerp);
+                const vec4 t = Bench_CurveResolveLinear<vec4>(positionCurves[j], time, Lerp<vec4>);
+                if (verify) {
+                    reference[s++] = q;
+                    reference[s++] = t;
+                }
+                sink += q + t;
+            }
+        }
+
+        const auto t1 = Clock::now();
+        for (size_t frame = 0, s = 0; frame < numFrames; ++frame) {
+            for (const size_t boneIdx : bones) {
+                const quat q = motion.GetBoneRotation(boneIdx, frame);
+                const vec3 t = motion.GetBonePosition(boneIdx, frame);
+                if (verify) {
+                    maxError = std::max(maxError, Bench_MaxDiff(reference[s++], vec4(q.x, q.y, q.z, q.w)));
+                    maxError = std::max(maxError, Bench_MaxDiff(vec4(vec3(reference[s++]), 0.0f), vec4(t, 0.0f)));
+                }
+                sink += vec4(q.x, q.y, q.z, q.w) + vec4(t, 0.0f);
+            }
+        }
+
+        const auto t2 = Clock::now();
+        sampler.ResetCursors();
+        for (size_t frame = 0, s = 0; frame < numFrames; ++frame) {
+            const float time = scast<float>(frame) / scast<float>(MetroMotion::kFrameRate);
+            for (const size_t boneIdx : bones) {
+                const quat q = sampler.GetBoneRotation(boneIdx, time);
+                const vec3 t = sampler.GetBonePosition(boneIdx, time);
+                if (verify) {
+                    maxError = std::max(maxError, Bench_MaxDiff(reference[s++], vec4(q.x, q.y, q.z, q.w)));
+                    maxError = std::max(maxError, Bench_MaxDiff(vec4(vec3(reference[s++]), 0.0f), vec4(t, 0.0f)));
+                }
+                sink += vec4(q.x, q.y, q.z, q.w) + vec4(t, 0.0f);
+            }
+        }
+        const auto t3 = Clock::now();
+        for (size_t frame = 0, s = 0; frame < numFrames; ++frame) {
+            baked.SampleFrame(frame, bakedRotations.data(), bakedPositions.data(), nullptr);
+            for (const size_t boneIdx : bones) {
+                const quat& q = bakedRotations[boneIdx];
+                const vec3& t = bakedPositions[boneIdx];
+                if (verify) {
+                    bakedMaxError = std::max(bakedMaxError, Bench_MaxDiff(reference[s++], vec4(q.x, q.y, q.z, q.w)));
+                    bakedMaxError = std::max(bakedMaxError, Bench_MaxDiff(vec4(vec3(reference[s++]), 0.0f), vec4(t, 0.0f)));
+                }
+                sink += vec4(q.x, q.y, q.z, q.w) + vec4(t, 0.0f);
+            }
+        }
+        const auto t4 = Clock::now();
+
+        // the first iteration also fills and checks the reference, it doesn't count
+        if (!verify || numIterations == 1) {
+            const double linearMs = std::chrono::duration<double, std::milli>(t1 - t0).count();
+            const double binaryMs = std::chrono::duration<double, std::milli>(t2 - t1).count();
+            const double cursorMs = std::chrono::duration<double, std::milli>(t3 - t2).count();
+            const double bakedMs = std::chrono::duration<double, std::milli>(t4 - t3).count();
+
+            const bool first = (bestLinearMs == 0.0);
+            bestLinearMs = first ? linearMs : std::min(bestLinearMs, linearMs);
+            bestBinaryMs = first ? binaryMs : std::min(bestBinaryMs, binaryMs);
+            bestCursorMs = first ? cursorMs : std::min(bestCursorMs, cursorMs);
+            bestBakedMs = first ? bakedMs : std::min(bestBakedMs, bakedMs);
+        }
+    }
+
+    const double nsScale = 1e6 / scast<double>(numSamples);
+
+    result.motion = motion.GetName();
+    result.numBones = bones.size();
+    result.numFrames = numFrames;
+    result.keysPerTrack = scast<double>(numKeys) / scast<double>(bones.size() * 2);
+    result.numSamples = numSamples;
+    result.linearMs = bestLinearMs;
+    result.binaryMs = bestBinaryMs;
+    result.cursorMs = bestCursorMs;
+    result.bakedMs = bestBakedMs;
+    result.bakeMs = bakeMs;
+    result.linearNsPerSample = bestLinearMs * nsScale;
+    result.binaryNsPerSample = bestBinaryMs * nsScale;
+    result.cursorNsPerSample = bestCursorMs * nsScale;
+    result.bakedNsPerSample = bestBakedMs * nsScale;
+    result.maxError = maxError;
+    result.bakedMaxError = bakedMaxError;
+    result.curvesSize = numKeys * sizeof(AttributeCurve::AttribPoint);
+    result.bakedSize = baked.GetMemorySize();
+    result.motionSize = motion.GetMemorySize();
+
+    sBenchSink = sink.x + sink.y + sink.z + sink.w;
+
+    return true;
+}
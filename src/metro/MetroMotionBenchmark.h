@@ -0,0 +1,62 @@
+#pragma once
+#include "mycommon.h"
+#include "MetroMotion.h"
+
+struct json_t;
+
+// Plays motions back the way the animator does (every frame, every bone, rotation + position)
+//  and measures how fast the keyframes are resolved:
+//      linear  - the old per sample linear scan over the curve points, kept here as the reference
+//      binary  - MetroMotion::GetBone*, binary search per sample (random access)
+//      cursor  - MetroMotionSampler, cached cursor per track (sequential playback)
+//      baked   - MetroMotionBaked, all the bones of a frame at once from the quantized SoA tracks
+//  All modes sample the same frames in the same order, binary and cursor must match linear exactly,
+//  baked may only be off by its quantization, both show up as max_error in the json.
+
+struct MotionBenchResult {
+    CharString  motion;
+    size_t      numBones;
+    size_t      numFrames;
+    double      keysPerTrack;       // average over the animated tracks
+    size_t      numSamples;         // per mode and iteration, rotations + positions
+    double      linearMs;           // best of all iterations
+    double      binaryMs;
+    double      cursorMs;
+    double      bakedMs;
+    double      bakeMs;             // one time cost of building the baked tracks
+    double      linearNsPerSample;
+    double      binaryNsPerSample;
+    double      cursorNsPerSample;
+    double      bakedNsPerSample;
+    float       maxError;           // biggest difference of binary and cursor results from the linear ones
+    float       bakedMaxError;      // same for baked, that's the quantization error
+    size_t      curvesSize;         // bytes of the rotation + position keys, decoded
+    size_t      bakedSize;
+    size_t      motionSize;         // MetroMotion::GetMemorySize, loaded motions keep their curves packed
+};
+
+class MetroMotionBenchmark {
+public:
+    MetroMotionBenchmark();
+    ~MetroMotionBenchmark();
+
+    void                                AddMotion(const RefPtr<MetroMotion>& motion);
+    // keys every keyStep frames, for when there are no real motions at hand, every bone is animated
+    static RefPtr<MetroMotion>          MakeSyntheticMotion(const CharString& name, const size_t numBones, const size_t numFrames, const size_t keyStep);
+    void                                AddSyntheticMotion(const CharString& name, const size_t numBones, const size_t numFrames, const size_t keyStep);
+    void                                AddDefaultSyntheticMotions();
+    size_t                              GetNumMotions() const;
+
+    // returns number of successful runs
+    size_t                              Run(const size_t numIterations = 1);
+
+    const MyArray<MotionBenchResult>&   GetResults() const;
+    json_t*                             ToJsonTree() const;
+
+private:
+    bool                                RunSingle(const MetroMotion& motion, const size_t numIterations, MotionBenchResult& result) const;
+
+private:
+    MyArray<RefPtr<MetroMotion>>        mMotions;
+    MyArray<MotionBenchResult>          mResults;
+};
@@ -0,0 +1,583 @@
+#include "MetroMotionOptimizer.h"
+#include "MetroMotion.h"
+#include "MetroSkeleton.h"
+
+static const float kCompressedQuatNormFactor = 0.0000215805f;  // (1 / 32766) * (1 / sqrt(2)), same as MotionCurveReader
+static const float kFrameTimeEpsilon = 0.001f;                  // in frames, keys closer than that to a whole frame are on it
+static const float kToleranceSlack = 1.01f;                     // sampling at arbitrary times may add a bit of float noise
+static const float kModelSpaceRotationNoise = 0.001f;           // degrees, float noise of the hierarchy pass on top of the bounds
+static const float kModelSpacePositionNoise = 0.001f;           // cm
+static const size_t kMaxSegmentKeys = 1024;                     // longest run of source keys a single kept segment may cover
+
+
+float MetroMotionOptimizeParams::GetTolerance(const MotionCurveChannel channel) const {
+    switch (channel) {
+        case MotionCurveChannel::Rotation:
+            return rotationTolerance;
+        case MotionCurveChannel::Position:
+            return positionTolerance;
+        default:
+            return scaleTolerance;
+    }
+}
+
+size_t MetroMotionOptimizedCurve::GetNumKeys() const {
+    switch (storage) {
+        case Storage::OneValue:
+            return 1;
+        case Storage::Uncompressed:
+            return values.size();
+        case Storage::CompressedPos:
+        case Storage::CompressedQuat:
+            return timings.size();
+        default:
+            return 0;
+    }
+}
+
+size_t MetroMotionOptimizedCurve::GetSizeInBytes(const size_t attribSize) const {
+    const size_t numKeys = this->GetNumKeys();
+
+    size_t result = sizeof(uint32_t);   // curve header
+    switch (storage) {
+        case Storage::OneValue:
+            result += attribSize * sizeof(float);
+            break;
+        case Storage::Uncompressed:
+            result += numKeys * (sizeof(float) + attribSize * sizeof(float));
+            break;
+        case Storage::CompressedPos:
+            result += sizeof(float) + sizeof(vec3[2]) + numKeys * sizeof(uint16_t[4]);
+            break;
+        case Storage::CompressedQuat:
+            result += sizeof(float) + numKeys * sizeof(uint16_t[4]);
+            break;
+        default:
+            break;
+    }
+
+    return result;
+}
+
+bool MetroMotionErrorStats::IsWithin(const MetroMotionOptimizeParams& params) const {
+    return maxRotationError <= params.rotationTolerance * kToleranceSlack &&
+           maxPositionError <= params.positionTolerance * kToleranceSlack &&
+           maxScaleError <= params.scaleTolerance * kToleranceSlack;
+}
+
+bool MetroMotionModelErrorStats::IsWithin() const {
+    return maxBoundUsage <= kToleranceSlack;
+}
+
+
+// curves keep the quaternions as vec4 in the quat memory order (x, y, z, w)
+static quat Opt_ToQuat(const vec4& v) {
+    return quat(v.w, v.x, v.y, v.z);
+}
+
+static vec4 Opt_FromQuat(const quat& q) {
+    return vec4(q.x, q.y, q.z, q.w);
+}
+
+static float Opt_RotationError(const quat& a, const quat& b) {
+    // angle of the difference rotation, atan2 keeps the precision for the tiny angles where acos of the dot doesn't
+    const quat d = QuatConjugate(a) * b;
+    return Rad2Deg(2.0f * std::atan2(Length(vec3(d.x, d.y, d.z)), std::abs(d.w)));
+}
+
+static float Opt_Error(const MotionCurveChannel channel, const vec4& a, const vec4& b) {
+    switch (channel) {
+        case MotionCurveChannel::Rotation:
+            return Opt_RotationError(Opt_ToQuat(a), Opt_ToQuat(b));
+        case MotionCurveChannel::Position:
+            return Length(vec3(a) - vec3(b)) * 100.0f;  // meters to cm
+        default:
+            return Length(vec3(a) - vec3(b));
+    }
+}
+
+// the same interpolation the curves are sampled with
+static vec4 Opt_Interpolate(const MotionCurveChannel channel, const vec4& a, const vec4& b, const float t) {
+    if (channel == MotionCurveChannel::Rotation) {
+        return Opt_FromQuat(QuatSlerp(Opt_ToQuat(a), Opt_ToQuat(b), t));
+    } else {
+        return Lerp(a, b, t);
+    }
+}
+
+// Checks the segment [a, b] of the candidate keys (times + values, already the way they will be decoded)
+//  against every source key it covers, error is the biggest one found
+static bool Opt_SegmentFits(const AttributeCurve& curve,
+                            const MyArray<float>& times,
+                            const MyArray<vec4>& values,
+                            const MotionCurveChannel channel,
+                            const size_t a,
+                            const size_t b,
+                            const float tolerance,
+                            float& error) {
+    error = 0.0f;
+    for (size_t i = a; i <= b; ++i) {
+        const float t = curve.points[i].time;
+
+        vec4 v;
+        if (t <= times[a]) {
+            v = values[a];
+        } else if (t >= times[b]) {
+            v = values[b];
+        } else {
+            v = Opt_Interpolate(channel, values[a], values[b], (t - times[a]) / (times[b] - times[a]));
+        }
+
+        const float e = Opt_Error(channel, v, curve.points[i].value);
+        if (e > tolerance) {
+            return false;
+        }
+        error = std::max(error, e);
+    }
+
+    return true;
+}
+
+// indices of the kept keys, empty if even the neighbour keys can't reproduce the source (quantization is too coarse)
+//  Every segment grows greedily from its first key: the end doubles its distance while the segment still fits,
+//  then a binary search between the last fitting and the first failing end finds where it stops. A check costs
+//  the length of the segment, so a segment of L keys takes O(L log L) instead of O(L^2) of growing it one by one.
+static MyArray<size_t> Opt_ReduceKeys(const AttributeCurve& curve,
+                                      const MyArray<float>& times,
+                                      const MyArray<vec4>& values,
+                                      const MotionCurveChannel channel,
+                                      const float tolerance,
+                                      float& maxError) {
+    MyArray<size_t> result;
+    maxError = 0.0f;
+
+    const size_t numPoints = curve.points.size();
+    if (numPoints == 1) {
+        maxError = Opt_Error(channel, values[0], curve.points[0].value);
+        if (maxError <= tolerance) {
+            result.push_back(0);
+        }
+        return result;
+    }
+
+    result.push_back(0);
+    size_t a = 0;
+    while (a + 1 < numPoints) {
+        const size_t last = std::min(numPoints - 1, a + kMaxSegmentKeys);
+
+        size_t b = a + 1;
+        float error, segmentError;
+        if (!Opt_SegmentFits(curve, times, values, channel, a, b, tolerance, segmentError)) {
+            result.clear();
+            break;
+        }
+
+        // b always fits, bad is the first end known not to (or one past the last allowed one)
+        size_t bad = last + 1;
+        for (size_t step = 2; b < last; step *= 2) {
+            const size_t next = std::min(last, a + step);
+            if (!Opt_SegmentFits(curve, times, values, channel, a, next, tolerance, error)) {
+                bad = next;
+                break;
+            }
+            b = next;
+            segmentError = error;
+        }
+
+        while (b + 1 < bad) {
+            const size_t mid = b + (bad - b) / 2;
+            if (Opt_SegmentFits(curve, times, values, channel, a, mid, tolerance, error)) {
+                b = mid;
+                segmentError = error;
+            } else {
+                bad = mid;
+            }
+        }
+
+        maxError = std::max(maxError, segmentError);
+        result.push_back(b);
+        a = b;
+    }
+
+    return result;
+}
+
+static bool Opt_IsConstant(const AttributeCurve& curve, const MotionCurveChannel channel, const float tolerance, vec4& value, float& maxError) {
+    if (channel == MotionCurveChannel::Rotation) {
+        value = curve.points.front().value;
+    } else {
+        vec4 minV = curve.points.front().value, maxV = minV;
+        for (const auto& p : curve.points) {
+            minV = glm::min(minV, p.value);
+            maxV = glm::max(maxV, p.value);
+        }
+        value = (minV + maxV) * 0.5f;
+    }
+
+    maxError = 0.0f;
+    for (const auto& p : curve.points) {
+        maxError = std::max(maxError, Opt_Error(channel, value, p.value));
+        if (maxError > tolerance) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Sampled imports have their keys on whole frames, those keep the exact times with the frame rate as the timings scale,
+//  anything else spreads the u16 range over the curve length
+static bool Opt_QuantizeTimings(const AttributeCurve& curve, float& timingsPerSecond, MyArray<uint16_t>& timings, MyArray<float>& times) {
+    const float firstTime = curve.points.front().time;
+    const float lastTime = curve.points.back().time;
+    if (firstTime < 0.0f || lastTime <= 0.0f) {
+        return false;
+    }
+
+    const float frameRate = scast<float>(MetroMotion::kFrameRate);
+    bool onFrames = (lastTime * frameRate) <= 65535.0f;
+    for (size_t i = 0; i < curve.points.size() && onFrames; ++i) {
+        const float frame = curve.points[i].time * frameRate;
+        onFrames = std::abs(frame - std::round(frame)) <= kFrameTimeEpsilon;
+    }
+
+    timingsPerSecond = onFrames ? frameRate : (65535.0f / lastTime);
+    const float timingScale = 1.0f / timingsPerSecond;  // the way MotionCurveReader decodes them
+
+    timings.resize(curve.points.size());
+    times.resize(curve.points.size());
+    for (size_t i = 0; i < curve.points.size(); ++i) {
+        const float q = Clamp(std::round(curve.points[i].time * timingsPerSecond), 0.0f, 65535.0f);
+        timings[i] = scast<uint16_t>(q);
+        times[i] = scast<float>(timings[i]) * timingScale;
+
+        // keys closer than the timings precision
+        if (i > 0 && timings[i] <= timings[i - 1]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void Opt_QuantizePositions(const AttributeCurve& curve, vec3& scale, vec3& offset, MyArray<uint16_t>& quantized, MyArray<vec4>& values) {
+    vec3 minV = vec3(curve.points.front().value), maxV = minV;
+    for (const auto& p : curve.points) {
+        minV = glm::min(minV, vec3(p.value));
+        maxV = glm::max(maxV, vec3(p.value));
+    }
+
+    offset = minV;
+    scale = (maxV - minV) / 65535.0f;
+
+    quantized.resize(curve.points.size() * 3);
+    values.resize(curve.points.size());
+    for (size_t i = 0; i < curve.points.size(); ++i) {
+        uint16_t* q = quantized.data() + i * 3;
+        for (int c = 0; c < 3; ++c) {
+            const float v = (scale[c] > 0.0f) ? ((curve.points[i].value[c] - offset[c]) / scale[c]) : 0.0f;
+            q[c] = scast<uint16_t>(Clamp(std::round(v), 0.0f, 65535.0f));
+        }
+
+        values[i] = vec4(vec3(scast<float>(q[0]), scast<float>(q[1]), scast<float>(q[2])) * scale + offset, 0.0f);
+    }
+}
+
+// mirrors MotionCurveReader
+static vec4 Opt_DecodeQuat(const int16_t px, const int16_t py, const int16_t pz) {
+    const int permutation = (py & 1) | (2 * (px & 1));
+    const int wsign = (pz & 1);
+
+    const float qx = scast<float>(px) * kCompressedQuatNormFactor;
+    const float qy = scast<float>(py) * kCompressedQuatNormFactor;
+    const float qz = scast<float>(pz) * kCompressedQuatNormFactor;
+    const float t = 1.0f - (qx * qx) - (qy * qy) - (qz * qz);
+    const float qw = (t < 0.0f) ? 0.0f : (wsign ? -std::sqrt(t) : std::sqrt(t));
+
+    vec4 result;
+    switch (permutation) {
+        case 0: result = vec4(qw, qx, qy, qz); break;
+        case 1: result = vec4(qx, qw, qy, qz); break;
+        case 2: result = vec4(qx, qy, qw, qz); break;
+        default: result = vec4(qx, qy, qz, qw); break;
+    }
+
+    return Opt_FromQuat(Normalize(Opt_ToQuat(result)));
+}
+
+// nearest snorm value with the wanted low bit, that bit is where the permutation and the dropped component sign go
+static int16_t Opt_EncodeQuatComponent(const float v, const int bit) {
+    const float f = Clamp(v / kCompressedQuatNormFactor, -32766.0f, 32766.0f);
+    int32_t q = scast<int32_t>(std::round(f));
+    if ((q & 1) != bit) {
+        q += (f > scast<float>(q)) ? 1 : -1;
+    }
+    return scast<int16_t>(q);
+}
+
+// the biggest component is dropped and restored from the other three
+static void Opt_QuantizeQuats(const AttributeCurve& curve, MyArray<uint16_t>& quantized, MyArray<vec4>& values) {
+    quantized.resize(curve.points.size() * 3);
+    values.resize(curve.points.size());
+    for (size_t i = 0; i < curve.points.size(); ++i) {
+        const vec4 q = Opt_FromQuat(Normalize(Opt_ToQuat(curve.points[i].value)));
+
+        int permutation = 0;
+        for (int c = 1; c < 4; ++c) {
+            if (std::abs(q[c]) > std::abs(q[permutation])) {
+                permutation = c;
+            }
+        }
+
+        float rest[3];
+        for (int c = 0, j = 0; c < 4; ++c) {
+            if (c != permutation) {
+                rest[j++] = q[c];
+            }
+        }
+
+        const int16_t px = Opt_EncodeQuatComponent(rest[0], (permutation >> 1) & 1);
+        const int16_t py = Opt_EncodeQuatComponent(rest[1], permutation & 1);
+        const int16_t pz = Opt_EncodeQuatComponent(rest[2], (q[permutation] < 0.0f) ? 1 : 0);
+
+        quantized[i * 3 + 0] = scast<uint16_t>(px);
+        quantized[i * 3 + 1] = scast<uint16_t>(py);
+        quantized[i * 3 + 2] = scast<uint16_t>(pz);
+        values[i] = Opt_DecodeQuat(px, py, pz);
+    }
+}
+
+static bool Opt_Compress(const AttributeCurve& curve, const MotionCurveChannel channel, const float tolerance, MetroMotionOptimizedCurve& result) {
+    MyArray<uint16_t> timings, quantized;
+    MyArray<float> times;
+    MyArray<vec4> values;
+
+    if (curve.points.size() > 0xFFFF || !Opt_QuantizeTimings(curve, result.timingsPerSecond, timings, times)) {
+        return false;
+    }
+
+    if (channel == MotionCurveChannel::Rotation) {
+        result.storage = MetroMotionOptimizedCurve::Storage::CompressedQuat;
+        Opt_QuantizeQuats(curve, quantized, values);
+    } else {
+        result.storage = MetroMotionOptimizedCurve::Storage::CompressedPos;
+        Opt_QuantizePositions(curve, result.scale, result.offset, quantized, values);
+    }
+
+    const MyArray<size_t> keys = Opt_ReduceKeys(curve, times, values, channel, tolerance, result.maxError);
+    if (keys.empty()) {
+        return false;
+    }
+
+    result.timings.reserve(keys.size());
+    result.quantized.reserve(keys.size() * 3);
+    for (const size_t idx : keys) {
+        result.timings.push_back(timings[idx]);
+        result.quantized.insert(result.quantized.end(), quantized.begin() + idx * 3, quantized.begin() + idx * 3 + 3);
+    }
+
+    return true;
+}
+
+bool MOT_OptimizeCurve(const AttributeCurve& curve,
+                       const MotionCurveChannel channel,
+                       const MetroMotionOptimizeParams& params,
+                       MetroMotionOptimizedCurve& result,
+                       MetroMotionOptimizeStats* stats) {
+    using Storage = MetroMotionOptimizedCurve::Storage;
+
+    result = MetroMotionOptimizedCurve();
+
+    const size_t numPoints = curve.points.size();
+    if (!numPoints) {
+        // written as Empty either way, just the curve header
+        if (stats) {
+            stats->curvesSizeBefore += sizeof(uint32_t);
+            stats->curvesSizeAfter += sizeof(uint32_t);
+        }
+        return false;
+    }
+
+    const size_t attribSize = (channel == MotionCurveChannel::Rotation) ? 4 : 3;
+    const float tolerance = params.GetTolerance(channel);
+
+    vec4 constValue;
+    if (Opt_IsConstant(curve, channel, tolerance, constValue, result.maxError)) {
+        result.storage = Storage::OneValue;
+        result.values.push_back(constValue);
+    } else {
+        // exact values always fit, worst case every key is kept
+        MyArray<float> times(numPoints);
+        MyArray<vec4> values(numPoints);
+        for (size_t i = 0; i < numPoints; ++i) {
+            times[i] = curve.points[i].time;
+            values[i] = curve.points[i].value;
+        }
+
+        const MyArray<size_t> keys = Opt_ReduceKeys(curve, times, values, channel, tolerance, result.maxError);
+        result.storage = Storage::Uncompressed;
+        for (const size_t idx : keys) {
+            result.times.push_back(times[idx]);
+            result.values.push_back(values[idx]);
+        }
+
+        // quantization may cost some more keys, take whichever is smaller
+        if (params.allowCompression) {
+            MetroMotionOptimizedCurve compressed;
+            if (Opt_Compress(curve, channel, tolerance, compressed) && compressed.GetSizeInBytes(attribSize) < result.GetSizeInBytes(attribSize)) {
+                result = std::move(compressed);
+            }
+        }
+    }
+
+    if (stats) {
+        stats->numCurves++;
+        switch (result.storage) {
+            case Storage::OneValue:         stats->numOneValue++;       break;
+            case Storage::Uncompressed:     stats->numUncompressed++;   break;
+            case Storage::CompressedPos:    stats->numCompressedPos++;  break;
+            case Storage::CompressedQuat:   stats->numCompressedQuat++; break;
+            default:                                                    break;
+        }
+
+        stats->keysBefore += numPoints;
+        stats->keysAfter += result.GetNumKeys();
+        stats->curvesSizeBefore += sizeof(uint32_t) + ((numPoints == 1) ? (attribSize * sizeof(float)) : (numPoints * (attribSize + 1) * sizeof(float)));
+        stats->curvesSizeAfter += result.GetSizeInBytes(attribSize);
+
+        switch (channel) {
+            case MotionCurveChannel::Rotation:
+                stats->maxRotationError = std::max(stats->maxRotationError, result.maxError);
+                break;
+            case MotionCurveChannel::Position:
+                stats->maxPositionError = std::max(stats->maxPositionError, result.maxError);
+                break;
+            default:
+                stats->maxScaleError = std::max(stats->maxScaleError, result.maxError);
+                break;
+        }
+    }
+
+    return true;
+}
+
+void MOT_MeasureMotionError(const MetroMotion& reference, const MetroMotion& motion, MetroMotionErrorStats& result) {
+    result = MetroMotionErrorStats();
+
+    MetroMotionSampler referenceSampler(&reference);
+    MetroMotionSampler sampler(&motion);
+
+    const size_t numBones = std::min(reference.GetNumBones(), motion.GetNumBones());
+    const size_t numSteps = reference.GetNumFrames() * 2;
+    const float stepsPerSecond = scast<float>(MetroMotion::kFrameRate * 2);
+
+    for (size_t boneIdx = 0; boneIdx < numBones; ++boneIdx) {
+        const bool hasScales = reference.HasBoneScales(boneIdx);
+
+        for (size_t step = 0; step <= numSteps; ++step) {
+            const float time = scast<float>(step) / stepsPerSecond;
+
+            const quat refQ = referenceSampler.GetBoneRotation(boneIdx, time);
+            const quat q = sampler.GetBoneRotation(boneIdx, time);
+            result.maxRotationError = std::max(result.maxRotationError, Opt_RotationError(refQ, q));
+
+            const vec3 refT = referenceSampler.GetBonePosition(boneIdx, time);
+            const vec3 t = sampler.GetBonePosition(boneIdx, time);
+            result.maxPositionError = std::max(result.maxPositionError, Length(refT - t) * 100.0f);
+
+            if (hasScales) {
+                const vec3 refS = referenceSampler.GetBoneScale(boneIdx, time);
+                const vec3 s = sampler.GetBoneScale(boneIdx, time);
+                result.maxScaleError = std::max(result.maxScaleError, Length(refS - s));
+            }
+
+            ++result.numSamples;
+        }
+    }
+}
+
+bool MOT_MeasureModelSpaceError(const MetroMotion& reference,
+                                const MetroMotion& motion,
+                                const MetroSkeleton& skeleton,
+                                const MetroMotionOptimizeParams& params,
+                                MetroMotionModelErrorStats& result) {
+    result = MetroMotionModelErrorStats();
+
+    const size_t numBones = skeleton.GetNumBones();
+    if (numBones != reference.GetNumBones() || numBones != motion.GetNumBones()) {
+        return false;
+    }
+
+    MyArray<size_t> parents(numBones);
+    for (size_t i = 0; i < numBones; ++i) {
+        parents[i] = skeleton.GetBoneParentIdx(i);
+        if (parents[i] != kInvalidValue && parents[i] >= i) {
+            return false;
+        }
+    }
+
+    MetroMotionSampler referenceSampler(&reference);
+    MetroMotionSampler sampler(&motion);
+
+    struct ModelBone {
+        quat    refQ, q;
+        vec3    refT, t;
+        float   rotationBound;  // degrees
+        float   positionBound;  // cm
+    };
+    MyArray<ModelBone> pose(numBones);
+
+    const size_t numSteps = reference.GetNumFrames() * 2;
+    const float stepsPerSecond = scast<float>(MetroMotion::kFrameRate * 2);
+
+    for (size_t step = 0; step <= numSteps; ++step) {
+        const float time = scast<float>(step) / stepsPerSecond;
+
+        for (size_t i = 0; i < numBones; ++i) {
+            ModelBone& bone = pose[i];
+
+            const bool animated = reference.IsBoneAnimated(i);
+            quat refLocalQ = skeleton.GetBoneRotation(i), localQ = refLocalQ;
+            vec3 refLocalT = skeleton.GetBonePosition(i), localT = refLocalT;
+            if (animated) {
+                refLocalQ = referenceSampler.GetBoneRotation(i, time);
+                refLocalT = referenceSampler.GetBonePosition(i, time);
+                localQ = sampler.GetBoneRotation(i, time);
+                localT = sampler.GetBonePosition(i, time);
+            }
+
+            const float ownRotationBound = animated ? params.rotationTolerance : 0.0f;
+            const float ownPositionBound = animated ? params.positionTolerance : 0.0f;
+
+            if (parents[i] == kInvalidValue) {
+                bone.refQ = refLocalQ;
+                bone.q = localQ;
+                bone.refT = refLocalT;
+                bone.t = localT;
+                bone.rotationBound = ownRotationBound;
+                bone.positionBound = ownPositionBound;
+            } else {
+                const ModelBone& parent = pose[parents[i]];
+                bone.refQ = parent.refQ * refLocalQ;
+                bone.q = parent.q * localQ;
+                bone.refT = parent.refT + QuatRotate(parent.refQ, refLocalT);
+                bone.t = parent.t + QuatRotate(parent.q, localT);
+                bone.rotationBound = parent.rotationBound + ownRotationBound;
+                bone.positionBound = parent.positionBound + ownPositionBound +
+                                     Deg2Rad(parent.rotationBound) * Length(refLocalT) * 100.0f;
+            }
+
+            const float rotationError = Opt_RotationError(bone.refQ, bone.q);
+            const float positionError = Length(bone.refT - bone.t) * 100.0f;
+
+            result.maxRotationError = std::max(result.maxRotationError, rotationError);
+            result.maxPositionError = std::max(result.maxPositionError, positionError);
+            result.maxBoundUsage = std::max(result.maxBoundUsage, rotationError / (bone.rotationBound + kModelSpaceRotationNoise));
+            result.maxBoundUsage = std::max(result.maxBoundUsage, positionError / (bone.positionBound + kModelSpacePositionNoise));
+
+            ++result.numSamples;
+        }
+    }
+
+    return true;
+}
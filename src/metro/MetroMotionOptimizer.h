@@ -0,0 +1,110 @@
+#pragma once
+#include "mycommon.h"
+#include "mymath.h"
+
+struct AttributeCurve;
+class MetroMotion;
+class MetroSkeleton;
+
+// Error-bounded keyframe reduction of the motion curves, done on save
+//  Greedy pass over the keys: a segment grows for as long as interpolating its two ends reproduces every source key
+//  in between within the channel tolerance, so every dropped key is checked against the source curve itself.
+//  Every track then gets the smallest storage that still fits the tolerance (quantization error included):
+//      OneValue -> CompressedQuat / CompressedPos (u16 timings and values, per track scale + offset) -> Uncompressed
+
+enum class MotionCurveChannel : uint8_t {
+    Rotation,
+    Position,
+    Scale
+};
+
+struct MetroMotionOptimizeParams {
+    float   rotationTolerance = 0.1f;   // degrees
+    float   positionTolerance = 0.05f;  // cm, motions are in meters
+    float   scaleTolerance = 0.001f;    // absolute
+    bool    allowCompression = true;    // Compressed* curve types, otherwise only the keys are reduced
+
+    float   GetTolerance(const MotionCurveChannel channel) const;
+};
+
+struct MetroMotionOptimizedCurve {
+    enum class Storage : uint8_t {
+        Empty,
+        OneValue,
+        Uncompressed,
+        CompressedPos,
+        CompressedQuat
+    };
+
+    Storage             storage = Storage::Empty;
+    // OneValue and Uncompressed
+    MyArray<float>      times;
+    MyArray<vec4>       values;
+    // compressed, time = timing / timingsPerSecond
+    float               timingsPerSecond = 0.0f;
+    MyArray<uint16_t>   timings;
+    MyArray<uint16_t>   quantized;      // 3 per key, CompressedQuat stores int16 bits
+    vec3                scale = vec3(0.0f);     // CompressedPos, value = quantized * scale + offset
+    vec3                offset = vec3(0.0f);
+
+    float               maxError = 0.0f;        // biggest error at the source keys, in the channel tolerance units
+
+    size_t              GetNumKeys() const;
+    // as written by MetroMotion, curve header included
+    size_t              GetSizeInBytes(const size_t attribSize) const;
+};
+
+struct MetroMotionOptimizeStats {
+    size_t  numCurves = 0;
+    size_t  numOneValue = 0;
+    size_t  numUncompressed = 0;
+    size_t  numCompressedPos = 0;
+    size_t  numCompressedQuat = 0;
+    size_t  keysBefore = 0;
+    size_t  keysAfter = 0;
+    size_t  curvesSizeBefore = 0;       // bytes of the curves data, the way they would be written without the optimization
+    size_t  curvesSizeAfter = 0;
+    size_t  dataSizeBefore = 0;         // whole motion data chunk
+    size_t  dataSizeAfter = 0;
+    float   maxRotationError = 0.0f;    // degrees
+    float   maxPositionError = 0.0f;    // cm
+    float   maxScaleError = 0.0f;
+};
+
+// reconstruction error of a saved (and loaded back) motion against its source,
+//  every bone is sampled at every frame and half frame, same units as MetroMotionOptimizeParams
+struct MetroMotionErrorStats {
+    size_t  numSamples = 0;
+    float   maxRotationError = 0.0f;
+    float   maxPositionError = 0.0f;
+    float   maxScaleError = 0.0f;
+
+    bool    IsWithin(const MetroMotionOptimizeParams& params) const;
+};
+
+// same, but the poses are accumulated to the model space through a skeleton, the way the animator does (no scale)
+//  Local errors add up along the bone chains, so every bone gets its own bound: the rotation tolerance per animated
+//  link of its chain, the position tolerance per link plus the parent rotation bound swinging the bone offset
+struct MetroMotionModelErrorStats {
+    size_t  numSamples = 0;
+    float   maxRotationError = 0.0f;    // degrees
+    float   maxPositionError = 0.0f;    // cm
+    float   maxBoundUsage = 0.0f;       // biggest error / bound over all the bones and samples
+
+    bool    IsWithin() const;
+};
+
+// false only for the curves that have nothing to write (Empty)
+bool MOT_OptimizeCurve(const AttributeCurve& curve,
+                       const MotionCurveChannel channel,
+                       const MetroMotionOptimizeParams& params,
+                       MetroMotionOptimizedCurve& result,
+                       MetroMotionOptimizeStats* stats);
+
+void MOT_MeasureMotionError(const MetroMotion& reference, const MetroMotion& motion, MetroMotionErrorStats& result);
+// false if the skeleton doesn't match the motion or has a child before its parent
+bool MOT_MeasureModelSpaceError(const MetroMotion& reference,
+                                const MetroMotion& motion,
+                                const MetroSkeleton& skeleton,
+                                const MetroMotionOptimizeParams& params,
+                                MetroMotionModelErrorStats& result);
@@ -0,0 +1,249 @@
+#include "MetroPngBenchmark.h"
+#include "MetroTexture.h"
+#include "png_utils.h"
+#include "jansson.h"
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#define STB_IMAGE_WRITE_STATIC
+#define STBI_WRITE_NO_STDIO
+#include "stb_image_write.h"
+
+#define STBI_NO_STDIO
+#include "stb_image.h"
+
+#include <chrono>
+#include <cmath>
+
+
+static uint32_t Bench_Hash(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+static void Bench_StbWriteFunc(void* context, void* data, int size) {
+    BytesArray* dst = rcast<BytesArray*>(context);
+    const uint8_t* bytes = rcast<const uint8_t*>(data);
+    dst->insert(dst->end(), bytes, bytes + size);
+}
+
+
+MyArray<PngBenchPreset> MetroPngBenchmark::GetDefaultPresets() {
+    MyArray<PngBenchPreset> result;
+
+    // stb at its default level is what SaveAsPNG did before png_utils
+    result.push_back({ "stb_default", true, 8, 1 });
+    result.push_back({ "stb_fast", true, 1, 1 });
+    result.push_back({ "png_fast_1t", false, scast<int>(PngCompression::Fast), 1 });
+    result.push_back({ "png_fast", false, scast<int>(PngCompression::Fast), 0 });
+    result.push_back({ "png_default_1t", false, scast<int>(PngCompression::Default), 1 });
+    result.push_back({ "png_default", false, scast<int>(PngCompression::Default), 0 });
+
+    return result;
+}
+
+MetroPngBenchmark::MetroPngBenchmark() {
+}
+MetroPngBenchmark::~MetroPngBenchmark() {
+}
+
+bool MetroPngBenchmark::AddImage(const fs::path& filePath) {
+    bool result = false;
+
+    MetroTexture texture;
+    if (texture.LoadFromFile(filePath)) {
+        BytesArray rgba;
+        if (texture.GetRGBA(rgba)) {
+            this->AddImage(filePath.filename().u8string(), rgba.data(), texture.GetWidth(), texture.GetHeight());
+            result = true;
+        }
+    }
+
+    return result;
+}
+
+void MetroPngBenchmark::AddImage(const CharString& name, const uint8_t* rgba, const size_t width, const size_t height) {
+    if (!rgba || !width || !height) {
+        return;
+    }
+
+    Image image;
+    image.name = name;
+    image.width = width;
+    image.height = height;
+    image.rgba.assign(rgba, rgba + width * height * 4);
+
+    mImages.emplace_back(std::move(image));
+}
+
+void MetroPngBenchmark::AddSyntheticImage(const size_t size) {
+    if (!size) {
+        return;
+    }
+
+    Image image;
+    image.name = "synthetic_" + std::to_string(size);
+    image.width = size;
+    image.height = size;
+    image.rgba.resize(size * size * 4);
+
+    const float invSize = 1.0f / scast<float>(size);
+    for (size_t y = 0; y < size; ++y) {
+        uint8_t* row = image.rgba.data() + y * size * 4;
+        for (size_t x = 0; x < size; ++x) {
+            const float u = scast<float>(x) * invSize;
+            const float v = scast<float>(y) * invSize;
+            // noise amplitude changes per 64x64 cell, some cells are flat
+            const uint32_t cellHash = Bench_Hash(scast<uint32_t>((y / 64) * 4096 + (x / 64)));
+            const uint32_t noiseAmp = (cellHash & 3) * 6;
+            const uint32_t noise = noiseAmp ? (Bench_Hash(scast<uint32_t>(y * size + x)) % (noiseAmp + 1)) : 0;
+
+            const float wave = 0.5f + 0.5f * std::sin(u * 12.0f + std::cos(v * 9.0f) * 2.0f);
+            row[x * 4 + 0] = scast<uint8_t>(std::min(255.0f, 40.0f + 150.0f * u + scast<float>(noise)));
+            row[x * 4 + 1] = scast<uint8_t>(std::min(255.0f, 60.0f + 120.0f * wave + scast<float>(noise)));
+            row[x * 4 + 2] = scast<uint8_t>(std::min(255.0f, 30.0f + 100.0f * v + scast<float>(noise / 2)));
+            row[x * 4 + 3] = scast<uint8_t>(255.0f - 64.0f * wave);
+        }
+    }
+
+    mImages.emplace_back(std::move(image));
+}
+
+void MetroPngBenchmark::AddDefaultSyntheticImages() {
+    this->AddSyntheticImage(2048);
+    this->AddSyntheticImage(4096);
+}
+
+size_t MetroPngBenchmark::GetNumImages() const {
+    return mImages.size();
+}
+
+size_t MetroPngBenchmark::Run(const MyArray<PngBenchPreset>& presets, const size_t numIterations) {
+    mResults.clear();
+    mResults.reserve(mImages.size() * presets.size());
+
+    for (const Image& image : mImages) {
+        for (const PngBenchPreset& preset : presets) {
+            PngBenchResult result = {};
+            if (this->RunSingle(image, preset, std::max<size_t>(1, numIterations), result)) {
+                mResults.emplace_back(std::move(result));
+            } else {
+                LogPrintF(LogLevel::Warning, "PNG benchmark: preset %s failed on %s", preset.name.c_str(), image.name.c_str());
+            }
+        }
+    }
+
+    return mResults.size();
+}
+
+const MyArray<PngBenchResult>& MetroPngBenchmark::GetResults() const {
+    return mResults;
+}
+
+json_t* MetroPngBenchmark::ToJsonTree() const {
+    json_t* root = json_object();
+    json_t* results = json_array();
+
+    for (const PngBenchResult& r : mResults) {
+        json_t* jr = json_object();
+        json_object_set_new(jr, "image", json_string(r.image.c_str()));
+        json_object_set_new(jr, "preset", json_string(r.preset.c_str()));
+        json_object_set_new(jr, "width", json_integer(scast<json_int_t>(r.width)));
+        json_object_set_new(jr, "height", json_integer(scast<json_int_t>(r.height)));
+        json_object_set_new(jr, "level", json_integer(r.level));
+        json_object_set_new(jr, "threads", json_integer(scast<json_int_t>(r.numThreads)));
+        json_object_set_new(jr, "encode_ms", json_real(r.encodeMs));
+        json_object_set_new(jr, "encode_mpix_s", json_real(r.encodeMPixPerSec));
+        json_object_set_new(jr, "file_size", json_integer(scast<json_int_t>(r.fileSize)));
+        json_object_set_new(jr, "ratio", json_real(r.ratio));
+        json_object_set_new(jr, "lossless", json_boolean(r.lossless));
+        json_array_append_new(results, jr);
+    }
+
+    // speedup of every preset over stb_default on the same image
+    json_t* summary = json_object();
+    for (const PngBenchResult& r : mResults) {
+        const auto baseline = std::find_if(mResults.begin(), mResults.end(), [&r](const PngBenchResult& b) {
+            return b.image == r.image && b.preset == "stb_default";
+        });
+
+        if (baseline != mResults.end() && r.encodeMs > 0.0) {
+            json_t* image = json_object_get(summary, r.image.c_str());
+            if (!image) {
+                image = json_object();
+                json_object_set_new(summary, r.image.c_str(), image);
+            }
+
+            json_t* js = json_object();
+            json_object_set_new(js, "speedup", json_real(baseline->encodeMs / r.encodeMs));
+            json_object_set_new(js, "size_vs_stb", json_real(scast<double>(r.fileSize) / scast<double>(baseline->fileSize)));
+            json_object_set_new(image, r.preset.c_str(), js);
+        }
+    }
+
+    json_object_set_new(root, "results", results);
+    json_object_set_new(root, "summary", summary);
+
+    return root;
+}
+
+bool MetroPngBenchmark::RunSingle(const Image& image, const PngBenchPreset& preset, const size_t numIterations, PngBenchResult& result) const {
+    using Clock = std::chrono::high_resolution_clock;
+
+    const int width = scast<int>(image.width);
+    const int height = scast<int>(image.height);
+
+    PngWriteParams params;
+    params.level = preset.level;
+    params.numThreads = preset.numThreads;
+
+    BytesArray file;
+    double bestMs = 0.0;
+    for (size_t iteration = 0; iteration < numIterations; ++iteration) {
+        file.clear();
+        file.reserve(image.rgba.size());
+
+        bool ok = false;
+        const auto t0 = Clock::now();
+        if (preset.useStb) {
+            stbi_write_png_compression_level = preset.level;
+            ok = stbi_write_png_to_func(Bench_StbWriteFunc, &file, width, height, 4, image.rgba.data(), width * 4) != 0;
+        } else {
+            ok = PNG_WriteToFunc([&file](const void* data, const size_t length) {
+                const uint8_t* bytes = rcast<const uint8_t*>(data);
+                file.insert(file.end(), bytes, bytes + length);
+            }, image.rgba.data(), image.width, image.height, 4, params);
+        }
+        const auto t1 = Clock::now();
+
+        if (!ok || file.empty()) {
+            return false;
+        }
+
+        const double ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+        bestMs = (iteration == 0) ? ms : std::min(bestMs, ms);
+    }
+
+    int decodedW = 0, decodedH = 0, decodedComp = 0;
+    stbi_uc* decoded = stbi_load_from_memory(file.data(), scast<int>(file.size()), &decodedW, &decodedH, &decodedComp, 4);
+    const bool lossless = decoded && decodedW == width && decodedH == height &&
+                          std::memcmp(decoded, image.rgba.data(), image.rgba.size()) == 0;
+    stbi_image_free(decoded);
+
+    result.image = image.name;
+    result.preset = preset.name;
+    result.width = image.width;
+    result.height = image.height;
+    result.level = preset.level;
+    result.numThreads = preset.useStb ? 1 : ParallelGetNumThreads(preset.numThreads);
+    result.encodeMs = bestMs;
+    result.encodeMPixPerSec = (bestMs > 0.0) ? (scast<double>(image.width * image.height) / 1e6) / (bestMs / 1000.0) : 0.0;
+    result.fileSize = file.size();
+    result.ratio = scast<double>(image.rgba.size()) / scast<double>(file.size());
+    result.lossless = lossless;
+
+    return true;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include "mycommon.h"
+
+struct json_t;
+
+// Compares the PNG writer texture export uses (png_utils) against stb_image_write, that SaveAsPNG used before.
+//  Both encode the same RGBA pixels into memory, so disk speed stays out of it, every file is decoded back
+//  with stb_image and compared to the source. The synthetic images are the usual 2048^2 and 4096^2 texture sizes.
+
+struct PngBenchPreset {
+    CharString  name;
+    bool        useStb;
+    int         level;          // zlib level for png_utils, stbi_write_png_compression_level for stb
+    size_t      numThreads;     // png_utils only, 0 - all hardware threads
+};
+
+struct PngBenchResult {
+    CharString  image;
+    CharString  preset;
+    size_t      width;
+    size_t      height;
+    int         level;
+    size_t      numThreads;     // actually used
+    double      encodeMs;       // best of all iterations
+    double      encodeMPixPerSec;
+    size_t      fileSize;
+    double      ratio;          // RGBA bytes / file size
+    bool        lossless;       // decoded file matches the source exactly
+};
+
+class MetroPngBenchmark {
+public:
+    static MyArray<PngBenchPreset>      GetDefaultPresets();
+
+    MetroPngBenchmark();
+    ~MetroPngBenchmark();
+
+    bool                                AddImage(const fs::path& filePath);
+    void                                AddImage(const CharString& name, const uint8_t* rgba, const size_t width, const size_t height);
+    // smooth gradients, noise and flat areas with a soft alpha, roughly what an albedo texture compresses like
+    void                                AddSyntheticImage(const size_t size);
+    void                                AddDefaultSyntheticImages();
+    size_t                              GetNumImages() const;
+
+    // returns number of successful runs (images x presets)
+    size_t                              Run(const MyArray<PngBenchPreset>& presets, const size_t numIterations = 1);
+
+    const MyArray<PngBenchResult>&      GetResults() const;
+    json_t*                             ToJsonTree() const;
+
+private:
+    struct Image {
+        CharString  name;
+        size_t      width;
+        size_t      height;
+        BytesArray  rgba;
+    };
+
+    bool                                RunSingle(const Image& image, const PngBenchPreset& preset, const size_t numIterations, PngBenchResult& result) const;
+
+private:
+    MyArray<Image>                      mImages;
+    MyArray<PngBenchResult>             mResults;
+};
@@ -4,12 +4,6 @@
 
 #include "dds_utils.h"
 
-#define STBI_WRITE_NO_STDIO
-#define STB_IMAGE_WRITE_IMPLEMENTATION
-#pragma warning (disable : 4793) // `anonymous namespace'::stbiw__outfile': function compiled as native
-#include "stb_image_write.h"
-#pragma warning (default : 4793)
-
 #define STB_IMAGE_IMPLEMENTATION
 #define STBI_NO_STDIO
 #define STBI_NO_JPEG
@@ -20,14 +14,13 @@
 #define STBI_NO_PNM
 #include "stb_image.h"
 
-#define STB_IMAGE_RESIZE_IMPLEMENTATION
-#include "stb_image_resize.h"
-
 #ifndef METRO_NO_CRUNCH
 #include <crn_decomp.h>
 #endif
 
 #include <fstream>
+#include <atomic>
+#include <chrono>
 #include <intrin.h>
 #include <cwctype>
 
@@ -43,6 +36,258 @@ static size_t NumMipsFromResolution(const size_t resolution) {
     return result;
 }
 
+// returns true for the crunched extensions
+static bool GetDimensionFromExtension(const CharString& fileName, size_t& dimension, size_t& numMips) {
+    const CharString extension = fs::path(fileName).extension().string();
+
+    dimension = 0;
+    numMips = 0;
+    if (extension == ".512" || extension == ".512c") {
+        dimension = 512;
+        numMips = 10;
+    } else if (extension == ".1024" || extension == ".1024c") {
+        dimension = 1024;
+        numMips = 1;
+    } else if (extension == ".2048" || extension == ".2048c") {
+        dimension = 2048;
+        numMips = 1;
+    } else if (extension == ".4096") {
+        dimension = 4096;
+        numMips = 1;
+    }
+
+    return !extension.empty() && extension.back() == 'c';
+}
+
+
+bool MetroTexture::GetCrunchedInfo(const uint8_t* data, const size_t dataLength, CrunchedInfo& info) {
+    bool result = false;
+#ifndef METRO_NO_CRUNCH
+    crnd::crn_texture_info crnInfo;
+    crnInfo.m_struct_size = sizeof(crnd::crn_texture_info);
+    //#NOTE: only plain 2D textures, cubemaps would need 6 destination pointers per level
+    if (crnd::crnd_get_texture_info(data, scast<uint32_t>(dataLength), &crnInfo) && crnInfo.m_faces == 1) {
+        const bool isBC1 = (crnInfo.m_format == cCRNFmtDXT1);
+
+        info.width = crnInfo.m_width;
+        info.height = crnInfo.m_height;
+        info.numMips = crnInfo.m_levels;
+        info.format = isBC1 ? PixelFormat::BC1 : PixelFormat::BC3;
+        info.decodedSize = isBC1 ?
+            DDS_GetCompressedSizeBC1(info.width, info.height, info.numMips) :
+            DDS_GetCompressedSizeBC7(info.width, info.height, info.numMips);
+
+        result = true;
+    }
+#endif // METRO_NO_CRUNCH
+    return result;
+}
+
+void MetroTexture::DecrunchBatch(MyArray<DecrunchJob>& jobs, const size_t numThreads) {
+    for (DecrunchJob& job : jobs) {
+        job.success = false;
+        job.decodeTimeMs = 0.0;
+    }
+
+#ifndef METRO_NO_CRUNCH
+    struct MipItem {
+        size_t      job;
+        uint32_t    level;
+        uint32_t    pitch;
+        size_t      offset;
+        size_t      size;
+    };
+
+    // texture-major, biggest mip first - this way the heavy items get picked up first
+    // and a worker tends to stay on the same texture, reusing its context
+    MyArray<MipItem> items;
+    MyArray<uint8_t> jobValid(jobs.size(), 0);
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        const DecrunchJob& job = jobs[i];
+
+        CrunchedInfo info;
+        if (job.data && job.dst && MetroTexture::GetCrunchedInfo(job.data, job.dataLength, info) && job.dstSize >= info.decodedSize) {
+            const size_t blockSize = (info.format == PixelFormat::BC1) ? 8 : 16;
+
+            size_t w = info.width, h = info.height, offset = 0;
+            for (size_t mip = 0; mip < info.numMips; ++mip) {
+                const size_t blocksX = std::max<size_t>(1, (w + 3) / 4);
+                const size_t blocksY = std::max<size_t>(1, (h + 3) / 4);
+                const size_t pitch = blocksX * blockSize;
+                const size_t mipSize = pitch * blocksY;
+
+                items.push_back({ i, scast<uint32_t>(mip), scast<uint32_t>(pitch), offset, mipSize });
+
+                offset += mipSize;
+                w = std::max<size_t>(1, w / 2);
+                h = std::max<size_t>(1, h / 2);
+            }
+
+            jobValid[i] = 1;
+        }
+    }
+
+    struct WorkerCtx {
+        size_t                      job = kInvalidValue;
+        crnd::crnd_unpack_context   ctx = nullptr;
+    };
+
+    using Clock = std::chrono::high_resolution_clock;
+
+    MyArray<WorkerCtx> workers(ParallelGetNumThreads(numThreads));
+    MyArray<std::atomic_bool> jobFailed(jobs.size());
+    MyArray<std::atomic_int64_t> jobTimeNs(jobs.size());
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        jobFailed[i] = false;
+        jobTimeNs[i] = 0;
+    }
+
+    ParallelFor(items.size(), [&](const size_t idx, const size_t threadIdx) {
+        const MipItem& item = items[idx];
+        if (jobFailed[item.job]) {
+            return;
+        }
+
+        const Clock::time_point start = Clock::now();
+
+        const DecrunchJob& job = jobs[item.job];
+        WorkerCtx& worker = workers[threadIdx];
+        if (worker.job != item.job) {
+            if (worker.ctx) {
+                crnd::crnd_unpack_end(worker.ctx);
+            }
+            worker.ctx = crnd::crnd_unpack_begin(job.data, scast<uint32_t>(job.dataLength));
+            worker.job = item.job;
+        }
+
+        void* dstPtr = job.dst + item.offset;
+        if (!worker.ctx || !crnd::crnd_unpack_level(worker.ctx, &dstPtr, scast<uint32_t>(item.size), item.pitch, item.level)) {
+            jobFailed[item.job] = true;
+        }
+
+        jobTimeNs[item.job] += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+    }, numThreads);
+
+    for (WorkerCtx& worker : workers) {
+        if (worker.ctx) {
+            crnd::crnd_unpack_end(worker.ctx);
+        }
+    }
+
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        jobs[i].success = jobValid[i] && !jobFailed[i];
+        jobs[i].decodeTimeMs = scast<double>(jobTimeNs[i].load()) * 1e-6;
+    }
+#endif // METRO_NO_CRUNCH
+}
+
+void MetroTexture::DecrunchBatchToDDS(MyArray<DecrunchFileJob>& jobs, const size_t numThreads) {
+    // headers and blocks share one allocation per file, mips are transcoded right into place
+    MyArray<BytesArray> files(jobs.size());
+    MyArray<DecrunchJob> decrunchJobs;
+    MyArray<size_t> decrunchToFile;
+    decrunchJobs.reserve(jobs.size());
+    decrunchToFile.reserve(jobs.size());
+
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        DecrunchFileJob& job = jobs[i];
+        job.success = false;
+        job.decodeTimeMs = 0.0;
+
+        CrunchedInfo info;
+        if (MetroTexture::GetCrunchedInfo(job.data, job.dataLength, info)) {
+            DDSURFACEDESC2 ddsHdr;
+            DDS_MakeDX9Header(ddsHdr, info.width, info.height, info.numMips);
+            if (info.format == PixelFormat::BC1) {
+                ddsHdr.ddpfPixelFormat.dwFourCC = PIXEL_FMT_DXT1;
+            }
+
+            const size_t headerSize = sizeof(cDDSFileSignature) + sizeof(ddsHdr);
+            BytesArray& fileData = files[i];
+            fileData.resize(headerSize + info.decodedSize);
+            memcpy(fileData.data(), &cDDSFileSignature, sizeof(cDDSFileSignature));
+            memcpy(fileData.data() + sizeof(cDDSFileSignature), &ddsHdr, sizeof(ddsHdr));
+
+            decrunchJobs.push_back({ job.data, job.dataLength, fileData.data() + headerSize, info.decodedSize, false, 0.0 });
+            decrunchToFile.push_back(i);
+        }
+    }
+
+    MetroTexture::DecrunchBatch(decrunchJobs, numThreads);
+
+    for (size_t i = 0; i < decrunchJobs.size(); ++i) {
+        DecrunchFileJob& job = jobs[decrunchToFile[i]];
+        const BytesArray& fileData = files[decrunchToFile[i]];
+
+        job.decodeTimeMs = decrunchJobs[i].decodeTimeMs;
+        if (decrunchJobs[i].success) {
+            job.success = (OSWriteFile(job.filePath, fileData.data(), fileData.size()) == fileData.size());
+        }
+    }
+}
+
+bool MetroTexture::DecrunchToBuffer(const uint8_t* data, const size_t dataLength, uint8_t* dst, const size_t dstSize, double* decodeTimeMs) {
+    MyArray<DecrunchJob> jobs = { { data, dataLength, dst, dstSize, false, 0.0 } };
+    MetroTexture::DecrunchBatch(jobs, 1);
+
+    if (decodeTimeMs) {
+        *decodeTimeMs = jobs.front().decodeTimeMs;
+    }
+
+    return jobs.front().success;
+}
+
+bool MetroTexture::DecrunchToDDS(const uint8_t* data, const size_t dataLength, const fs::path& filePath, double* decodeTimeMs) {
+    MyArray<DecrunchFileJob> jobs = { { data, dataLength, filePath, false, 0.0 } };
+    MetroTexture::DecrunchBatchToDDS(jobs, 1);
+
+    if (decodeTimeMs) {
+        *decodeTimeMs = jobs.front().decodeTimeMs;
+    }
+
+    return jobs.front().success;
+}
+
+void MetroTexture::LoadCrunchedBatch(MyArray<CrunchedLoadJob>& jobs, const size_t numThreads) {
+    const bool legacyVersion = (MetroContext::Get().GetGameVersion() <= MetroGameVersion::Redux);
+
+    MyArray<DecrunchJob> decrunchJobs;
+    MyArray<size_t> decrunchToLoad;
+    decrunchJobs.reserve(jobs.size());
+    decrunchToLoad.reserve(jobs.size());
+
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        CrunchedLoadJob& job = jobs[i];
+        job.success = false;
+
+        // a plain DDS under a crunched name is left to LoadFromData
+        const bool isDDS = job.dataLength >= sizeof(cDDSFileSignature) && *rcast<const uint32_t*>(job.data) == cDDSFileSignature;
+
+        size_t dimension = 0, numMips = 0;
+        const bool isCrunched = GetDimensionFromExtension(job.fileName, dimension, numMips);
+        if (legacyVersion && isCrunched && !isDDS && dimension > 0 && job.texture && job.texture->PrepareCrunched(job.data, job.dataLength)) {
+            MetroTexture* texture = job.texture;
+            texture->mWidth = dimension;
+            texture->mHeight = dimension;
+            texture->mDepth = 1;
+            texture->mNumMips = numMips;
+
+            decrunchJobs.push_back({ job.data, job.dataLength, texture->mData.data(), texture->mData.size(), false, 0.0 });
+            decrunchToLoad.push_back(i);
+        }
+    }
+
+    MetroTexture::DecrunchBatch(decrunchJobs, numThreads);
+
+    for (size_t i = 0; i < decrunchJobs.size(); ++i) {
+        CrunchedLoadJob& job = jobs[decrunchToLoad[i]];
+        job.success = decrunchJobs[i].success;
+        if (!job.success) {
+            job.texture->mData.clear();
+        }
+    }
+}
+
 
 MetroTexture::MetroTexture()
     : mIsCubemap(false)
@@ -130,23 +375,8 @@ bool MetroTexture::LoadFromData(MemStream& stream, const CharString& fileName) {
 
         result = true;
     } else {
-        CharString extension = fs::path(fileName).extension().string();
         size_t dimension = 0, numMips = 0;
-        if (extension == ".512" || extension == ".512c") {
-            dimension = 512;
-            numMips = 10;
-        } else if (extension == ".1024" || extension == ".1024c") {
-            dimension = 1024;
-            numMips = 1;
-        } else if (extension == ".2048" || extension == ".2048c") {
-            dimension = 2048;
-            numMips = 1;
-        } else if (extension == ".4096") {
-            dimension = 4096;
-            numMips = 1;
-        }
-
-        const bool isCrunched = extension.back() == 'c';
+        const bool isCrunched = GetDimensionFromExtension(fileName, dimension, numMips);
 
         if (dimension > 0) {
             const bool legacyVersion = (gameVersion <= MetroGameVersion::Redux);
@@ -235,6 +465,24 @@ bool MetroTexture::LoadFromFile(const fs::path& fileName) {
     return result;
 }
 
+bool MetroTexture::LoadFromRGBA(const uint8_t* pixels, const size_t width, const size_t height) {
+    if (!pixels || !width || !height) {
+        return false;
+    }
+
+    mData.assign(pixels, pixels + width * height * 4);
+
+    mIsCubemap = false;
+    mWidth = width;
+    mHeight = height;
+    mDepth = 1;
+    mNumMips = 1;
+    mFormat = PixelFormat::RGBA8_UNORM;
+    mHasAlpha = true;
+
+    return true;
+}
+
 bool MetroTexture::SaveAsDDS(const fs::path& filePath) {
     bool result = false;
 
@@ -313,31 +561,52 @@ bool MetroTexture::SaveAsTGA(const fs::path& filePath) {
     return result;
 }
 
-bool MetroTexture::SaveAsPNG(const fs::path& filePath) {
+bool MetroTexture::SaveAsPNG(const fs::path& filePath, const int compressionLevel) {
     bool result = false;
 
+    if (mData.empty() || (mFormat != PixelFormat::BC1 && mFormat != PixelFormat::BC3 && mFormat != PixelFormat::BC7)) {
+        return false;
+    }
+
     std::ofstream file(filePath, std::ofstream::binary);
     if (file.good()) {
-        BytesArray rgbaPixels;
-        if (this->GetRGBA(rgbaPixels)) {
-            const int success = stbi_write_png_to_func([](void* ptr, void* data, int size) {
-                std::ofstream* filePtr = rcast<std::ofstream*>(ptr);
-                filePtr->write(rcast<const char*>(data), size);
-            }, &file, scast<int>(mWidth), scast<int>(mHeight), 4, rgbaPixels.data(), 0);
+        PngWriteParams params;
+        params.level = compressionLevel;
+
+        PngStreamWriter writer([&file](const void* data, const size_t length) {
+            file.write(rcast<const char*>(data), length);
+        }, mWidth, mHeight, 4, params);
+
+        //#NOTE: we decode block rows into a small band and stream it to the encoder,
+        //       so the whole RGBA image never has to live in memory
+        constexpr size_t kRowsPerBand = 64;
+        const size_t blockSize = (mFormat == PixelFormat::BC1) ? 8 : 16;
+        const size_t blockRowPitch = ((mWidth + 3) / 4) * blockSize;
+
+        BytesArray band(mWidth * kRowsPerBand * 4);
 
-            result = (success > 0);
+        result = true;
+        for (size_t y = 0; y < mHeight && result; y += kRowsPerBand) {
+            const size_t numRows = std::min(kRowsPerBand, mHeight - y);
+            const size_t numRowsAligned = (numRows + 3) & ~scast<size_t>(3);
+
+            result = this->DecompressBlocksRGBA(mData.data() + (y / 4) * blockRowPitch, band.data(), mWidth, numRowsAligned) &&
+                     writer.WriteRows(band.data(), numRows);
         }
+
+        result = result && writer.Finish() && file.good();
     }
 
     return result;
 }
 
-size_t CompressorHelper(BytesArray& outBuffer, BytesArray& inBuffer, const size_t resolution, const MetroTexture::PixelFormat format) {
+// Compresses numMips consecutive levels of the pyramid, starting at level firstMip
+static size_t CompressorHelper(BytesArray& outBuffer, const uint8_t* pyramid, const size_t pyramidRes, const size_t firstMip, const size_t numMips, const MetroTexture::PixelFormat format) {
     BytesArray workingBuffer;
 
-    size_t resultSize = 0;
-    const size_t numMips = (resolution == 512) ? 10 : 1;
+    const size_t resolution = std::max<size_t>(1, pyramidRes >> firstMip);
 
+    size_t resultSize = 0;
     switch (format) {
         case MetroTexture::PixelFormat::BC1: {
             resultSize = DDS_GetCompressedSizeBC1(resolution, resolution, numMips);
@@ -352,46 +621,44 @@ size_t CompressorHelper(BytesArray& outBuffer, BytesArray& inBuffer, const size_
     if (resultSize) {
         workingBuffer.resize(resultSize);
 
-        BytesArray nextMipBuffer; nextMipBuffer.resize(inBuffer.size() / 4);
-
-        uint8_t* bufferA = inBuffer.data();
-        uint8_t* bufferB = nextMipBuffer.data();
-
         uint8_t* bcBlocks = workingBuffer.data();
-        size_t mipResolution = resolution;
+        uint8_t tile[4 * 4 * 4];
 
         for (size_t i = 0; i < numMips; ++i) {
+            const size_t mipRes = std::max<size_t>(1, resolution >> i);
+            const uint8_t* mipPixels = pyramid + MIP_GetLevelOffset(pyramidRes, pyramidRes, firstMip + i);
+
+            // blocks are 4x4 - tiny mips are replicated to fill the whole block
+            if (mipRes < 4) {
+                for (size_t y = 0; y < 4; ++y) {
+                    for (size_t x = 0; x < 4; ++x) {
+                        std::memcpy(tile + (y * 4 + x) * 4, mipPixels + ((y % mipRes) * mipRes + (x % mipRes)) * 4, 4);
+                    }
+                }
+                mipPixels = tile;
+            }
+
+            const size_t blockRes = std::max<size_t>(4, mipRes);
             size_t mipSize = 0;
 
             switch (format) {
                 case MetroTexture::PixelFormat::BC1: {
-                    DDS_CompressBC1(bufferA, bcBlocks, mipResolution, mipResolution);
-                    mipSize = DDS_GetCompressedSizeBC1(mipResolution, mipResolution, 1);
+                    DDS_CompressBC1(mipPixels, bcBlocks, blockRes, blockRes);
+                    mipSize = DDS_GetCompressedSizeBC1(blockRes, blockRes, 1);
                 } break;
 
                 case MetroTexture::PixelFormat::BC3: {
-                    DDS_CompressBC3(bufferA, bcBlocks, mipResolution, mipResolution);
-                    mipSize = DDS_GetCompressedSizeBC7(mipResolution, mipResolution, 1);
+                    DDS_CompressBC3(mipPixels, bcBlocks, blockRes, blockRes);
+                    mipSize = DDS_GetCompressedSizeBC7(blockRes, blockRes, 1);
                 } break;
 
                 case MetroTexture::PixelFormat::BC7: {
-                    DDS_CompressBC7(bufferA, bcBlocks, mipResolution, mipResolution);
-                    mipSize = DDS_GetCompressedSizeBC7(mipResolution, mipResolution, 1);
+                    DDS_CompressBC7(mipPixels, bcBlocks, blockRes, blockRes);
+                    mipSize = DDS_GetCompressedSizeBC7(blockRes, blockRes, 1);
                 } break;
             }
 
             bcBlocks += mipSize;
-
-            if (numMips > 1) {
-                const size_t nextResolution = std::max<size_t>(4, mipResolution / 2);
-                if (nextResolution != resolution) { //mip size changed - resample
-                    stbir_resize_uint8(bufferA, scast<int>(mipResolution), scast<int>(mipResolution), 0,
-                                        bufferB, scast<int>(nextResolution), scast<int>(nextResolution), 0, 4);
-
-                    std::swap(bufferA, bufferB);
-                }
-                mipResolution = nextResolution;
-            }
         }
 
         if (format == MetroTexture::PixelFormat::BC7) {
@@ -405,85 +672,52 @@ size_t CompressorHelper(BytesArray& outBuffer, BytesArray& inBuffer, const size_
     return resultSize;
 }
 
-bool MetroTexture::SaveAsMetroTexture(const fs::path& filePath, const PixelFormat format) {
+bool MetroTexture::SaveAsMetroTexture(const fs::path& filePath, const PixelFormat format, const MipGenParams& mipParams) {
     bool result = false;
 
-    size_t resolution = scast<size_t>(mWidth);
-
-    BytesArray mipBuffer = mData;
-    BytesArray nextMipBuffer; nextMipBuffer.resize(mipBuffer.size() / 4);
-
-    WideString extensions[4];
-    extensions[0] = L".4096";
-    extensions[1] = L".2048";
-    extensions[2] = L".1024";
-    extensions[3] = L".512";
-
-    if (resolution == 4096) {
-        std::ofstream file(filePath.native() + extensions[0], std::ofstream::binary);
-        if (file.good()) {
-            BytesArray outBuffer;
-            const size_t outSize = CompressorHelper(outBuffer, mipBuffer, resolution, format);
-
-            file.write(rcast<const char*>(outBuffer.data()), outSize);
-            file.flush();
-            file.close();
-        }
-
-        stbir_resize_uint8(mipBuffer.data(), scast<int>(resolution), scast<int>(resolution), 0,
-                           nextMipBuffer.data(), scast<int>(resolution / 2), scast<int>(resolution / 2), 0, 4);
-
-        resolution /= 2;
-        mipBuffer = nextMipBuffer;
-    }
-
-    if (resolution == 2048) {
-        std::ofstream file(filePath.native() + extensions[1], std::ofstream::binary);
-        if (file.good()) {
-            BytesArray outBuffer;
-            const size_t outSize = CompressorHelper(outBuffer, mipBuffer, resolution, format);
-
-            file.write(rcast<const char*>(outBuffer.data()), outSize);
-            file.flush();
-            file.close();
-        }
-
-        stbir_resize_uint8(mipBuffer.data(), scast<int>(resolution), scast<int>(resolution), 0,
-                           nextMipBuffer.data(), scast<int>(resolution / 2), scast<int>(resolution / 2), 0, 4);
-
-        resolution /= 2;
-        mipBuffer = nextMipBuffer;
+    const size_t resolution = scast<size_t>(mWidth);
+    const bool isPow2 = (resolution & (resolution - 1)) == 0;
+    if (resolution < 512 || resolution > 4096 || !isPow2 || mData.empty()) {
+        return false;
     }
 
-    if (resolution == 1024) {
-        std::ofstream file(filePath.native() + extensions[2], std::ofstream::binary);
-        if (file.good()) {
-            BytesArray outBuffer;
-            const size_t outSize = CompressorHelper(outBuffer, mipBuffer, resolution, format);
-
-            file.write(rcast<const char*>(outBuffer.data()), outSize);
-            file.flush();
-            file.close();
+    //#NOTE: the whole chain is built once, every tier below just picks its levels out of it
+    const size_t numMips = MIP_CalcNumMips(resolution, resolution);
+    BytesArray pyramid(MIP_GetPyramidSize(resolution, resolution, numMips));
+    std::memcpy(pyramid.data(), mData.data(), std::min(mData.size(), resolution * resolution * 4));
+    MIP_BuildPyramid(pyramid.data(), resolution, resolution, numMips, mipParams);
+
+    struct Tier {
+        const wchar_t*  extension;
+        size_t          resolution;
+        size_t          numMips;
+    };
+    const Tier tiers[4] = {
+        { L".4096", 4096, 1 },
+        { L".2048", 2048, 1 },
+        { L".1024", 1024, 1 },
+        { L".512",   512, 10 }
+    };
+
+    for (const Tier& tier : tiers) {
+        if (tier.resolution > resolution) {
+            continue;
         }
 
-        stbir_resize_uint8(mipBuffer.data(), scast<int>(resolution), scast<int>(resolution), 0,
-                           nextMipBuffer.data(), scast<int>(resolution / 2), scast<int>(resolution / 2), 0, 4);
-
-        resolution /= 2;
-        mipBuffer = nextMipBuffer;
-    }
+        const size_t firstMip = NumMipsFromResolution(resolution) - NumMipsFromResolution(tier.resolution);
 
-    if (resolution == 512) {
-        std::ofstream file(filePath.native() + extensions[3], std::ofstream::binary);
+        std::ofstream file(filePath.native() + tier.extension, std::ofstream::binary);
         if (file.good()) {
             BytesArray outBuffer;
-            const size_t outSize = CompressorHelper(outBuffer, mipBuffer, resolution, format);
+            const size_t outSize = CompressorHelper(outBuffer, pyramid.data(), resolution, firstMip, tier.numMips, format);
 
             file.write(rcast<const char*>(outBuffer.data()), outSize);
             file.flush();
             file.close();
 
-            result = true;
+            if (tier.resolution == 512) {
+                result = true;
+            }
         }
     }
 
@@ -522,20 +756,10 @@ bool MetroTexture::GetRGBA(BytesArray& imagePixels) const {
     bool result = false;
 
     if (!mData.empty()) {
-        //#TODO: add support for other formats!
-        if (mFormat == PixelFormat::BC7) {
-            imagePixels.resize(mWidth * mHeight * 4);
-            DDS_DecompressBC7(mData.data(), imagePixels.data(), mWidth, mHeight);
-            result = true;
-        } else if (mFormat == PixelFormat::BC3) {
-            imagePixels.resize(mWidth * mHeight * 4);
-            DDS_DecompressBC3(mData.data(), imagePixels.data(), mWidth, mHeight);
-            result = true;
-        } else if (mFormat == PixelFormat::BC1) {
-            imagePixels.resize(mWidth * mHeight * 4);
-            memset(imagePixels.data(), 255, imagePixels.size());
-            DDS_DecompressBC1(mData.data(), imagePixels.data(), mWidth, mHeight);
-            result = true;
+        imagePixels.resize(mWidth * mHeight * 4);
+        result = this->DecompressBlocksRGBA(mData.data(), imagePixels.data(), mWidth, mHeight);
+        if (!result) {
+            imagePixels.clear();
         }
     }
 
@@ -558,52 +782,47 @@ const uint8_t* MetroTexture::GetRawData() const {
     return mData.data();
 }
 
+bool MetroTexture::PrepareCrunched(const uint8_t* data, const size_t dataLength) {
+    CrunchedInfo info;
+    const bool result = MetroTexture::GetCrunchedInfo(data, dataLength, info);
+    if (result) {
+        mData.resize(info.decodedSize);
+        mFormat = info.format;
+    }
+    return result;
+}
+
 bool MetroTexture::DecrunchTexture(const uint8_t* data, const size_t dataLength) {
     bool result = true;
 #ifndef METRO_NO_CRUNCH
-    crnd::crn_texture_info info;
-    info.m_struct_size = sizeof(crnd::crn_texture_info);
-    if (crnd::crnd_get_texture_info(data, scast<uint32_t>(dataLength), &info)) {
-        crnd::crnd_unpack_context ctx = crnd::crnd_unpack_begin(data, scast<uint32_t>(dataLength));
-
-        const size_t blockSize = (info.m_format == cCRNFmtDXT1) ? 8 : 16;
-
-        const size_t ddsSize = (info.m_format == cCRNFmtDXT1) ?
-            DDS_GetCompressedSizeBC1(info.m_width, info.m_height, info.m_levels) :
-            DDS_GetCompressedSizeBC7(info.m_width, info.m_height, info.m_levels);
-
-        mData.resize(ddsSize);
-
-        uint8_t* dstPtr = mData.data();
-
-        size_t size = info.m_width;
-        for (size_t mip = 0; mip < info.m_levels; ++mip) {
-            const size_t numBlocks = (size / 4);
-            const size_t pitch = numBlocks * blockSize;
-            const size_t mipSize = numBlocks * pitch;
-
-            if (!crnd::crnd_unpack_level(ctx, rcast<void**>(&dstPtr), scast<uint32_t>(mipSize), scast<uint32_t>(pitch), scast<uint32_t>(mip))) {
-                crnd::crnd_unpack_end(ctx);
-                result = false;
-                break;
-            }
-
-            dstPtr += mipSize;
-
-            size >>= 1;
-            if (size < 4) {
-                size = 4;
-            }
-        }
+    result = this->PrepareCrunched(data, dataLength) &&
+             MetroTexture::DecrunchToBuffer(data, dataLength, mData.data(), mData.size());
+    if (!result) {
+        mData.clear();
+    }
+#endif // METRO_NO_CRUNCH
+    return result;
+}
 
-        if (result) {
-            crnd::crnd_unpack_end(ctx);
+bool MetroTexture::DecompressBlocksRGBA(const uint8_t* blocks, uint8_t* outPixels, const size_t width, const size_t height) const {
+    bool result = false;
 
-            mFormat = (info.m_format == cCRNFmtDXT1) ? PixelFormat::BC1 : PixelFormat::BC3;
-        }
-    } else {
-        result = false;
+    //#TODO: add support for other formats!
+    if (mFormat == PixelFormat::BC7) {
+        DDS_DecompressBC7(blocks, outPixels, width, height);
+        result = true;
+    } else if (mFormat == PixelFormat::BC3) {
+        DDS_DecompressBC3(blocks, outPixels, width, height);
+        result = true;
+    } else if (mFormat == PixelFormat::BC1) {
+        memset(outPixels, 255, width * height * 4);
+        DDS_DecompressBC1(blocks, outPixels, width, height);
+        result = true;
+    } else if (mFormat == PixelFormat::RGBA8_UNORM) {
+        // loaded images (LoadFromFile / LoadFromRGBA) are plain pixels already
+        memcpy(outPixels, blocks, width * height * 4);
+        result = true;
     }
-#endif // METRO_NO_CRUNCH
+
     return result;
 }
@@ -1,5 +1,7 @@
 #pragma once
 #include "mycommon.h"
+#include "png_utils.h"
+#include "mip_utils.h"
 
 class MetroTexture {
 public:
@@ -58,6 +60,55 @@ public:
         "BGRA8_UNORM"
     };
 
+    // legacy crunched textures (.512c / .1024c / .2048c)
+    struct CrunchedInfo {
+        size_t          width;
+        size_t          height;
+        size_t          numMips;
+        PixelFormat     format;         // BC1 or BC3
+        size_t          decodedSize;    // size of all BCn mips, tightly packed
+    };
+
+    struct DecrunchJob {
+        const uint8_t*  data;
+        size_t          dataLength;
+        uint8_t*        dst;            // must hold at least CrunchedInfo::decodedSize bytes
+        size_t          dstSize;
+        // results
+        bool            success;
+        double          decodeTimeMs;   // summed over all threads that worked on this texture
+    };
+
+    struct DecrunchFileJob {
+        const uint8_t*  data;
+        size_t          dataLength;
+        fs::path        filePath;       // DX9 DDS (DXT1 / DXT5) with all the mips
+        // results
+        bool            success;
+        double          decodeTimeMs;
+    };
+
+    struct CrunchedLoadJob {
+        const uint8_t*  data;
+        size_t          dataLength;
+        CharString      fileName;       // dimension and mips come from the extension, as in LoadFromData
+        MetroTexture*   texture;
+        // results
+        bool            success;
+    };
+
+public:
+    static bool     GetCrunchedInfo(const uint8_t* data, const size_t dataLength, CrunchedInfo& info);
+    // transcodes all mips of all jobs concurrently, every worker keeps its own unpack context
+    //  meant for many textures at once (folder export), a single texture has too few mips to spread over threads
+    static void     DecrunchBatch(MyArray<DecrunchJob>& jobs, const size_t numThreads = 0);
+    static void     DecrunchBatchToDDS(MyArray<DecrunchFileJob>& jobs, const size_t numThreads = 0);
+    // single texture, transcoded serially on the calling thread with one unpack context
+    static bool     DecrunchToBuffer(const uint8_t* data, const size_t dataLength, uint8_t* dst, const size_t dstSize, double* decodeTimeMs = nullptr);
+    static bool     DecrunchToDDS(const uint8_t* data, const size_t dataLength, const fs::path& filePath, double* decodeTimeMs = nullptr);
+    // same result as LoadFromData on every job's texture, but all the mips of all the textures go through one DecrunchBatch
+    static void     LoadCrunchedBatch(MyArray<CrunchedLoadJob>& jobs, const size_t numThreads = 0);
+
 public:
     MetroTexture();
     ~MetroTexture();
@@ -65,12 +116,13 @@ public:
     bool            LoadFromPath(const CharString& path);
     bool            LoadFromData(MemStream& stream, const CharString& fileName);
     bool            LoadFromFile(const fs::path& fileName);
+    bool            LoadFromRGBA(const uint8_t* pixels, const size_t width, const size_t height);
 
     bool            SaveAsDDS(const fs::path& filePath);
     bool            SaveAsLegacyDDS(const fs::path& filePath);
     bool            SaveAsTGA(const fs::path& filePath);
-    bool            SaveAsPNG(const fs::path& filePath);
-    bool            SaveAsMetroTexture(const fs::path& filePath, const PixelFormat format = PixelFormat::BC7);
+    bool            SaveAsPNG(const fs::path& filePath, const int compressionLevel = scast<int>(PngCompression::Default));
+    bool            SaveAsMetroTexture(const fs::path& filePath, const PixelFormat format = PixelFormat::BC7, const MipGenParams& mipParams = MipGenParams());
 
     bool            IsCubemap() const;
     size_t          GetWidth() const;
@@ -85,7 +137,9 @@ public:
     const uint8_t*  GetRawData() const;
 
 private:
+    bool            PrepareCrunched(const uint8_t* data, const size_t dataLength);
     bool            DecrunchTexture(const uint8_t* data, const size_t dataLength);
+    bool            DecompressBlocksRGBA(const uint8_t* blocks, uint8_t* outPixels, const size_t width, const size_t height) const;
 
 private:
     BytesArray      mData;
@@ -0,0 +1,352 @@
+#include "MetroTextureBenchmark.h"
+#include "MetroCompression.h"
+#include "jansson.h"
+
+#include <chrono>
+#include <cmath>
+
+
+static const double kMaxPSNR = 99.0;
+
+static double Bench_PSNR(const uint8_t* a, const uint8_t* b, const size_t width, const size_t height, const size_t stride, const size_t channelMask) {
+    double sse = 0.0;
+    size_t numSamples = 0;
+
+    for (size_t y = 0; y < height; ++y) {
+        const uint8_t* rowA = a + y * stride * 4;
+        const uint8_t* rowB = b + y * stride * 4;
+        for (size_t x = 0; x < width; ++x) {
+            for (size_t c = 0; c < 4; ++c) {
+                if (channelMask & (1 << c)) {
+                    const double d = scast<double>(rowA[x * 4 + c]) - scast<double>(rowB[x * 4 + c]);
+                    sse += d * d;
+                    ++numSamples;
+                }
+            }
+        }
+    }
+
+    if (!numSamples || sse <= 0.0) {
+        return kMaxPSNR;
+    }
+
+    const double mse = sse / scast<double>(numSamples);
+    return std::min(kMaxPSNR, 10.0 * std::log10((255.0 * 255.0) / mse));
+}
+
+// mean SSIM over 8x8 windows with a step of 4
+static double Bench_SSIM(const uint8_t* a, const uint8_t* b, const size_t width, const size_t height, const size_t stride, const size_t channel) {
+    const double c1 = (0.01 * 255.0) * (0.01 * 255.0);
+    const double c2 = (0.03 * 255.0) * (0.03 * 255.0);
+    const size_t kWindow = 8, kStep = 4;
+
+    if (width < kWindow || height < kWindow) {
+        return 1.0;
+    }
+
+    double sum = 0.0;
+    size_t numWindows = 0;
+
+    for (size_t wy = 0; wy + kWindow <= height; wy += kStep) {
+        for (size_t wx = 0; wx + kWindow <= width; wx += kStep) {
+            double sa = 0.0, sb = 0.0, saa = 0.0, sbb = 0.0, sab = 0.0;
+            for (size_t y = wy; y < wy + kWindow; ++y) {
+                for (size_t x = wx; x < wx + kWindow; ++x) {
+                    const double va = a[(y * stride + x) * 4 + channel];
+                    const double vb = b[(y * stride + x) * 4 + channel];
+                    sa += va; sb += vb;
+                    saa += va * va; sbb += vb * vb; sab += va * vb;
+                }
+            }
+
+            const double n = scast<double>(kWindow * kWindow);
+            const double ma = sa / n, mb = sb / n;
+            const double va = saa / n - ma * ma;
+            const double vb = sbb / n - mb * mb;
+            const double cov = sab / n - ma * mb;
+
+            sum += ((2.0 * ma * mb + c1) * (2.0 * cov + c2)) / ((ma * ma + mb * mb + c1) * (va + vb + c2));
+            ++numWindows;
+        }
+    }
+
+    return sum / scast<double>(numWindows);
+}
+
+static const char* Bench_FormatName(const MetroTexture::PixelFormat format) {
+    switch (format) {
+        case MetroTexture::PixelFormat::BC1: return "BC1";
+        case MetroTexture::PixelFormat::BC3: return "BC3";
+        case MetroTexture::PixelFormat::BC7: return "BC7";
+        default: return "unknown";
+    }
+}
+
+
+MyArray<TextureBenchPreset> MetroTextureBenchmark::GetDefaultPresets() {
+    MyArray<TextureBenchPreset> result;
+
+    TextureBenchPreset preset;
+
+    // BC1 / BC3
+    preset.params = DDSCompressParams();
+    preset.name = "bc1_hq";     preset.format = MetroTexture::PixelFormat::BC1; result.push_back(preset);
+    preset.name = "bc3_hq";     preset.format = MetroTexture::PixelFormat::BC3; result.push_back(preset);
+    preset.params.highQuality = false;
+    preset.name = "bc1_fast";   preset.format = MetroTexture::PixelFormat::BC1; result.push_back(preset);
+    preset.name = "bc3_fast";   preset.format = MetroTexture::PixelFormat::BC3; result.push_back(preset);
+
+    // BC7
+    preset.format = MetroTexture::PixelFormat::BC7;
+    preset.params = DDSCompressParams();
+    preset.name = "bc7_perceptual"; result.push_back(preset);
+
+    preset.params.perceptual = false;
+    preset.params.weights[0] = preset.params.weights[1] = preset.params.weights[2] = preset.params.weights[3] = 1;
+    preset.name = "bc7_linear"; result.push_back(preset);
+
+    preset.params = DDSCompressParams();
+    preset.params.maxPartitions = 16;
+    preset.name = "bc7_perceptual_fast"; result.push_back(preset);
+
+    preset.params = DDSCompressParams();
+    preset.params.uberLevel = 2;
+    preset.name = "bc7_perceptual_uber2"; result.push_back(preset);
+
+    return result;
+}
+
+MetroTextureBenchmark::MetroTextureBenchmark() {
+}
+MetroTextureBenchmark::~MetroTextureBenchmark() {
+}
+
+bool MetroTextureBenchmark::AddImage(const fs::path& filePath) {
+    bool result = false;
+
+    MetroTexture texture;
+    if (texture.LoadFromFile(filePath)) {
+        BytesArray rgba;
+        if (texture.GetRGBA(rgba)) {
+            this->AddImage(filePath.filename().u8string(), rgba.data(), texture.GetWidth(), texture.GetHeight());
+            result = true;
+        }
+    }
+
+    return result;
+}
+
+void MetroTextureBenchmark::AddImage(const CharString& name, const uint8_t* rgba, const size_t width, const size_t height) {
+    if (!rgba || !width || !height) {
+        return;
+    }
+
+    Image image;
+    image.name = name;
+    image.width = width;
+    image.height = height;
+    image.paddedWidth = (width + 3) & ~size_t(3);
+    image.paddedHeight = (height + 3) & ~size_t(3);
+    image.rgba.resize(image.paddedWidth * image.paddedHeight * 4);
+
+    // encoders only deal with whole blocks - replicate the edge texels into the padding
+    for (size_t y = 0; y < image.paddedHeight; ++y) {
+        const uint8_t* srcRow = rgba + std::min(y, height - 1) * width * 4;
+        uint8_t* dstRow = image.rgba.data() + y * image.paddedWidth * 4;
+        std::memcpy(dstRow, srcRow, width * 4);
+        for (size_t x = width; x < image.paddedWidth; ++x) {
+            std::memcpy(dstRow + x * 4, srcRow + (width - 1) * 4, 4);
+        }
+    }
+
+    mImages.emplace_back(std::move(image));
+}
+
+size_t MetroTextureBenchmark::GetNumImages() const {
+    return mImages.size();
+}
+
+size_t MetroTextureBenchmark::Run(const MyArray<TextureBenchPreset>& presets, const size_t numIterations) {
+    mResults.clear();
+    mResults.reserve(mImages.size() * presets.size());
+
+    for (const Image& image : mImages) {
+        for (const TextureBenchPreset& preset : presets) {
+            TextureBenchResult result = {};
+            if (this->RunSingle(image, preset, std::max<size_t>(1, numIterations), result)) {
+                mResults.emplace_back(std::move(result));
+            } else {
+                LogPrintF(LogLevel::Warning, "Texture benchmark: preset %s can't be used for %s", preset.name.c_str(), image.name.c_str());
+            }
+        }
+    }
+
+    return mResults.size();
+}
+
+const MyArray<TextureBenchResult>& MetroTextureBenchmark::GetResults() const {
+    return mResults;
+}
+
+json_t* MetroTextureBenchmark::ToJsonTree() const {
+    json_t* root = json_object();
+    json_t* results = json_array();
+
+    struct PresetSummary {
+        double      psnrRGB = 0.0;
+        double      ssim = 0.0;
+        double      encodeMs = 0.0;
+        double      decodeMs = 0.0;
+        double      megaPixels = 0.0;
+        size_t      blocksSize = 0;
+        size_t      lz4Size = 0;
+        size_t      count = 0;
+    };
+    MyArray<CharString> presetsOrder;
+    MyDict<CharString, PresetSummary> summaries;
+
+    for (const TextureBenchResult& r : mResults) {
+        json_t* jr = json_object();
+        json_object_set_new(jr, "image", json_string(r.image.c_str()));
+        json_object_set_new(jr, "preset", json_string(r.preset.c_str()));
+        json_object_set_new(jr, "format", json_string(Bench_FormatName(r.format)));
+        json_object_set_new(jr, "width", json_integer(scast<json_int_t>(r.width)));
+        json_object_set_new(jr, "height", json_integer(scast<json_int_t>(r.height)));
+        json_object_set_new(jr, "encode_ms", json_real(r.encodeMs));
+        json_object_set_new(jr, "encode_mpix_s", json_real(r.encodeMPixPerSec));
+        json_object_set_new(jr, "decode_ms", json_real(r.decodeMs));
+        json_object_set_new(jr, "decode_mpix_s", json_real(r.decodeMPixPerSec));
+
+        json_t* psnr = json_object();
+        json_object_set_new(psnr, "r", json_real(r.psnr[0]));
+        json_object_set_new(psnr, "g", json_real(r.psnr[1]));
+        json_object_set_new(psnr, "b", json_real(r.psnr[2]));
+        json_object_set_new(psnr, "a", json_real(r.psnr[3]));
+        json_object_set_new(psnr, "rgb", json_real(r.psnrRGB));
+        json_object_set_new(jr, "psnr", psnr);
+
+        json_t* ssim = json_object();
+        json_object_set_new(ssim, "r", json_real(r.ssim[0]));
+        json_object_set_new(ssim, "g", json_real(r.ssim[1]));
+        json_object_set_new(ssim, "b", json_real(r.ssim[2]));
+        json_object_set_new(ssim, "a", json_real(r.ssim[3]));
+        json_object_set_new(jr, "ssim", ssim);
+
+        json_object_set_new(jr, "blocks_size", json_integer(scast<json_int_t>(r.blocksSize)));
+        json_object_set_new(jr, "lz4_size", json_integer(scast<json_int_t>(r.lz4Size)));
+        json_object_set_new(jr, "lz4_ratio", json_real(r.lz4Ratio));
+
+        json_array_append_new(results, jr);
+
+        auto it = summaries.find(r.preset);
+        if (it == summaries.end()) {
+            presetsOrder.push_back(r.preset);
+            it = summaries.insert({ r.preset, PresetSummary() }).first;
+        }
+
+        PresetSummary& ps = it->second;
+        ps.psnrRGB += r.psnrRGB;
+        ps.ssim += (r.ssim[0] + r.ssim[1] + r.ssim[2]) / 3.0;
+        ps.encodeMs += r.encodeMs;
+        ps.decodeMs += r.decodeMs;
+        ps.megaPixels += scast<double>(r.width * r.height) / 1e6;
+        ps.blocksSize += r.blocksSize;
+        ps.lz4Size += r.lz4Size;
+        ++ps.count;
+    }
+
+    json_t* summary = json_object();
+    for (const CharString& name : presetsOrder) {
+        const PresetSummary& ps = summaries[name];
+        const double n = scast<double>(ps.count);
+
+        json_t* js = json_object();
+        json_object_set_new(js, "images", json_integer(scast<json_int_t>(ps.count)));
+        json_object_set_new(js, "mean_psnr_rgb", json_real(ps.psnrRGB / n));
+        json_object_set_new(js, "mean_ssim_rgb", json_real(ps.ssim / n));
+        json_object_set_new(js, "encode_mpix_s", json_real(ps.encodeMs > 0.0 ? ps.megaPixels / (ps.encodeMs / 1000.0) : 0.0));
+        json_object_set_new(js, "decode_mpix_s", json_real(ps.decodeMs > 0.0 ? ps.megaPixels / (ps.decodeMs / 1000.0) : 0.0));
+        json_object_set_new(js, "lz4_ratio", json_real(ps.lz4Size ? scast<double>(ps.blocksSize) / scast<double>(ps.lz4Size) : 0.0));
+        json_object_set_new(summary, name.c_str(), js);
+    }
+
+    json_object_set_new(root, "results", results);
+    json_object_set_new(root, "summary", summary);
+
+    return root;
+}
+
+bool MetroTextureBenchmark::RunSingle(const Image& image, const TextureBenchPreset& preset, const size_t numIterations, TextureBenchResult& result) const {
+    using Clock = std::chrono::high_resolution_clock;
+
+    const size_t w = image.paddedWidth;
+    const size_t h = image.paddedHeight;
+
+    size_t blocksSize = 0;
+    switch (preset.format) {
+        case MetroTexture::PixelFormat::BC1: {
+            blocksSize = DDS_GetCompressedSizeBC1(w, h, 1);
+        } break;
+        case MetroTexture::PixelFormat::BC3:
+        case MetroTexture::PixelFormat::BC7: {
+            blocksSize = DDS_GetCompressedSizeBC7(w, h, 1);
+        } break;
+        default:
+            return false;
+    }
+
+    BytesArray blocks(blocksSize);
+    BytesArray decoded(w * h * 4);
+
+    double bestEncodeMs = 0.0, bestDecodeMs = 0.0;
+    for (size_t i = 0; i < numIterations; ++i) {
+        const auto t0 = Clock::now();
+        switch (preset.format) {
+            case MetroTexture::PixelFormat::BC1: DDS_CompressBC1(image.rgba.data(), blocks.data(), w, h, preset.params); break;
+            case MetroTexture::PixelFormat::BC3: DDS_CompressBC3(image.rgba.data(), blocks.data(), w, h, preset.params); break;
+            case MetroTexture::PixelFormat::BC7: DDS_CompressBC7(image.rgba.data(), blocks.data(), w, h, preset.params); break;
+            default: break;
+        }
+        const auto t1 = Clock::now();
+        switch (preset.format) {
+            case MetroTexture::PixelFormat::BC1: DDS_DecompressBC1(blocks.data(), decoded.data(), w, h); break;
+            case MetroTexture::PixelFormat::BC3: DDS_DecompressBC3(blocks.data(), decoded.data(), w, h); break;
+            case MetroTexture::PixelFormat::BC7: DDS_DecompressBC7(blocks.data(), decoded.data(), w, h); break;
+            default: break;
+        }
+        const auto t2 = Clock::now();
+
+        const double encodeMs = std::chrono::duration<double, std::milli>(t1 - t0).count();
+        const double decodeMs = std::chrono::duration<double, std::milli>(t2 - t1).count();
+        bestEncodeMs = (i == 0) ? encodeMs : std::min(bestEncodeMs, encodeMs);
+        bestDecodeMs = (i == 0) ? decodeMs : std::min(bestDecodeMs, decodeMs);
+    }
+
+    BytesArray packed;
+    MetroCompression::CompressBlob(blocks.data(), blocks.size(), packed);
+
+    const double megaPixels = scast<double>(w * h) / 1e6;
+
+    result.image = image.name;
+    result.preset = preset.name;
+    result.format = preset.format;
+    result.width = image.width;
+    result.height = image.height;
+    result.encodeMs = bestEncodeMs;
+    result.decodeMs = bestDecodeMs;
+    result.encodeMPixPerSec = bestEncodeMs > 0.0 ? megaPixels / (bestEncodeMs / 1000.0) : 0.0;
+    result.decodeMPixPerSec = bestDecodeMs > 0.0 ? megaPixels / (bestDecodeMs / 1000.0) : 0.0;
+
+    // quality is measured on the original area only, padding doesn't count
+    for (size_t c = 0; c < 4; ++c) {
+        result.psnr[c] = Bench_PSNR(image.rgba.data(), decoded.data(), image.width, image.height, w, size_t(1) << c);
+        result.ssim[c] = Bench_SSIM(image.rgba.data(), decoded.data(), image.width, image.height, w, c);
+    }
+    result.psnrRGB = Bench_PSNR(image.rgba.data(), decoded.data(), image.width, image.height, w, 0x7);
+
+    result.blocksSize = blocks.size();
+    result.lz4Size = packed.size();
+    result.lz4Ratio = packed.empty() ? 0.0 : scast<double>(blocks.size()) / scast<double>(packed.size());
+
+    return true;
+}
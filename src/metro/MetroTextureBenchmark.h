@@ -0,0 +1,68 @@
+#pragma once
+#include "mycommon.h"
+#include "dds_utils.h"
+#include "MetroTexture.h"
+
+struct json_t;
+
+// Runs a set of images through the block encoders we ship Metro textures with
+//  and measures encode/decode speed, per-channel PSNR/SSIM and how well the blocks pack with LZ4.
+//  Everything runs on the calling thread, so numbers stay comparable between builds.
+
+struct TextureBenchPreset {
+    CharString                  name;
+    MetroTexture::PixelFormat   format;     // BC1, BC3 or BC7
+    DDSCompressParams           params;
+};
+
+struct TextureBenchResult {
+    CharString  image;
+    CharString  preset;
+    MetroTexture::PixelFormat format;
+    size_t      width;
+    size_t      height;
+    double      encodeMs;               // best of all iterations
+    double      decodeMs;
+    double      encodeMPixPerSec;
+    double      decodeMPixPerSec;
+    double      psnr[4];                // R, G, B, A in dB, capped at 99 for exact matches
+    double      psnrRGB;
+    double      ssim[4];
+    size_t      blocksSize;
+    size_t      lz4Size;                // what CompressBlob makes of the blocks
+    double      lz4Ratio;
+};
+
+class MetroTextureBenchmark {
+public:
+    static MyArray<TextureBenchPreset> GetDefaultPresets();
+
+    MetroTextureBenchmark();
+    ~MetroTextureBenchmark();
+
+    bool                                AddImage(const fs::path& filePath);
+    void                                AddImage(const CharString& name, const uint8_t* rgba, const size_t width, const size_t height);
+    size_t                              GetNumImages() const;
+
+    // returns number of successful runs (images x presets)
+    size_t                              Run(const MyArray<TextureBenchPreset>& presets, const size_t numIterations = 1);
+
+    const MyArray<TextureBenchResult>&  GetResults() const;
+    json_t*                             ToJsonTree() const;
+
+private:
+    struct Image {
+        CharString  name;
+        size_t      width;          // original size
+        size_t      height;
+        size_t      paddedWidth;    // rounded up to whole blocks
+        size_t      paddedHeight;
+        BytesArray  rgba;           // padded
+    };
+
+    bool                                RunSingle(const Image& image, const TextureBenchPreset& preset, const size_t numIterations, TextureBenchResult& result) const;
+
+private:
+    MyArray<Image>                      mImages;
+    MyArray<TextureBenchResult>         mResults;
+};
@@ -0,0 +1,418 @@
+#include "MetroTextureDupFinder.h"
+#include "MetroFileSystem.h"
+#include "MetroTexture.h"
+#include "jansson.h"
+
+#include <cmath>
+#include <mutex>
+#include <numeric>
+
+
+struct MetroTextureDupFinder::TextureEntry {
+    struct Level {
+        Level(const MetroFSPath& _path, const CharString& _extension, const size_t _size)
+            : path(_path), extension(_extension), size(_size) {}
+
+        MetroFSPath path;
+        CharString  extension;
+        size_t      size;
+    };
+
+    CharString          name;
+    MyArray<Level>      levels;         // sorted by extension
+    size_t              totalSize = 0;
+    uint64_t            layoutKey = 0;  // extensions + sizes
+    uint64_t            tiersKey = 0;   // extensions only
+    uint64_t            contentKey = 0;
+    uint64_t            pHash = 0;
+    bool                hasPHash = false;
+    bool                hasAlpha = false;
+    size_t              width = 0;
+    size_t              height = 0;
+    size_t              numMips = 0;
+    float               meanColor[4] = {};
+    bool                aliased = false;
+};
+
+
+static bool DupFinder_IsTextureExtension(const CharString& ext) {
+    return ext == ".512" || ext == ".1024" || ext == ".2048" || ext == ".4096" ||
+           ext == ".512c" || ext == ".1024c" || ext == ".2048c" || ext == ".dds";
+}
+
+// classic pHash - 32x32 luminance, 2D DCT, low 8x8 frequencies (minus DC) against their median
+static uint64_t DupFinder_CalcPHash(const uint8_t* rgba, const size_t width, const size_t height) {
+    const size_t kSize = 32, kLow = 8;
+
+    float luma[kSize * kSize];
+    for (size_t y = 0; y < kSize; ++y) {
+        const size_t y0 = (y * height) / kSize, y1 = std::max(y0 + 1, ((y + 1) * height) / kSize);
+        for (size_t x = 0; x < kSize; ++x) {
+            const size_t x0 = (x * width) / kSize, x1 = std::max(x0 + 1, ((x + 1) * width) / kSize);
+
+            float sum = 0.0f;
+            for (size_t sy = y0; sy < y1; ++sy) {
+                const uint8_t* p = rgba + (sy * width + x0) * 4;
+                for (size_t sx = x0; sx < x1; ++sx, p += 4) {
+                    sum += 0.299f * p[0] + 0.587f * p[1] + 0.114f * p[2];
+                }
+            }
+            luma[y * kSize + x] = sum / scast<float>((y1 - y0) * (x1 - x0));
+        }
+    }
+
+    static float sCosTable[kLow * kSize];
+    static std::once_flag sCosTableInit;
+    std::call_once(sCosTableInit, []() {
+        for (size_t u = 0; u < kLow; ++u) {
+            for (size_t x = 0; x < kSize; ++x) {
+                sCosTable[u * kSize + x] = std::cos(((2.0f * x + 1.0f) * u * 3.14159265f) / (2.0f * kSize));
+            }
+        }
+    });
+
+    // rows first, only the frequencies we need
+    float rows[kSize * kLow];
+    for (size_t y = 0; y < kSize; ++y) {
+        for (size_t u = 0; u < kLow; ++u) {
+            float sum = 0.0f;
+            for (size_t x = 0; x < kSize; ++x) {
+                sum += luma[y * kSize + x] * sCosTable[u * kSize + x];
+            }
+            rows[y * kLow + u] = sum;
+        }
+    }
+
+    float dct[kLow * kLow];
+    for (size_t v = 0; v < kLow; ++v) {
+        for (size_t u = 0; u < kLow; ++u) {
+            float sum = 0.0f;
+            for (size_t y = 0; y < kSize; ++y) {
+                sum += rows[y * kLow + u] * sCosTable[v * kSize + y];
+            }
+            dct[v * kLow + u] = sum;
+        }
+    }
+
+    float sorted[kLow * kLow - 1];
+    std::copy(dct + 1, dct + kLow * kLow, sorted);
+    std::nth_element(sorted, sorted + (kLow * kLow - 1) / 2, sorted + kLow * kLow - 1);
+    const float median = sorted[(kLow * kLow - 1) / 2];
+
+    uint64_t result = 0;
+    for (size_t i = 1; i < kLow * kLow; ++i) {
+        if (dct[i] > median) {
+            result |= uint64_t(1) << i;
+        }
+    }
+
+    return result;
+}
+
+static void DupFinder_CalcMeanColor(const uint8_t* rgba, const size_t width, const size_t height, float (&meanColor)[4]) {
+    double sum[4] = {};
+    const size_t numPixels = width * height;
+    for (size_t i = 0; i < numPixels; ++i, rgba += 4) {
+        sum[0] += rgba[0]; sum[1] += rgba[1]; sum[2] += rgba[2]; sum[3] += rgba[3];
+    }
+    for (size_t c = 0; c < 4; ++c) {
+        meanColor[c] = numPixels ? scast<float>(sum[c] / scast<double>(numPixels)) : 0.0f;
+    }
+}
+
+static uint32_t DupFinder_HammingDistance(const uint64_t a, const uint64_t b) {
+    uint64_t x = a ^ b;
+    uint32_t result = 0;
+    while (x) {
+        x &= x - 1;
+        ++result;
+    }
+    return result;
+}
+
+
+MetroTextureDupFinder::MetroTextureDupFinder()
+    : mNumScannedTextures(0) {
+}
+MetroTextureDupFinder::~MetroTextureDupFinder() {
+}
+
+bool MetroTextureDupFinder::Scan(const MetroFileSystem& mfs, const TextureDupScanParams& params) {
+    mSuggestions.clear();
+    mNumScannedTextures = 0;
+
+    const MyArray<MetroFSPath> files = mfs.FindFilesInFolder(MetroFileSystem::Paths::TexturesFolder, kEmptyString, true);
+    if (files.empty()) {
+        return false;
+    }
+
+    // group level files into textures
+    MyArray<TextureEntry> textures;
+    MyDict<CharString, size_t> nameToTexture;
+
+    for (size_t i = 0; i < files.size(); ++i) {
+        const CharString fullPath = mfs.GetFullPath(files[i]);
+        const CharString::size_type dotPos = fullPath.find_last_of('.');
+        if (dotPos == CharString::npos) {
+            continue;
+        }
+
+        CharString ext = fullPath.substr(dotPos);
+        std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+        if (!DupFinder_IsTextureExtension(ext)) {
+            continue;
+        }
+
+        const CharString::size_type folderPos = fullPath.find(MetroFileSystem::Paths::TexturesFolder);
+        const size_t nameStart = (folderPos == CharString::npos) ? 0 : folderPos + MetroFileSystem::Paths::TexturesFolder.length();
+        const CharString name = fullPath.substr(nameStart, dotPos - nameStart);
+
+        auto it = nameToTexture.find(name);
+        if (it == nameToTexture.end()) {
+            it = nameToTexture.insert({ name, textures.size() }).first;
+            textures.push_back(TextureEntry());
+            textures.back().name = name;
+        }
+
+        TextureEntry& tex = textures[it->second];
+        tex.levels.emplace_back(files[i], ext, mfs.GetUncompressedSize(files[i]));
+        tex.totalSize += tex.levels.back().size;
+    }
+
+    for (TextureEntry& tex : textures) {
+        std::sort(tex.levels.begin(), tex.levels.end(), [](const TextureEntry::Level& a, const TextureEntry::Level& b) {
+            return a.extension < b.extension;
+        });
+
+        uint64_t key = 0, tiersKey = 0;
+        for (const TextureEntry::Level& level : tex.levels) {
+            key = Hash_CalculateXX64(rcast<const uint8_t*>(level.extension.data()), level.extension.length(), key);
+            key = Hash_CalculateXX64(rcast<const uint8_t*>(&level.size), sizeof(size_t), key);
+            tiersKey = Hash_CalculateXX64(rcast<const uint8_t*>(level.extension.data()), level.extension.length(), tiersKey);
+        }
+        tex.layoutKey = key;
+        tex.tiersKey = tiersKey;
+    }
+
+    // deterministic output no matter how the archives are laid out
+    std::sort(textures.begin(), textures.end(), [](const TextureEntry& a, const TextureEntry& b) {
+        return a.name < b.name;
+    });
+
+    mNumScannedTextures = textures.size();
+
+    this->FindExactDuplicates(mfs, textures, params);
+    if (params.findNearDuplicates) {
+        this->FindNearDuplicates(mfs, textures, params);
+    }
+
+    return true;
+}
+
+size_t MetroTextureDupFinder::GetNumScannedTextures() const {
+    return mNumScannedTextures;
+}
+
+const MyArray<TextureAliasSuggestion>& MetroTextureDupFinder::GetSuggestions() const {
+    return mSuggestions;
+}
+
+json_t* MetroTextureDupFinder::ToJsonTree() const {
+    json_t* root = json_object();
+    json_t* aliases = json_array();
+
+    size_t exactSaved = 0, nearSaved = 0;
+    for (const TextureAliasSuggestion& s : mSuggestions) {
+        json_t* ja = json_object();
+        json_object_set_new(ja, "src", json_string(s.src.c_str()));
+        json_object_set_new(ja, "dst", json_string(s.dst.c_str()));
+        json_object_set_new(ja, "exact", s.exact ? json_true() : json_false());
+        json_object_set_new(ja, "hash_distance", json_integer(scast<json_int_t>(s.hashDistance)));
+        json_object_set_new(ja, "bytes_saved", json_integer(scast<json_int_t>(s.bytesSaved)));
+        json_array_append_new(aliases, ja);
+
+        (s.exact ? exactSaved : nearSaved) += s.bytesSaved;
+    }
+
+    json_object_set_new(root, "scanned_textures", json_integer(scast<json_int_t>(mNumScannedTextures)));
+    json_object_set_new(root, "exact_bytes_saved", json_integer(scast<json_int_t>(exactSaved)));
+    json_object_set_new(root, "near_bytes_saved", json_integer(scast<json_int_t>(nearSaved)));
+    // same member name and src/dst layout as texture_aliases.bin
+    json_object_set_new(root, "texture_aliases", aliases);
+
+    return root;
+}
+
+void MetroTextureDupFinder::FindExactDuplicates(const MetroFileSystem& mfs, MyArray<TextureEntry>& textures, const TextureDupScanParams& params) {
+    // only textures sharing the exact same set of level sizes can be byte-identical, hash just those
+    MyDict<uint64_t, MyArray<size_t>> byLayout;
+    for (size_t i = 0; i < textures.size(); ++i) {
+        byLayout[textures[i].layoutKey].push_back(i);
+    }
+
+    MyArray<size_t> toHash;
+    for (const auto& kv : byLayout) {
+        if (kv.second.size() > 1) {
+            toHash.insert(toHash.end(), kv.second.begin(), kv.second.end());
+        }
+    }
+    // textures are sorted by name, so in index order the first copy is always the alphabetically first one
+    std::sort(toHash.begin(), toHash.end());
+
+    ParallelFor(toHash.size(), [&](const size_t idx, const size_t) {
+        TextureEntry& tex = textures[toHash[idx]];
+
+        uint64_t key = tex.layoutKey;
+        for (const TextureEntry::Level& level : tex.levels) {
+            MemStream stream = mfs.OpenFileStream(level.path);
+            key = stream ? Hash_CalculateXX64(stream.Data(), stream.Length(), key) : ~0ull;
+            if (!stream) {
+                break;
+            }
+        }
+        tex.contentKey = key;
+    }, params.numThreads);
+
+    MyDict<uint64_t, size_t> firstByContent;
+    for (const size_t i : toHash) {
+        TextureEntry& tex = textures[i];
+        if (tex.contentKey == ~0ull) {
+            continue;
+        }
+
+        auto it = firstByContent.find(tex.contentKey);
+        if (it == firstByContent.end()) {
+            firstByContent.insert({ tex.contentKey, i });
+        } else {
+            tex.aliased = true;
+            mSuggestions.push_back({ tex.name, textures[it->second].name, true, 0, tex.totalSize });
+        }
+    }
+}
+
+void MetroTextureDupFinder::FindNearDuplicates(const MetroFileSystem& mfs, MyArray<TextureEntry>& textures, const TextureDupScanParams& params) {
+    // hash the top mip of the .512 file (or the plain dds) of everything that isn't an alias already
+    ParallelFor(textures.size(), [&](const size_t idx, const size_t) {
+        TextureEntry& tex = textures[idx];
+        if (tex.aliased) {
+            return;
+        }
+
+        const TextureEntry::Level* source = nullptr;
+        for (const TextureEntry::Level& level : tex.levels) {
+            if (level.extension == ".512" || level.extension == ".512c" || (level.extension == ".dds" && !source)) {
+                source = &level;
+            }
+        }
+        if (!source) {
+            return;
+        }
+
+        MemStream stream = mfs.OpenFileStream(source->path);
+        if (!stream) {
+            return;
+        }
+
+        MetroTexture texture;
+        BytesArray rgba;
+        if (texture.LoadFromData(stream, tex.name + source->extension) && texture.GetRGBA(rgba)) {
+            tex.pHash = DupFinder_CalcPHash(rgba.data(), texture.GetWidth(), texture.GetHeight());
+            tex.hasPHash = true;
+            tex.hasAlpha = texture.HasAlpha();
+            tex.width = texture.GetWidth();
+            tex.height = texture.GetHeight();
+            tex.numMips = texture.GetNumMips();
+            DupFinder_CalcMeanColor(rgba.data(), tex.width, tex.height, tex.meanColor);
+        }
+    }, params.numThreads);
+
+    // only compare textures that could actually replace each other - same size, mips, tiers and alpha presence
+    MyDict<uint64_t, MyArray<size_t>> buckets;
+    for (size_t i = 0; i < textures.size(); ++i) {
+        const TextureEntry& tex = textures[i];
+        if (tex.hasPHash) {
+            const size_t bucketValues[5] = { tex.width, tex.height, tex.numMips, tex.hasAlpha ? size_t(1) : size_t(0), scast<size_t>(tex.tiersKey) };
+            const uint64_t bucketKey = Hash_CalculateXX64(rcast<const uint8_t*>(bucketValues), sizeof(bucketValues), 0);
+            buckets[bucketKey].push_back(i);
+        }
+    }
+
+    auto isClose = [&params](const TextureEntry& a, const TextureEntry& b) {
+        // buckets are keyed by a hash, so the layout is checked again
+        if (a.width != b.width || a.height != b.height || a.numMips != b.numMips || a.hasAlpha != b.hasAlpha || a.tiersKey != b.tiersKey) {
+            return false;
+        }
+        for (size_t c = 0; c < 4; ++c) {
+            if (std::abs(a.meanColor[c] - b.meanColor[c]) > params.maxMeanColorDiff) {
+                return false;
+            }
+        }
+        return DupFinder_HammingDistance(a.pHash, b.pHash) <= params.maxHashDistance;
+    };
+
+    // union-find over all close pairs, the alphabetically first texture of every cluster becomes the target
+    MyArray<size_t> parent(textures.size());
+    std::iota(parent.begin(), parent.end(), size_t(0));
+    auto findRoot = [&parent](size_t i) {
+        while (parent[i] != i) {
+            parent[i] = parent[parent[i]];
+            i = parent[i];
+        }
+        return i;
+    };
+
+    std::mutex pairsLock;
+    for (const auto& kv : buckets) {
+        const MyArray<size_t>& bucket = kv.second;
+        if (bucket.size() < 2) {
+            continue;
+        }
+
+        ParallelFor(bucket.size(), [&](const size_t bi, const size_t) {
+            const TextureEntry& a = textures[bucket[bi]];
+
+            MyArray<size_t> close;
+            for (size_t bj = bi + 1; bj < bucket.size(); ++bj) {
+                if (isClose(a, textures[bucket[bj]])) {
+                    close.push_back(bucket[bj]);
+                }
+            }
+
+            if (!close.empty()) {
+                std::lock_guard<std::mutex> lock(pairsLock);
+                for (const size_t j : close) {
+                    const size_t ra = findRoot(bucket[bi]), rb = findRoot(j);
+                    if (ra != rb) {
+                        // textures are sorted by name, so the smaller index is always the better target
+                        parent[std::max(ra, rb)] = std::min(ra, rb);
+                    }
+                }
+            }
+        }, params.numThreads);
+    }
+
+    MyDict<CharString, size_t> nearAliased;
+    const size_t numExact = mSuggestions.size();
+    for (size_t i = 0; i < textures.size(); ++i) {
+        const size_t root = findRoot(i);
+        // clusters are chained pairs, the texture still has to be close to the one it gets aliased to
+        if (root != i && isClose(textures[i], textures[root])) {
+            TextureEntry& tex = textures[i];
+            const TextureEntry& target = textures[root];
+            tex.aliased = true;
+            nearAliased.insert({ tex.name, mSuggestions.size() });
+            mSuggestions.push_back({ tex.name, target.name, false, DupFinder_HammingDistance(tex.pHash, target.pHash), tex.totalSize });
+        }
+    }
+
+    // aliases aren't resolved recursively, so exact copies of a texture that just got aliased have to follow it
+    for (size_t i = 0; i < numExact; ++i) {
+        TextureAliasSuggestion& s = mSuggestions[i];
+        auto it = nearAliased.find(s.dst);
+        if (it != nearAliased.end()) {
+            s.dst = mSuggestions[it->second].dst;
+            s.exact = false;
+            s.hashDistance = mSuggestions[it->second].hashDistance;
+        }
+    }
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include "mycommon.h"
+
+class MetroFileSystem;
+struct json_t;
+
+// Finds textures that are stored more than once under different names
+//  Exact duplicates - all mip level files are byte-identical (only same-sized sets get hashed at all).
+//  Near duplicates  - perceptual hash (DCT of the 32x32 luminance) of the top .512 mip is within maxHashDistance bits
+//                     and the average colours match, only between textures of the same size, mips count and set of tiers.
+//  Result is a list of aliases in the same src -> dst form texture_aliases.bin uses.
+//
+// The json report (ToJsonTree, MetroTEX -dedup) is for people and tools editing texture_aliases.bin, nothing in
+//  MetroTools reads it back:
+//  {
+//    "scanned_textures":   number of textures found under the textures folder
+//    "exact_bytes_saved":  sum of "bytes_saved" of the exact aliases
+//    "near_bytes_saved":   same for the near ones
+//    "texture_aliases": [  one entry per texture that can go, exact ones first
+//      {
+//        "src":            texture name the way the game asks for it ("ui\hud\icon"), relative to content\textures,
+//                          no extension, all of its level files (.dds/.512/.1024/.2048/...) can be dropped
+//        "dst":            texture to alias src to, never a src itself, so one level of aliases is enough
+//                          (the game doesn't resolve them recursively)
+//        "exact":          true when every level file of src is byte-identical to the one of dst
+//        "hash_distance":  0 for exact, otherwise bits that differ in the 64 bit perceptual hash
+//        "bytes_saved":    total size of the src level files
+//      }
+//    ]
+//  }
+//  "src" and "dst" of every entry go to texture_aliases.bin as they are, entries of the texture_aliases.bin the game
+//  ships are not in the report (those textures are not stored at all).
+
+struct TextureAliasSuggestion {
+    CharString  src;            // texture that can be dropped, relative to the textures folder, no extension
+    CharString  dst;            // texture to alias it to
+    bool        exact;
+    uint32_t    hashDistance;   // 0 for exact duplicates
+    size_t      bytesSaved;     // total size of src level files
+};
+
+struct TextureDupScanParams {
+    size_t      numThreads = 0;         // 0 - all hardware threads
+    bool        findNearDuplicates = true;
+    uint32_t    maxHashDistance = 4;    // out of 64 bits
+    float       maxMeanColorDiff = 4.0f;// per channel, 0 .. 255, the hash is blind to flat colours (all flat textures hash the same)
+};
+
+class MetroTextureDupFinder {
+public:
+    MetroTextureDupFinder();
+    ~MetroTextureDupFinder();
+
+    // walks everything under MetroFileSystem::Paths::TexturesFolder
+    bool                                    Scan(const MetroFileSystem& mfs, const TextureDupScanParams& params = TextureDupScanParams());
+
+    size_t                                  GetNumScannedTextures() const;
+    const MyArray<TextureAliasSuggestion>&  GetSuggestions() const;
+
+    json_t*                                 ToJsonTree() const;
+
+private:
+    struct TextureEntry;
+
+    void                                    FindExactDuplicates(const MetroFileSystem& mfs, MyArray<TextureEntry>& textures, const TextureDupScanParams& params);
+    void                                    FindNearDuplicates(const MetroFileSystem& mfs, MyArray<TextureEntry>& textures, const TextureDupScanParams& params);
+
+private:
+    size_t                                  mNumScannedTextures;
+    MyArray<TextureAliasSuggestion>         mSuggestions;
+};
@@ -12,6 +12,7 @@
 //#include <functional>
 #include <windows.h>
 #include <process.h>
+#include <mutex>
 
 enum class MetroTextureType : uint8_t;
 
@@ -77,6 +78,8 @@ struct MetroTextureAliasInfo {
     }
 };
 
+#include "metro/textures/MetroTexturesDBIndex.inl"
+
 #include "metro/textures/MetroTexturesDBImpl2033.inl"
 #include "metro/textures/MetroTexturesDBImplLastLight.inl"
 #include "metro/textures/MetroTexturesDBImplRedux.inl"
@@ -109,7 +112,7 @@ bool MetroTexturesDatabase::Initialize(const MetroGameVersion version, const fs:
             mImpl = new Arktika1Impl::MetroTexturesDBImplArktika1();
         break;
         case MetroGameVersion::Exodus:
-            mImpl = new ExodusImpl::MetroTexturesDBImplExodus();
+            mImpl = new ExodusImpl::MetroTexturesDBImplExodus(mIndexCacheFolder);
         break;
         default:
             mImpl = nullptr;
@@ -128,6 +131,10 @@ bool MetroTexturesDatabase::Initialize(const MetroGameVersion version, const fs:
     return result;
 }
 
+void MetroTexturesDatabase::SetIndexCacheFolder(const fs::path& folder) {
+    mIndexCacheFolder = folder;
+}
+
 bool MetroTexturesDatabase::Good() const {
     return mImpl != nullptr;
 }
@@ -141,6 +148,7 @@ bool MetroTexturesDatabase::SaveBin(const fs::path& binPath) {
 }
 
 void MetroTexturesDatabase::Shutdown() {
+    this->InvalidateSurfacesCache();
     MySafeDelete(mImpl);
 }
 
@@ -181,11 +189,19 @@ MetroSurfaceDescription MetroTexturesDatabase::GetSurfaceSetFromFile(const Metro
     }
 }
 
-MetroSurfaceDescription MetroTexturesDatabase::GetSurfaceSetFromName(const HashString& textureName, const bool allMips) const {
+RefPtr<const MetroSurfaceDescription> MetroTexturesDatabase::GetSurfaceSetFromName(const HashString& textureName, const bool allMips) const {
     if (this->Good()) {
-        return mImpl->GetSurfaceSetFromName(textureName, allMips);
+        const uint64_t key = (scast<uint64_t>(textureName.hash) << 1) | (allMips ? 1 : 0);
+
+        std::lock_guard<std::mutex> lock(mSurfacesCacheLock);
+        auto it = mSurfacesCache.find(key);
+        if (it == mSurfacesCache.end()) {
+            //#NOTE: callers share the resolved set, clearing the cache only drops our reference to it
+            it = mSurfacesCache.insert({ key, MakeRefPtr<const MetroSurfaceDescription>(mImpl->GetSurfaceSetFromName(textureName, allMips)) }).first;
+        }
+        return it->second;
     } else {
-        static MetroSurfaceDescription emptyResult;
+        static const RefPtr<const MetroSurfaceDescription> emptyResult = MakeRefPtr<const MetroSurfaceDescription>();
         return emptyResult;
     }
 }
@@ -207,17 +223,25 @@ void MetroTexturesDatabase::FillCommonInfoByIdx(const size_t idx, MetroTextureIn
 void MetroTexturesDatabase::SetCommonInfoByIdx(const size_t idx, const MetroTextureInfoCommon& info) {
     if (this->Good()) {
         mImpl->SetCommonInfoByIdx(idx, info);
+        this->InvalidateSurfacesCache();
     }
 }
 
 void MetroTexturesDatabase::RemoveTextureByIdx(const size_t idx) {
     if (this->Good()) {
         mImpl->RemoveTextureByIdx(idx);
+        this->InvalidateSurfacesCache();
     }
 }
 
 void MetroTexturesDatabase::AddTexture(const MetroTextureInfoCommon& info) {
     if (this->Good()) {
         mImpl->AddTexture(info);
+        this->InvalidateSurfacesCache();
     }
 }
+
+void MetroTexturesDatabase::InvalidateSurfacesCache() {
+    std::lock_guard<std::mutex> lock(mSurfacesCacheLock);
+    mSurfacesCache.clear();
+}
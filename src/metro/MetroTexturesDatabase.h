@@ -3,6 +3,8 @@
 #include "mymath.h"
 #include "MetroTypes.h"
 
+#include <mutex>
+
 class MetroTexturesDBImpl;
 
 struct MetroTextureInfoCommon {
@@ -32,6 +34,8 @@ public:
     ~MetroTexturesDatabase();
 
     bool                    Initialize(const MetroGameVersion version, const fs::path& binPath = fs::path());
+    // where compiled indices get cached (Exodus only for now), empty - build in memory every time
+    void                    SetIndexCacheFolder(const fs::path& folder);
     bool                    Good() const;
     bool                    SaveBin(const fs::path& binPath);
     void                    Shutdown();
@@ -44,7 +48,8 @@ public:
     bool                    IsAlbedo(const MetroFSPath& file) const;
     bool                    IsCubemap(const MetroFSPath& file) const;
     MetroSurfaceDescription GetSurfaceSetFromFile(const MetroFSPath& file, const bool allMips) const;
-    MetroSurfaceDescription GetSurfaceSetFromName(const HashString& textureName, const bool allMips) const;
+    // resolved once per (name, allMips) and shared, the returned set outlives any cache invalidation
+    RefPtr<const MetroSurfaceDescription> GetSurfaceSetFromName(const HashString& textureName, const bool allMips) const;
 
     size_t                  GetNumTextures() const;
     const CharString&       GetTextureNameByIdx(const size_t idx) const;
@@ -54,6 +59,13 @@ public:
     void                    AddTexture(const MetroTextureInfoCommon& info);
 
 
+private:
+    void                    InvalidateSurfacesCache();
+
 private:
     MetroTexturesDBImpl*    mImpl;
+    fs::path                mIndexCacheFolder;
+
+    mutable MyDict<uint64_t, RefPtr<const MetroSurfaceDescription>> mSurfacesCache;
+    mutable std::mutex                                  mSurfacesCacheLock;
 };
@@ -0,0 +1,463 @@
+#include "MetroVertexCodec.h"
+#include "cpu_utils.h"
+
+
+namespace {
+
+constexpr size_t kConvertBlockSize  = 256;  // vertices decoded into SoA at once by VTX_ConvertVertices
+
+constexpr float kSkinnedPosDequant  = 1.0f / 32767.0f;
+constexpr float kSkinnedPosQuant    = 32767.0f;
+constexpr float kSkinnedUVDequant   = 1.0f / 2048.0f;
+constexpr float kSkinnedUVQuant     = 2048.0f;
+constexpr float kLevelUV0Dequant    = 1.0f / 1024.0f;
+constexpr float kLevelUV1Dequant    = 1.0f / 32767.0f;
+
+static bool UseAVX2() {
+    static const bool sHasAVX2 = CPU_SupportsAVX2();
+    return sHasAVX2;
+}
+
+
+// scalar path, exactly what ConvertVertex does
+static void DecodeNormalScalar(const uint32_t n, MetroVertexStreams& dst, const size_t i) {
+    const vec4 v = DecodeNormal(n);
+    dst.nx[i] = v.x;
+    dst.ny[i] = v.y;
+    dst.nz[i] = v.z;
+    dst.ao[i] = v.w;
+}
+
+static void DecodeTangentsScalar(const uint32_t t, const uint32_t b, MetroVertexStreams& dst, const size_t i) {
+    const vec4 tangent = DecodeTangent(t);
+    dst.tx[i] = tangent.x;
+    dst.ty[i] = tangent.y;
+    dst.tz[i] = tangent.z;
+    dst.tw[i] = tangent.w;
+
+    const vec4 bitangent = DecodeNormal(b);
+    dst.bx[i] = bitangent.x;
+    dst.by[i] = bitangent.y;
+    dst.bz[i] = bitangent.z;
+}
+
+static void DecodeStaticScalar(const VertexStatic& v, MetroVertexStreams& dst, const size_t i) {
+    dst.px[i] = v.pos.x;
+    dst.py[i] = v.pos.y;
+    dst.pz[i] = v.pos.z;
+    DecodeNormalScalar(v.normal, dst, i);
+    DecodeTangentsScalar(v.aux0, v.aux1, dst, i);
+    dst.u0[i] = v.uv.x;
+    dst.v0[i] = v.uv.y;
+}
+
+static void DecodeSkinnedScalar(const VertexSkinned& v, const float posScale, MetroVertexStreams& dst, const size_t i) {
+    const vec3 pos = DecodeSkinnedPosition(v.pos) * posScale;
+    dst.px[i] = pos.x;
+    dst.py[i] = pos.y;
+    dst.pz[i] = pos.z;
+    DecodeNormalScalar(v.normal, dst, i);
+    DecodeTangentsScalar(v.aux0, v.aux1, dst, i);
+    dst.u0[i] = scast<float>(v.uv[0]) * kSkinnedUVDequant;
+    dst.v0[i] = scast<float>(v.uv[1]) * kSkinnedUVDequant;
+    dst.bones[i] = *rcast<const uint32_t*>(v.bones);
+    dst.weights[i] = *rcast<const uint32_t*>(v.weights);
+}
+
+static void DecodeLevelScalar(const VertexLevel& v, MetroVertexStreams& dst, const size_t i) {
+    dst.px[i] = v.pos.x;
+    dst.py[i] = v.pos.y;
+    dst.pz[i] = v.pos.z;
+    DecodeNormalScalar(v.normal, dst, i);
+    DecodeTangentsScalar(v.aux0, v.aux1, dst, i);
+    dst.u0[i] = scast<float>(v.uv0[0]) * kLevelUV0Dequant;
+    dst.v0[i] = scast<float>(v.uv0[1]) * kLevelUV0Dequant;
+    dst.u1[i] = scast<float>(v.uv1[0]) * kLevelUV1Dequant;
+    dst.v1[i] = scast<float>(v.uv1[1]) * kLevelUV1Dequant;
+}
+
+static void EncodeStaticScalar(const MetroVertexStreams& src, const size_t i, VertexStatic& v) {
+    v.pos = vec3(src.px[i], src.py[i], src.pz[i]);
+    v.normal = EncodeNormal(vec3(src.nx[i], src.ny[i], src.nz[i]), src.ao[i]);
+    v.aux0 = EncodeNormal(vec3(src.tx[i], src.ty[i], src.tz[i]), src.tw[i] * 0.5f + 0.5f);
+    v.aux1 = EncodeNormal(vec3(src.bx[i], src.by[i], src.bz[i]), 1.0f);
+    v.uv = vec2(src.u0[i], src.v0[i]);
+}
+
+static void EncodeSkinnedScalar(const MetroVertexStreams& src, const size_t i, const float invPosScale, VertexSkinned& v) {
+    int16_t pos[4], uv[2];
+    EncodeSkinnedPosition(vec3(src.px[i], src.py[i], src.pz[i]) * invPosScale, pos);
+    EncodeSkinnedUV(vec2(src.u0[i], src.v0[i]), uv);
+
+    std::memcpy(v.pos, pos, sizeof(pos));
+    v.normal = EncodeNormal(vec3(src.nx[i], src.ny[i], src.nz[i]), src.ao[i]);
+    v.aux0 = EncodeNormal(vec3(src.tx[i], src.ty[i], src.tz[i]), src.tw[i] * 0.5f + 0.5f);
+    v.aux1 = EncodeNormal(vec3(src.bx[i], src.by[i], src.bz[i]), 1.0f);
+    *rcast<uint32_t*>(v.bones) = src.bones[i];
+    *rcast<uint32_t*>(v.weights) = src.weights[i];
+    std::memcpy(v.uv, uv, sizeof(uv));
+}
+
+
+// AVX2 path, 8 vertices (32 bytes each) at a time
+//  8 rows of 8 dwords get transposed so every register holds the same dword of all 8 vertices
+TARGET_AVX2 static inline void Transpose8x8(__m256 (&r)[8]) {
+    const __m256 t0 = _mm256_unpacklo_ps(r[0], r[1]);
+    const __m256 t1 = _mm256_unpackhi_ps(r[0], r[1]);
+    const __m256 t2 = _mm256_unpacklo_ps(r[2], r[3]);
+    const __m256 t3 = _mm256_unpackhi_ps(r[2], r[3]);
+    const __m256 t4 = _mm256_unpacklo_ps(r[4], r[5]);
+    const __m256 t5 = _mm256_unpackhi_ps(r[4], r[5]);
+    const __m256 t6 = _mm256_unpacklo_ps(r[6], r[7]);
+    const __m256 t7 = _mm256_unpackhi_ps(r[6], r[7]);
+
+    const __m256 s0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+    const __m256 s1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+    const __m256 s2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+    const __m256 s3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+    const __m256 s4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+    const __m256 s5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+    const __m256 s6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+    const __m256 s7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+
+    r[0] = _mm256_permute2f128_ps(s0, s4, 0x20);
+    r[1] = _mm256_permute2f128_ps(s1, s5, 0x20);
+    r[2] = _mm256_permute2f128_ps(s2, s6, 0x20);
+    r[3] = _mm256_permute2f128_ps(s3, s7, 0x20);
+    r[4] = _mm256_permute2f128_ps(s0, s4, 0x31);
+    r[5] = _mm256_permute2f128_ps(s1, s5, 0x31);
+    r[6] = _mm256_permute2f128_ps(s2, s6, 0x31);
+    r[7] = _mm256_permute2f128_ps(s3, s7, 0x31);
+}
+
+TARGET_AVX2 static inline void Load8(const void* src, __m256 (&r)[8]) {
+    const float* f = rcast<const float*>(src);
+    for (size_t i = 0; i < 8; ++i) {
+        r[i] = _mm256_loadu_ps(f + i * 8);
+    }
+    Transpose8x8(r);
+}
+
+TARGET_AVX2 static inline void Store8(__m256 (&r)[8], void* dst) {
+    Transpose8x8(r);
+    float* f = rcast<float*>(dst);
+    for (size_t i = 0; i < 8; ++i) {
+        _mm256_storeu_ps(f + i * 8, r[i]);
+    }
+}
+
+template <int shift>
+TARGET_AVX2 static inline __m256 ByteToFloat(const __m256i v) {
+    return _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(v, shift), _mm256_set1_epi32(0xFF)));
+}
+
+TARGET_AVX2 static inline __m256 LowInt16ToFloat(const __m256i v) {
+    return _mm256_cvtepi32_ps(_mm256_srai_epi32(_mm256_slli_epi32(v, 16), 16));
+}
+
+TARGET_AVX2 static inline __m256 HighInt16ToFloat(const __m256i v) {
+    return _mm256_cvtepi32_ps(_mm256_srai_epi32(v, 16));
+}
+
+// DecodeNormal: xyz = (b / 255) * 2 - 1, w = a / 255
+TARGET_AVX2 static inline void DecodeNormals8(const __m256 packed, MetroVertexStreams& dst, const size_t i) {
+    const __m256i n = _mm256_castps_si256(packed);
+    const __m256 kDiv255 = _mm256_set1_ps(1.0f / 255.0f);
+    const __m256 kTwo = _mm256_set1_ps(2.0f);
+    const __m256 kOne = _mm256_set1_ps(1.0f);
+
+    _mm256_storeu_ps(dst.nx.data() + i, _mm256_sub_ps(_mm256_mul_ps(_mm256_mul_ps(ByteToFloat<16>(n), kDiv255), kTwo), kOne));
+    _mm256_storeu_ps(dst.ny.data() + i, _mm256_sub_ps(_mm256_mul_ps(_mm256_mul_ps(ByteToFloat<8>(n), kDiv255), kTwo), kOne));
+    _mm256_storeu_ps(dst.nz.data() + i, _mm256_sub_ps(_mm256_mul_ps(_mm256_mul_ps(ByteToFloat<0>(n), kDiv255), kTwo), kOne));
+    _mm256_storeu_ps(dst.ao.data() + i, _mm256_mul_ps(ByteToFloat<24>(n), kDiv255));
+}
+
+// DecodeTangent: xyzw = b / 127.5 - 1, bitangent is a normal without vao
+TARGET_AVX2 static inline void DecodeTangents8(const __m256 packedT, const __m256 packedB, MetroVertexStreams& dst, const size_t i) {
+    const __m256i t = _mm256_castps_si256(packedT);
+    const __m256i b = _mm256_castps_si256(packedB);
+    const __m256 kDiv = _mm256_set1_ps(1.0f / 127.5f);
+    const __m256 kDiv255 = _mm256_set1_ps(1.0f / 255.0f);
+    const __m256 kTwo = _mm256_set1_ps(2.0f);
+    const __m256 kOne = _mm256_set1_ps(1.0f);
+
+    _mm256_storeu_ps(dst.tx.data() + i, _mm256_sub_ps(_mm256_mul_ps(ByteToFloat<16>(t), kDiv), kOne));
+    _mm256_storeu_ps(dst.ty.data() + i, _mm256_sub_ps(_mm256_mul_ps(ByteToFloat<8>(t), kDiv), kOne));
+    _mm256_storeu_ps(dst.tz.data() + i, _mm256_sub_ps(_mm256_mul_ps(ByteToFloat<0>(t), kDiv), kOne));
+    _mm256_storeu_ps(dst.tw.data() + i, _mm256_sub_ps(_mm256_mul_ps(ByteToFloat<24>(t), kDiv), kOne));
+
+    _mm256_storeu_ps(dst.bx.data() + i, _mm256_sub_ps(_mm256_mul_ps(_mm256_mul_ps(ByteToFloat<16>(b), kDiv255), kTwo), kOne));
+    _mm256_storeu_ps(dst.by.data() + i, _mm256_sub_ps(_mm256_mul_ps(_mm256_mul_ps(ByteToFloat<8>(b), kDiv255), kTwo), kOne));
+    _mm256_storeu_ps(dst.bz.data() + i, _mm256_sub_ps(_mm256_mul_ps(_mm256_mul_ps(ByteToFloat<0>(b), kDiv255), kTwo), kOne));
+}
+
+TARGET_AVX2 static inline __m256i QuantizeUNorm8(const __m256 v) {
+    const __m256 k255 = _mm256_set1_ps(255.0f);
+    return _mm256_cvttps_epi32(_mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(v, k255), _mm256_setzero_ps()), k255));
+}
+
+// EncodeNormal: clamp((xyz * 0.5 + 0.5) * 255), clamp(w * 255), truncated
+TARGET_AVX2 static inline __m256 EncodeNormals8(const __m256 x, const __m256 y, const __m256 z, const __m256 w) {
+    const __m256 kHalf = _mm256_set1_ps(0.5f);
+
+    const __m256i ux = QuantizeUNorm8(_mm256_add_ps(_mm256_mul_ps(x, kHalf), kHalf));
+    const __m256i uy = QuantizeUNorm8(_mm256_add_ps(_mm256_mul_ps(y, kHalf), kHalf));
+    const __m256i uz = QuantizeUNorm8(_mm256_add_ps(_mm256_mul_ps(z, kHalf), kHalf));
+    const __m256i uw = QuantizeUNorm8(w);
+
+    const __m256i result = _mm256_or_si256(_mm256_or_si256(_mm256_slli_epi32(uw, 24), _mm256_slli_epi32(ux, 16)),
+                                           _mm256_or_si256(_mm256_slli_epi32(uy, 8), uz));
+    return _mm256_castsi256_ps(result);
+}
+
+// two truncated int16 into one dword, a in the low half
+TARGET_AVX2 static inline __m256 PackInt16x2(const __m256 a, const __m256 b) {
+    const __m256i lo = _mm256_and_si256(_mm256_cvttps_epi32(a), _mm256_set1_epi32(0xFFFF));
+    const __m256i hi = _mm256_slli_epi32(_mm256_cvttps_epi32(b), 16);
+    return _mm256_castsi256_ps(_mm256_or_si256(lo, hi));
+}
+
+TARGET_AVX2 static void DecodeStaticAVX2(const VertexStatic* src, const size_t count, MetroVertexStreams& dst) {
+    for (size_t i = 0; i < count; i += 8) {
+        __m256 r[8];
+        Load8(src + i, r);
+
+        _mm256_storeu_ps(dst.px.data() + i, r[0]);
+        _mm256_storeu_ps(dst.py.data() + i, r[1]);
+        _mm256_storeu_ps(dst.pz.data() + i, r[2]);
+        DecodeNormals8(r[3], dst, i);
+        DecodeTangents8(r[4], r[5], dst, i);
+        _mm256_storeu_ps(dst.u0.data() + i, r[6]);
+        _mm256_storeu_ps(dst.v0.data() + i, r[7]);
+    }
+}
+
+TARGET_AVX2 static void DecodeSkinnedAVX2(const VertexSkinned* src, const size_t count, const float posScale, MetroVertexStreams& dst) {
+    const __m256 kPosDequant = _mm256_set1_ps(kSkinnedPosDequant);
+    const __m256 kPosScale = _mm256_set1_ps(posScale);
+    const __m256 kUVDequant = _mm256_set1_ps(kSkinnedUVDequant);
+
+    for (size_t i = 0; i < count; i += 8) {
+        __m256 r[8];
+        Load8(src + i, r);
+
+        const __m256i pos01 = _mm256_castps_si256(r[0]);
+        const __m256i pos23 = _mm256_castps_si256(r[1]);
+        _mm256_storeu_ps(dst.px.data() + i, _mm256_mul_ps(_mm256_mul_ps(LowInt16ToFloat(pos01), kPosDequant), kPosScale));
+        _mm256_storeu_ps(dst.py.data() + i, _mm256_mul_ps(_mm256_mul_ps(HighInt16ToFloat(pos01), kPosDequant), kPosScale));
+        _mm256_storeu_ps(dst.pz.data() + i, _mm256_mul_ps(_mm256_mul_ps(LowInt16ToFloat(pos23), kPosDequant), kPosScale));
+        DecodeNormals8(r[2], dst, i);
+        DecodeTangents8(r[3], r[4], dst, i);
+        _mm256_storeu_si256(rcast<__m256i*>(dst.bones.data() + i), _mm256_castps_si256(r[5]));
+        _mm256_storeu_si256(rcast<__m256i*>(dst.weights.data() + i), _mm256_castps_si256(r[6]));
+
+        const __m256i uv = _mm256_castps_si256(r[7]);
+        _mm256_storeu_ps(dst.u0.data() + i, _mm256_mul_ps(LowInt16ToFloat(uv), kUVDequant));
+        _mm256_storeu_ps(dst.v0.data() + i, _mm256_mul_ps(HighInt16ToFloat(uv), kUVDequant));
+    }
+}
+
+TARGET_AVX2 static void DecodeLevelAVX2(const VertexLevel* src, const size_t count, MetroVertexStreams& dst) {
+    const __m256 kUV0Dequant = _mm256_set1_ps(kLevelUV0Dequant);
+    const __m256 kUV1Dequant = _mm256_set1_ps(kLevelUV1Dequant);
+
+    for (size_t i = 0; i < count; i += 8) {
+        __m256 r[8];
+        Load8(src + i, r);
+
+        _mm256_storeu_ps(dst.px.data() + i, r[0]);
+        _mm256_storeu_ps(dst.py.data() + i, r[1]);
+        _mm256_storeu_ps(dst.pz.data() + i, r[2]);
+        DecodeNormals8(r[3], dst, i);
+        DecodeTangents8(r[4], r[5], dst, i);
+
+        const __m256i uv0 = _mm256_castps_si256(r[6]);
+        const __m256i uv1 = _mm256_castps_si256(r[7]);
+        _mm256_storeu_ps(dst.u0.data() + i, _mm256_mul_ps(LowInt16ToFloat(uv0), kUV0Dequant));
+        _mm256_storeu_ps(dst.v0.data() + i, _mm256_mul_ps(HighInt16ToFloat(uv0), kUV0Dequant));
+        _mm256_storeu_ps(dst.u1.data() + i, _mm256_mul_ps(LowInt16ToFloat(uv1), kUV1Dequant));
+        _mm256_storeu_ps(dst.v1.data() + i, _mm256_mul_ps(HighInt16ToFloat(uv1), kUV1Dequant));
+    }
+}
+
+TARGET_AVX2 static void EncodeStaticAVX2(const MetroVertexStreams& src, const size_t count, VertexStatic* dst) {
+    const __m256 kHalf = _mm256_set1_ps(0.5f);
+    const __m256 kOne = _mm256_set1_ps(1.0f);
+
+    for (size_t i = 0; i < count; i += 8) {
+        __m256 r[8];
+        r[0] = _mm256_loadu_ps(src.px.data() + i);
+        r[1] = _mm256_loadu_ps(src.py.data() + i);
+        r[2] = _mm256_loadu_ps(src.pz.data() + i);
+        r[3] = EncodeNormals8(_mm256_loadu_ps(src.nx.data() + i), _mm256_loadu_ps(src.ny.data() + i), _mm256_loadu_ps(src.nz.data() + i), _mm256_loadu_ps(src.ao.data() + i));
+        r[4] = EncodeNormals8(_mm256_loadu_ps(src.tx.data() + i), _mm256_loadu_ps(src.ty.data() + i), _mm256_loadu_ps(src.tz.data() + i),
+                              _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(src.tw.data() + i), kHalf), kHalf));
+        r[5] = EncodeNormals8(_mm256_loadu_ps(src.bx.data() + i), _mm256_loadu_ps(src.by.data() + i), _mm256_loadu_ps(src.bz.data() + i), kOne);
+        r[6] = _mm256_loadu_ps(src.u0.data() + i);
+        r[7] = _mm256_loadu_ps(src.v0.data() + i);
+
+        Store8(r, dst + i);
+    }
+}
+
+TARGET_AVX2 static void EncodeSkinnedAVX2(const MetroVertexStreams& src, const size_t count, const float invPosScale, VertexSkinned* dst) {
+    const __m256 kPosQuant = _mm256_set1_ps(kSkinnedPosQuant);
+    const __m256 kInvPosScale = _mm256_set1_ps(invPosScale);
+    const __m256 kUVQuant = _mm256_set1_ps(kSkinnedUVQuant);
+    const __m256 kHalf = _mm256_set1_ps(0.5f);
+    const __m256 kOne = _mm256_set1_ps(1.0f);
+
+    for (size_t i = 0; i < count; i += 8) {
+        const __m256 x = _mm256_mul_ps(_mm256_mul_ps(_mm256_loadu_ps(src.px.data() + i), kInvPosScale), kPosQuant);
+        const __m256 y = _mm256_mul_ps(_mm256_mul_ps(_mm256_loadu_ps(src.py.data() + i), kInvPosScale), kPosQuant);
+        const __m256 z = _mm256_mul_ps(_mm256_mul_ps(_mm256_loadu_ps(src.pz.data() + i), kInvPosScale), kPosQuant);
+
+        __m256 r[8];
+        r[0] = PackInt16x2(x, y);
+        r[1] = PackInt16x2(z, kOne);    // pos[3] is always 1
+        r[2] = EncodeNormals8(_mm256_loadu_ps(src.nx.data() + i), _mm256_loadu_ps(src.ny.data() + i), _mm256_loadu_ps(src.nz.data() + i), _mm256_loadu_ps(src.ao.data() + i));
+        r[3] = EncodeNormals8(_mm256_loadu_ps(src.tx.data() + i), _mm256_loadu_ps(src.ty.data() + i), _mm256_loadu_ps(src.tz.data() + i),
+                              _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(src.tw.data() + i), kHalf), kHalf));
+        r[4] = EncodeNormals8(_mm256_loadu_ps(src.bx.data() + i), _mm256_loadu_ps(src.by.data() + i), _mm256_loadu_ps(src.bz.data() + i), kOne);
+        r[5] = _mm256_castsi256_ps(_mm256_loadu_si256(rcast<const __m256i*>(src.bones.data() + i)));
+        r[6] = _mm256_castsi256_ps(_mm256_loadu_si256(rcast<const __m256i*>(src.weights.data() + i)));
+        r[7] = PackInt16x2(_mm256_mul_ps(_mm256_loadu_ps(src.u0.data() + i), kUVQuant), _mm256_mul_ps(_mm256_loadu_ps(src.v0.data() + i), kUVQuant));
+
+        Store8(r, dst + i);
+    }
+}
+
+static size_t GetSIMDCount(const size_t count) {
+    return UseAVX2() ? (count & ~scast<size_t>(7)) : 0;
+}
+
+static void FillMetroVertex(const MetroVertexStreams& s, const size_t i, MetroVertex& v) {
+    v = {};
+    v.pos = vec3(s.px[i], s.py[i], s.pz[i]);
+    v.normal = vec4(s.nx[i], s.ny[i], s.nz[i], s.ao[i]);
+    v.tangent = vec4(s.tx[i], s.ty[i], s.tz[i], s.tw[i]);
+    v.uv0 = vec2(s.u0[i], s.v0[i]);
+}
+
+} // namespace
+
+
+void MetroVertexStreams::Resize(const size_t numVertices, const uint32_t components) {
+    count = numVertices;
+
+    for (MyArray<float>* arr : { &px, &py, &pz, &nx, &ny, &nz, &ao, &tx, &ty, &tz, &tw, &bx, &by, &bz, &u0, &v0 }) {
+        arr->resize(numVertices);
+    }
+
+    const size_t uv1Count = TestBit<uint32_t>(components, UV1) ? numVertices : 0;
+    u1.resize(uv1Count);
+    v1.resize(uv1Count);
+
+    const size_t skinCount = TestBit<uint32_t>(components, Skin) ? numVertices : 0;
+    bones.resize(skinCount);
+    weights.resize(skinCount);
+}
+
+
+void VTX_DecodeStatic(const VertexStatic* src, const size_t count, MetroVertexStreams& dst) {
+    dst.Resize(count, MetroVertexStreams::Base);
+
+    const size_t simdCount = GetSIMDCount(count);
+    if (simdCount) {
+        DecodeStaticAVX2(src, simdCount, dst);
+    }
+    for (size_t i = simdCount; i < count; ++i) {
+        DecodeStaticScalar(src[i], dst, i);
+    }
+}
+
+void VTX_DecodeSkinned(const VertexSkinned* src, const size_t count, const float posScale, MetroVertexStreams& dst) {
+    dst.Resize(count, MetroVertexStreams::Skin);
+
+    const size_t simdCount = GetSIMDCount(count);
+    if (simdCount) {
+        DecodeSkinnedAVX2(src, simdCount, posScale, dst);
+    }
+    for (size_t i = simdCount; i < count; ++i) {
+        DecodeSkinnedScalar(src[i], posScale, dst, i);
+    }
+}
+
+void VTX_DecodeLevel(const VertexLevel* src, const size_t count, MetroVertexStreams& dst) {
+    dst.Resize(count, MetroVertexStreams::UV1);
+
+    const size_t simdCount = GetSIMDCount(count);
+    if (simdCount) {
+        DecodeLevelAVX2(src, simdCount, dst);
+    }
+    for (size_t i = simdCount; i < count; ++i) {
+        DecodeLevelScalar(src[i], dst, i);
+    }
+}
+
+void VTX_EncodeStatic(const MetroVertexStreams& src, VertexStatic* dst) {
+    const size_t simdCount = GetSIMDCount(src.count);
+    if (simdCount) {
+        EncodeStaticAVX2(src, simdCount, dst);
+    }
+    for (size_t i = simdCount; i < src.count; ++i) {
+        EncodeStaticScalar(src, i, dst[i]);
+    }
+}
+
+void VTX_EncodeSkinned(const MetroVertexStreams& src, const float posScale, VertexSkinned* dst) {
+    assert(src.bones.size() == src.count && src.weights.size() == src.count);
+
+    const float invPosScale = 1.0f / posScale;
+
+    const size_t simdCount = GetSIMDCount(src.count);
+    if (simdCount) {
+        EncodeSkinnedAVX2(src, simdCount, invPosScale, dst);
+    }
+    for (size_t i = simdCount; i < src.count; ++i) {
+        EncodeSkinnedScalar(src, i, invPosScale, dst[i]);
+    }
+}
+
+void VTX_ConvertVertices(const VertexStatic* src, const size_t count, MetroVertex* dst) {
+    MetroVertexStreams block;
+    for (size_t first = 0; first < count; first += kConvertBlockSize) {
+        const size_t num = std::min(kConvertBlockSize, count - first);
+        VTX_DecodeStatic(src + first, num, block);
+
+        for (size_t i = 0; i < num; ++i) {
+            FillMetroVertex(block, i, dst[first + i]);
+        }
+    }
+}
+
+void VTX_ConvertVertices(const VertexSkinned* src, const size_t count, const float posScale, MetroVertex* dst) {
+    MetroVertexStreams block;
+    for (size_t first = 0; first < count; first += kConvertBlockSize) {
+        const size_t num = std::min(kConvertBlockSize, count - first);
+        VTX_DecodeSkinned(src + first, num, posScale, block);
+
+        for (size_t i = 0; i < num; ++i) {
+            MetroVertex& v = dst[first + i];
+            FillMetroVertex(block, i, v);
+            *rcast<uint32_t*>(v.bones) = block.bones[i];
+            MetroSwizzle(v.bones);
+            *rcast<uint32_t*>(v.weights) = block.weights[i];
+            MetroSwizzle(v.weights);
+        }
+    }
+}
+
+void VTX_ConvertVertices(const VertexLevel* src, const size_t count, MetroVertex* dst) {
+    MetroVertexStreams block;
+    for (size_t first = 0; first < count; first += kConvertBlockSize) {
+        const size_t num = std::min(kConvertBlockSize, count - first);
+        VTX_DecodeLevel(src + first, num, block);
+
+        for (size_t i = 0; i < num; ++i) {
+            MetroVertex& v = dst[first + i];
+            FillMetroVertex(block, i, v);
+            v.uv1 = vec2(block.u1[i], block.v1[i]);
+        }
+    }
+}
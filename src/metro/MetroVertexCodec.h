@@ -0,0 +1,41 @@
+#pragma once
+#include "MetroTypes.h"
+
+// Batch conversion between packed Metro vertices and SoA float streams.
+//  Works 8 vertices at a time with AVX2 (picked at runtime), the scalar tail/fallback gives bit-identical results
+//  to DecodeNormal/DecodeTangent/DecodeSkinnedPosition and ConvertVertex.
+
+struct MetroVertexStreams {
+    enum Components : uint32_t {
+        Base        = 0,    // pos, normal (+vao), tangent, bitangent, uv0
+        UV1         = 1,    // level vertices
+        Skin        = 2     // bones, weights
+    };
+
+    size_t              count = 0;
+    MyArray<float>      px, py, pz;
+    MyArray<float>      nx, ny, nz, ao;
+    MyArray<float>      tx, ty, tz, tw;
+    MyArray<float>      bx, by, bz;         // bitangent, stored in aux1
+    MyArray<float>      u0, v0;
+    MyArray<float>      u1, v1;
+    MyArray<uint32_t>   bones;              // 4 packed bytes in the file order (see MetroSwizzle), not remapped
+    MyArray<uint32_t>   weights;
+
+    void                Resize(const size_t numVertices, const uint32_t components);
+};
+
+// decoders, dst gets resized to count, skinned positions get multiplied by posScale
+void    VTX_DecodeStatic(const VertexStatic* src, const size_t count, MetroVertexStreams& dst);
+void    VTX_DecodeSkinned(const VertexSkinned* src, const size_t count, const float posScale, MetroVertexStreams& dst);
+void    VTX_DecodeLevel(const VertexLevel* src, const size_t count, MetroVertexStreams& dst);
+
+// encoders, dst must have room for src.count vertices
+//  tangent w is [-1, 1] (as decoded), skinned positions get divided by posScale and must end up in [-1, 1]
+void    VTX_EncodeStatic(const MetroVertexStreams& src, VertexStatic* dst);
+void    VTX_EncodeSkinned(const MetroVertexStreams& src, const float posScale, VertexSkinned* dst);
+
+// same as calling ConvertVertex for every vertex (plus pos scale for skinned), goes through the batch decoders
+void    VTX_ConvertVertices(const VertexStatic* src, const size_t count, MetroVertex* dst);
+void    VTX_ConvertVertices(const VertexSkinned* src, const size_t count, const float posScale, MetroVertex* dst);
+void    VTX_ConvertVertices(const VertexLevel* src, const size_t count, MetroVertex* dst);
@@ -97,8 +97,11 @@ struct MetroTextureInfo {
 
 
 class MetroTexturesDBImplExodus final : public MetroTexturesDBImpl {
+    using IndexRecord = MetroTexturesCompactIndex::Record;
+
 public:
-    MetroTexturesDBImplExodus() {
+    MetroTexturesDBImplExodus(const fs::path& indexCacheFolder)
+        : mIndexCacheFolder(indexCacheFolder) {
     }
     virtual ~MetroTexturesDBImplExodus() {
     }
@@ -109,14 +112,21 @@ public:
         const MetroFileSystem& mfs = MetroContext::Get().GetFilesystem();
 
         MemStream stream = binPath.empty() ? mfs.OpenFileFromPath(R"(content\textures_handles_storage.bin)") : OSReadFile(binPath);
+        MemStream aliasesStream = mfs.OpenFileFromPath(R"(content\scripts\texture_aliases.bin)");
         if (stream) {
-            result = this->LoadHandles(stream);
-        }
+            //#NOTE: the compiled index is tied to the exact bytes it was built from, any change to the sources rebuilds it
+            uint32_t sourceHash = Hash_CalculateXX(stream.Data(), stream.Length());
+            if (aliasesStream) {
+                sourceHash ^= Hash_CalculateXX(aliasesStream.Data(), aliasesStream.Length()) * 0x9E3779B1u;
+            }
 
-        if (result) {
-            stream = mfs.OpenFileFromPath(R"(content\scripts\texture_aliases.bin)");
-            if (stream) {
-                result = this->LoadAliases(stream);
+            const fs::path indexPath = mIndexCacheFolder.empty() ? fs::path() : (mIndexCacheFolder / L"textures_handles_storage.mtix");
+            if (!indexPath.empty() && OSPathIsFile(indexPath)) {
+                result = mIndex.Load(OSMapFile(indexPath), sourceHash);
+            }
+
+            if (!result) {
+                result = this->BuildIndex(stream, aliasesStream, sourceHash, indexPath);
             }
         }
 
@@ -124,40 +134,34 @@ public:
     }
 
     virtual const CharString& GetSourceName(const HashString& name) const override {
-        const HashString& alias = this->GetAlias(name);
-
-        const MetroTextureInfo* mti = this->GetInfoByName(alias.Valid() ? alias : name);
-        return (mti == nullptr) ? kEmptyString : mti->source_name;
+        const IndexRecord* rec = this->GetRecordByHash(this->ResolveAlias(name.hash));
+        return (rec == nullptr) ? kEmptyString : mIndex.GetString(rec->source_name);
     }
 
     virtual const CharString& GetBumpName(const HashString& name) const override {
-        const CharString& realName = this->GetSourceName(name);
-        const MetroTextureInfo* mti = this->GetInfoByName(realName);
-        return mti ? mti->bump_name : kEmptyString;
+        const IndexRecord* rec = this->GetRecordBySourceName(name);
+        return rec ? mIndex.GetString(rec->bump_name) : kEmptyString;
     }
 
     virtual const CharString& GetDetName(const HashString& name) const override {
-        const CharString& realName = this->GetSourceName(name);
-        const MetroTextureInfo* mti = this->GetInfoByName(realName);
-        return mti ? mti->det_name : kEmptyString;
+        const IndexRecord* rec = this->GetRecordBySourceName(name);
+        return rec ? mIndex.GetString(rec->det_name) : kEmptyString;
     }
 
     virtual const CharString& GetAuxName(const HashString& name, const size_t) const override {
-        const CharString& realName = this->GetSourceName(name);
-        const MetroTextureInfo* mti = this->GetInfoByName(realName);
-        return mti ? mti->aux0_name : kEmptyString;
+        const IndexRecord* rec = this->GetRecordBySourceName(name);
+        return rec ? mIndex.GetString(rec->aux0_name) : kEmptyString;
     }
 
     virtual StringArray GetAllLevels(const HashString& name) const override {
         StringArray result;
 
-        const CharString& realName = this->GetSourceName(name);
-        const MetroTextureInfo* mti = this->GetInfoByName(realName);
-        if (mti) {
-            if (!mti->streamable) {
-                result.push_back(MetroFileSystem::Paths::TexturesFolder + this->GetNameWithExt(*mti));
+        const IndexRecord* rec = this->GetRecordBySourceName(name);
+        if (rec) {
+            if (!rec->streamable) {
+                result.push_back(this->GetPathWithExt(*rec));
             } else {
-                this->CollectAllLevelsWithExt(*mti, result);
+                this->CollectAllLevelsWithExt(*rec, result);
             }
         }
 
@@ -174,10 +178,10 @@ public:
             relativePath = relativePath.substr(0, dotPos);
         }
 
-        const MetroTextureInfo* mti = this->GetInfoByName(relativePath);
+        const IndexRecord* rec = this->GetRecordByHash(HashString(relativePath).hash);
 
-        if (mti != nullptr) {
-            return scast<MetroTextureType>(mti->type);
+        if (rec != nullptr) {
+            return scast<MetroTextureType>(rec->type);
         }
 
         return MetroTextureType::Invalid;
@@ -209,44 +213,23 @@ public:
     virtual MetroSurfaceDescription GetSurfaceSetFromName(const HashString& textureName, const bool allMips) const override {
         MetroSurfaceDescription result;
 
-        const CharString& realName = this->GetSourceName(textureName);
-        const MetroTextureInfo* mti = this->GetInfoByName(realName);
-        if (mti) {
-            result.albedo = mti->source_name;
-            if (!allMips || !mti->streamable) {
-                result.albedoPaths.push_back(MetroFileSystem::Paths::TexturesFolder + this->GetNameWithExt(*mti));
-            } else {
-                this->CollectAllLevelsWithExt(*mti, result.albedoPaths);
-            }
+        const IndexRecord* rec = this->GetRecordBySourceName(textureName);
+        if (rec) {
+            this->FillSurface(*rec, allMips, result.albedo, result.albedoPaths);
 
-            const MetroTextureInfo* mtiBump;
-            if (!mti->bump_name.empty() && (mtiBump = this->GetInfoByName(mti->bump_name), mtiBump != nullptr)) {
-                result.bump = mtiBump->source_name;
-                if (!allMips || !mtiBump->streamable) {
-                    result.bumpPaths.push_back(MetroFileSystem::Paths::TexturesFolder + this->GetNameWithExt(*mtiBump));
-                } else {
-                    this->CollectAllLevelsWithExt(*mtiBump, result.bumpPaths);
-                }
+            const IndexRecord* recBump = this->GetRecordByStringIdx(rec->bump_name);
+            if (recBump) {
+                this->FillSurface(*recBump, allMips, result.bump, result.bumpPaths);
 
-                const MetroTextureInfo* mtiNormalMap;
-                if (!mtiBump->bump_name.empty() && (mtiNormalMap = this->GetInfoByName(mtiBump->bump_name), mtiNormalMap != nullptr)) {
-                    result.normalmap = mtiNormalMap->source_name;
-                    if (!allMips || !mtiNormalMap->streamable) {
-                        result.normalmapPaths.push_back(MetroFileSystem::Paths::TexturesFolder + this->GetNameWithExt(*mtiNormalMap));
-                    } else {
-                        this->CollectAllLevelsWithExt(*mtiNormalMap, result.normalmapPaths);
-                    }
+                const IndexRecord* recNormalMap = this->GetRecordByStringIdx(recBump->bump_name);
+                if (recNormalMap) {
+                    this->FillSurface(*recNormalMap, allMips, result.normalmap, result.normalmapPaths);
                 }
             }
 
-            const MetroTextureInfo* mtiDetail;
-            if (!mti->det_name.empty() && (mtiDetail = this->GetInfoByName(mti->det_name), mtiDetail != nullptr)) {
-                result.detail = mtiDetail->source_name;
-                if (!allMips || !mtiDetail->streamable) {
-                    result.detailPaths.push_back(MetroFileSystem::Paths::TexturesFolder + this->GetNameWithExt(*mtiDetail));
-                } else {
-                    this->CollectAllLevelsWithExt(*mtiDetail, result.detailPaths);
-                }
+            const IndexRecord* recDetail = this->GetRecordByStringIdx(rec->det_name);
+            if (recDetail) {
+                this->FillSurface(*recDetail, allMips, result.detail, result.detailPaths);
             }
         }
 
@@ -254,7 +237,31 @@ public:
     }
 
 private:
-    bool LoadHandles(MemStream& stream) {
+    bool BuildIndex(MemStream& stream, MemStream& aliasesStream, const uint32_t sourceHash, const fs::path& indexPath) {
+        MyArray<MetroTexturesCompactIndex::SourceTexture> textures;
+        MyArray<MetroTexturesCompactIndex::SourceAlias> aliases;
+
+        bool result = this->LoadHandles(stream, textures);
+        if (result && aliasesStream) {
+            result = this->LoadAliases(aliasesStream, aliases);
+        }
+
+        if (result) {
+            mIndexBlob = MetroTexturesCompactIndex::Build(textures, aliases, sourceHash);
+
+            // try to save it for the next time and use the mapped copy, fall back to the one in memory
+            if (!indexPath.empty() && OSWriteFile(indexPath, mIndexBlob.data(), mIndexBlob.size()) == mIndexBlob.size() &&
+                mIndex.Load(OSMapFile(indexPath), sourceHash)) {
+                BytesArray().swap(mIndexBlob);
+            } else {
+                result = mIndex.Load(MemStream(mIndexBlob.data(), mIndexBlob.size()), sourceHash);
+            }
+        }
+
+        return result;
+    }
+
+    bool LoadHandles(MemStream& stream, MyArray<MetroTexturesCompactIndex::SourceTexture>& textures) {
         bool result = true;
 
         size_t numEntries = stream.ReadTyped<uint32_t>();
@@ -263,9 +270,9 @@ private:
             numEntries = stream.ReadTyped<uint32_t>();
         }
 
-        mPool.resize(numEntries);
-        mDatabase.reserve(numEntries);
+        textures.resize(numEntries);
 
+        MetroTextureInfo texInfo;
         for (size_t i = 0; i < numEntries; ++i) {
             const size_t idx = stream.ReadTyped<uint32_t>();
             const size_t size = stream.ReadTyped<uint32_t>();
@@ -277,12 +284,23 @@ private:
 
             MetroReflectionBinaryReadStream reader(subStream, flags);
 
-            MetroTextureInfo* texInfo = &mPool[i];
-            texInfo->name = name;
-            reader >> *texInfo;
-
-            HashString hashStr(texInfo->name);
-            mDatabase.insert({ hashStr, texInfo });
+            texInfo = MetroTextureInfo();
+            texInfo.name = name;
+            reader >> texInfo;
+
+            MetroTexturesCompactIndex::SourceTexture& dst = textures[i];
+            dst.name = texInfo.name;
+            dst.source_name = texInfo.source_name;
+            dst.bump_name = texInfo.bump_name;
+            dst.det_name = texInfo.det_name;
+            dst.aux0_name = texInfo.aux0_name;
+            dst.type = texInfo.type;
+            dst.format = texInfo.format;
+            dst.width = texInfo.width;
+            dst.height = texInfo.height;
+            dst.streamable = texInfo.streamable;
+            dst.animated = texInfo.animated;
+            dst.mipmapped = texInfo.mipmapped;
 
             stream.SkipBytes(size);
         }
@@ -290,7 +308,7 @@ private:
         return result;
     }
 
-    bool LoadAliases(MemStream& stream) {
+    bool LoadAliases(MemStream& stream, MyArray<MetroTexturesCompactIndex::SourceAlias>& aliases) {
         bool result = false;
 
         MetroBinArchive bin("texture_aliases.bin", stream, MetroBinArchive::kHeaderDoAutoSearch);
@@ -300,9 +318,9 @@ private:
         METRO_SERIALIZE_STRUCT_ARRAY_MEMBER(*reader, texture_aliases);
 
         if (!texture_aliases.empty()) {
-            mAliases.reserve(texture_aliases.size());
+            aliases.reserve(texture_aliases.size());
             for (const auto& alias : texture_aliases) {
-                mAliases.insert({ HashString(alias.src), HashString(alias.dst) });
+                aliases.push_back({ alias.src, alias.dst });
             }
 
             result = true;
@@ -311,42 +329,60 @@ private:
         return result;
     }
 
-    const HashString& GetAlias(const HashString& name) const {
-        static HashString emptyString;
+    uint32_t ResolveAlias(const uint32_t nameHash) const {
+        const uint32_t aliasHash = mIndex.FindAlias(nameHash);
+        return (aliasHash != 0u) ? aliasHash : nameHash;
+    }
 
-        auto it = mAliases.find(name);
-        if (it == mAliases.end()) {
-            return emptyString;
-        }
+    const IndexRecord* GetRecordByHash(const uint32_t nameHash) const {
+        return mIndex.FindRecord(nameHash);
+    }
 
-        return it->second;
+    const IndexRecord* GetRecordByStringIdx(const uint32_t strIdx) const {
+        const StringView name = mIndex.GetStringView(strIdx);
+        return name.empty() ? nullptr : this->GetRecordByHash(Hash_CalculateXX(name));
     }
 
-    const MetroTextureInfo* GetInfoByName(const HashString& name) const {
-        const auto it = mDatabase.find(name);
-        if (it == mDatabase.end()) {
-            return nullptr;
+    // name -> alias -> source name -> record, same chain the game uses
+    const IndexRecord* GetRecordBySourceName(const HashString& name) const {
+        const IndexRecord* rec = this->GetRecordByHash(this->ResolveAlias(name.hash));
+        return rec ? this->GetRecordByStringIdx(rec->source_name) : nullptr;
+    }
+
+    void FillSurface(const IndexRecord& rec, const bool allMips, CharString& name, StringArray& paths) const {
+        name = CharString(mIndex.GetStringView(rec.source_name));
+        if (!allMips || !rec.streamable) {
+            paths.push_back(this->GetPathWithExt(rec));
         } else {
-            return it->second;
+            this->CollectAllLevelsWithExt(rec, paths);
         }
     }
 
-    CharString GetNameWithExt(const MetroTextureInfo& mti) const {
-        return mti.source_name + ((mti.streamable) ? (CharString(".") + std::to_string(mti.width)) : ".dds");
+    CharString GetPathWithExt(const IndexRecord& rec) const {
+        CharString result = MetroFileSystem::Paths::TexturesFolder;
+        result.append(mIndex.GetStringView(rec.source_name));
+        result.append((rec.streamable) ? (CharString(".") + std::to_string(rec.width)) : ".dds");
+        return result;
     }
 
-    void CollectAllLevelsWithExt(const MetroTextureInfo& mti, StringArray& dest) const {
-        size_t width = mti.width;
+    void CollectAllLevelsWithExt(const IndexRecord& rec, StringArray& dest) const {
+        const StringView sourceName = mIndex.GetStringView(rec.source_name);
+
+        size_t width = rec.width;
         while (width >= 512) {
-            dest.push_back(MetroFileSystem::Paths::TexturesFolder + mti.source_name + '.' + std::to_string(width));
+            CharString path = MetroFileSystem::Paths::TexturesFolder;
+            path.append(sourceName);
+            path.push_back('.');
+            path.append(std::to_string(width));
+            dest.emplace_back(std::move(path));
             width >>= 1;
         }
     }
 
 private:
-    MyArray<MetroTextureInfo>             mPool;
-    MyDict<HashString, MetroTextureInfo*> mDatabase;
-    MyDict<HashString, HashString>        mAliases;
+    fs::path                    mIndexCacheFolder;
+    BytesArray                  mIndexBlob;     // only when the index couldn't be written and mapped
+    MetroTexturesCompactIndex   mIndex;
 };
 
 } // namespace ExodusImpl
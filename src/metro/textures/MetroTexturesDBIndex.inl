@@ -0,0 +1,274 @@
+// Compiled, read-only form of a textures database
+//  Built once from the game bin, then used straight from the (mapped) file without any parsing.
+//  Layout: Header | Record[numRecords] | HashEntry[numNames] | HashEntry[numAliases] |
+//          uint32_t stringOffsets[numStrings] | zero-terminated string chars
+//  Hash tables are sorted by hash and searched with a binary search, hashes are the same
+//  xxhash HashString uses, so lookups by HashString don't have to hash anything.
+//  String #0 is always the empty string.
+
+class MetroTexturesCompactIndex {
+public:
+    static const uint32_t kMagic = MakeFourcc<'M', 'T', 'I', 'X'>();
+    static const uint32_t kVersion = 1;
+
+    struct Header {
+        uint32_t    magic;
+        uint32_t    version;
+        uint32_t    sourceHash;
+        uint32_t    numRecords;
+        uint32_t    numNames;
+        uint32_t    numAliases;
+        uint32_t    numStrings;
+        uint32_t    charsSize;
+        uint32_t    recordsOffset;
+        uint32_t    namesOffset;
+        uint32_t    aliasesOffset;
+        uint32_t    stringsOffset;
+        uint32_t    charsOffset;
+    };
+
+    struct Record {
+        uint32_t    name;           // string indices
+        uint32_t    source_name;
+        uint32_t    bump_name;
+        uint32_t    det_name;
+        uint32_t    aux0_name;
+        uint32_t    type;
+        uint32_t    format;
+        uint32_t    width;
+        uint32_t    height;
+        uint8_t     streamable;
+        uint8_t     animated;
+        uint8_t     mipmapped;
+        uint8_t     _pad;
+    };
+
+    struct HashEntry {
+        uint32_t    hash;
+        uint32_t    value;          // record index for names, target name hash for aliases
+    };
+
+    // build-time description of a single texture
+    struct SourceTexture {
+        CharString  name;
+        CharString  source_name;
+        CharString  bump_name;
+        CharString  det_name;
+        CharString  aux0_name;
+        uint32_t    type;
+        uint32_t    format;
+        uint32_t    width;
+        uint32_t    height;
+        bool        streamable;
+        bool        animated;
+        bool        mipmapped;
+    };
+
+    using SourceAlias = std::pair<CharString, CharString>;
+
+public:
+    MetroTexturesCompactIndex()
+        : mHeader(nullptr)
+        , mRecords(nullptr)
+        , mNames(nullptr)
+        , mAliases(nullptr)
+        , mStringOffsets(nullptr)
+        , mChars(nullptr) {
+    }
+
+    static BytesArray Build(const MyArray<SourceTexture>& textures, const MyArray<SourceAlias>& aliases, const uint32_t sourceHash) {
+        MyArray<uint32_t> stringOffsets;
+        BytesArray chars;
+        MyDict<CharString, uint32_t> stringsMap;
+
+        auto addString = [&stringOffsets, &chars, &stringsMap](const CharString& str) -> uint32_t {
+            auto it = stringsMap.find(str);
+            if (it != stringsMap.end()) {
+                return it->second;
+            }
+
+            const uint32_t idx = scast<uint32_t>(stringOffsets.size());
+            stringOffsets.push_back(scast<uint32_t>(chars.size()));
+            chars.insert(chars.end(), str.begin(), str.end());
+            chars.push_back(0);
+            stringsMap.insert({ str, idx });
+            return idx;
+        };
+
+        addString(kEmptyString);
+
+        MyArray<Record> records;
+        records.reserve(textures.size());
+        MyArray<HashEntry> names;
+        names.reserve(textures.size());
+
+        for (const SourceTexture& src : textures) {
+            Record rec = {};
+            rec.name = addString(src.name);
+            rec.source_name = addString(src.source_name);
+            rec.bump_name = addString(src.bump_name);
+            rec.det_name = addString(src.det_name);
+            rec.aux0_name = addString(src.aux0_name);
+            rec.type = src.type;
+            rec.format = src.format;
+            rec.width = src.width;
+            rec.height = src.height;
+            rec.streamable = src.streamable ? 1 : 0;
+            rec.animated = src.animated ? 1 : 0;
+            rec.mipmapped = src.mipmapped ? 1 : 0;
+
+            names.push_back({ HashString(src.name).hash, scast<uint32_t>(records.size()) });
+            records.push_back(rec);
+        }
+
+        MyArray<HashEntry> aliasEntries;
+        aliasEntries.reserve(aliases.size());
+        for (const SourceAlias& alias : aliases) {
+            aliasEntries.push_back({ HashString(alias.first).hash, HashString(alias.second).hash });
+        }
+
+        // stable sort + unique keeps the first entry for every hash, same as MyDict::insert would
+        auto sortAndDedup = [](MyArray<HashEntry>& table) {
+            std::stable_sort(table.begin(), table.end(), [](const HashEntry& a, const HashEntry& b) { return a.hash < b.hash; });
+            table.erase(std::unique(table.begin(), table.end(), [](const HashEntry& a, const HashEntry& b) { return a.hash == b.hash; }), table.end());
+        };
+        sortAndDedup(names);
+        sortAndDedup(aliasEntries);
+
+        Header hdr = {};
+        hdr.magic = kMagic;
+        hdr.version = kVersion;
+        hdr.sourceHash = sourceHash;
+        hdr.numRecords = scast<uint32_t>(records.size());
+        hdr.numNames = scast<uint32_t>(names.size());
+        hdr.numAliases = scast<uint32_t>(aliasEntries.size());
+        hdr.numStrings = scast<uint32_t>(stringOffsets.size());
+        hdr.charsSize = scast<uint32_t>(chars.size());
+        hdr.recordsOffset = scast<uint32_t>(sizeof(Header));
+        hdr.namesOffset = hdr.recordsOffset + scast<uint32_t>(records.size() * sizeof(Record));
+        hdr.aliasesOffset = hdr.namesOffset + scast<uint32_t>(names.size() * sizeof(HashEntry));
+        hdr.stringsOffset = hdr.aliasesOffset + scast<uint32_t>(aliasEntries.size() * sizeof(HashEntry));
+        hdr.charsOffset = hdr.stringsOffset + scast<uint32_t>(stringOffsets.size() * sizeof(uint32_t));
+
+        BytesArray result(hdr.charsOffset + chars.size());
+        uint8_t* dst = result.data();
+        std::memcpy(dst, &hdr, sizeof(hdr));
+        std::memcpy(dst + hdr.recordsOffset, records.data(), records.size() * sizeof(Record));
+        std::memcpy(dst + hdr.namesOffset, names.data(), names.size() * sizeof(HashEntry));
+        std::memcpy(dst + hdr.aliasesOffset, aliasEntries.data(), aliasEntries.size() * sizeof(HashEntry));
+        std::memcpy(dst + hdr.stringsOffset, stringOffsets.data(), stringOffsets.size() * sizeof(uint32_t));
+        std::memcpy(dst + hdr.charsOffset, chars.data(), chars.size());
+
+        return std::move(result);
+    }
+
+    // stream may be a mapped file, it's kept alive for as long as the index lives
+    bool Load(const MemStream& stream, const uint32_t expectedSourceHash) {
+        this->Reset();
+
+        const size_t length = stream.Length();
+        if (!stream || length < sizeof(Header)) {
+            return false;
+        }
+
+        const uint8_t* base = stream.Data();
+        const Header* hdr = rcast<const Header*>(base);
+        if (hdr->magic != kMagic || hdr->version != kVersion || hdr->sourceHash != expectedSourceHash) {
+            return false;
+        }
+
+        const bool good = hdr->numStrings > 0 && hdr->charsSize > 0 &&
+                          hdr->recordsOffset == sizeof(Header) &&
+                          hdr->namesOffset == hdr->recordsOffset + hdr->numRecords * sizeof(Record) &&
+                          hdr->aliasesOffset == hdr->namesOffset + hdr->numNames * sizeof(HashEntry) &&
+                          hdr->stringsOffset == hdr->aliasesOffset + hdr->numAliases * sizeof(HashEntry) &&
+                          hdr->charsOffset == hdr->stringsOffset + hdr->numStrings * sizeof(uint32_t) &&
+                          scast<size_t>(hdr->charsOffset) + hdr->charsSize == length &&
+                          base[length - 1] == 0;
+        if (!good) {
+            return false;
+        }
+
+        mData = stream;
+        mHeader = hdr;
+        mRecords = rcast<const Record*>(base + hdr->recordsOffset);
+        mNames = rcast<const HashEntry*>(base + hdr->namesOffset);
+        mAliases = rcast<const HashEntry*>(base + hdr->aliasesOffset);
+        mStringOffsets = rcast<const uint32_t*>(base + hdr->stringsOffset);
+        mChars = rcast<const char*>(base + hdr->charsOffset);
+
+        mStringsCache.resize(hdr->numStrings);
+
+        return true;
+    }
+
+    void Reset() {
+        mData = MemStream();
+        mHeader = nullptr;
+        mRecords = nullptr;
+        mNames = nullptr;
+        mAliases = nullptr;
+        mStringOffsets = nullptr;
+        mChars = nullptr;
+        mStringsCache.clear();
+    }
+
+    bool Good() const {
+        return mHeader != nullptr;
+    }
+
+    size_t GetNumRecords() const {
+        return this->Good() ? mHeader->numRecords : 0;
+    }
+
+    const Record* FindRecord(const uint32_t hash) const {
+        const HashEntry* entry = this->Good() ? FindEntry(mNames, mHeader->numNames, hash) : nullptr;
+        return (entry && entry->value < mHeader->numRecords) ? &mRecords[entry->value] : nullptr;
+    }
+
+    // returns hash of the alias target, 0 if there's no alias
+    uint32_t FindAlias(const uint32_t hash) const {
+        const HashEntry* entry = this->Good() ? FindEntry(mAliases, mHeader->numAliases, hash) : nullptr;
+        return entry ? entry->value : 0u;
+    }
+
+    StringView GetStringView(const uint32_t idx) const {
+        if (!this->Good() || idx >= mHeader->numStrings || mStringOffsets[idx] >= mHeader->charsSize) {
+            return StringView();
+        }
+        return StringView(mChars + mStringOffsets[idx]);
+    }
+
+    // for the interfaces that hand out string references - strings are materialized on first request and live as long as the index
+    const CharString& GetString(const uint32_t idx) const {
+        if (idx == 0 || idx >= mStringsCache.size()) {
+            return kEmptyString;
+        }
+
+        std::lock_guard<std::mutex> lock(mStringsCacheLock);
+        CharString& cached = mStringsCache[idx];
+        if (cached.empty()) {
+            cached = CharString(this->GetStringView(idx));
+        }
+        return cached;
+    }
+
+private:
+    static const HashEntry* FindEntry(const HashEntry* table, const size_t count, const uint32_t hash) {
+        const HashEntry* end = table + count;
+        const HashEntry* it = std::lower_bound(table, end, hash, [](const HashEntry& e, const uint32_t h) { return e.hash < h; });
+        return (it != end && it->hash == hash) ? it : nullptr;
+    }
+
+private:
+    MemStream                   mData;
+    const Header*               mHeader;
+    const Record*               mRecords;
+    const HashEntry*            mNames;
+    const HashEntry*            mAliases;
+    const uint32_t*             mStringOffsets;
+    const char*                 mChars;
+
+    mutable MyArray<CharString> mStringsCache;
+    mutable std::mutex          mStringsCacheLock;
+};